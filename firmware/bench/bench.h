@@ -0,0 +1,63 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/**
+ * Timing helpers shared by the on-device benchmarks (the bench_*
+ * environments in platformio.ini build one of them in place of main.cpp)
+ */
+
+#include <Arduino.h>
+
+static const int BENCH_RUNS = 2000;
+
+struct BenchResult {
+    uint32_t minCycles;
+    uint32_t avgCycles;
+};
+
+/**
+ * Time fn(i) BENCH_RUNS times with the CPU cycle counter. prepare(i) runs
+ * before each call, untimed (e.g. to drain a queue the call fills).
+ * Interrupts stay enabled, so min is the clean figure and avg includes the
+ * odd WiFi/tick interrupt.
+ */
+template <typename F, typename P>
+static BenchResult measure(F&& fn, P&& prepare) {
+    BenchResult result = { UINT32_MAX, 0 };
+    uint64_t total = 0;
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        prepare(i);
+        uint32_t start = ESP.getCycleCount();
+        fn(i);
+        uint32_t cycles = ESP.getCycleCount() - start;
+        total += cycles;
+        result.minCycles = min(result.minCycles, cycles);
+    }
+    result.avgCycles = total / BENCH_RUNS;
+    return result;
+}
+
+template <typename F>
+static BenchResult measure(F&& fn) {
+    return measure(fn, [](int) {});
+}
+
+// Calls per second one core sustains at the average cost
+static float callsPerSecond(const BenchResult& result) {
+    return ESP.getCpuFreqMHz() * 1e6f / max(result.avgCycles, (uint32_t)1);
+}
+
+static void printHeader(const char* title) {
+    Serial.printf("\n%s - %s @ %lu MHz, %d runs\n", title, ESP.getChipModel(),
+                  (unsigned long)ESP.getCpuFreqMHz(), BENCH_RUNS);
+    Serial.printf("  %-30s %8s %8s %9s %10s\n", "kernel", "min cyc", "avg cyc", "avg us",
+                  "per s");
+}
+
+static void report(const char* name, const BenchResult& result) {
+    Serial.printf("  %-30s %8lu %8lu %9.2f %10.0f\n", name, (unsigned long)result.minCycles,
+                  (unsigned long)result.avgCycles,
+                  (float)result.avgCycles / ESP.getCpuFreqMHz(), callsPerSecond(result));
+}
+
+#endif // BENCH_H
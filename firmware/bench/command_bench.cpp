@@ -0,0 +1,151 @@
+/**
+ * Command path microbenchmark
+ *
+ * Replaces main.cpp (see the bench_commands_* environments in
+ * platformio.ini):
+ *
+ *   pio run -e bench_commands_esp32 -t upload -t monitor
+ *   pio run -e bench_commands_esp32s3 -t upload -t monitor
+ *
+ * Times, in cycles per call: the parser on typical commands (and a mix of
+ * them, whose "per s" column is commands parsed per second), queueing a
+ * move through the planner, moveToMultiple dispatch, and building and
+ * serializing the GET /api/status document.
+ *
+ * The move benchmarks enable the drivers and step J1-J4 back and forth by
+ * a few steps: run it with the arm clear, or with motor power off.
+ */
+
+#include <Arduino.h>
+#include "config.h"
+#include "motor_controller.h"
+#include "command_parser.h"
+#include "web_server.h"
+#include "telemetry.h"
+#include "json_arena.h"
+#include "bench.h"
+
+// Balanced so the relative moves cancel out
+static const char* const MIX[] = {
+    "G0 J1:20 J2:-20 J3:10",
+    "M114",
+    "G1 J4:5",
+    "?",
+    "G0 J1:0 J2:0 J3:0",
+    "M119",
+    "G1 J4:-5",
+    "?",
+};
+static const int MIX_COUNT = sizeof(MIX) / sizeof(MIX[0]);
+
+// J1-J4 move
+static const long OFFSET[MOTOR_COUNT] = { 20, -20, 10, 5 };
+static const long ORIGIN[MOTOR_COUNT] = { 0, 0, 0, 0 };
+static const uint8_t MOVED = 0x0F;
+
+// Results go here so the compiler cannot drop the work
+static volatile size_t sink;
+
+static JsonArena<WEB_JSON_ARENA_SIZE> arena;
+static char jsonBuffer[4096];
+
+// Keep room in the queue so every timed move is accepted
+static void keepQueueRoom(int) {
+    if (motors.getQueueFree() < 2) {
+        motors.clearQueue();
+    }
+}
+
+static BenchResult timeCommand(const char* command) {
+    return measure([&](int) {
+        CommandResult result = commandParser.execute(command);
+        sink = result.length;
+    }, keepQueueRoom);
+}
+
+static BenchResult timeAlternating(const char* even, const char* odd) {
+    return measure([&](int i) {
+        CommandResult result = commandParser.execute(i % 2 ? odd : even);
+        sink = result.length;
+    }, keepQueueRoom);
+}
+
+static void settle() {
+    motors.clearQueue();
+    motors.moveToMultiple(ORIGIN, MOVED);
+    while (motors.isAnyMoving()) {
+        motors.update();
+        delay(1);
+    }
+}
+
+static void runBenchmarks() {
+    printHeader("Command benchmark");
+    motors.setEnabled(true);
+    int rejected = 0;
+
+    report("parse ?", timeCommand("?"));
+    report("parse M114", timeCommand("M114"));
+    report("parse G0 (3 joints, queued)", timeAlternating(MIX[0], MIX[4]));
+    report("parse G1 (relative, queued)", timeAlternating(MIX[2], MIX[6]));
+    report("parse mix", measure([&](int i) {
+        CommandResult result = commandParser.execute(MIX[i % MIX_COUNT]);
+        sink = result.length;
+        if (!result.success) {
+            rejected++;
+        }
+    }, keepQueueRoom));
+    settle();
+
+    // Profile + push + look-ahead replan, averaged over queue depths
+    report("queueMove (plan)", measure([&](int i) {
+        if (!motors.queueMove(i % 2 ? ORIGIN : OFFSET, MOVED)) {
+            rejected++;
+        }
+    }, keepQueueRoom));
+    settle();
+
+    // Straight to the steppers, retargeting the running move
+    report("moveToMultiple", measure([&](int i) {
+        if (!motors.moveToMultiple(i % 2 ? ORIGIN : OFFSET, MOVED)) {
+            rejected++;
+        }
+    }));
+    report("moveToMultiple (coordinated)", measure([&](int i) {
+        if (!motors.moveToMultiple(i % 2 ? ORIGIN : OFFSET, MOVED, true)) {
+            rejected++;
+        }
+    }));
+    settle();
+    motors.setEnabled(false);
+
+    telemetry.capture();
+    report("buildStatusJson", measure([&](int) {
+        JsonDocument doc(&arena);
+        webServer.buildStatusJson(doc);
+        sink = doc.size();
+    }));
+    size_t length = 0;
+    report("buildStatusJson + serialize", measure([&](int) {
+        JsonDocument doc(&arena);
+        webServer.buildStatusJson(doc);
+        length = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+    }));
+    Serial.printf("  Status document: %u bytes\n", (unsigned)length);
+
+    if (rejected) {
+        Serial.printf("  %d commands/moves were rejected\n", rejected);
+    }
+}
+
+void setup() {
+    Serial.begin(SERIAL_BAUD_RATE);
+    delay(1000);
+    motors.begin();
+}
+
+void loop() {
+    // Repeated, so a monitor attached late still sees a report
+    runBenchmarks();
+    delay(10000);
+}
@@ -0,0 +1,137 @@
+/**
+ * Kinematics microbenchmark
+ *
+ * Replaces main.cpp (see the bench_* environments in platformio.ini):
+ *
+ *   pio run -e bench_esp32 -t upload -t monitor
+ *   pio run -e bench_esp32s3 -t upload -t monitor
+ *
+ * Times each kernel with the CPU cycle counter and prints cycles per call,
+ * for the sin/cos kernel, FK, IK (tracking a path, and from a cold seed)
+ * and one full Cartesian segment (path point + IK + steps). The last line
+ * is the highest segment rate the core could sustain, to compare against
+ * CARTESIAN_MAX_SPEED_MM_S / CARTESIAN_SEGMENT_MM.
+ */
+
+#include <Arduino.h>
+#include "config.h"
+#include "kinematics.h"
+#include "fast_trig.h"
+#include "bench.h"
+
+static const int MAX_WAYPOINTS = 128;
+
+// Results go here so the compiler cannot drop the work
+static volatile float sink;
+
+static void runBenchmarks() {
+    printHeader("Kinematics benchmark");
+
+    // Joint angles of the home pose, and a straight path from it
+    long home[MOTOR_COUNT] = {0};
+    float angles[KINEMATICS_JOINTS];
+    kinematics.stepsToAngles(home, angles);
+
+    Frame start;
+    kinematics.forward(angles, start);
+    Pose endPose;
+    Kinematics::frameToPose(start, endPose);
+    endPose.x += 100;
+    endPose.y -= 60;
+    endPose.z -= 80;
+    endPose.c += 30;
+    Frame end;
+    Kinematics::poseToFrame(endPose, end);
+
+    LinearPath path;
+    Kinematics::beginPath(start, end, path);
+    const int segments = min((int)ceilf(path.length / CARTESIAN_SEGMENT_MM), MAX_WAYPOINTS);
+
+    report("sinf + cosf (newlib)", measure([&](int i) {
+        float a = i * 0.001f;
+        sink = sinf(a) + cosf(a);
+    }));
+
+    report("FastTrig::sincos", measure([&](int i) {
+        float s, c;
+        FastTrig::sincos(i * 0.001f, s, c);
+        sink = s + c;
+    }));
+
+    report("forward (FK)", measure([&](int i) {
+        Frame tool;
+        angles[0] = i * 1e-4f;
+        kinematics.forward(angles, tool);
+        sink = tool.p[0];
+    }));
+    kinematics.stepsToAngles(home, angles);
+
+    // Waypoints along the path, each solved from the previous one - what
+    // the planner does for every segment
+    static Frame waypoints[MAX_WAYPOINTS];
+    for (int i = 0; i < segments; i++) {
+        Kinematics::pathPoint(path, (float)(i + 1) / segments, waypoints[i]);
+    }
+    float tracked[KINEMATICS_JOINTS];
+    memcpy(tracked, angles, sizeof(tracked));
+    int failures = 0;
+    report("inverse (IK), tracking", measure([&](int i) {
+        if (i % segments == 0) {
+            memcpy(tracked, angles, sizeof(tracked));
+        }
+        if (!kinematics.inverse(waypoints[i % segments], tracked, tracked)) {
+            failures++;
+        }
+    }));
+
+    // End pose straight from home - start() solves this once per move
+    report("inverse (IK), cold seed", measure([&](int) {
+        float solution[KINEMATICS_JOINTS];
+        if (!kinematics.inverse(end, angles, solution)) {
+            failures++;
+        }
+    }));
+
+    report("pathPoint", measure([&](int i) {
+        Frame point;
+        Kinematics::pathPoint(path, i * (1.0f / BENCH_RUNS), point);
+        sink = point.p[2];
+    }));
+
+    memcpy(tracked, angles, sizeof(tracked));
+    BenchResult segment = measure([&](int i) {
+        if (i % segments == 0) {
+            memcpy(tracked, angles, sizeof(tracked));
+        }
+        Frame point;
+        Kinematics::pathPoint(path, (float)(i % segments + 1) / segments, point);
+        if (!kinematics.inverse(point, tracked, tracked)) {
+            failures++;
+        }
+        long steps[MOTOR_COUNT];
+        kinematics.anglesToSteps(tracked, steps);
+        sink = steps[0];
+    });
+    report("segment (point + IK + steps)", segment);
+
+    if (failures) {
+        Serial.printf("  %d IK solves did not converge\n", failures);
+    }
+
+    float maxRate = callsPerSecond(segment);
+    float neededRate = CARTESIAN_MAX_SPEED_MM_S / CARTESIAN_SEGMENT_MM;
+    Serial.printf("  Max interpolation rate: %.0f segments/s (%.0f needed at %.0f mm/s, "
+                  "%.1f%% of one core)\n",
+                  maxRate, neededRate, CARTESIAN_MAX_SPEED_MM_S, 100 * neededRate / maxRate);
+}
+
+void setup() {
+    Serial.begin(SERIAL_BAUD_RATE);
+    delay(1000);
+}
+
+void loop() {
+    // Repeated, so a monitor attached late still sees a report
+    runBenchmarks();
+    delay(10000);
+}
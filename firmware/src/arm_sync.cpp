@@ -0,0 +1,352 @@
+#include "arm_sync.h"
+#include "motor_controller.h"
+#include "motion_task.h"
+
+// Global instance
+ArmSync armSync;
+
+static const char SYNC_MAGIC[4] = { 'R', 'B', 'S', 'Y' };
+static const uint8_t SYNC_VERSION = 1;
+
+// Spacing of the repeated START broadcasts
+static const uint32_t SYNC_START_REPEAT_MS = 5;
+
+ArmSync::ArmSync()
+    : _listening(false), _role(SyncRole::OFF), _group(SYNC_DEFAULT_GROUP),
+      _pulseMode(false), _error(""),
+      _sampleCount(0), _nextSample(0), _offsetUs(0), _jitterUs(0),
+      _beacons(0), _lastBeaconMs(0),
+      _startReceived(false), _receivedStartUs(0), _lastStartSeq(-1),
+      _state(SyncStartState::IDLE), _startUs(0), _timer(nullptr),
+      _pulseSeen(false), _pulseAtUs(0), _pulseHighUs(0), _starts(0), _lastErrorUs(0),
+      _lastBeaconSentMs(0), _lastStartSentMs(0), _seq(0), _startRepeats(0),
+      _broadcastStartUs(0) {
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    _lock = unlocked;
+}
+
+const char* ArmSync::roleName(SyncRole role) {
+    switch (role) {
+        case SyncRole::OFF: return "off";
+        case SyncRole::MASTER: return "master";
+        case SyncRole::FOLLOWER: return "follower";
+    }
+    return "unknown";
+}
+
+const char* ArmSync::startStateName(SyncStartState state) {
+    switch (state) {
+        case SyncStartState::IDLE: return "idle";
+        case SyncStartState::HELD: return "held";
+        case SyncStartState::ARMED: return "armed";
+    }
+    return "unknown";
+}
+
+bool ArmSync::setRole(SyncRole role, uint8_t group) {
+    if (role != SyncRole::OFF && !_listening) {
+        if (!_udp.listen(SYNC_UDP_PORT)) {
+            _error = "UDP listen failed - is WiFi connected?";
+            return false;
+        }
+        _udp.onPacket([this](AsyncUDPPacket& packet) { handlePacket(packet); });
+        _listening = true;
+    } else if (role == SyncRole::OFF && _listening) {
+        _udp.close();
+        _listening = false;
+    }
+
+    _role = role;
+    _group = group;
+    resetWindow();
+
+    // The pin direction follows the role
+    if (_pulseMode) {
+        setPulseMode(true);
+    }
+    DEBUG_PRINTF("Sync: %s, group %u\n", roleName(role), (unsigned)group);
+    return true;
+}
+
+bool ArmSync::setPulseMode(bool enabled) {
+    if (enabled && SYNC_PULSE_PIN < 0) {
+        _error = "No sync pulse pin - set SYNC_PULSE_PIN in config.h";
+        return false;
+    }
+
+    if (SYNC_PULSE_PIN >= 0) {
+        detachInterrupt(digitalPinToInterrupt(SYNC_PULSE_PIN));
+        if (enabled && _role == SyncRole::MASTER) {
+            pinMode(SYNC_PULSE_PIN, OUTPUT);
+            digitalWrite(SYNC_PULSE_PIN, LOW);
+        } else {
+            pinMode(SYNC_PULSE_PIN, INPUT_PULLDOWN);
+            if (enabled) {
+                attachInterruptArg(digitalPinToInterrupt(SYNC_PULSE_PIN), onPulse, this, RISING);
+            }
+        }
+    }
+    _pulseMode = enabled;
+    _pulseHighUs = 0;
+    return true;
+}
+
+void ArmSync::resetWindow() {
+    portENTER_CRITICAL(&_lock);
+    _sampleCount = 0;
+    _nextSample = 0;
+    _offsetUs = 0;
+    _jitterUs = 0;
+    portEXIT_CRITICAL(&_lock);
+    _beacons.store(0, std::memory_order_relaxed);
+}
+
+bool ArmSync::isLocked() const {
+    if (_role != SyncRole::FOLLOWER) {
+        return true;  // Own clock
+    }
+    return getBeaconCount() > 0 && getBeaconAgeMs() < SYNC_LOCK_TIMEOUT_MS;
+}
+
+int64_t ArmSync::getOffsetUs() const {
+    if (_role != SyncRole::FOLLOWER) {
+        return 0;
+    }
+    portENTER_CRITICAL(&_lock);
+    int64_t offset = _offsetUs;
+    portEXIT_CRITICAL(&_lock);
+    return offset;
+}
+
+int32_t ArmSync::getJitterUs() const {
+    portENTER_CRITICAL(&_lock);
+    int32_t jitter = _jitterUs;
+    portEXIT_CRITICAL(&_lock);
+    return jitter;
+}
+
+uint32_t ArmSync::getBeaconAgeMs() const {
+    return millis() - _lastBeaconMs.load(std::memory_order_relaxed);
+}
+
+void ArmSync::hold() {
+    motors.setStartHold(true);
+    if (_state == SyncStartState::IDLE) {
+        _state = SyncStartState::HELD;
+    }
+}
+
+bool ArmSync::scheduleStart(int64_t sharedUs) {
+    if (!isLocked()) {
+        _error = "Clock not synchronized - no beacons from the master";
+        return false;
+    }
+
+    int64_t lead = sharedUs - now();
+    if (lead <= 0) {
+        _error = "Start time has passed";
+        return false;
+    }
+
+    if (!_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = timerCallback;
+        args.arg = this;
+        args.name = "sync";
+        if (esp_timer_create(&args, &_timer) != ESP_OK) {
+            _timer = nullptr;
+            _error = "Could not create the start timer";
+            return false;
+        }
+    }
+
+    motors.setStartHold(true);
+    _startUs = sharedUs;
+    _state = SyncStartState::ARMED;
+
+    // Wake the motion task a little early; update() spins out the rest
+    esp_timer_stop(_timer);
+    esp_timer_start_once(_timer, lead > SYNC_SPIN_US ? lead - SYNC_SPIN_US : 1);
+    return true;
+}
+
+bool ArmSync::broadcastStart(uint32_t delayMs) {
+    if (_role != SyncRole::MASTER) {
+        _error = "Only the sync master can start the group (M870 S1)";
+        return false;
+    }
+    if (delayMs < SYNC_MIN_LEAD_MS) {
+        _error = "Start delay too short for the followers to hear it";
+        return false;
+    }
+
+    int64_t start = now() + (int64_t)delayMs * 1000;
+    if (!scheduleStart(start)) {
+        return false;
+    }
+
+    _broadcastStartUs = start;
+    _seq++;
+    _startRepeats.store(SYNC_START_REPEATS, std::memory_order_release);
+    return true;
+}
+
+void ArmSync::cancel() {
+    if (_timer) {
+        esp_timer_stop(_timer);
+    }
+    _startRepeats.store(0, std::memory_order_relaxed);
+    motors.setStartHold(false);
+    _state = SyncStartState::IDLE;
+}
+
+void ArmSync::update() {
+    if (_pulseHighUs && esp_timer_get_time() - _pulseHighUs >= SYNC_PULSE_WIDTH_US) {
+        digitalWrite(SYNC_PULSE_PIN, LOW);
+        _pulseHighUs = 0;
+    }
+
+    // An E-stop (stopAll) drops the hold under us
+    if (_state != SyncStartState::IDLE && !motors.isStartHeld()) {
+        cancel();
+    }
+
+    // A start broadcast by the master
+    if (_startReceived.exchange(false, std::memory_order_acq_rel)) {
+        portENTER_CRITICAL(&_lock);
+        int64_t start = _receivedStartUs;
+        portEXIT_CRITICAL(&_lock);
+
+        if (_pulseMode) {
+            hold();  // The pulse starts it
+        } else if (!scheduleStart(start)) {
+            DEBUG_PRINTF("Sync: start dropped - %s\n", _error);
+        }
+    }
+
+    bool pulse = _pulseSeen.exchange(false, std::memory_order_acq_rel);
+    if (_state == SyncStartState::IDLE) {
+        return;
+    }
+
+    if (_pulseMode && _role == SyncRole::FOLLOWER) {
+        if (pulse) {
+            // Measured from the edge
+            int64_t nowUs = esp_timer_get_time();
+            uint32_t sinceEdge = (uint32_t)nowUs - _pulseAtUs.load(std::memory_order_relaxed);
+            fire(nowUs - sinceEdge);
+        }
+        return;
+    }
+
+    if (_state != SyncStartState::ARMED) {
+        return;
+    }
+
+    int64_t deadline = _startUs - getOffsetUs();
+    if (deadline - esp_timer_get_time() > SYNC_SPIN_US) {
+        return;  // The timer wakes us
+    }
+    while (esp_timer_get_time() < deadline) {
+        // Spin out the last few hundred microseconds
+    }
+    fire(deadline);
+}
+
+void ArmSync::fire(int64_t deadlineUs) {
+    if (_pulseMode && _role == SyncRole::MASTER) {
+        digitalWrite(SYNC_PULSE_PIN, HIGH);
+        _pulseHighUs = esp_timer_get_time();
+    }
+
+    // The motion task dispatches the queue right after this
+    motors.setStartHold(false);
+    _state = SyncStartState::IDLE;
+    _lastErrorUs = (int32_t)(esp_timer_get_time() - deadlineUs);
+    _starts++;
+}
+
+void ArmSync::loop() {
+    if (_role != SyncRole::MASTER || !_listening) {
+        return;
+    }
+
+    uint32_t nowMs = millis();
+    uint8_t repeats = _startRepeats.load(std::memory_order_acquire);
+    if (repeats > 0 && nowMs - _lastStartSentMs >= SYNC_START_REPEAT_MS) {
+        _lastStartSentMs = nowMs;
+        send(SYNC_PACKET_START, _seq, _broadcastStartUs);
+        _startRepeats.store(repeats - 1, std::memory_order_relaxed);
+    }
+
+    if (nowMs - _lastBeaconSentMs >= SYNC_BEACON_INTERVAL_MS) {
+        _lastBeaconSentMs = nowMs;
+        send(SYNC_PACKET_BEACON, 0, esp_timer_get_time());
+    }
+}
+
+void ArmSync::send(uint8_t type, uint8_t seq, int64_t timeUs) {
+    SyncPacket packet;
+    memcpy(packet.magic, SYNC_MAGIC, sizeof(packet.magic));
+    packet.version = SYNC_VERSION;
+    packet.type = type;
+    packet.group = _group;
+    packet.seq = seq;
+    packet.timeUs = timeUs;
+    _udp.broadcastTo((uint8_t*)&packet, sizeof(packet), SYNC_UDP_PORT);
+}
+
+void ArmSync::handlePacket(AsyncUDPPacket& packet) {
+    int64_t receivedUs = esp_timer_get_time();
+
+    SyncPacket msg;
+    if (packet.length() != sizeof(msg) || _role != SyncRole::FOLLOWER) {
+        return;
+    }
+    memcpy(&msg, packet.data(), sizeof(msg));
+    if (memcmp(msg.magic, SYNC_MAGIC, sizeof(msg.magic)) != 0 ||
+        msg.version != SYNC_VERSION || msg.group != _group) {
+        return;
+    }
+
+    if (msg.type == SYNC_PACKET_BEACON) {
+        // A beacon is only ever late, so the largest sample is the best
+        int64_t sample = msg.timeUs - receivedUs;
+        portENTER_CRITICAL(&_lock);
+        _samples[_nextSample] = sample;
+        _nextSample = (_nextSample + 1) % SYNC_FILTER_BEACONS;
+        if (_sampleCount < SYNC_FILTER_BEACONS) {
+            _sampleCount++;
+        }
+        int64_t high = _samples[0];
+        int64_t low = _samples[0];
+        for (size_t i = 1; i < _sampleCount; i++) {
+            high = max(high, _samples[i]);
+            low = min(low, _samples[i]);
+        }
+        _offsetUs = high;
+        _jitterUs = (int32_t)min(high - low, (int64_t)INT32_MAX);
+        portEXIT_CRITICAL(&_lock);
+
+        _lastBeaconMs.store(millis(), std::memory_order_relaxed);
+        _beacons.fetch_add(1, std::memory_order_relaxed);
+    } else if (msg.type == SYNC_PACKET_START && msg.seq != _lastStartSeq) {
+        _lastStartSeq = msg.seq;
+        portENTER_CRITICAL(&_lock);
+        _receivedStartUs = msg.timeUs;
+        portEXIT_CRITICAL(&_lock);
+        _startReceived.store(true, std::memory_order_release);
+        motionTask.wake();
+    }
+}
+
+void ArmSync::timerCallback(void* arg) {
+    motionTask.wake();
+}
+
+void IRAM_ATTR ArmSync::onPulse(void* arg) {
+    ArmSync* sync = static_cast<ArmSync*>(arg);
+    sync->_pulseAtUs.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    sync->_pulseSeen.store(true, std::memory_order_release);
+    motionTask.wakeFromISR();
+}
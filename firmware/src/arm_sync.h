@@ -0,0 +1,196 @@
+#ifndef ARM_SYNC_H
+#define ARM_SYNC_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <AsyncUDP.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+
+enum class SyncRole : uint8_t {
+    OFF,
+    MASTER,     // Broadcasts the shared clock and M871 D starts
+    FOLLOWER    // Tracks the master's clock, obeys its starts
+};
+
+enum class SyncStartState : uint8_t {
+    IDLE,
+    HELD,       // Queued moves wait; no start time yet (or a pulse)
+    ARMED       // Start time known, waiting for it
+};
+
+enum SyncPacketType : uint8_t {
+    SYNC_PACKET_BEACON = 1,     // timeUs = master clock at send
+    SYNC_PACKET_START = 2,      // timeUs = shared start time
+};
+
+/**
+ * UDP broadcast payload (little-endian)
+ */
+struct __attribute__((packed)) SyncPacket {
+    char magic[4];              // "RBSY"
+    uint8_t version;
+    uint8_t type;               // SyncPacketType
+    uint8_t group;              // Only controllers of the same group listen
+    uint8_t seq;                // START: repeats share it
+    int64_t timeUs;
+};
+
+/**
+ * Multi-arm synchronized start
+ *
+ * Shared clock: the master broadcasts its esp_timer time every
+ * SYNC_BEACON_INTERVAL_MS on SYNC_UDP_PORT. A follower takes each beacon's
+ * master time minus its own receive time as an offset sample; WiFi only
+ * ever delays a beacon, so the largest sample of the last
+ * SYNC_FILTER_BEACONS is the one closest to the true offset. The spread of
+ * the window is reported as the jitter.
+ *
+ * Start: M871 H1 holds the motion queue (MotorController::setStartHold),
+ * so moves queued afterwards wait. M871 T<ms> arms a start at a shared
+ * clock time; M871 D<ms> on the master picks a time D ms ahead and
+ * broadcasts it to the group (SYNC_START_REPEATS times, followers ignore
+ * repeats). An esp_timer wakes the motion task SYNC_SPIN_US early, and
+ * update() busy-waits out the rest before releasing the queue, so the
+ * start is not quantized to the motion tick.
+ *
+ * Pulse mode (M870 P1, SYNC_PULSE_PIN): the master drives the pin high at
+ * the start; held followers start on the rising edge instead of a time,
+ * which removes the clock estimate from the error budget entirely.
+ *
+ * Threads: configuration and the start state machine run on the motion
+ * task; UDP packets arrive on the AsyncUDP task and beacons are sent from
+ * loop(); the offset window is guarded by a spinlock.
+ */
+class ArmSync {
+public:
+    ArmSync();
+
+    /**
+     * Set the role and group (motion task); OFF stops listening
+     * @return false if the UDP socket could not be opened (see getError)
+     */
+    bool setRole(SyncRole role, uint8_t group);
+
+    /**
+     * Start on the sync pulse instead of the clock
+     * @return false if SYNC_PULSE_PIN is not configured
+     */
+    bool setPulseMode(bool enabled);
+
+    SyncRole getRole() const { return _role; }
+    static const char* roleName(SyncRole role);
+    uint8_t getGroup() const { return _group; }
+    bool isPulseMode() const { return _pulseMode; }
+
+    /**
+     * Shared clock, microseconds (the master's esp_timer time)
+     */
+    int64_t now() const { return esp_timer_get_time() + getOffsetUs(); }
+
+    /**
+     * Master, or follower with a beacon within SYNC_LOCK_TIMEOUT_MS
+     */
+    bool isLocked() const;
+
+    int64_t getOffsetUs() const;
+    int32_t getJitterUs() const;
+    uint32_t getBeaconCount() const { return _beacons.load(std::memory_order_relaxed); }
+    uint32_t getBeaconAgeMs() const;
+
+    /**
+     * Hold queued moves until the start (motion task)
+     */
+    void hold();
+
+    /**
+     * Arm a start at a shared clock time (motion task)
+     * @return false if the clock is not locked or the time has passed
+     */
+    bool scheduleStart(int64_t sharedUs);
+
+    /**
+     * Master: start every arm of the group delayMs from now
+     * @return false if not master, or delayMs < SYNC_MIN_LEAD_MS
+     */
+    bool broadcastStart(uint32_t delayMs);
+
+    /**
+     * Drop the hold and any armed start (M871 H0, E-stop)
+     */
+    void cancel();
+
+    SyncStartState getStartState() const { return _state; }
+    static const char* startStateName(SyncStartState state);
+    int64_t getStartTimeUs() const { return _startUs; }
+    uint32_t getStartCount() const { return _starts; }
+
+    // How late the last start fired against its local deadline
+    int32_t getLastStartErrorUs() const { return _lastErrorUs; }
+
+    // Reason the last setRole/setPulseMode/scheduleStart/broadcastStart failed
+    const char* getError() const { return _error; }
+
+    /**
+     * Fire a due start (motion task, before the queue is dispatched)
+     */
+    void update();
+
+    /**
+     * Send beacons and START broadcasts (loop())
+     */
+    void loop();
+
+private:
+    AsyncUDP _udp;
+    bool _listening;
+    SyncRole _role;
+    uint8_t _group;
+    bool _pulseMode;
+    const char* _error;
+
+    // Offset window (AsyncUDP task writes, any task reads)
+    mutable portMUX_TYPE _lock;
+    int64_t _samples[SYNC_FILTER_BEACONS];
+    size_t _sampleCount;
+    size_t _nextSample;
+    int64_t _offsetUs;
+    int32_t _jitterUs;
+    std::atomic<uint32_t> _beacons;
+    std::atomic<uint32_t> _lastBeaconMs;
+
+    // START packets, AsyncUDP task -> motion task
+    std::atomic<bool> _startReceived;
+    int64_t _receivedStartUs;       // Guarded by _lock
+    int _lastStartSeq;
+
+    // Start state machine (motion task)
+    SyncStartState _state;
+    int64_t _startUs;               // Shared time of the armed start
+    esp_timer_handle_t _timer;
+    std::atomic<bool> _pulseSeen;
+    std::atomic<uint32_t> _pulseAtUs;       // Low word of the edge time (ISR)
+    int64_t _pulseHighUs;           // Master: when the pulse went high, 0 = low
+    uint32_t _starts;
+    int32_t _lastErrorUs;
+
+    // Sending (loop())
+    uint32_t _lastBeaconSentMs;
+    uint32_t _lastStartSentMs;
+    uint8_t _seq;
+    std::atomic<uint8_t> _startRepeats;     // START broadcasts still to send
+    int64_t _broadcastStartUs;
+
+    void fire(int64_t deadlineUs);
+    void resetWindow();
+    void handlePacket(AsyncUDPPacket& packet);
+    void send(uint8_t type, uint8_t seq, int64_t timeUs);
+    static void timerCallback(void* arg);
+    static void IRAM_ATTR onPulse(void* arg);
+};
+
+// Global sync instance
+extern ArmSync armSync;
+
+#endif // ARM_SYNC_H
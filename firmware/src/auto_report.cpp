@@ -0,0 +1,160 @@
+#include "auto_report.h"
+#include "binary_protocol.h"
+
+// Global instance
+AutoReport serialReport;
+
+namespace {
+
+uint8_t snapshotFlags(const MotionSnapshot& snapshot) {
+    uint8_t flags = 0;
+    if (snapshot.enabled) flags |= REPORT_FLAG_ENABLED;
+    if (snapshot.isMoving()) flags |= REPORT_FLAG_MOVING;
+    if (snapshot.jogging) flags |= REPORT_FLAG_JOGGING;
+    if (snapshot.homing) flags |= REPORT_FLAG_HOMING;
+    if (snapshot.coordinated) flags |= REPORT_FLAG_COORDINATED;
+    return flags;
+}
+
+uint8_t* writeInt32(uint8_t* p, int32_t value) {
+    uint32_t v = (uint32_t)value;
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+}  // namespace
+
+AutoReport::AutoReport(ReportFormat format)
+    : _intervalMs(0), _format(format), _resetPending(false),
+      _haveLast(false), _sequence(0), _lastFrameMs(0), _lastKeyframeMs(0),
+      _framesSent(0) {
+    memset(&_last, 0, sizeof(_last));
+    memset(&_pending, 0, sizeof(_pending));
+}
+
+void AutoReport::configure(uint32_t intervalMs, ReportFormat format) {
+    _format.store(format, std::memory_order_relaxed);
+    _intervalMs.store(intervalMs, std::memory_order_relaxed);
+    _resetPending.store(true, std::memory_order_release);
+}
+
+bool AutoReport::poll(uint32_t nowMs, ReportFrame& frame) {
+    uint32_t interval = getInterval();
+    if (interval == 0) {
+        return false;
+    }
+
+    if (_resetPending.exchange(false, std::memory_order_acq_rel)) {
+        _haveLast = false;
+    }
+    if (_haveLast && nowMs - _lastFrameMs < interval) {
+        return false;
+    }
+
+    MotionSnapshot snapshot = telemetry.get();
+    bool keyframe = !_haveLast;
+    #if AUTO_REPORT_KEYFRAME_MS > 0
+    keyframe = keyframe || nowMs - _lastKeyframeMs >= AUTO_REPORT_KEYFRAME_MS;
+    #endif
+
+    uint8_t flags = snapshotFlags(snapshot);
+    uint8_t mask = 0;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        uint8_t bit = 1 << i;
+        if (keyframe || snapshot.position[i] != _last.position[i] ||
+            snapshot.target[i] != _last.target[i] ||
+            ((snapshot.movingMask ^ _last.movingMask) & bit) ||
+            ((snapshot.homedMask ^ _last.homedMask) & bit)) {
+            mask |= bit;
+        }
+    }
+
+    if (mask == 0 && flags == snapshotFlags(_last) &&
+        snapshot.queueDepth == _last.queueDepth) {
+        return false;  // Nothing new
+    }
+
+    frame.sequence = _sequence;
+    frame.jointMask = mask;
+    frame.flags = flags | (keyframe ? REPORT_FLAG_KEYFRAME : 0);
+    frame.movingMask = snapshot.movingMask;
+    frame.homedMask = snapshot.homedMask;
+    frame.queueDepth = snapshot.queueDepth;
+    frame.snapshot = snapshot.sequence;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        frame.position[i] = snapshot.position[i];
+        frame.target[i] = snapshot.target[i];
+        frame.speedHz[i] = snapshot.speedMilliHz[i] / 1000;
+    }
+
+    // Kept until commit(); a frame that is not sent leaves the reference alone
+    _pending = snapshot;
+    return true;
+}
+
+void AutoReport::commit(const ReportFrame& frame, uint32_t nowMs) {
+    _last = _pending;
+    _haveLast = true;
+    _sequence++;
+    _lastFrameMs = nowMs;
+    if (frame.isKeyframe()) {
+        _lastKeyframeMs = nowMs;
+    }
+    _framesSent++;
+}
+
+size_t AutoReport::formatText(const ReportFrame& frame, char* out, size_t size) {
+    char activity = (frame.flags & REPORT_FLAG_HOMING) ? 'H'
+                  : (frame.flags & REPORT_FLAG_JOGGING) ? 'J'
+                  : (frame.flags & REPORT_FLAG_MOVING) ? 'M' : 'I';
+    int n = snprintf(out, size, "%s %c%c Q:%u H:%02X", frame.isKeyframe() ? "RK" : "R",
+                     (frame.flags & REPORT_FLAG_ENABLED) ? 'E' : 'D', activity,
+                     (unsigned)frame.queueDepth, (unsigned)frame.homedMask);
+    size_t length = n > 0 ? n : 0;
+
+    for (int i = 0; i < MOTOR_COUNT && length < size; i++) {
+        if (!frame.includes(i)) {
+            continue;
+        }
+        n = snprintf(out + length, size - length, " J%d:%ld,%ld,%ld", i + 1,
+                     (long)frame.position[i], (long)frame.target[i], (long)frame.speedHz[i]);
+        length += n > 0 ? n : 0;
+    }
+
+    return length < size ? length : 0;
+}
+
+size_t AutoReport::encodeBinary(const ReportFrame& frame, uint8_t* out, size_t size) {
+    size_t length = BINARY_STATUS_HEADER_SIZE +
+                    BINARY_STATUS_JOINT_SIZE * __builtin_popcount(frame.jointMask) +
+                    BINARY_CRC_SIZE;
+    if (length > size) {
+        return 0;
+    }
+
+    out[0] = BINARY_SYNC;
+    out[1] = FRAME_STATUS;
+    out[2] = frame.sequence;
+    out[3] = frame.jointMask;
+    out[4] = frame.flags;
+    out[5] = frame.movingMask;
+    out[6] = frame.homedMask;
+    out[7] = frame.queueDepth;
+
+    uint8_t* p = out + BINARY_STATUS_HEADER_SIZE;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (frame.includes(i)) {
+            p = writeInt32(p, frame.position[i]);
+            p = writeInt32(p, frame.target[i]);
+            p = writeInt32(p, frame.speedHz[i]);
+        }
+    }
+
+    uint16_t crc = BinaryProtocol::crc16(out + 1, p - out - 1);
+    p[0] = crc & 0xFF;
+    p[1] = crc >> 8;
+    return length;
+}
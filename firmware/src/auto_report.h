@@ -0,0 +1,120 @@
+#ifndef AUTO_REPORT_H
+#define AUTO_REPORT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "telemetry.h"
+
+enum class ReportFormat : uint8_t {
+    TEXT,       // "R EM Q:2 H:3F J1:1200,1250,300" lines
+    BINARY,     // FRAME_STATUS frames (binary_protocol.h)
+    JSON        // {"type":"delta"} WebSocket messages (web_server.cpp)
+};
+
+// Frame flags
+static const uint8_t REPORT_FLAG_ENABLED = 1 << 0;
+static const uint8_t REPORT_FLAG_MOVING = 1 << 1;
+static const uint8_t REPORT_FLAG_JOGGING = 1 << 2;
+static const uint8_t REPORT_FLAG_HOMING = 1 << 3;
+static const uint8_t REPORT_FLAG_COORDINATED = 1 << 4;
+static const uint8_t REPORT_FLAG_KEYFRAME = 1 << 7;   // Every joint included
+
+/**
+ * One report: the joints whose position, target, moving or homed state
+ * changed since the previous frame, plus the arm-wide state (always sent)
+ */
+struct ReportFrame {
+    uint8_t sequence;           // Frame count, wraps; a gap means a lost frame
+    uint8_t jointMask;          // Joints included below
+    uint8_t flags;              // REPORT_FLAG_*
+    uint8_t movingMask;
+    uint8_t homedMask;
+    uint8_t queueDepth;
+    uint32_t snapshot;          // MotionSnapshot::sequence it was taken from
+    int32_t position[MOTOR_COUNT];
+    int32_t target[MOTOR_COUNT];
+    int32_t speedHz[MOTOR_COUNT];   // Signed steps/s
+
+    bool includes(uint8_t joint) const { return jointMask & (1 << joint); }
+    bool isKeyframe() const { return flags & REPORT_FLAG_KEYFRAME; }
+};
+
+/**
+ * Change-driven status reporting (like Marlin's M154 auto-report)
+ *
+ * Instead of the whole status on every poll, a channel gets a frame at
+ * most every interval, and only when something changed: each frame holds
+ * just the joints that differ from the last frame sent. An idle arm sends
+ * nothing but a keyframe - every joint - each AUTO_REPORT_KEYFRAME_MS, so a
+ * listener that joins late or drops a frame resynchronizes.
+ *
+ * One instance per channel. configure() may be called from any task (M154
+ * runs on the motion task); poll() and commit() belong to the task that
+ * writes the channel, so frames never split a command reply. A frame the
+ * channel has no room for is simply not committed, and the next poll()
+ * folds its changes into a later one.
+ */
+class AutoReport {
+public:
+    AutoReport(ReportFormat format = ReportFormat::TEXT);
+
+    /**
+     * Set the interval (0 = off) and format; the next frame is a keyframe
+     */
+    void configure(uint32_t intervalMs, ReportFormat format);
+
+    uint32_t getInterval() const { return _intervalMs.load(std::memory_order_relaxed); }
+    ReportFormat getFormat() const { return _format.load(std::memory_order_relaxed); }
+    bool isEnabled() const { return getInterval() > 0; }
+
+    /**
+     * Make the next frame a keyframe (e.g. a new listener)
+     */
+    void requestKeyframe() { _resetPending.store(true, std::memory_order_release); }
+
+    /**
+     * Build the next frame from the latest telemetry if one is due
+     * @return false if reporting is off, the interval has not elapsed or
+     *         nothing changed
+     */
+    bool poll(uint32_t nowMs, ReportFrame& frame);
+
+    /**
+     * Record a frame from poll() as sent; later frames are relative to it
+     */
+    void commit(const ReportFrame& frame, uint32_t nowMs);
+
+    uint32_t getFramesSent() const { return _framesSent; }
+
+    /**
+     * Format as a text line (no line ending)
+     * @return length, 0 if it does not fit
+     */
+    static size_t formatText(const ReportFrame& frame, char* out, size_t size);
+
+    /**
+     * Encode as a FRAME_STATUS binary frame
+     * @return length, 0 if it does not fit
+     */
+    static size_t encodeBinary(const ReportFrame& frame, uint8_t* out, size_t size);
+
+private:
+    std::atomic<uint32_t> _intervalMs;
+    std::atomic<ReportFormat> _format;
+    std::atomic<bool> _resetPending;
+
+    // Sending task state
+    MotionSnapshot _last;           // As of the last committed frame
+    MotionSnapshot _pending;        // Behind the frame poll() returned
+    bool _haveLast;
+    uint8_t _sequence;
+    uint32_t _lastFrameMs;
+    uint32_t _lastKeyframeMs;
+    uint32_t _framesSent;
+};
+
+// Serial auto-report (M154), written by the serial task
+extern AutoReport serialReport;
+
+#endif // AUTO_REPORT_H
@@ -0,0 +1,99 @@
+#include "binary_protocol.h"
+#include "motor_controller.h"
+
+namespace {
+
+const uint8_t VALID_JOINT_MASK = (1 << MOTOR_COUNT) - 1;
+
+int32_t readInt32(const uint8_t* p) {
+    return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                     ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+void sendAck(Print& out, uint8_t type, uint8_t seq, uint8_t status) {
+    uint8_t ack[BINARY_ACK_SIZE];
+    ack[0] = BINARY_SYNC;
+    ack[1] = type | FRAME_ACK_FLAG;
+    ack[2] = seq;
+    ack[3] = status;
+    ack[4] = (uint8_t)min(motors.getQueueFree(), (size_t)255);
+
+    uint16_t crc = BinaryProtocol::crc16(ack + 1, 4);
+    ack[5] = crc & 0xFF;
+    ack[6] = crc >> 8;
+
+    out.write(ack, sizeof(ack));
+}
+
+uint8_t executeMove(uint8_t type, uint8_t mask, const uint8_t* payload) {
+    if (motors.isQueueFull()) {
+        return BINARY_QUEUE_FULL;
+    }
+
+    long positions[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (mask & (1 << i)) {
+            positions[i] = readInt32(payload);
+            payload += 4;
+            if (type == FRAME_MOVE_RELATIVE) {
+                positions[i] += motors.getPlannedPosition(i);
+            }
+        }
+    }
+
+    return motors.queueMove(positions, mask) ? BINARY_OK : BINARY_REJECTED;
+}
+
+}  // namespace
+
+namespace BinaryProtocol {
+
+size_t frameLength(const uint8_t* header) {
+    uint8_t mask = header[3];
+    if (mask == 0 || (mask & ~VALID_JOINT_MASK)) {
+        return 0;
+    }
+    return BINARY_HEADER_SIZE + 4 * __builtin_popcount(mask) + BINARY_CRC_SIZE;
+}
+
+void handleFrame(const uint8_t* frame, size_t length, Print& out) {
+    uint8_t type = frame[1];
+    uint8_t seq = frame[2];
+
+    if (length < BINARY_HEADER_SIZE + BINARY_CRC_SIZE || frameLength(frame) != length) {
+        sendAck(out, type, seq, BINARY_BAD_FRAME);
+        return;
+    }
+
+    uint16_t expected = frame[length - 2] | (frame[length - 1] << 8);
+    if (crc16(frame + 1, length - 1 - BINARY_CRC_SIZE) != expected) {
+        sendAck(out, type, seq, BINARY_BAD_FRAME);
+        return;
+    }
+
+    uint8_t status;
+    switch (type) {
+        case FRAME_MOVE_ABSOLUTE:
+        case FRAME_MOVE_RELATIVE:
+            status = executeMove(type, frame[3], frame + BINARY_HEADER_SIZE);
+            break;
+        default:
+            status = BINARY_BAD_FRAME;
+            break;
+    }
+
+    sendAck(out, type, seq, status);
+}
+
+uint16_t crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    while (length--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+}  // namespace BinaryProtocol
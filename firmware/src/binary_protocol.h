@@ -0,0 +1,80 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Compact binary framing for dense move streams over Serial
+ *
+ * A frame starts with the sync byte 0xA5, which never appears in ASCII
+ * commands, so binary frames and text lines can be mixed freely on the
+ * same link. Binary frames bypass the G-code parser entirely.
+ *
+ * Move frame (host -> controller), little-endian:
+ *   [0]    0xA5 sync
+ *   [1]    type   (FRAME_MOVE_ABSOLUTE / FRAME_MOVE_RELATIVE)
+ *   [2]    seq    (echoed in the ack)
+ *   [3]    joint mask (bit 0 = J1 ... bit 5 = J6)
+ *   [4..]  int32 target per set bit, lowest joint first
+ *   [n-2]  CRC16-CCITT (poly 0x1021, init 0xFFFF) over bytes 1..n-3
+ *
+ * Ack frame (controller -> host):
+ *   [0] 0xA5  [1] type | 0x80  [2] seq  [3] status  [4] queue free
+ *   [5..6] CRC16 over bytes 1..4
+ *
+ * Status frame (controller -> host, unsolicited; M154 B1 auto-report):
+ *   [0] 0xA5  [1] FRAME_STATUS  [2] report seq  [3] joint mask
+ *   [4] flags (REPORT_FLAG_*, auto_report.h)  [5] moving mask
+ *   [6] homed mask  [7] queue depth
+ *   [8..]  int32 position, target and speed (steps/s) per set bit
+ *   [n-2]  CRC16 over bytes 1..n-3
+ * It is only sent between replies, never inside one.
+ */
+
+#define BINARY_SYNC 0xA5
+#define BINARY_HEADER_SIZE 4
+#define BINARY_CRC_SIZE 2
+#define BINARY_MAX_FRAME_SIZE (BINARY_HEADER_SIZE + 4 * MOTOR_COUNT + BINARY_CRC_SIZE)
+#define BINARY_ACK_SIZE 7
+#define BINARY_STATUS_HEADER_SIZE 8
+#define BINARY_STATUS_JOINT_SIZE 12
+#define BINARY_MAX_STATUS_SIZE \
+    (BINARY_STATUS_HEADER_SIZE + BINARY_STATUS_JOINT_SIZE * MOTOR_COUNT + BINARY_CRC_SIZE)
+
+enum BinaryFrameType : uint8_t {
+    FRAME_MOVE_ABSOLUTE = 0x01,
+    FRAME_MOVE_RELATIVE = 0x02,
+    FRAME_STATUS = 0x10,
+    FRAME_ACK_FLAG = 0x80,
+};
+
+enum BinaryStatus : uint8_t {
+    BINARY_OK = 0,
+    BINARY_QUEUE_FULL = 1,    // Retry later
+    BINARY_REJECTED = 2,      // Limits / motors disabled
+    BINARY_BAD_FRAME = 3,     // CRC, type or mask error
+};
+
+namespace BinaryProtocol {
+
+/**
+ * Total frame length implied by a header
+ * @param header At least BINARY_HEADER_SIZE bytes
+ * @return frame length in bytes, 0 if the header is invalid
+ */
+size_t frameLength(const uint8_t* header);
+
+/**
+ * Validate and execute a complete frame, writing the ack to out
+ */
+void handleFrame(const uint8_t* frame, size_t length, Print& out);
+
+/**
+ * CRC16-CCITT (poly 0x1021, init 0xFFFF)
+ */
+uint16_t crc16(const uint8_t* data, size_t length);
+
+}  // namespace BinaryProtocol
+
+#endif // BINARY_PROTOCOL_H
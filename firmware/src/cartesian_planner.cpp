@@ -0,0 +1,152 @@
+#include "cartesian_planner.h"
+#include "motor_controller.h"
+#include "trace.h"
+
+// Global instance
+CartesianPlanner cartesianPlanner;
+
+CartesianPlanner::CartesianPlanner()
+    : _state(CartesianState::IDLE), _segment(0), _segmentCount(0),
+      _segmentSeconds(0), _stopCount(0), _error("") {
+}
+
+void CartesianPlanner::plannedSteps(long steps[MOTOR_COUNT]) const {
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        steps[i] = motors.getPlannedPosition(i);
+    }
+}
+
+void CartesianPlanner::plannedPose(Pose& pose) const {
+    long steps[MOTOR_COUNT];
+    plannedSteps(steps);
+    kinematics.poseFromSteps(steps, pose);
+}
+
+bool CartesianPlanner::start(const Pose& target, float speedMmS) {
+    uint8_t chain = Kinematics::chainMask();
+    if ((motors.getHomedMask() & chain) != chain) {
+        _error = "Not homed - run G28 first";
+        return false;
+    }
+
+    plannedSteps(_lastSteps);
+    kinematics.stepsToAngles(_lastSteps, _angles);
+    Frame from;
+    Frame to;
+    kinematics.forward(_angles, from);
+    Kinematics::poseToFrame(target, to);
+
+    // Solve the end pose up front, so an unreachable target is rejected
+    // before the arm sets off
+    if (!kinematics.inverse(to, _angles, _endAngles)) {
+        _error = "Target out of reach";
+        return false;
+    }
+
+    long endSteps[MOTOR_COUNT];
+    kinematics.anglesToSteps(_endAngles, endSteps);
+    for (int i = 0; i < KINEMATICS_JOINTS; i++) {
+        if (endSteps[i] < motors.getLimitMin(i) || endSteps[i] > motors.getLimitMax(i)) {
+            _error = "Target outside joint limits";
+            return false;
+        }
+    }
+
+    Kinematics::beginPath(from, to, _path);
+    float distance = _path.length;
+    float rotationDeg = _path.angle * RAD_TO_DEG;
+
+    float segments = max(distance / CARTESIAN_SEGMENT_MM, rotationDeg / CARTESIAN_SEGMENT_DEG);
+    if (segments > CARTESIAN_MAX_SEGMENTS) {
+        _error = "Move too long - split it up";
+        return false;
+    }
+    _segmentCount = max((int)ceilf(segments), 1);
+
+    speedMmS = constrain(speedMmS, 0.1f, CARTESIAN_MAX_SPEED_MM_S);
+    float seconds = max(distance / speedMmS, rotationDeg / CARTESIAN_ROTATION_SPEED_DEG_S);
+    _segmentSeconds = max(seconds / _segmentCount, 0.001f);
+
+    _segment = 0;
+    _stopCount = motors.getStopCount();
+    _error = "";
+    _state = CartesianState::MOVING;
+    DEBUG_PRINTF("Cartesian: %.1f mm, %.1f deg in %u segments\n",
+                 distance, rotationDeg, (unsigned)_segmentCount);
+
+    // Queue the first segments right away
+    update();
+    return true;
+}
+
+void CartesianPlanner::stop() {
+    if (_state == CartesianState::MOVING) {
+        _state = CartesianState::IDLE;
+        DEBUG_PRINTLN("Cartesian: stopped");
+    }
+}
+
+void CartesianPlanner::fail(const char* reason) {
+    _state = CartesianState::FAILED;
+    _error = reason;
+    trace.trigger(TraceTrigger::PATH);
+    DEBUG_PRINTF("Cartesian: segment %u - %s\n", (unsigned)_segment + 1, reason);
+}
+
+void CartesianPlanner::update() {
+    if (_state != CartesianState::MOVING) {
+        return;
+    }
+
+    // Emergency stop, disable, program abort...: the queue is gone
+    if (motors.getStopCount() != _stopCount) {
+        stop();
+        return;
+    }
+
+    for (int n = 0; n < CARTESIAN_SEGMENTS_PER_UPDATE && !motors.isQueueFull(); n++) {
+        float angles[KINEMATICS_JOINTS];
+        if (_segment + 1 == _segmentCount) {
+            memcpy(angles, _endAngles, sizeof(angles));
+        } else {
+            Frame waypoint;
+            Kinematics::pathPoint(_path, (float)(_segment + 1) / _segmentCount, waypoint);
+            if (!kinematics.inverse(waypoint, _angles, angles)) {
+                fail("Path leaves the workspace");
+                return;
+            }
+        }
+
+        long steps[MOTOR_COUNT];
+        kinematics.anglesToSteps(angles, steps);
+
+        // Time the segment by its longest joint travel; the other joints
+        // are scaled to arrive with it
+        uint32_t longest = 0;
+        for (int i = 0; i < KINEMATICS_JOINTS; i++) {
+            longest = max(longest, (uint32_t)labs(steps[i] - _lastSteps[i]));
+        }
+        uint32_t speedHz = max((uint32_t)lroundf(longest / _segmentSeconds), (uint32_t)1);
+
+        if (!motors.queueMove(steps, Kinematics::chainMask(), speedHz, 0, true)) {
+            fail("Move rejected - check limits or enable motors");
+            return;
+        }
+
+        memcpy(_angles, angles, sizeof(_angles));
+        memcpy(_lastSteps, steps, sizeof(_lastSteps));
+        if (++_segment == _segmentCount) {
+            _state = CartesianState::IDLE;
+            return;
+        }
+    }
+}
+
+const char* CartesianPlanner::stateName(CartesianState state) {
+    switch (state) {
+        case CartesianState::IDLE:   return "idle";
+        case CartesianState::MOVING: return "moving";
+        case CartesianState::FAILED: return "failed";
+    }
+    return "unknown";
+}
@@ -0,0 +1,86 @@
+#ifndef CARTESIAN_PLANNER_H
+#define CARTESIAN_PLANNER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "kinematics.h"
+
+enum class CartesianState : uint8_t {
+    IDLE,       // No linear move being fed (queued segments may still run)
+    MOVING,     // Feeding segments of a linear move
+    FAILED      // A waypoint was unreachable; the queue ran up to it
+};
+
+/**
+ * Linear Cartesian moves, interpolated on the device
+ *
+ * start() checks the end pose against the workspace and joint limits, then
+ * update() walks the straight line from the end of the motion queue to it:
+ * each CARTESIAN_SEGMENT_MM (or CARTESIAN_SEGMENT_DEG of rotation) it solves
+ * IK - seeded with the previous waypoint, so one or two iterations - and
+ * queues a coordinated joint segment timed for the requested tool speed.
+ * The look-ahead planner carries joint speed across the junctions, so the
+ * tool moves smoothly along the line.
+ *
+ * Like the trajectory player it only queues while there is room, so a
+ * host sends a handful of Cartesian waypoints instead of thousands of
+ * sampled joint positions. One move is fed at a time; G0/G1 are refused
+ * with a busy error until it has been queued completely.
+ */
+class CartesianPlanner {
+public:
+    CartesianPlanner();
+
+    /**
+     * Start a linear move from the planned end of the motion queue
+     * @param target End pose
+     * @param speedMmS Tool speed along the line (mm/s)
+     * @return false if not homed, unreachable or out of limits (see getError)
+     */
+    bool start(const Pose& target, float speedMmS);
+
+    /**
+     * Stop feeding segments (already queued ones are left to the caller)
+     */
+    void stop();
+
+    /**
+     * Queue the next segments (called by the motion task)
+     */
+    void update();
+
+    /**
+     * Tool pose at the end of the motion queue (where the next move starts)
+     */
+    void plannedPose(Pose& pose) const;
+
+    CartesianState getState() const { return _state; }
+    static const char* stateName(CartesianState state);
+    bool isActive() const { return _state == CartesianState::MOVING; }
+
+    uint16_t getSegment() const { return _segment; }
+    uint16_t getSegmentCount() const { return _segmentCount; }
+
+    // Reason the last start() or move failed
+    const char* getError() const { return _error; }
+
+private:
+    CartesianState _state;
+    LinearPath _path;
+    float _angles[KINEMATICS_JOINTS];     // Last queued waypoint
+    float _endAngles[KINEMATICS_JOINTS];  // Solved end pose
+    long _lastSteps[MOTOR_COUNT];
+    uint16_t _segment;                    // Segments queued so far
+    uint16_t _segmentCount;
+    float _segmentSeconds;                // Duration of one segment
+    uint32_t _stopCount;                  // motors.getStopCount() at start
+    const char* _error;
+
+    void plannedSteps(long steps[MOTOR_COUNT]) const;
+    void fail(const char* reason);
+};
+
+// Global Cartesian planner instance
+extern CartesianPlanner cartesianPlanner;
+
+#endif // CARTESIAN_PLANNER_H
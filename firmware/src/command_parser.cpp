@@ -1,137 +1,388 @@
 #include "command_parser.h"
+#include "serial_reader.h"
+#include "program_store.h"
+#include "program_player.h"
+#include "trajectory.h"
+#include "telemetry.h"
+#include "cartesian_planner.h"
+#include "units.h"
+#include "metrics.h"
+#include "trace.h"
+#include "auto_report.h"
+#include "arm_sync.h"
+#include "settings_store.h"
+#include "encoder_monitor.h"
 
 // Global instance
 CommandParser commandParser;
 
-CommandParser::CommandParser() {
+static const char* const JOGGING_ERROR = "Jogging - stop with M810 first";
+
+// Pose words of a Cartesian G0/G1, in Pose field order
+static const char CARTESIAN_AXES[] = "XYZABC";
+static const uint32_t CARTESIAN_MASK =
+    (1UL << ('X' - 'A')) | (1UL << ('Y' - 'A')) | (1UL << ('Z' - 'A')) |
+    (1UL << ('A' - 'A')) | (1UL << ('B' - 'A')) | (1UL << ('C' - 'A'));
+
+// =============================================================================
+// CommandResult
+// =============================================================================
+
+CommandResult CommandResult::ok(const char* msg) {
+    CommandResult result;
+    result.success = true;
+    result.busy = false;
+    result.length = 0;
+    result.message[0] = '\0';
+    result.append("%s", msg);
+    return result;
+}
+
+CommandResult CommandResult::error(const char* format, ...) {
+    CommandResult result;
+    result.success = false;
+    result.busy = false;
+    result.length = 0;
+    result.message[0] = '\0';
+    result.append("error: ");
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(result.message + result.length,
+                      sizeof(result.message) - result.length, format, args);
+    va_end(args);
+    if (n > 0) {
+        result.length = min(result.length + n, sizeof(result.message) - 1);
+    }
+    return result;
 }
 
-CommandResult CommandParser::execute(const String& command) {
-    String cmd = command;
-    cmd.trim();
+CommandResult CommandResult::queueFull() {
+    return busyError("Queue full");
+}
+
+CommandResult CommandResult::busyError(const char* reason) {
+    CommandResult result = error("%s", reason);
+    result.busy = true;
+    return result;
+}
+
+void CommandResult::append(const char* format, ...) {
+    if (length >= sizeof(message) - 1) {
+        return;  // Already full
+    }
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(message + length, sizeof(message) - length, format, args);
+    va_end(args);
+
+    if (n > 0) {
+        length = min(length + n, sizeof(message) - 1);
+    }
+}
+
+// =============================================================================
+// CommandArgs
+// =============================================================================
+
+bool CommandArgs::has(char letter) const {
+    letter = toupper(letter);
+    if (letter < 'A' || letter > 'Z') {
+        return false;
+    }
+    return paramMask & (1UL << (letter - 'A'));
+}
+
+long CommandArgs::get(char letter, long fallback) const {
+    return has(letter) ? params[toupper(letter) - 'A'] : fallback;
+}
+
+float CommandArgs::getFloat(char letter, float fallback) const {
+    return has(letter) ? values[toupper(letter) - 'A'] : fallback;
+}
 
-    if (cmd.length() == 0) {
+// =============================================================================
+// CommandParser
+// =============================================================================
+
+CommandParser::CommandParser()
+    : _jointUnits(false) {
+}
+
+CommandResult CommandParser::execute(const char* command, size_t length) {
+    Metrics::Timer timer(Metrics::PARSE);
+    CommandResult result = executeCommand(command, length);
+    metrics.countCommand(result.success, result.busy);
+    return result;
+}
+
+CommandResult CommandParser::executeCommand(const char* command, size_t length) {
+    // Trim whitespace in place
+    while (length > 0 && isspace((unsigned char)*command)) {
+        command++;
+        length--;
+    }
+    while (length > 0 && isspace((unsigned char)command[length - 1])) {
+        length--;
+    }
+
+    if (length == 0) {
         return CommandResult::ok();
     }
 
     #if DEBUG_COMMANDS
-    DEBUG_PRINTF("CMD: %s\n", cmd.c_str());
+    DEBUG_PRINTF("CMD: %.*s\n", (int)length, command);
     #endif
 
     // Quick status
-    if (cmd == "?") {
-        return CommandResult::ok(getQuickStatus());
+    if (length == 1 && command[0] == '?') {
+        CommandResult result = CommandResult::ok("");
+        reportQuickStatus(result);
+        return result;
     }
 
     // Get command code
-    char cmdType = cmd.charAt(0);
+    char cmdType = toupper(command[0]);
     int cmdNum = -1;
 
     // Parse command number (e.g., "G0" -> 0, "M114" -> 114)
-    int numStart = 1;
-    int numEnd = 1;
-    while (numEnd < cmd.length() && isDigit(cmd.charAt(numEnd))) {
+    size_t numEnd = 1;
+    while (numEnd < length && isDigit(command[numEnd])) {
         numEnd++;
     }
 
-    if (numEnd > numStart) {
-        cmdNum = cmd.substring(numStart, numEnd).toInt();
+    if (numEnd > 1) {
+        long value;
+        if (parseInt(command + 1, numEnd - 1, value)) {
+            cmdNum = value;
+        }
+    }
+
+    // File name argument instead of letter words
+    if (cmdType == 'M' && (cmdNum == 23 || cmdNum == 30)) {
+        const char* name = command + numEnd;
+        size_t nameLength = length - numEnd;
+        return cmdNum == 23 ? handleM23(name, nameLength) : handleM30(name, nameLength);
     }
 
-    // Get arguments (everything after command code)
-    String args = "";
-    if (numEnd < cmd.length()) {
-        args = cmd.substring(numEnd);
-        args.trim();
+    // Tokenize arguments (everything after command code)
+    CommandArgs args;
+    const char* errorWord = nullptr;
+    size_t errorLength = 0;
+    if (!parseArgs(command + numEnd, length - numEnd, args, errorWord, errorLength)) {
+        return CommandResult::error("Invalid argument: %.*s", (int)errorLength, errorWord);
     }
 
     // Dispatch command
     switch (cmdType) {
         case 'G':
-        case 'g':
             switch (cmdNum) {
                 case 0:  return handleG0(args);
                 case 1:  return handleG1(args);
                 case 28: return handleG28(args);
                 default:
-                    return CommandResult::error("Unknown G-code: G" + String(cmdNum));
+                    return CommandResult::error("Unknown G-code: G%d", cmdNum);
             }
             break;
 
         case 'M':
-        case 'm':
             switch (cmdNum) {
                 case 17:  return handleM17();
                 case 18:  return handleM18();
+                case 20:  return handleM20();
+                case 24:  return handleM24();
+                case 25:  return handleM25();
+                case 27:  return handleM27();
                 case 112: return handleM112();
                 case 114: return handleM114();
+                case 119: return handleM119();
+                case 154: return handleM154(args);
+                case 201: return handleM201(args);
+                case 203: return handleM203(args);
+                case 205: return handleM205(args);
+                case 208: return handleM208(args);
+                case 500: return handleM500();
+                case 501: return handleM501();
+                case 502: return handleM502();
                 case 503: return handleM503();
+                case 524: return handleM524();
+                case 575: return handleM575(args);
+                case 720: return handleM720(args);
+                case 721: return handleM721();
+                case 722: return handleM722();
+                case 800: return handleM800(args);
+                case 801: return handleM801(args);
+                case 810: return handleM810(args);
+                case 850: return handleM850(args);
+                case 860: return handleM860(args);
+                case 870: return handleM870(args);
+                case 871: return handleM871(args);
+                case 880: return handleM880(args);
                 default:
-                    return CommandResult::error("Unknown M-code: M" + String(cmdNum));
+                    return CommandResult::error("Unknown M-code: M%d", cmdNum);
             }
             break;
 
         default:
-            return CommandResult::error("Unknown command: " + cmd);
+            return CommandResult::error("Unknown command: %.*s", (int)length, command);
     }
 }
 
-CommandResult CommandParser::handleG0(const String& args) {
-    long positions[MOTOR_COUNT];
-    for (int i = 0; i < MOTOR_COUNT; i++) {
-        positions[i] = LONG_MIN;  // LONG_MIN means don't move
+bool CommandParser::isQueuedMove(const char* command, size_t length) {
+    while (length > 0 && isspace((unsigned char)*command)) {
+        command++;
+        length--;
     }
 
-    int parsed = parseJointPositions(args, positions);
-    if (parsed < 0) {
-        return CommandResult::error("Invalid joint format. Use: G0 J1:1000 J2:500");
+    if (length < 2 || toupper(command[0]) != 'G') {
+        return false;
     }
 
-    if (parsed == 0) {
-        return CommandResult::error("No joints specified");
+    // G0 / G1 (but not G10, G28, ...)
+    if (command[1] != '0' && command[1] != '1') {
+        return false;
+    }
+    return length == 2 || !isDigit(command[2]);
+}
+
+const char* CommandParser::moveBusyReason() {
+    if (motors.isHoming()) {
+        return "Homing in progress";
+    }
+    if (cartesianPlanner.isActive()) {
+        return "Cartesian move in progress";
+    }
+    return nullptr;
+}
+
+CommandResult CommandParser::queueMove(const MoveRequest& move) {
+    if (motors.isJogging()) {
+        return CommandResult::error(JOGGING_ERROR);
+    }
+
+    // Programs and streaming hosts retry until homing is done
+    if (const char* busy = moveBusyReason()) {
+        return CommandResult::busyError(busy);
+    }
+
+    if (motors.isQueueFull()) {
+        return CommandResult::queueFull();
     }
 
-    if (!motors.moveToMultiple(positions)) {
+    if (!motors.queueMove(move)) {
         return CommandResult::error("Move failed - check limits or enable motors");
     }
 
     return CommandResult::ok();
 }
 
-CommandResult CommandParser::handleG1(const String& args) {
-    long positions[MOTOR_COUNT];
+// G0/G1 joint words as a move at the joint limits, in the current
+// coordinated-move mode
+static MoveRequest jointMove(const CommandArgs& args, bool relative) {
+    MoveRequest move = {};
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        positions[i] = LONG_MIN;
+        move.positions[i] = args.joints[i];
     }
+    move.jointMask = args.jointMask;
+    move.relative = relative;
+    move.coordinated = motors.isCoordinated();
+    return move;
+}
 
-    int parsed = parseJointPositions(args, positions);
-    if (parsed < 0) {
-        return CommandResult::error("Invalid joint format");
+CommandResult CommandParser::handleG0(const CommandArgs& args) {
+    if (args.paramMask & CARTESIAN_MASK) {
+        return handleCartesianMove(args, false);
     }
 
-    if (parsed == 0) {
+    if (args.jointMask == 0) {
         return CommandResult::error("No joints specified");
     }
 
-    // Convert to absolute positions for relative move
-    for (int i = 0; i < MOTOR_COUNT; i++) {
-        if (positions[i] != LONG_MIN) {
-            positions[i] = motors.getPosition(i) + positions[i];
+    return queueMove(jointMove(args, false));
+}
+
+CommandResult CommandParser::handleG1(const CommandArgs& args) {
+    if (args.paramMask & CARTESIAN_MASK) {
+        return handleCartesianMove(args, true);
+    }
+
+    if (args.jointMask == 0) {
+        return CommandResult::error("No joints specified");
+    }
+
+    // Offsets from where the queue ends
+    return queueMove(jointMove(args, true));
+}
+
+CommandResult CommandParser::handleCartesianMove(const CommandArgs& args, bool relative) {
+    if (args.jointMask) {
+        return CommandResult::error("Use either joint (J) or Cartesian (XYZABC) words");
+    }
+
+    if (!motors.isEnabled()) {
+        return CommandResult::error("Motors disabled - enable with M17");
+    }
+
+    if (motors.isJogging()) {
+        return CommandResult::error(JOGGING_ERROR);
+    }
+
+    // The line is fed over many updates, so it cannot be rolled back
+    if (motors.isBatchOpen()) {
+        return CommandResult::error("Cartesian moves cannot be batched");
+    }
+
+    if (const char* busy = moveBusyReason()) {
+        return CommandResult::busyError(busy);
+    }
+
+    if (motors.isQueueFull()) {
+        return CommandResult::queueFull();
+    }
+
+    // Start from where the queue ends; omitted axes keep their value
+    Pose pose;
+    cartesianPlanner.plannedPose(pose);
+    float* axes[6] = { &pose.x, &pose.y, &pose.z, &pose.a, &pose.b, &pose.c };
+    for (int i = 0; i < 6; i++) {
+        if (args.has(CARTESIAN_AXES[i])) {
+            float value = args.getFloat(CARTESIAN_AXES[i]);
+            *axes[i] = relative ? *axes[i] + value : value;
         }
     }
 
-    if (!motors.moveToMultiple(positions)) {
-        return CommandResult::error("Move failed - check limits or enable motors");
+    float speed = args.getFloat('F', CARTESIAN_DEFAULT_SPEED_MM_S);
+    if (speed <= 0) {
+        return CommandResult::error("F must be > 0 (mm/s)");
+    }
+
+    if (!cartesianPlanner.start(pose, speed)) {
+        return CommandResult::error("%s", cartesianPlanner.getError());
     }
 
     return CommandResult::ok();
 }
 
-CommandResult CommandParser::handleG28(const String& args) {
-    // For now, just set current position as zero
-    // TODO: Implement actual homing with endstops
-    motors.setZeroAll();
-    return CommandResult::ok("All joints homed (zeroed)");
+CommandResult CommandParser::handleG28(const CommandArgs& args) {
+    // G28 homes every joint; "G28 J2:1 J3:1" only the listed ones
+    uint8_t mask = args.jointMask ? args.jointMask : ALL_JOINTS_MASK;
+
+    if (!motors.isEnabled()) {
+        return CommandResult::error("Motors disabled - enable with M17");
+    }
+
+    if (motors.isHoming()) {
+        return CommandResult::busyError("Homing in progress");
+    }
+
+    if (!motors.startHoming(mask)) {
+        return CommandResult::error("Moves in progress - cannot home");
+    }
+
+    // Joints without endstops are zeroed at once; the rest home in update()
+    return CommandResult::ok(motors.isHoming() ? "Homing started (M119 for status)"
+                                               : "Homed (zeroed)");
 }
 
 CommandResult CommandParser::handleM17() {
@@ -144,137 +395,973 @@ CommandResult CommandParser::handleM18() {
     return CommandResult::ok("Motors disabled");
 }
 
+CommandResult CommandParser::handleM20() {
+    static ProgramInfo programs[ProgramStore::MAX_PROGRAMS];
+
+    if (!programStore.isMounted()) {
+        return CommandResult::error("Program storage not available");
+    }
+
+    size_t count = programStore.list(programs, ProgramStore::MAX_PROGRAMS);
+    CommandResult result = CommandResult::ok("");
+    result.append("Programs: %u", (unsigned)count);
+    for (size_t i = 0; i < count; i++) {
+        result.append("\n%s %u", programs[i].name, (unsigned)programs[i].size);
+    }
+    result.append("\nFree: %u bytes",
+                  (unsigned)(programStore.totalBytes() - programStore.usedBytes()));
+    return result;
+}
+
+CommandResult CommandParser::handleM23(const char* name, size_t length) {
+    char program[PROGRAM_NAME_MAX_LENGTH + 1];
+    if (!parseProgramName(name, length, program)) {
+        return CommandResult::error("Invalid program name");
+    }
+
+    if (programPlayer.isActive()) {
+        return CommandResult::error("Program running - abort with M524 first");
+    }
+
+    if (!programPlayer.select(program)) {
+        return CommandResult::error("Program not found: %s", program);
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Program selected: %s (%u bytes)", program,
+                  (unsigned)programPlayer.getFileSize());
+    return result;
+}
+
+CommandResult CommandParser::handleM24() {
+    if (programPlayer.getState() == PlaybackState::IDLE) {
+        return CommandResult::error("No program selected");
+    }
+
+    if (!motors.isEnabled()) {
+        return CommandResult::error("Motors disabled - enable with M17");
+    }
+
+    if (trajectoryPlayer.isActive()) {
+        return CommandResult::error("Trajectory playing - stop with M721 first");
+    }
+
+    if (motors.isJogging()) {
+        return CommandResult::error(JOGGING_ERROR);
+    }
+
+    bool resuming = programPlayer.getState() == PlaybackState::PAUSED;
+    if (!programPlayer.start()) {
+        return CommandResult::error("Cannot open program: %s", programPlayer.getName());
+    }
+
+    return CommandResult::ok(resuming ? "Program resumed" : "Program started");
+}
+
+CommandResult CommandParser::handleM25() {
+    if (programPlayer.getState() != PlaybackState::PLAYING) {
+        return CommandResult::error("No program playing");
+    }
+    programPlayer.pause();
+    return CommandResult::ok("Program paused");
+}
+
+CommandResult CommandParser::handleM27() {
+    CommandResult result = CommandResult::ok("");
+    reportProgramStatus(result);
+    return result;
+}
+
+CommandResult CommandParser::handleM30(const char* name, size_t length) {
+    char program[PROGRAM_NAME_MAX_LENGTH + 1];
+    if (!parseProgramName(name, length, program)) {
+        return CommandResult::error("Invalid program name");
+    }
+
+    if (programPlayer.isActive() && strcmp(programPlayer.getName(), program) == 0) {
+        return CommandResult::error("Program running - abort with M524 first");
+    }
+
+    if (!programStore.remove(program)) {
+        return CommandResult::error("Program not found: %s", program);
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Program deleted: %s", program);
+    return result;
+}
+
 CommandResult CommandParser::handleM112() {
+    trace.trigger(TraceTrigger::ESTOP);
+    programPlayer.abort();
+    trajectoryPlayer.stop();
     motors.stopAll();
     motors.setEnabled(false);
     return CommandResult::ok("EMERGENCY STOP - Motors disabled");
 }
 
 CommandResult CommandParser::handleM114() {
-    return CommandResult::ok(getPositionReport());
+    CommandResult result = CommandResult::ok("");
+    reportPositions(result);
+    return result;
 }
 
-CommandResult CommandParser::handleM503() {
-    return CommandResult::ok(getSettingsReport());
+CommandResult CommandParser::handleM201(const CommandArgs& args) {
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (args.hasJoint(i) && args.joints[i] <= 0) {
+            return CommandResult::error("Acceleration must be > 0");
+        }
+    }
+
+    // Queued segments keep the ramps they were planned with
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (args.hasJoint(i)) {
+            motors.setAcceleration(i, args.joints[i]);
+        }
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Accel:");
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        appendJoint(result, i, motors.getAcceleration(i));
+    }
+    return result;
 }
 
-String CommandParser::getPositionReport() const {
-    String report = "Position:";
+CommandResult CommandParser::handleM203(const CommandArgs& args) {
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        report += " J" + String(i + 1) + ":" + String(motors.getPosition(i));
+        if (args.hasJoint(i) &&
+            (args.joints[i] <= 0 || args.joints[i] > MAX_SPEED_HZ)) {
+            return CommandResult::error("Speed must be 1-%d steps/s", MAX_SPEED_HZ);
+        }
+    }
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (args.hasJoint(i)) {
+            motors.setMaxSpeed(i, args.joints[i]);
+        }
     }
 
-    report += "\nTarget:";
+    CommandResult result = CommandResult::ok("");
+    result.append("MaxSpeed:");
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        report += " J" + String(i + 1) + ":" + String(motors.getTargetPosition(i));
+        appendJoint(result, i, motors.getMaxSpeed(i));
     }
+    return result;
+}
 
-    report += "\nMoving: ";
-    report += motors.isAnyMoving() ? "yes" : "no";
+CommandResult CommandParser::handleM205(const CommandArgs& args) {
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (args.hasJoint(i) && args.joints[i] < 0) {
+            return CommandResult::error("Jerk must be >= 0 (0 = trapezoidal ramps)");
+        }
+    }
 
-    report += "\nEnabled: ";
-    report += motors.isEnabled() ? "yes" : "no";
+    // Queued segments keep the ramps they were planned with
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (args.hasJoint(i)) {
+            motors.setJerk(i, args.joints[i]);
+        }
+    }
 
-    return report;
+    CommandResult result = CommandResult::ok("");
+    result.append("Jerk:");
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        appendJoint(result, i, motors.getJerk(i));
+    }
+    return result;
 }
 
-String CommandParser::getSettingsReport() const {
-    String report = "Settings (FastAccelStepper):\n";
+CommandResult CommandParser::handleM208(const CommandArgs& args) {
+    bool setMin = args.get('S') == 1;
 
+    // Check every joint first, so a bad word changes nothing
+    long limitMin[MOTOR_COUNT];
+    long limitMax[MOTOR_COUNT];
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        const MotorConfig& cfg = motors.getConfig(i);
-        report += String(cfg.name) +
-                  " Step:" + String(cfg.stepPin) +
-                  " Dir:" + String(cfg.dirPin) +
-                  " SPR:" + String(cfg.stepsPerRev) +
-                  " uStep:" + String(cfg.microstepping) +
-                  " MaxHz:" + String(cfg.maxSpeedHz) +
-                  " Accel:" + String(cfg.acceleration) + "\n";
+        limitMin[i] = motors.getLimitMin(i);
+        limitMax[i] = motors.getLimitMax(i);
+        if (!args.hasJoint(i)) {
+            continue;
+        }
+        if (args.joints[i] < INT32_MIN || args.joints[i] > INT32_MAX) {
+            return CommandResult::error("J%d: limit out of range", i + 1);
+        }
+        (setMin ? limitMin : limitMax)[i] = args.joints[i];
+        if (limitMin[i] >= limitMax[i]) {
+            return CommandResult::error("J%d: minimum must be below maximum", i + 1);
+        }
+    }
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        motors.setLimits(i, limitMin[i], limitMax[i]);
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Min:");
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        appendJoint(result, i, motors.getLimitMin(i));
     }
+    result.append("\nMax:");
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        appendJoint(result, i, motors.getLimitMax(i));
+    }
+    return result;
+}
 
-    return report;
+CommandResult CommandParser::handleM500() {
+    // Flash writes stall both cores; keep them out of running moves
+    if (motors.isAnyMoving() || motors.getQueueDepth() > 0 ||
+        motors.isHoming() || motors.isJogging()) {
+        return CommandResult::busyError("Moving - save when idle");
+    }
+
+    JointSettings settings[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        settings[i] = motors.getSettings(i);
+    }
+    if (!settingsStore.save(settings)) {
+        return CommandResult::error("%s", settingsStore.getError());
+    }
+    return CommandResult::ok("Settings saved");
 }
 
-String CommandParser::getQuickStatus() const {
-    String status = motors.isEnabled() ? "E" : "D";  // Enabled/Disabled
-    status += motors.isAnyMoving() ? "M" : "I";      // Moving/Idle
+CommandResult CommandParser::handleM501() {
+    JointSettings settings[MOTOR_COUNT];
+    if (!settingsStore.load(settings)) {
+        return CommandResult::error("%s", settingsStore.getError() ? settingsStore.getError()
+                                                                   : "No saved settings");
+    }
 
-    status += " P:";
+    // All or nothing: check every joint before changing any
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (!MotorController::isValidSettings(settings[i])) {
+            return CommandResult::error("Saved settings for J%d out of range", i + 1);
+        }
+    }
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        if (i > 0) status += ",";
-        status += String(motors.getPosition(i));
+        motors.setSettings(i, settings[i]);
     }
+    return CommandResult::ok("Settings loaded");
+}
+
+CommandResult CommandParser::handleM502() {
+    motors.resetSettings();
+    return CommandResult::ok("Defaults restored (M500 to save)");
+}
+
+CommandResult CommandParser::handleM503() {
+    CommandResult result = CommandResult::ok("");
+    reportSettings(result);
+    return result;
+}
+
+CommandResult CommandParser::handleM524() {
+    if (!programPlayer.isActive()) {
+        return CommandResult::error("No program running");
+    }
+    programPlayer.abort();
+    return CommandResult::ok("Program aborted");
+}
+
+CommandResult CommandParser::handleM575(const CommandArgs& args) {
+    if (!args.has('B')) {
+        CommandResult result = CommandResult::ok("");
+        result.append("Baud rate: %lu", (unsigned long)serialReader.getBaudRate());
+        return result;
+    }
+
+    long baud = args.get('B');
+    if (baud < 9600 || baud > SERIAL_MAX_BAUD_RATE) {
+        return CommandResult::error("Baud rate must be 9600-%lu",
+                                    (unsigned long)SERIAL_MAX_BAUD_RATE);
+    }
+
+    // Switched after this reply has been flushed at the old rate
+    serialReader.requestBaudRate(baud);
 
-    return status;
+    CommandResult result = CommandResult::ok("");
+    result.append("Baud rate: %ld", baud);
+    return result;
 }
 
-int CommandParser::parseJointPositions(const String& args, long positions[MOTOR_COUNT]) {
-    int parsed = 0;
-    String remaining = args;
-    remaining.toUpperCase();
+CommandResult CommandParser::handleM720(const CommandArgs& args) {
+    if (!trajectoryPlayer.isValid()) {
+        return CommandResult::error("No trajectory stored");
+    }
+
+    if (!motors.isEnabled()) {
+        return CommandResult::error("Motors disabled - enable with M17");
+    }
+
+    if (programPlayer.isActive()) {
+        return CommandResult::error("Program running - abort with M524 first");
+    }
+
+    if (trajectoryPlayer.isActive()) {
+        return CommandResult::error("Trajectory already playing");
+    }
 
-    while (remaining.length() > 0) {
-        remaining.trim();
+    if (motors.isJogging()) {
+        return CommandResult::error(JOGGING_ERROR);
+    }
 
-        // Find joint specifier (J1, J2, etc.)
-        int jIdx = remaining.indexOf('J');
-        if (jIdx < 0) break;
+    if (const char* busy = moveBusyReason()) {
+        return CommandResult::busyError(busy);
+    }
 
-        // Get joint number
-        int jointNum = 0;
-        int colonIdx = remaining.indexOf(':', jIdx);
-        if (colonIdx < 0) {
-            return -1;  // Invalid format
+    long repeat = args.get('L', 1);
+    if (repeat < 0) {
+        return CommandResult::error("L must be >= 0");
+    }
+
+    if (!trajectoryPlayer.start(repeat)) {
+        return CommandResult::error("Trajectory upload in progress");
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Trajectory started: %lu records", (unsigned long)trajectoryPlayer.getRecordCount());
+    return result;
+}
+
+CommandResult CommandParser::handleM721() {
+    if (!trajectoryPlayer.isActive()) {
+        return CommandResult::error("No trajectory playing");
+    }
+    trajectoryPlayer.stop();
+    return CommandResult::ok("Trajectory stopped");
+}
+
+CommandResult CommandParser::handleM722() {
+    CommandResult result = CommandResult::ok("");
+    reportTrajectoryStatus(result);
+    return result;
+}
+
+CommandResult CommandParser::handleM800(const CommandArgs& args) {
+    if (args.has('S')) {
+        motors.setCoordinated(args.get('S') != 0);
+    }
+    return CommandResult::ok(motors.isCoordinated() ? "Coordinated moves: on"
+                                                    : "Coordinated moves: off");
+}
+
+CommandResult CommandParser::handleM801(const CommandArgs& args) {
+    if (args.has('S')) {
+        _jointUnits = args.get('S') != 0;
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Joint units:");
+    if (!_jointUnits) {
+        result.append(" steps");
+    } else {
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            result.append(" J%d:%s", i + 1, Units::name(i));
         }
+    }
+    return result;
+}
+
+CommandResult CommandParser::handleM810(const CommandArgs& args) {
+    if (programPlayer.isActive() || trajectoryPlayer.isActive()) {
+        return CommandResult::error("Program running - cannot jog");
+    }
 
-        jointNum = remaining.substring(jIdx + 1, colonIdx).toInt();
-        if (jointNum < 1 || jointNum > MOTOR_COUNT) {
-            return -1;  // Invalid joint number
+    if (cartesianPlanner.isActive()) {
+        return CommandResult::error("Moves in progress - cannot jog");
+    }
+
+    // The command carries the whole velocity vector: omitted joints stop
+    long speeds[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        speeds[i] = args.hasJoint(i) ? args.joints[i] : 0;
+    }
+
+    if (!motors.jog(speeds)) {
+        return CommandResult::error(motors.isEnabled() ? "Moves in progress - cannot jog"
+                                                       : "Motors disabled - enable with M17");
+    }
+    return CommandResult::ok();
+}
+
+// Bucket bound as a percentile ("250", or ">25000" past the last bucket)
+static void appendPercentile(CommandResult& out, uint32_t us) {
+    if (us == UINT32_MAX) {
+        out.append(" >%lu", (unsigned long)LatencyHistogram::BOUNDS_US[LatencyHistogram::BUCKET_COUNT - 2]);
+    } else {
+        out.append(" %lu", (unsigned long)us);
+    }
+}
+
+CommandResult CommandParser::handleM850(const CommandArgs& args) {
+    if (args.has('R')) {
+        metrics.reset();
+        return CommandResult::ok("Metrics reset");
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Latency (us): count avg p50 p99 max");
+    for (int s = 0; s < Metrics::SECTION_COUNT; s++) {
+        const LatencyHistogram& histogram = metrics.histogram((Metrics::Section)s);
+        uint32_t count = histogram.count();
+        uint32_t avg = count ? metrics.toMicros(histogram.sumCycles()) / count : 0;
+        result.append("\n%s %lu %lu", Metrics::sectionName((Metrics::Section)s),
+                      (unsigned long)count, (unsigned long)avg);
+        appendPercentile(result, histogram.percentileUs(50));
+        appendPercentile(result, histogram.percentileUs(99));
+        result.append(" %lu", (unsigned long)metrics.toMicros(histogram.maxCycles()));
+    }
+
+    result.append("\nCommands: %lu errors %lu busy %lu", (unsigned long)metrics.getCommandCount(),
+                  (unsigned long)metrics.getCommandErrors(),
+                  (unsigned long)metrics.getCommandBusy());
+    result.append("\nHTTP: 2xx %lu 4xx %lu 5xx %lu", (unsigned long)metrics.getHttpResponses(2),
+                  (unsigned long)metrics.getHttpResponses(4),
+                  (unsigned long)metrics.getHttpResponses(5));
+    result.append("\nHigh water: motion %lu/%u serial %lu/%u",
+                  (unsigned long)metrics.motionQueue.get(), (unsigned)MOTION_QUEUE_SIZE,
+                  (unsigned long)metrics.serialRing.get(), (unsigned)SERIAL_RING_SIZE);
+
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    result.append("\nHeap: free %lu min %lu largest %lu frag %lu%%", (unsigned long)freeHeap,
+                  (unsigned long)ESP.getMinFreeHeap(), (unsigned long)largest,
+                  (unsigned long)(freeHeap ? 100 - (uint64_t)largest * 100 / freeHeap : 0));
+    return result;
+}
+
+CommandResult CommandParser::handleM860(const CommandArgs& args) {
+    if (args.has('E')) {
+        if (trace.getState() != TraceState::ARMED) {
+            return CommandResult::error("Trace not armed - arm it with M860 S2");
         }
+        trace.trigger(TraceTrigger::MANUAL);
+        return CommandResult::ok("Trace triggered");
+    }
 
-        // Find end of value (next space or end)
-        int valueStart = colonIdx + 1;
-        int valueEnd = remaining.indexOf(' ', valueStart);
-        if (valueEnd < 0) {
-            valueEnd = remaining.length();
+    if (args.has('S')) {
+        long mode = args.get('S');
+        if (mode == 0) {
+            trace.stop();
+        } else if (mode == 1 || mode == 2) {
+            long rate = args.get('R', TRACE_DEFAULT_RATE_HZ);
+            long post = mode == 2 ? args.get('P', TRACE_DEFAULT_POST_TRIGGER_MS) : 0;
+            if (rate <= 0 || post < 0 || (mode == 2 && post == 0)) {
+                return CommandResult::error("Invalid rate or post-trigger time");
+            }
+            if (!trace.start(rate, post)) {
+                return CommandResult::error("%s", trace.getError());
+            }
+        } else {
+            return CommandResult::error("Invalid mode - S0 stop, S1 record, S2 arm");
         }
+    }
 
-        // Parse value
-        long value;
-        if (!parseInt(remaining.substring(valueStart, valueEnd), value)) {
-            return -1;
+    TraceState state = trace.getState();
+    CommandResult result = CommandResult::ok("");
+    result.append("Trace: %s", Trace::stateName(state));
+    if (trace.getBufferSize()) {
+        result.append(" %lu Hz, %lu samples, %u KB %s, missed %lu",
+                      (unsigned long)trace.getRateHz(), (unsigned long)trace.getSampleCount(),
+                      (unsigned)(trace.getBufferSize() / 1024), trace.inPsram() ? "PSRAM" : "DRAM",
+                      (unsigned long)trace.getMissedSamples());
+    }
+    if (trace.getTriggerReason() != TraceTrigger::NONE) {
+        result.append(", trigger: %s", Trace::triggerName(trace.getTriggerReason()));
+    }
+    return result;
+}
+
+CommandResult CommandParser::handleM870(const CommandArgs& args) {
+    if (args.has('S') || args.has('G')) {
+        long role = args.get('S', (long)armSync.getRole());
+        long group = args.get('G', armSync.getGroup());
+        if (role < 0 || role > (long)SyncRole::FOLLOWER) {
+            return CommandResult::error("Invalid role - S0 off, S1 master, S2 follower");
+        }
+        if (group < 0 || group > 255) {
+            return CommandResult::error("Group must be 0-255");
+        }
+        if (!armSync.setRole((SyncRole)role, group)) {
+            return CommandResult::error("%s", armSync.getError());
         }
+    }
+    if (args.has('P') && !armSync.setPulseMode(args.get('P') != 0)) {
+        return CommandResult::error("%s", armSync.getError());
+    }
+
+    SyncRole role = armSync.getRole();
+    CommandResult result = CommandResult::ok("");
+    result.append("Sync: %s group %u", ArmSync::roleName(role), (unsigned)armSync.getGroup());
+    if (role == SyncRole::FOLLOWER) {
+        result.append(", %s, offset %lld us, jitter %ld us, %lu beacons",
+                      armSync.isLocked() ? "locked" : "not locked",
+                      (long long)armSync.getOffsetUs(), (long)armSync.getJitterUs(),
+                      (unsigned long)armSync.getBeaconCount());
+        if (armSync.getBeaconCount()) {
+            result.append(" (%lu ms ago)", (unsigned long)armSync.getBeaconAgeMs());
+        }
+    }
+    result.append(", clock %lld ms, pulse %s", (long long)(armSync.now() / 1000),
+                  armSync.isPulseMode() ? "on" : "off");
+    return result;
+}
+
+CommandResult CommandParser::handleM871(const CommandArgs& args) {
+    if (args.has('H')) {
+        if (args.get('H')) {
+            armSync.hold();
+        } else {
+            armSync.cancel();
+        }
+    } else if (args.has('T')) {
+        if (!armSync.scheduleStart((int64_t)args.get('T') * 1000)) {
+            return CommandResult::error("%s", armSync.getError());
+        }
+    } else if (args.has('D')) {
+        long delayMs = args.get('D');
+        if (delayMs <= 0 || !armSync.broadcastStart(delayMs)) {
+            return CommandResult::error("%s", delayMs <= 0 ? "Delay must be positive"
+                                                           : armSync.getError());
+        }
+    }
+
+    SyncStartState state = armSync.getStartState();
+    CommandResult result = CommandResult::ok("");
+    result.append("Start: %s", ArmSync::startStateName(state));
+    if (state == SyncStartState::ARMED) {
+        result.append(" at %lld ms (in %lld ms)", (long long)(armSync.getStartTimeUs() / 1000),
+                      (long long)((armSync.getStartTimeUs() - armSync.now()) / 1000));
+    }
+    result.append(", %lu starts", (unsigned long)armSync.getStartCount());
+    if (armSync.getStartCount()) {
+        result.append(", last %ld us late", (long)armSync.getLastStartErrorUs());
+    }
+    return result;
+}
+
+CommandResult CommandParser::handleM880(const CommandArgs& args) {
+    if (!encoders.getMask()) {
+        return CommandResult::error("No encoders configured");
+    }
+    if (args.has('S')) {
+        long mode = args.get('S');
+        if (mode < 0 || mode > (long)EncoderMode::CORRECT) {
+            return CommandResult::error("Invalid mode - S0 off, S1 monitor, S2 correct");
+        }
+        encoders.setMode((EncoderMode)mode);
+    }
+    if (args.has('E')) {
+        long steps = args.get('E');
+        if (steps <= 0) {
+            return CommandResult::error("Fault threshold must be positive");
+        }
+        encoders.setFaultSteps(steps);
+    }
+    if (args.has('D')) {
+        long steps = args.get('D');
+        if (steps < 0 || (uint32_t)steps >= encoders.getFaultSteps()) {
+            return CommandResult::error("Correction deadband must be 0 to below the fault threshold");
+        }
+        encoders.setCorrectSteps(steps);
+    }
+    if (args.get('R') != 0) {
+        encoders.clearFault();
+    }
+
+    CommandResult result = CommandResult::ok("");
+    result.append("Encoders: %s, fault %lu, deadband %lu steps",
+                  EncoderMonitor::modeName(encoders.getMode()),
+                  (unsigned long)encoders.getFaultSteps(),
+                  (unsigned long)encoders.getCorrectSteps());
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (!encoders.hasEncoder(i)) {
+            continue;
+        }
+        result.append("\nJ%d Actual:%ld Error:%ld Max:%lu%s", i + 1,
+                      encoders.getActual(i), (long)encoders.getFollowingError(i),
+                      (unsigned long)encoders.getMaxError(i),
+                      (encoders.getFaultMask() >> i) & 1 ? " FAULT" : "");
+    }
+    result.append("\nFaults: %lu, corrections: %lu", (unsigned long)encoders.getFaultCount(),
+                  (unsigned long)encoders.getCorrectionCount());
+    return result;
+}
+
+CommandResult CommandParser::handleM119() {
+    CommandResult result = CommandResult::ok("");
+    result.append("Homing: %s", motors.isHoming() ? "running" : "idle");
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        const MotorConfig& cfg = MOTOR_CONFIGS[i];
+        result.append("\nJ%d: ", i + 1);
+        if (cfg.endstopPin < 0) {
+            result.append("no endstop");
+        } else {
+            result.append(motors.isEndstopActive(i) ? "TRIGGERED" : "open");
+        }
+        result.append(" %s %s", MotorController::homingPhaseName(motors.getHomingPhase(i)),
+                      motors.isHomed(i) ? "homed" : "not homed");
+    }
+    if (motors.getHomingError()[0]) {
+        result.append("\nError: %s", motors.getHomingError());
+    }
+    return result;
+}
+
+CommandResult CommandParser::handleM154(const CommandArgs& args) {
+    if (args.has('S') || args.has('B')) {
+        long interval = args.get('S', serialReport.getInterval());
+        if (interval < 0) {
+            return CommandResult::error("Interval must be 0 (off) or more ms");
+        }
+        if (interval > 0 && interval < AUTO_REPORT_MIN_INTERVAL_MS) {
+            interval = AUTO_REPORT_MIN_INTERVAL_MS;
+        }
+        bool binary = args.get('B', serialReport.getFormat() == ReportFormat::BINARY) != 0;
+        serialReport.configure(interval, binary ? ReportFormat::BINARY : ReportFormat::TEXT);
+    }
+
+    CommandResult result = CommandResult::ok("");
+    if (!serialReport.isEnabled()) {
+        result.append("Auto-report: off");
+    } else {
+        result.append("Auto-report: every %lu ms, %s",
+                      (unsigned long)serialReport.getInterval(),
+                      serialReport.getFormat() == ReportFormat::BINARY ? "binary" : "text");
+    }
+    return result;
+}
+
+void CommandParser::reportPositions(CommandResult& out) const {
+    // One consistent snapshot of all joints
+    MotionSnapshot snapshot = telemetry.get();
+
+    out.append("Position:");
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        appendJoint(out, i, snapshot.position[i]);
+    }
+
+    out.append("\nTarget:");
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        appendJoint(out, i, snapshot.target[i]);
+    }
 
-        positions[jointNum - 1] = value;  // Convert to 0-indexed
-        parsed++;
+    // Tool pose of the current joint positions
+    long steps[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        steps[i] = snapshot.position[i];
+    }
+    Pose pose;
+    kinematics.poseFromSteps(steps, pose);
+    out.append("\nPose: X:%.2f Y:%.2f Z:%.2f A:%.2f B:%.2f C:%.2f%s",
+               pose.x, pose.y, pose.z, pose.a, pose.b, pose.c,
+               (snapshot.homedMask & Kinematics::chainMask()) == Kinematics::chainMask()
+                   ? "" : " (not homed)");
 
-        // Move past this joint specifier
-        remaining = remaining.substring(valueEnd);
+    CartesianState cartesian = cartesianPlanner.getState();
+    if (cartesian == CartesianState::MOVING) {
+        out.append("\nCartesian: moving %u/%u", (unsigned)cartesianPlanner.getSegment(),
+                   (unsigned)cartesianPlanner.getSegmentCount());
+    } else if (cartesian == CartesianState::FAILED) {
+        out.append("\nCartesian: failed at %u/%u - %s", (unsigned)cartesianPlanner.getSegment(),
+                   (unsigned)cartesianPlanner.getSegmentCount(), cartesianPlanner.getError());
     }
 
-    return parsed;
+    out.append("\nMoving: %s", snapshot.isMoving() ? "yes" : "no");
+    out.append("\nQueued: %u/%u", (unsigned)snapshot.queueDepth,
+               (unsigned)MOTION_QUEUE_SIZE);
+    out.append("\nEnabled: %s", snapshot.enabled ? "yes" : "no");
+}
+
+void CommandParser::reportSettings(CommandResult& out) const {
+    out.append("Settings (FastAccelStepper):\n");
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        const MotorConfig& cfg = motors.getConfig(i);
+        out.append("%s Step:%u Dir:%u SPR:%u uStep:%u Steps/%s:%.3f MaxHz:%lu Accel:%lu Jerk:%lu"
+                   " Min:%ld Max:%ld\n",
+                   cfg.name, cfg.stepPin, cfg.dirPin, cfg.stepsPerRev,
+                   cfg.microstepping, Units::name(i), Units::scale(i),
+                   (unsigned long)motors.getMaxSpeed(i),
+                   (unsigned long)motors.getAcceleration(i),
+                   (unsigned long)motors.getJerk(i),
+                   (long)motors.getLimitMin(i), (long)motors.getLimitMax(i));
+    }
+
+    out.append("Saved: %s\n", settingsStore.isSaved() ? "yes" : "no");
+    out.append("Coordinated: %s", motors.isCoordinated() ? "on" : "off");
+    out.append("\nJoint units: %s", _jointUnits ? "on" : "off");
+}
+
+void CommandParser::appendJoint(CommandResult& out, int joint, long steps) const {
+    if (!_jointUnits) {
+        out.append(" J%d:%ld", joint + 1, steps);
+        return;
+    }
+    char value[16];
+    Units::format(Units::fromSteps(joint, steps), value, sizeof(value));
+    out.append(" J%d:%s", joint + 1, value);
 }
 
-bool CommandParser::parseInt(const String& str, long& value) {
-    String s = str;
-    s.trim();
+void CommandParser::reportQuickStatus(CommandResult& out) const {
+    MotionSnapshot snapshot = telemetry.get();
+
+    char activity = snapshot.homing ? 'H' : (snapshot.isMoving() ? 'M' : 'I');
+    out.append("%c%c P:", snapshot.enabled ? 'E' : 'D',  // Enabled/Disabled
+                          activity);                     // Homing/Moving/Idle
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        out.append(i > 0 ? ",%ld" : "%ld", (long)snapshot.position[i]);
+    }
+
+    out.append(" Q:%u", (unsigned)snapshot.queueDepth);
+}
+
+void CommandParser::reportProgramStatus(CommandResult& out) const {
+    PlaybackState state = programPlayer.getState();
+    if (state == PlaybackState::IDLE) {
+        out.append("No program selected");
+        return;
+    }
+
+    out.append("Program: %s %s byte %u/%u line %lu", programPlayer.getName(),
+               ProgramPlayer::stateName(state),
+               (unsigned)programPlayer.getBytesExecuted(),
+               (unsigned)programPlayer.getFileSize(),
+               (unsigned long)programPlayer.getLineNumber());
+
+    if (state == PlaybackState::FAILED) {
+        out.append("\n%s", programPlayer.getError());
+    }
+}
 
-    if (s.length() == 0) {
+void CommandParser::reportTrajectoryStatus(CommandResult& out) const {
+    TrajectoryState state = trajectoryPlayer.getState();
+    out.append("Trajectory: %s", TrajectoryPlayer::stateName(state));
+    if (state == TrajectoryState::EMPTY) {
+        return;
+    }
+
+    out.append(" record %lu/%lu", (unsigned long)trajectoryPlayer.getIndex(),
+               (unsigned long)trajectoryPlayer.getRecordCount());
+    if (trajectoryPlayer.getRepeat() == 0) {
+        out.append(" pass %lu", (unsigned long)trajectoryPlayer.getPass());
+    } else {
+        out.append(" pass %lu/%lu", (unsigned long)trajectoryPlayer.getPass(),
+                   (unsigned long)trajectoryPlayer.getRepeat());
+    }
+}
+
+bool CommandParser::parseArgs(const char* text, size_t length, CommandArgs& args,
+                              const char*& errorWord, size_t& errorLength) {
+    args.jointMask = 0;
+    args.paramMask = 0;
+
+    size_t pos = 0;
+    while (pos < length) {
+        // Skip separators
+        while (pos < length && isspace((unsigned char)text[pos])) {
+            pos++;
+        }
+        if (pos >= length) {
+            break;
+        }
+
+        // Find end of word
+        size_t start = pos;
+        while (pos < length && !isspace((unsigned char)text[pos])) {
+            pos++;
+        }
+        const char* word = text + start;
+        size_t wordLength = pos - start;
+
+        errorWord = word;
+        errorLength = wordLength;
+
+        char letter = toupper(word[0]);
+        if (letter < 'A' || letter > 'Z') {
+            return false;
+        }
+
+        if (letter == 'J') {
+            // Joint word: J<n>:<value>
+            const char* colon = (const char*)memchr(word, ':', wordLength);
+            if (!colon) {
+                return false;
+            }
+
+            long jointNum;
+            if (!parseInt(word + 1, colon - word - 1, jointNum) ||
+                jointNum < 1 || jointNum > MOTOR_COUNT) {
+                return false;
+            }
+
+            // Steps, or degrees/mm converted in fixed point (M801)
+            long value;
+            if (_jointUnits) {
+                int32_t milli;
+                if (!parseFixed(colon + 1, word + wordLength - colon - 1, milli)) {
+                    return false;
+                }
+                value = Units::toSteps(jointNum - 1, milli);
+            } else if (!parseInt(colon + 1, word + wordLength - colon - 1, value)) {
+                return false;
+            }
+
+            args.joints[jointNum - 1] = value;  // Convert to 0-indexed
+            args.jointMask |= 1 << (jointNum - 1);
+        } else {
+            // Letter parameter: <L><value>
+            long value;
+            float decimal;
+            if (parseInt(word + 1, wordLength - 1, value)) {
+                decimal = value;
+            } else if (parseDecimal(word + 1, wordLength - 1, decimal)) {
+                value = lroundf(decimal);
+            } else {
+                return false;
+            }
+            args.params[letter - 'A'] = value;
+            args.values[letter - 'A'] = decimal;
+            args.paramMask |= 1UL << (letter - 'A');
+        }
+    }
+
+    return true;
+}
+
+bool CommandParser::parseInt(const char* text, size_t length, long& value) {
+    if (length == 0) {
         return false;
     }
 
     // Check for valid integer format
-    int start = 0;
-    if (s.charAt(0) == '-' || s.charAt(0) == '+') {
+    size_t start = 0;
+    bool negative = false;
+    if (text[0] == '-' || text[0] == '+') {
+        negative = (text[0] == '-');
         start = 1;
     }
 
-    for (int i = start; i < s.length(); i++) {
-        if (!isDigit(s.charAt(i))) {
+    if (start == length) {
+        return false;
+    }
+
+    int64_t result = 0;
+    for (size_t i = start; i < length; i++) {
+        if (!isDigit(text[i])) {
+            return false;
+        }
+        result = result * 10 + (text[i] - '0');
+        if (result > LONG_MAX) {
+            return false;  // Overflow
+        }
+    }
+
+    value = negative ? -result : result;
+    return true;
+}
+
+bool CommandParser::parseFixed(const char* text, size_t length, int32_t& milli) {
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < length && (text[pos] == '-' || text[pos] == '+')) {
+        negative = (text[pos] == '-');
+        pos++;
+    }
+
+    // Integer part, then up to three decimals; a fourth rounds
+    int32_t value = 0;
+    int digits = 0;
+    int fraction = -1;  // Decimals kept (-1 = no point yet)
+    bool roundUp = false;
+    for (; pos < length; pos++) {
+        char ch = text[pos];
+        if (ch == '.' && fraction < 0) {
+            fraction = 0;
+            continue;
+        }
+        if (!isDigit(ch)) {
+            return false;
+        }
+        digits++;
+        if (fraction < 0) {
+            value = value * 10 + (ch - '0');
+            if (value > Units::MAX_UNITS) {
+                return false;
+            }
+        } else if (fraction < 3) {
+            value = value * 10 + (ch - '0');
+            fraction++;
+        } else if (fraction == 3) {
+            roundUp = ch >= '5';
+            fraction++;
+        }
+    }
+
+    if (digits == 0) {
+        return false;
+    }
+
+    for (int i = max(fraction, 0); i < 3; i++) {
+        value *= 10;
+    }
+    value += roundUp;
+    milli = negative ? -value : value;
+    return true;
+}
+
+bool CommandParser::parseDecimal(const char* text, size_t length, float& value) {
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < length && (text[pos] == '-' || text[pos] == '+')) {
+        negative = (text[pos] == '-');
+        pos++;
+    }
+
+    // Accumulate all digits as an integer and scale once at the end
+    int64_t mantissa = 0;
+    int digits = 0;
+    int fraction = -1;  // Digits after the point (-1 = no point yet)
+    for (; pos < length; pos++) {
+        if (text[pos] == '.' && fraction < 0) {
+            fraction = 0;
+            continue;
+        }
+        if (!isDigit(text[pos]) || digits == 15) {
             return false;
         }
+        mantissa = mantissa * 10 + (text[pos] - '0');
+        digits++;
+        if (fraction >= 0) {
+            fraction++;
+        }
+    }
+
+    if (digits == 0) {
+        return false;
+    }
+
+    float result = mantissa;
+    for (int i = 0; i < fraction; i++) {
+        result /= 10;
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+bool CommandParser::parseProgramName(const char* text, size_t length, char* name) {
+    while (length > 0 && isspace((unsigned char)*text)) {
+        text++;
+        length--;
+    }
+
+    if (!ProgramStore::isValidName(text, length)) {
+        return false;
     }
 
-    value = s.toInt();
+    memcpy(name, text, length);
+    name[length] = '\0';
     return true;
 }
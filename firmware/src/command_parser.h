@@ -9,29 +9,119 @@
  * G-code style command parser for robotic arm control
  *
  * Supported commands:
- *   G0 J1:1000 J2:500    - Move joints to absolute positions
- *   G1 J1:100            - Move joints relative to current position
- *   G28                  - Home all axes (sets current position as zero)
+ *   G0 J1:1000 J2:500    - Queue move to absolute positions
+ *   G1 J1:100            - Queue move relative to end of previous move
+ *   G0 X300 Y50 Z200 F80 - Linear Cartesian move of the tool to a pose (mm,
+ *                          A/B/C in degrees, F in mm/s); omitted axes keep
+ *                          their value. Interpolated on the device.
+ *   G1 Z-20.5 C15        - Linear Cartesian move by offsets
+ *   G28                  - Home all joints against their endstops in parallel
+ *   G28 J2:1 J3:1        - Home only the listed joints (values ignored)
  *   M17                  - Enable steppers
  *   M18                  - Disable steppers
+ *   M20                  - List stored programs
+ *   M23 pick.gcode       - Select stored program
+ *   M24                  - Start (or resume) selected program
+ *   M25                  - Pause program (queued moves still run)
+ *   M27                  - Report program status
+ *   M30 pick.gcode       - Delete stored program
  *   M112                 - Emergency stop
  *   M114                 - Report current positions
+ *   M119                 - Report endstop states and homing progress
+ *   M154 S100            - Auto-report changed joints on Serial at most
+ *                          every S ms (S0 off; B1 binary frames, B0 text);
+ *                          M154 alone reports the setting
+ *   M201 J1:20000        - Acceleration per joint (steps/s^2); M201 alone
+ *                          reports
+ *   M203 J1:8000         - Maximum speed per joint (steps/s); M203 alone
+ *                          reports
+ *   M205 J2:100000       - Jerk limit per joint (steps/s^3, 0 = trapezoid);
+ *                          M205 alone reports
+ *   M208 J1:90000        - Soft limit maximum per joint (S1: minimum);
+ *                          M208 alone reports both
+ *   M500                 - Save M201/M203/M205/M208 values (NVS, loaded at
+ *                          boot); refused while moving
+ *   M501                 - Reload the saved values
+ *   M502                 - Back to the config.h defaults (M500 to keep)
  *   M503                 - Report settings
+ *   M575 B921600         - Change serial baud rate (after this reply)
+ *   M524                 - Abort program (stops motion)
+ *   M720 L10             - Play stored binary trajectory (L passes, L0 = loop)
+ *   M721                 - Stop trajectory (stops motion)
+ *   M722                 - Report trajectory status
+ *   M800 S1              - Coordinated moves on (S0 = independent joints)
+ *   M801 S1              - J words and M114 in joint units (degrees or mm
+ *                          per JOINT_UNITS, speeds per second); S0 = steps
+ *   M810 J1:500 J2:-300  - Jog at signed speeds (steps/s); omitted joints
+ *                          stop, M810 alone stops all. Repeat within
+ *                          JOG_WATCHDOG_MS or the joints ramp down.
+ *   M850                 - Report latency histograms, counters, queue
+ *                          high-water marks and heap (M850 R1 resets)
+ *   M860 S1 R2000        - Record a motion trace at R Hz (S0 stops)
+ *   M860 S2 P200         - Arm it: stop P ms after an E-stop/fault
+ *                          (M860 E1 triggers by hand; M860 reports)
+ *   M870 S1 G1           - Multi-arm sync: S1 master, S2 follower, S0 off
+ *                          (G group, P1 start on the sync pulse); M870
+ *                          alone reports the clock
+ *   M871 H1              - Hold queued moves for a synchronized start
+ *                          (H0 releases); T<ms> starts at shared clock
+ *                          time T, D<ms> (master) starts the whole group
+ *                          D ms from now
+ *   M880 S2 E128 D16     - Encoder feedback: S0 off, S1 monitor, S2 also
+ *                          correct; E fault / D correction threshold
+ *                          (steps), R1 clears a fault; M880 reports the
+ *                          measured positions and following errors
  *   ?                    - Quick status
+ *
+ * Moves are appended to the motion queue. When the queue is full (or it is
+ * busy homing or feeding a Cartesian move) the command is rejected with
+ * result.busy set, e.g. "error: Queue full", so the host can retry once a
+ * segment has been consumed.
+ *
+ * The parser tokenizes the command in place and never touches the heap:
+ * arguments go into a fixed CommandArgs struct and responses are written
+ * into the CommandResult's inline buffer.
  */
 
 // Command result structure
 struct CommandResult {
     bool success;
-    String message;
+    bool busy;       // Rejected due to backpressure (retry later)
+    size_t length;   // Characters used in message
+    char message[COMMAND_RESPONSE_SIZE];
+
+    static CommandResult ok(const char* msg = "ok");
+
+    // printf-style, prefixed with "error: "
+    static CommandResult error(const char* format, ...);
+
+    static CommandResult queueFull();
 
-    static CommandResult ok(const String& msg = "ok") {
-        return {true, msg};
-    }
+    // Error with busy set: the command can be retried later as-is
+    static CommandResult busyError(const char* reason);
 
-    static CommandResult error(const String& msg) {
-        return {false, "error: " + msg};
-    }
+    // printf-style append to message (truncates at buffer size)
+    void append(const char* format, ...);
+};
+
+/**
+ * Parsed command arguments
+ *
+ * Joint words use the form "J<n>:<value>"; every other word is a single
+ * letter followed by a number (e.g. "S1", "F2000", "X-12.5"). Decimal
+ * values are rounded for get(); getFloat() returns them exactly.
+ */
+struct CommandArgs {
+    long joints[MOTOR_COUNT];   // Only joints in jointMask are set
+    uint8_t jointMask;          // Bit n set = J<n+1> present
+    long params[26];            // Letter parameters A-Z
+    float values[26];           // The same, unrounded
+    uint32_t paramMask;         // Bit n set = letter 'A' + n present
+
+    bool has(char letter) const;
+    bool hasJoint(uint8_t joint) const { return (jointMask >> joint) & 1; }
+    long get(char letter, long fallback = 0) const;
+    float getFloat(char letter, float fallback = 0) const;
 };
 
 class CommandParser {
@@ -39,45 +129,128 @@ public:
     CommandParser();
 
     /**
-     * Parse and execute a command string
-     * @param command The command to parse (e.g., "G0 J1:1000")
+     * Parse and execute a command
+     * @param command Command text (e.g., "G0 J1:1000"), need not be terminated
+     * @param length Number of characters in command
      * @return Result with success/error and message
      */
-    CommandResult execute(const String& command);
+    CommandResult execute(const char* command, size_t length);
 
     /**
-     * Get status as a string (for M114)
+     * Parse and execute a NUL-terminated command
      */
-    String getPositionReport() const;
+    CommandResult execute(const char* command) { return execute(command, strlen(command)); }
 
     /**
-     * Get settings as a string (for M503)
+     * Check whether a command takes a motion queue slot (G0/G1)
+     * Only looks at the command code; arguments are not validated
      */
-    String getSettingsReport() const;
+    static bool isQueuedMove(const char* command, size_t length);
 
     /**
-     * Get quick status (for ?)
+     * Why moves are refused for now (homing, Cartesian move being fed), or
+     * nullptr if they can be queued. Call on the motion task.
      */
-    String getQuickStatus() const;
+    static const char* moveBusyReason();
+
+    /**
+     * Queue a joint move with the checks G0/G1 make (jogging, busy, queue
+     * full, limits), so every move path reports them the same way.
+     * Call on the motion task.
+     */
+    static CommandResult queueMove(const MoveRequest& move);
+
+    /**
+     * Append position report to a result (for M114)
+     */
+    void reportPositions(CommandResult& out) const;
+
+    /**
+     * Append settings report to a result (for M503)
+     */
+    void reportSettings(CommandResult& out) const;
+
+    /**
+     * Append quick status to a result (for ?)
+     */
+    void reportQuickStatus(CommandResult& out) const;
+
+    /**
+     * Append program playback status to a result (for M27)
+     */
+    void reportProgramStatus(CommandResult& out) const;
+
+    /**
+     * Append trajectory playback status to a result (for M722)
+     */
+    void reportTrajectoryStatus(CommandResult& out) const;
 
 private:
+    // execute() without the instrumentation
+    CommandResult executeCommand(const char* command, size_t length);
+
     // Command handlers
-    CommandResult handleG0(const String& args);   // Move absolute
-    CommandResult handleG1(const String& args);   // Move relative
-    CommandResult handleG28(const String& args);  // Home
-    CommandResult handleM17();                    // Enable
-    CommandResult handleM18();                    // Disable
-    CommandResult handleM112();                   // Emergency stop
-    CommandResult handleM114();                   // Position report
-    CommandResult handleM503();                   // Settings report
-
-    // Parse joint positions from args string
-    // Format: "J1:1000 J2:500" -> fills positions array
-    // Returns number of joints parsed, -1 on error
-    int parseJointPositions(const String& args, long positions[MOTOR_COUNT]);
-
-    // Parse a single integer value from a string
-    bool parseInt(const String& str, long& value);
+    CommandResult handleG0(const CommandArgs& args);   // Move absolute
+    CommandResult handleG1(const CommandArgs& args);   // Move relative
+    CommandResult handleG28(const CommandArgs& args);  // Home
+    CommandResult handleCartesianMove(const CommandArgs& args, bool relative);  // G0/G1 X..C
+    CommandResult handleM17();                         // Enable
+    CommandResult handleM18();                         // Disable
+    CommandResult handleM20();                         // List programs
+    CommandResult handleM23(const char* name, size_t length);  // Select program
+    CommandResult handleM24();                         // Start/resume program
+    CommandResult handleM25();                         // Pause program
+    CommandResult handleM27();                         // Program status
+    CommandResult handleM30(const char* name, size_t length);  // Delete program
+    CommandResult handleM112();                        // Emergency stop
+    CommandResult handleM114();                        // Position report
+    CommandResult handleM119();                        // Endstops / homing status
+    CommandResult handleM154(const CommandArgs& args); // Serial auto-report
+    CommandResult handleM201(const CommandArgs& args); // Acceleration limits
+    CommandResult handleM203(const CommandArgs& args); // Speed limits
+    CommandResult handleM205(const CommandArgs& args); // Jerk limits
+    CommandResult handleM208(const CommandArgs& args); // Soft position limits
+    CommandResult handleM500();                        // Save settings
+    CommandResult handleM501();                        // Load settings
+    CommandResult handleM502();                        // Default settings
+    CommandResult handleM503();                        // Settings report
+    CommandResult handleM524();                        // Abort program
+    CommandResult handleM575(const CommandArgs& args); // Serial baud rate
+    CommandResult handleM720(const CommandArgs& args); // Play trajectory
+    CommandResult handleM721();                        // Stop trajectory
+    CommandResult handleM722();                        // Trajectory status
+    CommandResult handleM800(const CommandArgs& args); // Coordinated move mode
+    CommandResult handleM801(const CommandArgs& args); // Joint units mode
+    CommandResult handleM810(const CommandArgs& args); // Jog (velocity mode)
+    CommandResult handleM850(const CommandArgs& args); // Metrics report
+    CommandResult handleM860(const CommandArgs& args); // Motion trace
+    CommandResult handleM870(const CommandArgs& args); // Multi-arm sync clock
+    CommandResult handleM871(const CommandArgs& args); // Synchronized start
+    CommandResult handleM880(const CommandArgs& args); // Encoder feedback
+
+    // J words are degrees/mm (M801 S1) rather than steps
+    bool _jointUnits;
+
+    // Append " J<n>:<position>" in the current units
+    void appendJoint(CommandResult& out, int joint, long steps) const;
+
+    // Tokenize arguments in place into args
+    // Returns false (with the offending word in errorWord) on bad syntax
+    bool parseArgs(const char* text, size_t length, CommandArgs& args,
+                   const char*& errorWord, size_t& errorLength);
+
+    // Parse a signed integer from a span
+    static bool parseInt(const char* text, size_t length, long& value);
+
+    // Parse a signed decimal into thousandths ("-12.5" -> -12500) without
+    // floating point; at most Units::MAX_UNITS in magnitude
+    static bool parseFixed(const char* text, size_t length, int32_t& milli);
+
+    // Parse a signed decimal number ("-12.5", "3.", ".25") from a span
+    static bool parseDecimal(const char* text, size_t length, float& value);
+
+    // Copy a program name argument into name (NUL-terminated)
+    static bool parseProgramName(const char* text, size_t length, char* name);
 };
 
 // Global command parser instance
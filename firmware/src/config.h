@@ -11,16 +11,75 @@
 #define WIFI_PASSWORD "YOUR_WIFI_PASSWORD"
 #define WIFI_HOSTNAME "roboarm"
 
+// WiFi connects in the background (setup does not wait for it); while the
+// link is down, reconnects are retried at this interval
+#define WIFI_RECONNECT_INTERVAL_MS 10000
+
 // =============================================================================
 // Serial Configuration
 // =============================================================================
 #define SERIAL_BAUD_RATE 115200
 
+// Upper bound for runtime baud changes (M575 B<baud>)
+#define SERIAL_MAX_BAUD_RATE 3000000
+
+// UART driver receive buffer (set before Serial.begin). The default 256
+// bytes overflows while loop() is busy with WiFi at high stream rates.
+#define SERIAL_RX_BUFFER_SIZE 4096
+
+// UART driver transmit buffer, so replies and M154 auto-reports are queued
+// instead of blocking the serial task until the FIFO drains
+#define SERIAL_TX_BUFFER_SIZE 1024
+
+// Line reader ring buffer (power of two)
+#define SERIAL_RING_SIZE 1024
+
+// Read serial input in a dedicated FreeRTOS task instead of loop(), so
+// WiFi work cannot starve it
+#define SERIAL_TASK_ENABLED true
+#define SERIAL_TASK_CORE 0
+#define SERIAL_TASK_PRIORITY 3
+#define SERIAL_TASK_STACK_SIZE 6144
+
+// =============================================================================
+// Motion Task
+// =============================================================================
+// Motion queue dispatch and program playback run in their own task, pinned
+// away from WiFi/AsyncTCP (core 0). Serial and web ingest hand commands to
+// it through lock-free SPSC queues (see motion_task.h).
+#define MOTION_TASK_ENABLED true
+#define MOTION_TASK_CORE 1
+#define MOTION_TASK_PRIORITY 5      // Above loop() (1) and serial ingest (3)
+#define MOTION_TASK_STACK_SIZE 8192
+
+// The task wakes on every command and at least this often to dispatch
+// queued segments (must be well below PLANNER_HANDOFF_MARGIN_US)
+#define MOTION_TASK_INTERVAL_MS 1
+
+// Requests per ingest channel (power of two)
+#define MOTION_CHANNEL_DEPTH 4
+
+// The motion task publishes a consistent snapshot of all joints at this
+// interval (and after every command) for the reporting paths to read
+#define TELEMETRY_PUBLISH_INTERVAL_US 5000
+
+// =============================================================================
+// Command Parser Configuration
+// =============================================================================
+// Commands are parsed in place and results are written to fixed buffers,
+// so the command path never allocates. Longest response is M503.
+#define COMMAND_MAX_LENGTH 256
+#define COMMAND_RESPONSE_SIZE 1024
+
 // =============================================================================
 // Motor Configuration
 // =============================================================================
 #define MOTOR_COUNT 6
 
+// Joint sets are passed as bitmasks (bit n = joint n+1), in a uint8_t
+#define MAX_JOINTS 8
+constexpr uint8_t ALL_JOINTS_MASK = (uint8_t)((1u << MOTOR_COUNT) - 1);
+
 // Motor indices
 #define JOINT_1 0  // Base rotation
 #define JOINT_2 1  // Shoulder
@@ -38,8 +97,14 @@ struct MotorConfig {
     uint8_t microstepping;
     uint32_t maxSpeedHz;     // steps per second (FastAccelStepper uses Hz)
     uint32_t acceleration;   // steps per second^2
+    uint32_t jerk;           // steps per second^3 (0 = trapezoidal ramps)
     bool invertDir;          // Invert direction
     const char* name;        // Joint name for debugging
+    int8_t endstopPin;       // Homing switch input (-1 = none, G28 just zeroes)
+    int8_t homeDir;          // Direction towards the switch (-1 or +1)
+    int8_t encoderPinA;      // Quadrature/ABI encoder channel A (-1 = none)
+    int8_t encoderPinB;      // Channel B
+    uint16_t encoderCountsPerRev;  // Counts per motor revolution, x4 (0 = none)
 };
 
 // =============================================================================
@@ -48,25 +113,73 @@ struct MotorConfig {
 // Shared enable pin for all drivers (active LOW)
 #define MOTORS_ENABLE_PIN 4
 
+// jerk > 0 gives a joint S-curve ramps: its acceleration builds up over
+// accel / jerk seconds instead of jumping to full (FastAccelStepper's
+// linear-acceleration phase), which keeps the long J2/J3 links from ringing
+// and losing steps at high acceleration. Change at runtime with M205.
+//
 // Motor configurations using validated safe GPIO pins
 // Based on ESP32 research: GPIO 6-11 are flash, 34-39 are input-only
 // Safe pins: 4, 13, 14, 16-19, 21-23, 25-27, 32-33
-const MotorConfig MOTOR_CONFIGS[MOTOR_COUNT] = {
-    // stepPin, dirPin, enablePin, stepsPerRev, microstepping, maxSpeedHz, accel, invertDir, name
-    {16, 17, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, false, "J1-Base"},
-    {18, 19, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, false, "J2-Shoulder"},
-    {21, 22, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, false, "J3-Elbow"},
-    {23, 25, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, false, "J4-WristPitch"},
-    {26, 27, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, false, "J5-WristRoll"},
-    {32, 33, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, false, "J6-Gripper"},
+// Endstops use input-only GPIO 35/36/39 (no internal pull-ups - fit external
+// ones, 10k to 3.3V) and 13/14; GPIO 34 is kept for the optional E-stop.
+// GPIO 36/39 also see short false edges while WiFi or the ADC is powered;
+// homing only accepts an edge the switch confirms (ENDSTOP_CONFIRM_US)
+constexpr MotorConfig MOTOR_CONFIGS[MOTOR_COUNT] = {
+    // stepPin, dirPin, enablePin, stepsPerRev, microstepping, maxSpeedHz, accel, jerk, invertDir, name, endstopPin, homeDir, encA, encB, encCounts
+    {16, 17, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000,      0, false, "J1-Base",       35, -1, -1, -1, 0},
+    {18, 19, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, 100000, false, "J2-Shoulder",   36, -1, -1, -1, 0},
+    {21, 22, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000, 100000, false, "J3-Elbow",      39, -1, -1, -1, 0},
+    {23, 25, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000,      0, false, "J4-WristPitch", 13, -1, -1, -1, 0},
+    {26, 27, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000,      0, false, "J5-WristRoll",  14, -1, -1, -1, 0},
+    {32, 33, MOTORS_ENABLE_PIN, 200, 16, 50000, 10000,      0, false, "J6-Gripper",    -1, -1, -1, -1, 0},
+};
+
+// Calculated full revolution steps (with microstepping); folds to a
+// constant for a constant motor index
+constexpr uint32_t getFullRevolution(uint8_t motor) {
+    return motor >= MOTOR_COUNT ? 3200
+                                : (uint32_t)MOTOR_CONFIGS[motor].stepsPerRev *
+                                      MOTOR_CONFIGS[motor].microstepping;
+}
+
+// =============================================================================
+// Joint Units
+// =============================================================================
+// What one motor revolution moves each joint by, in the joint's own unit.
+// With M801 S1 the parser takes and reports J words in these units (degrees
+// or mm, speeds per second). The step conversion factors are fixed-point
+// constants derived from this table at compile time (units.h).
+enum class JointUnit : uint8_t {
+    DEGREES,
+    MILLIMETERS
+};
+
+struct JointUnitConfig {
+    JointUnit unit;
+    double perMotorRev;    // Degrees or mm per motor revolution
 };
 
-// Calculated full revolution steps (with microstepping)
-inline uint32_t getFullRevolution(uint8_t motor) {
-    if (motor >= MOTOR_COUNT) return 3200;
-    return MOTOR_CONFIGS[motor].stepsPerRev * MOTOR_CONFIGS[motor].microstepping;
+// Rotary joint: gearRatio motor revolutions per joint revolution
+constexpr JointUnitConfig rotaryJoint(double gearRatio) {
+    return { JointUnit::DEGREES, 360.0 / gearRatio };
 }
 
+// Linear axis (lead screw, belt): mm of travel per motor revolution
+constexpr JointUnitConfig linearJoint(double mmPerRev) {
+    return { JointUnit::MILLIMETERS, mmPerRev };
+}
+
+// Joints in the kinematic chain must be rotary
+constexpr JointUnitConfig JOINT_UNITS[MOTOR_COUNT] = {
+    rotaryJoint(10.0),   // J1: 10:1 belt
+    rotaryJoint(50.0),   // J2: 50:1 planetary
+    rotaryJoint(50.0),   // J3: 50:1 planetary
+    rotaryJoint(13.6),   // J4
+    rotaryJoint(10.0),   // J5
+    rotaryJoint(19.4),   // J6
+};
+
 // =============================================================================
 // Default Motion Parameters
 // =============================================================================
@@ -74,11 +187,227 @@ inline uint32_t getFullRevolution(uint8_t motor) {
 #define DEFAULT_ACCEL 500          // steps/sec²
 #define MAX_SPEED_HZ 50000         // safety limit
 
+// =============================================================================
+// Motion Queue Configuration
+// =============================================================================
+// G0/G1 segments are buffered in a ring buffer and executed back-to-back.
+// When the queue is full, commands are rejected with "error: Queue full"
+// (HTTP 503) and the host should retry after a segment completes.
+#define MOTION_QUEUE_SIZE 32
+
+// Coordinated moves rescale each joint's speed/acceleration so all joints
+// in a move arrive at the same time (toggle at runtime with M800 S0/S1)
+#define DEFAULT_COORDINATED_MOVES true
+
+// Look-ahead: joints moving the same way across a junction keep their speed
+// instead of stopping. The next segment is handed to the stepper when the
+// joint is exit^2 / (2 a) from the junction - where its stop ramp would pass
+// the planned exit speed - plus this long at the current speed.
+#define LOOKAHEAD_ENABLED true
+#define PLANNER_HANDOFF_MARGIN_US 2000
+
+// Jog (velocity) mode, M810: joints ramp down if no new jog command arrives
+// within this time (teleoperation sends one about every 50 ms)
+#define JOG_WATCHDOG_MS 250
+
+// =============================================================================
+// Homing (G28)
+// =============================================================================
+// Each joint with an endstop seeks the switch fast, backs off, then creeps
+// back onto it; the position is latched from the switch interrupt's
+// timestamp. All joints home in parallel. The switch position becomes 0.
+#define ENDSTOP_ACTIVE_LOW true        // Switch pulls the input LOW (NO switch to GND)
+#define ENDSTOP_CONFIRM_US 500         // Switch must still read active this long after the edge
+#define HOMING_SEEK_SPEED_HZ 8000
+#define HOMING_SEEK_ACCEL 40000
+#define HOMING_CREEP_SPEED_HZ 400
+#define HOMING_BACKOFF_STEPS 800
+
+// =============================================================================
+// Kinematics (Cartesian moves)
+// =============================================================================
+// Standard Denavit-Hartenberg parameters of the chain, base to tool flange.
+// The DH joint angle is theta = steps / steps-per-radian + thetaOffset, so
+// thetaOffset is the angle at the homed (0 step) position. Gear ratios come
+// from JOINT_UNITS.
+struct DhParameters {
+    float a;             // Link length (mm)
+    float alpha;         // Link twist (degrees)
+    float d;             // Link offset (mm)
+    float thetaOffset;   // Joint angle at step 0 (degrees)
+};
+
+// Joints 1..KINEMATICS_JOINTS form the chain; any others (a gripper) are
+// left alone by Cartesian moves. With fewer than 6 joints the orientation
+// is matched as closely as the chain allows.
+#define KINEMATICS_JOINTS 6
+
+// Example: shoulder offset 50 mm, 300 mm upper arm, 250 mm forearm and a
+// spherical wrist. At step 0 the upper arm is vertical, the forearm points
+// along +X and the flange points straight down: X300 Y0 Z390 A180 B0 C0.
+// Measure your own arm.
+const DhParameters DH_PARAMETERS[KINEMATICS_JOINTS] = {
+    // a,    alpha,  d,      thetaOffset
+    {  50.0f, -90.0f, 170.0f,   0.0f},
+    { 300.0f,   0.0f,   0.0f, -90.0f},
+    {   0.0f, -90.0f,   0.0f,   0.0f},
+    {   0.0f,  90.0f, 250.0f,   0.0f},
+    {   0.0f, -90.0f,   0.0f,  90.0f},
+    {   0.0f,   0.0f,  80.0f,   0.0f},
+};
+
+// Tool centre point along the flange Z axis (mm)
+#define KINEMATICS_TOOL_LENGTH 0.0f
+
+// Inverse kinematics: damped least squares, seeded with the previous
+// solution. Orientation error is weighted as if 1 rad were this many mm.
+#define IK_MAX_ITERATIONS 64
+#define IK_POSITION_TOLERANCE_MM 0.01f
+#define IK_ORIENTATION_TOLERANCE_RAD 0.0002f
+#define IK_ORIENTATION_WEIGHT_MM 100.0f
+#define IK_DAMPING_MM 1.0f
+#define IK_MAX_STEP_MM 50.0f       // Task-space error clamp per iteration
+
+// Linear Cartesian moves (G0/G1 X Y Z A B C) are cut into short joint
+// segments on the device while the motion queue has room
+#define CARTESIAN_SEGMENT_MM 2.0f          // Longest segment (position)
+#define CARTESIAN_SEGMENT_DEG 1.0f         // Longest segment (orientation)
+#define CARTESIAN_DEFAULT_SPEED_MM_S 50.0f // Without F (mm/s)
+#define CARTESIAN_MAX_SPEED_MM_S 500.0f
+#define CARTESIAN_ROTATION_SPEED_DEG_S 45.0f
+#define CARTESIAN_MAX_SEGMENTS 4000
+#define CARTESIAN_SEGMENTS_PER_UPDATE 4
+
+// =============================================================================
+// Metrics
+// =============================================================================
+// Cycle-counter timers around parse/plan/dispatch and the motion loop,
+// fixed-bucket latency histograms, queue high-water marks and heap stats,
+// reported by M850 and GET /api/metrics (Prometheus text). A sample costs
+// a few dozen cycles; false compiles the timers out.
+#define METRICS_ENABLED true
+#define METRICS_RESPONSE_CHUNK 1024   // AsyncResponseStream buffer growth (bytes)
+
+// =============================================================================
+// Motion Trace
+// =============================================================================
+// Joint positions, speeds and queue state sampled into a delta-encoded
+// ring, for post-mortems of a bad move. An esp_timer only marks a sample
+// due and wakes the motion task, which takes it in step().
+// M860 records or arms it around E-stop/faults; GET /api/trace downloads
+// it. Uses PSRAM when the core maps it (BOARD_HAS_PSRAM, env:esp32s3),
+// else a small heap buffer; either is allocated on the first M860 S1.
+#define TRACE_DEFAULT_RATE_HZ 1000
+#define TRACE_MIN_RATE_HZ 100
+#define TRACE_MAX_RATE_HZ 5000
+#define TRACE_DEFAULT_POST_TRIGGER_MS 200   // Recorded after a trigger (M860 S2 P)
+#define TRACE_BLOCK_SIZE 1024               // Bytes; each block starts with a keyframe
+#define TRACE_PSRAM_SIZE (2 * 1024 * 1024)  // ~30 s at 5 kHz
+#define TRACE_DRAM_SIZE (16 * 1024)         // ~1 s at 1 kHz
+
+// =============================================================================
+// Auto-report
+// =============================================================================
+// Change-driven status frames (M154 on Serial, {"report": ...} on /ws):
+// only joints that moved or changed state since the last frame, at most
+// once per interval, plus a full keyframe every AUTO_REPORT_KEYFRAME_MS
+// (0 = only the first) so late or lossy listeners resynchronize.
+#define AUTO_REPORT_MIN_INTERVAL_MS 10
+#define AUTO_REPORT_KEYFRAME_MS 5000
+#define AUTO_REPORT_LINE_SIZE 256           // Text frame buffer (6 joints fit)
+
+// =============================================================================
+// Multi-arm Synchronization
+// =============================================================================
+// Controllers on one LAN share a clock: the master (M870 S1) broadcasts
+// its time over UDP and followers (M870 S2) track their offset from the
+// fastest beacons. M871 then starts held moves on every arm of the group
+// at one shared instant. See arm_sync.h.
+#define SYNC_UDP_PORT 4210
+#define SYNC_DEFAULT_GROUP 1
+#define SYNC_BEACON_INTERVAL_MS 100
+#define SYNC_FILTER_BEACONS 16          // Offset window (max of the samples)
+#define SYNC_LOCK_TIMEOUT_MS 1000       // Unlocked after this long without a beacon
+#define SYNC_START_REPEATS 3            // START broadcasts per M871 D
+#define SYNC_MIN_LEAD_MS 20             // Shortest M871 D (followers must hear it)
+#define SYNC_SPIN_US 300                // Busy-wait the last stretch before a start
+
+// Optional sync-pulse line (M870 P1): the master drives it high at the
+// start and followers start on its rising edge, for microsecond alignment
+// without WiFi jitter. Wire the pins of all controllers together (-1 = none).
+#define SYNC_PULSE_PIN -1
+#define SYNC_PULSE_WIDTH_US 1000
+
 // =============================================================================
 // Web Server Configuration
 // =============================================================================
 #define WEB_SERVER_PORT 80
 
+// WebSocket streaming endpoint (/ws): default telemetry push interval,
+// changeable per connection with {"telemetry_ms": N} (0 = off)
+#define WS_TELEMETRY_INTERVAL_MS 100
+#define WS_MIN_TELEMETRY_INTERVAL_MS 10
+
+// Largest body accepted by POST /api/batch
+#define BATCH_MAX_BODY_SIZE 16384
+
+// Static arenas for JSON documents built by request handlers, by the
+// telemetry push and by deferred requests on the motion task; larger
+// documents spill over to the heap
+#define WEB_JSON_ARENA_SIZE 8192
+#define WEB_TELEMETRY_ARENA_SIZE 1024
+#define WEB_DEFERRED_ARENA_SIZE 2048
+
+// HTTP requests for the motion task in flight at once: the handler hands
+// the request to the motion task and AsyncTCP sends the reply when it has
+// run, so the AsyncTCP task never waits on a slow command. Further
+// requests get 503.
+#define WEB_DEFERRED_SLOTS 4
+
+// How long a deferred HTTP request waits for the motion task before its
+// reply is left to the connection's next TCP poll (up to 500 ms later)
+#define WEB_DEFERRED_WAIT_MS 5
+
+// WebSocket messages for the motion task in flight, all clients together
+// (power of two). Replies keep the message order, so a client that finds
+// the ring full while its earlier messages are in it is disconnected.
+#define WS_DEFERRED_SLOTS 8
+
+// Browsers cache the web UI and revalidate it by ETag afterwards
+#define WEB_UI_CACHE_CONTROL "max-age=3600"
+
+// =============================================================================
+// Settings Storage
+// =============================================================================
+// Joint speed/accel/jerk/soft limits saved by M500 (NVS, loaded at boot)
+#define SETTINGS_NVS_NAMESPACE "roboarm"
+#define SETTINGS_NVS_KEY "joints"
+
+// =============================================================================
+// Program Storage
+// =============================================================================
+// G-code programs stored on LittleFS (partition "spiffs" in partitions.csv)
+#define PROGRAM_DIR "/programs"
+#define PROGRAM_NAME_MAX_LENGTH 31
+
+// An unfinished upload idle this long may be replaced by a new one
+#define PROGRAM_UPLOAD_TIMEOUT_MS 10000
+
+// Playback reads the file in blocks, double-buffered so the next block is
+// loaded while the current one is executed
+#define PROGRAM_BLOCK_SIZE 1024
+
+// Lines executed per update() call while the motion queue has room
+#define PROGRAM_LINES_PER_UPDATE 8
+
+// Pre-compiled binary trajectory: raw partition (see partitions.csv),
+// memory-mapped and fed to the motion queue without parsing
+#define TRAJECTORY_PARTITION_LABEL "traj"
+#define TRAJECTORY_PARTITION_SUBTYPE 0x40
+
+// Records queued per update() call while the motion queue has room
+#define TRAJECTORY_RECORDS_PER_UPDATE 8
+
 // =============================================================================
 // Safety Limits
 // =============================================================================
@@ -88,27 +417,97 @@ inline uint32_t getFullRevolution(uint8_t motor) {
 #define MIN_POSITION_STEPS -100000
 
 // Per-joint position limits (in steps)
-const int32_t POSITION_LIMITS_MIN[MOTOR_COUNT] = {-100000, -50000, -50000, -25000, -25000, -10000};
-const int32_t POSITION_LIMITS_MAX[MOTOR_COUNT] = { 100000,  50000,  50000,  25000,  25000,  10000};
+constexpr int32_t POSITION_LIMITS_MIN[MOTOR_COUNT] = {-100000, -50000, -50000, -25000, -25000, -10000};
+constexpr int32_t POSITION_LIMITS_MAX[MOTOR_COUNT] = { 100000,  50000,  50000,  25000,  25000,  10000};
 
 // Emergency stop pin (optional, pull LOW to stop)
 // #define ESTOP_PIN 34
 
+// =============================================================================
+// Encoder Feedback
+// =============================================================================
+// Joints with encoderCountsPerRev set are read by the PCNT peripheral (wire
+// magnetic encoders like the AS5047/AS5600 through their ABI output). Every
+// motion step compares the commanded position with the encoder: an error
+// beyond ENCODER_FAULT_STEPS (plus the lag allowed at the current speed)
+// stops and disables the arm; in CORRECT mode a settled error beyond
+// ENCODER_CORRECT_STEPS is moved out. Change at runtime with M880.
+// 0 = off, 1 = monitor (fault only), 2 = monitor and correct
+#define ENCODER_MODE 1
+#define ENCODER_FAULT_STEPS 128
+#define ENCODER_CORRECT_STEPS 16
+// Commanded position leads the shaft by up to this much time at speed
+#define ENCODER_LAG_ALLOWANCE_US 2000
+// Joint must be at rest this long before a correction
+#define ENCODER_SETTLE_MS 50
+// Glitch filter, in APB clock cycles (80 MHz, at most 1023)
+#define ENCODER_PCNT_FILTER 100
+// Hardware counter range; polled every motion step, so it only has to hold
+// the counts of one step
+#define ENCODER_PCNT_LIMIT 30000
+
+// =============================================================================
+// Arm Description Checks
+// =============================================================================
+// The tables above describe the arm; a 4- or 7-axis variant changes
+// MOTOR_COUNT and their rows. These catch a table that does not match
+// (missing rows are zero-filled) at compile time rather than on the bench.
+static_assert(MOTOR_COUNT >= 1 && MOTOR_COUNT <= MAX_JOINTS,
+              "MOTOR_COUNT must be 1-8 (joint masks are 8 bits)");
+static_assert(KINEMATICS_JOINTS <= MOTOR_COUNT, "KINEMATICS_JOINTS exceeds MOTOR_COUNT");
+
+constexpr bool isValidMotorConfig(const MotorConfig& cfg) {
+    return cfg.stepsPerRev > 0 && cfg.microstepping > 0 &&
+           cfg.maxSpeedHz > 0 && cfg.maxSpeedHz <= MAX_SPEED_HZ &&
+           cfg.acceleration > 0 && cfg.name != nullptr &&
+           (cfg.homeDir == -1 || cfg.homeDir == 1) &&
+           (cfg.encoderCountsPerRev == 0 ||
+            (cfg.encoderPinA >= 0 && cfg.encoderPinB >= 0 &&
+             cfg.encoderPinA != cfg.encoderPinB));
+}
+
+// No two joints share a step pin
+constexpr bool stepPinUnique(uint8_t joint, uint8_t other) {
+    return other >= MOTOR_COUNT ||
+           (MOTOR_CONFIGS[joint].stepPin != MOTOR_CONFIGS[other].stepPin &&
+            stepPinUnique(joint, other + 1));
+}
+
+constexpr bool motorConfigsValid(uint8_t joint) {
+    return joint >= MOTOR_COUNT ||
+           (isValidMotorConfig(MOTOR_CONFIGS[joint]) && stepPinUnique(joint, joint + 1) &&
+            JOINT_UNITS[joint].perMotorRev > 0 &&
+            POSITION_LIMITS_MIN[joint] < POSITION_LIMITS_MAX[joint] &&
+            motorConfigsValid(joint + 1));
+}
+static_assert(motorConfigsValid(0),
+              "MOTOR_CONFIGS, JOINT_UNITS or POSITION_LIMITS_MIN/MAX row invalid or missing");
+
 // =============================================================================
 // Debug Configuration
 // =============================================================================
 #define DEBUG_SERIAL true
-#define DEBUG_COMMANDS true
+#ifndef DEBUG_COMMANDS
+#define DEBUG_COMMANDS true     // Echo every command ("CMD: ..."); off in bench builds
+#endif
 #define DEBUG_MOTORS false
 
+// Debug output is buffered (log_ring.h) and drained to Serial by the serial
+// task between replies, so no task ever blocks on the UART to log
+#define LOG_RING_SIZE 4096
+
 #if DEBUG_SERIAL
-    #define DEBUG_PRINT(x) Serial.print(x)
-    #define DEBUG_PRINTLN(x) Serial.println(x)
-    #define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+    #define DEBUG_PRINT(x) logRing.print(x)
+    #define DEBUG_PRINTLN(x) logRing.println(x)
+    #define DEBUG_PRINTF(...) logRing.printf(__VA_ARGS__)
 #else
     #define DEBUG_PRINT(x)
     #define DEBUG_PRINTLN(x)
     #define DEBUG_PRINTF(...)
 #endif
 
+#if DEBUG_SERIAL
+#include "log_ring.h"
+#endif
+
 #endif // CONFIG_H
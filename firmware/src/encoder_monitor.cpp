@@ -0,0 +1,291 @@
+#include "encoder_monitor.h"
+#include "motor_controller.h"
+#include "program_player.h"
+#include "trajectory.h"
+#include "trace.h"
+
+// Global instance
+EncoderMonitor encoders;
+
+EncoderMonitor::EncoderMonitor()
+    : _mask(0), _mode((EncoderMode)ENCODER_MODE),
+      _faultSteps(ENCODER_FAULT_STEPS), _correctSteps(ENCODER_CORRECT_STEPS),
+      _wasEnabled(false), _restSinceMs(0), _faultMask(0), _faultCount(0),
+      _corrections(0), _error(nullptr) {
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        _unit[i] = PCNT_UNIT_MAX;
+        _stepsPerCountQ24[i] = 0;
+        _lastRaw[i] = 0;
+        _counts[i] = 0;
+        _offset[i] = 0;
+        _origin[i] = 0;
+        _followingError[i] = 0;
+        _maxError[i] = 0;
+    }
+}
+
+bool EncoderMonitor::begin() {
+    _error = nullptr;
+    int count = 0;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (MOTOR_CONFIGS[i].encoderCountsPerRev) {
+            count++;
+        }
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    // Steppers without an encoder may each hold a PCNT unit from the bottom
+    if (MOTOR_COUNT > PCNT_UNIT_MAX) {
+        _error = "Not enough PCNT units for the encoders";
+        return false;
+    }
+
+    int next = PCNT_UNIT_MAX - 1;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        const MotorConfig& cfg = MOTOR_CONFIGS[i];
+        if (!cfg.encoderCountsPerRev) {
+            continue;
+        }
+        if (cfg.encoderPinA < 0 || cfg.encoderPinB < 0) {
+            _error = "Encoder pins not set";
+            return false;
+        }
+        if (!setupUnit(i, (pcnt_unit_t)next--)) {
+            _error = "PCNT setup failed";
+            return false;
+        }
+
+        _stepsPerCountQ24[i] = (uint32_t)(((uint64_t)getFullRevolution(i) << 24) /
+                                          cfg.encoderCountsPerRev);
+        _mask |= 1 << i;
+        reference(i);
+        DEBUG_PRINTF("  %s: Encoder A=%d, B=%d, %u counts/rev (PCNT %d)\n",
+                     cfg.name, cfg.encoderPinA, cfg.encoderPinB,
+                     cfg.encoderCountsPerRev, (int)_unit[i]);
+    }
+    return true;
+}
+
+bool EncoderMonitor::setupUnit(uint8_t joint, pcnt_unit_t unit) {
+    const MotorConfig& cfg = MOTOR_CONFIGS[joint];
+
+    // x4 decoding: each channel counts both edges of one signal, the other
+    // signal's level giving the direction (swap A and B if it counts backwards)
+    pcnt_config_t channel = {};
+    channel.pulse_gpio_num = cfg.encoderPinA;
+    channel.ctrl_gpio_num = cfg.encoderPinB;
+    channel.lctrl_mode = PCNT_MODE_REVERSE;
+    channel.hctrl_mode = PCNT_MODE_KEEP;
+    channel.pos_mode = PCNT_COUNT_DEC;
+    channel.neg_mode = PCNT_COUNT_INC;
+    channel.counter_h_lim = ENCODER_PCNT_LIMIT;
+    channel.counter_l_lim = -ENCODER_PCNT_LIMIT;
+    channel.unit = unit;
+    channel.channel = PCNT_CHANNEL_0;
+    if (pcnt_unit_config(&channel) != ESP_OK) {
+        return false;
+    }
+
+    channel.pulse_gpio_num = cfg.encoderPinB;
+    channel.ctrl_gpio_num = cfg.encoderPinA;
+    channel.pos_mode = PCNT_COUNT_INC;
+    channel.neg_mode = PCNT_COUNT_DEC;
+    channel.channel = PCNT_CHANNEL_1;
+    if (pcnt_unit_config(&channel) != ESP_OK) {
+        return false;
+    }
+
+    pcnt_set_filter_value(unit, ENCODER_PCNT_FILTER);
+    pcnt_filter_enable(unit);
+    pcnt_counter_pause(unit);
+    pcnt_counter_clear(unit);
+    pcnt_counter_resume(unit);
+
+    _unit[joint] = unit;
+    _lastRaw[joint] = 0;
+    _counts[joint] = 0;
+    return true;
+}
+
+void EncoderMonitor::setMode(EncoderMode mode) {
+    if (mode != _mode && _mode == EncoderMode::OFF) {
+        adoptMeasured();  // Errors were not checked while off
+    }
+    _mode = mode;
+}
+
+void EncoderMonitor::poll(uint8_t joint) {
+    int16_t raw = 0;
+    pcnt_get_counter_value(_unit[joint], &raw);
+
+    // The counter resets to 0 on reaching either limit; a jump of more than
+    // half the range is that wrap
+    int32_t delta = (int32_t)raw - _lastRaw[joint];
+    if (delta < -ENCODER_PCNT_LIMIT / 2) {
+        delta += ENCODER_PCNT_LIMIT;
+    } else if (delta > ENCODER_PCNT_LIMIT / 2) {
+        delta -= ENCODER_PCNT_LIMIT;
+    }
+    _lastRaw[joint] = raw;
+    _counts[joint] += delta;
+}
+
+long EncoderMonitor::countsToSteps(uint8_t joint) const {
+    int64_t scaled = _counts[joint] * (int64_t)_stepsPerCountQ24[joint];
+    return (long)((scaled + (1 << 23)) >> 24);
+}
+
+void EncoderMonitor::reference(uint8_t joint) {
+    _offset[joint] = motors.getPosition(joint) - countsToSteps(joint);
+    _origin[joint] = motors.getOriginCount(joint);
+    _followingError[joint] = 0;
+}
+
+void EncoderMonitor::adoptMeasured() {
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (!hasEncoder(i)) {
+            continue;
+        }
+        if (!motors.isMoving(i)) {
+            motors.setPosition(i, getActual(i));
+        }
+        reference(i);
+    }
+}
+
+long EncoderMonitor::getActual(uint8_t joint) const {
+    if (!hasEncoder(joint)) {
+        return joint < MOTOR_COUNT ? motors.getPosition(joint) : 0;
+    }
+    return _offset[joint] + countsToSteps(joint);
+}
+
+int32_t EncoderMonitor::getFollowingError(uint8_t joint) const {
+    return hasEncoder(joint) ? _followingError[joint] : 0;
+}
+
+uint32_t EncoderMonitor::getMaxError(uint8_t joint) const {
+    return hasEncoder(joint) ? _maxError[joint] : 0;
+}
+
+void EncoderMonitor::clearFault() {
+    _faultMask = 0;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        _maxError[i] = 0;
+    }
+}
+
+void EncoderMonitor::update() {
+    if (!_mask) {
+        return;
+    }
+
+    // Keep counting in every mode, so a PCNT wrap is never missed
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (hasEncoder(i)) {
+            poll(i);
+            if (motors.getOriginCount(i) != _origin[i]) {
+                reference(i);  // Zeroed or homed since the last step
+            }
+        }
+    }
+
+    bool enabled = motors.isEnabled();
+    if (enabled && !_wasEnabled) {
+        adoptMeasured();
+    }
+    _wasEnabled = enabled;
+    if (!enabled || _mode == EncoderMode::OFF) {
+        return;
+    }
+
+    uint8_t faulted = 0;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (!hasEncoder(i)) {
+            continue;
+        }
+        int32_t error = (int32_t)(motors.getPosition(i) - getActual(i));
+        uint32_t magnitude = error < 0 ? -error : error;
+        _followingError[i] = error;
+        if (magnitude > _maxError[i]) {
+            _maxError[i] = magnitude;
+        }
+
+        // The shaft trails the commanded position by a little at speed
+        int32_t speedMilliHz = motors.getSpeedMilliHz(i);
+        uint32_t speed = speedMilliHz < 0 ? -speedMilliHz : speedMilliHz;
+        uint32_t lag = (uint32_t)((uint64_t)speed * ENCODER_LAG_ALLOWANCE_US / 1000000000ULL);
+        if (magnitude > _faultSteps + lag) {
+            faulted |= 1 << i;
+        }
+    }
+
+    if (faulted) {
+        fault(faulted);
+    } else if (_mode == EncoderMode::CORRECT) {
+        correct();
+    }
+}
+
+void EncoderMonitor::fault(uint8_t mask) {
+    trace.trigger(TraceTrigger::ENCODER);
+    programPlayer.abort();
+    trajectoryPlayer.stop();
+    motors.stopAll();
+    motors.setEnabled(false);
+    _wasEnabled = false;
+
+    _faultMask |= mask;
+    _faultCount++;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if ((mask >> i) & 1) {
+            DEBUG_PRINTF("Encoder: %s following error %ld steps - motors disabled\n",
+                         MOTOR_CONFIGS[i].name, (long)_followingError[i]);
+        }
+    }
+}
+
+void EncoderMonitor::correct() {
+    unsigned long now = millis();
+    bool atRest = !motors.isAnyMoving() && motors.getQueueDepth() == 0 &&
+                  !motors.isJogging() && !motors.isHoming();
+    if (!atRest) {
+        _restSinceMs = now;
+        return;
+    }
+    if (now - _restSinceMs < ENCODER_SETTLE_MS) {
+        return;
+    }
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (!hasEncoder(i)) {
+            continue;
+        }
+        int32_t error = _followingError[i];
+        if ((uint32_t)(error < 0 ? -error : error) <= _correctSteps) {
+            continue;
+        }
+
+        // Make the measured position current, then move to the commanded one
+        long commanded = motors.getPosition(i);
+        motors.setPosition(i, getActual(i));
+        _origin[i] = motors.getOriginCount(i);
+        if (motors.moveTo(i, commanded)) {
+            _corrections++;
+            DEBUG_PRINTF("Encoder: %s corrected %ld steps\n",
+                         MOTOR_CONFIGS[i].name, (long)error);
+        }
+    }
+    _restSinceMs = now;
+}
+
+const char* EncoderMonitor::modeName(EncoderMode mode) {
+    switch (mode) {
+        case EncoderMode::OFF:     return "off";
+        case EncoderMode::MONITOR: return "monitor";
+        case EncoderMode::CORRECT: return "correct";
+        default:                   return "unknown";
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef ENCODER_MONITOR_H
+#define ENCODER_MONITOR_H
+
+#include <Arduino.h>
+#include <driver/pcnt.h>
+#include "config.h"
+
+enum class EncoderMode : uint8_t {
+    OFF,
+    MONITOR,    // Fault on a following error, never move
+    CORRECT     // Also move out settled errors
+};
+
+/**
+ * Closed-loop position check from optional joint encoders
+ *
+ * Joints with encoderCountsPerRev set in MOTOR_CONFIGS are counted in x4
+ * quadrature by a PCNT unit of their own, taken from the top unit down
+ * (FastAccelStepper's MCPWM/PCNT step driver uses them from unit 0 up;
+ * MotorController steps encoder joints from RMT instead). Counting runs in
+ * hardware; update() polls every counter once per motion step and widens
+ * it into a 64-bit count, so the counters never need an overflow interrupt
+ * as long as one step moves less than ENCODER_PCNT_LIMIT / 2 counts.
+ *
+ * The encoder is incremental: it is referenced to the commanded position
+ * whenever that is redefined (zeroing, homing - see
+ * MotorController::getOriginCount), and when the motors are enabled the
+ * steppers adopt the measured position, so moving a disabled arm by hand
+ * is not mistaken for lost steps.
+ *
+ * Following error = commanded - measured, in steps. While enabled, an
+ * error beyond the fault threshold plus the lag allowed at the joint's
+ * current speed (ENCODER_LAG_ALLOWANCE_US) stops and disables the arm,
+ * latches the fault and triggers the motion trace. In CORRECT mode a joint
+ * at rest for ENCODER_SETTLE_MS with an error beyond the deadband is moved
+ * the missing steps to its commanded position.
+ *
+ * Motion task only (update() and the M880 handlers run there); other
+ * tasks read the errors from the telemetry snapshot.
+ */
+class EncoderMonitor {
+public:
+    EncoderMonitor();
+
+    /**
+     * Configure a PCNT unit per encoder (after motors.begin())
+     * @return false if the units could not be set up (see getError)
+     */
+    bool begin();
+
+    /**
+     * Poll the counters and check the following errors (motion task,
+     * after motors.update())
+     */
+    void update();
+
+    // Bit n set = joint n+1 has an encoder
+    uint8_t getMask() const { return _mask; }
+    bool hasEncoder(uint8_t joint) const { return joint < MOTOR_COUNT && ((_mask >> joint) & 1); }
+
+    EncoderMode getMode() const { return _mode; }
+    void setMode(EncoderMode mode);
+    uint32_t getFaultSteps() const { return _faultSteps; }
+    void setFaultSteps(uint32_t steps) { _faultSteps = steps; }
+    uint32_t getCorrectSteps() const { return _correctSteps; }
+    void setCorrectSteps(uint32_t steps) { _correctSteps = steps; }
+
+    /**
+     * Measured position in steps (the commanded position for a joint
+     * without an encoder)
+     */
+    long getActual(uint8_t joint) const;
+
+    /**
+     * Latest following error in steps (commanded - measured, 0 without an
+     * encoder)
+     */
+    int32_t getFollowingError(uint8_t joint) const;
+
+    // Largest |following error| seen while enabled, since the last clear
+    uint32_t getMaxError(uint8_t joint) const;
+
+    // Bit n set = joint n+1 faulted (latched until clearFault)
+    uint8_t getFaultMask() const { return _faultMask; }
+    uint32_t getFaultCount() const { return _faultCount; }
+    uint32_t getCorrectionCount() const { return _corrections; }
+
+    /**
+     * Clear the fault latch and the maximum errors
+     */
+    void clearFault();
+
+    const char* getError() const { return _error; }
+
+    static const char* modeName(EncoderMode mode);
+
+private:
+    uint8_t _mask;
+    pcnt_unit_t _unit[MOTOR_COUNT];
+    uint32_t _stepsPerCountQ24[MOTOR_COUNT];    // Steps per count, x 2^24
+
+    int16_t _lastRaw[MOTOR_COUNT];
+    int64_t _counts[MOTOR_COUNT];               // Widened hardware count
+    long _offset[MOTOR_COUNT];                  // Steps at count 0
+    uint32_t _origin[MOTOR_COUNT];              // Last seen origin count
+    int32_t _followingError[MOTOR_COUNT];
+    uint32_t _maxError[MOTOR_COUNT];
+
+    EncoderMode _mode;
+    uint32_t _faultSteps;
+    uint32_t _correctSteps;
+    bool _wasEnabled;
+    unsigned long _restSinceMs;
+    uint8_t _faultMask;
+    uint32_t _faultCount;
+    uint32_t _corrections;
+    const char* _error;
+
+    bool setupUnit(uint8_t joint, pcnt_unit_t unit);
+    void poll(uint8_t joint);
+    long countsToSteps(uint8_t joint) const;
+    void reference(uint8_t joint);
+    void adoptMeasured();
+    void fault(uint8_t mask);
+    void correct();
+};
+
+// Global encoder monitor instance
+extern EncoderMonitor encoders;
+
+#endif // ENCODER_MONITOR_H
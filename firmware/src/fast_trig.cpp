@@ -0,0 +1,35 @@
+#include "fast_trig.h"
+
+namespace FastTrig {
+
+// Taylor series of sin(x), summed until the terms vanish in double
+constexpr double sinSeries(double x, double term, int n, double sum) {
+    return (term < 1e-18 && term > -1e-18)
+        ? sum
+        : sinSeries(x, -term * x * x / ((n + 1) * (n + 2)), n + 2, sum + term);
+}
+
+// Reduced to [-pi, pi) first so the series converges quickly
+constexpr double sinEntry(int i) {
+    return sinSeries(2 * PI_D * (i < TABLE_SIZE / 2 ? i : i - TABLE_SIZE) / TABLE_SIZE,
+                     2 * PI_D * (i < TABLE_SIZE / 2 ? i : i - TABLE_SIZE) / TABLE_SIZE,
+                     1, 0.0);
+}
+
+#define SIN_1(i)   (float)sinEntry(i)
+#define SIN_4(i)   SIN_1(i), SIN_1(i + 1), SIN_1(i + 2), SIN_1(i + 3)
+#define SIN_16(i)  SIN_4(i), SIN_4(i + 4), SIN_4(i + 8), SIN_4(i + 12)
+#define SIN_64(i)  SIN_16(i), SIN_16(i + 16), SIN_16(i + 32), SIN_16(i + 48)
+
+DRAM_ATTR const float SIN_TABLE[TABLE_SIZE] = {
+    SIN_64(0), SIN_64(64), SIN_64(128), SIN_64(192)
+};
+
+static_assert(TABLE_SIZE == 256, "SIN_TABLE initializer covers 256 entries");
+
+#undef SIN_1
+#undef SIN_4
+#undef SIN_16
+#undef SIN_64
+
+}  // namespace FastTrig
@@ -0,0 +1,67 @@
+#ifndef FAST_TRIG_H
+#define FAST_TRIG_H
+
+#include <Arduino.h>
+
+/**
+ * Table-driven sine/cosine for the kinematics kernels
+ *
+ * FK evaluates six sine/cosine pairs per solve, which through newlib's
+ * sinf/cosf is most of the cost of an IK iteration. Here both come from
+ * one lookup and a short correction polynomial:
+ *
+ *   angle = i * STEP + d,  |d| < STEP
+ *   sin(angle) = sin(i STEP) cos(d) + cos(i STEP) sin(d)
+ *
+ * with cos(d)/sin(d) from their Taylor series, which at STEP = 2 pi / 256
+ * are exact to float precision after the d^4 / d^3 terms. Over a few turns
+ * either way the result is within 4e-7 of sin/cos of the float argument
+ * (a few ulps; well under a micrometre at the arm's reach).
+ *
+ * The table is generated at compile time (constexpr series in double) and
+ * kept in DRAM so a lookup never waits on the flash cache.
+ */
+
+namespace FastTrig {
+
+static const int TABLE_BITS = 8;
+static const int TABLE_SIZE = 1 << TABLE_BITS;   // Entries per turn
+static const int QUARTER = TABLE_SIZE / 4;
+
+// sin(i * 2 pi / TABLE_SIZE) for one turn
+extern const float SIN_TABLE[TABLE_SIZE];
+
+constexpr double PI_D = 3.14159265358979323846;
+constexpr float STEP = (float)(2 * PI_D / TABLE_SIZE);
+constexpr float INV_STEP = (float)(TABLE_SIZE / (2 * PI_D));
+
+// Correction polynomial coefficients (1/3!, 1/2!, 1/4!)
+constexpr float C3 = (float)(1.0 / 6);
+constexpr float C2 = 0.5f;
+constexpr float C4 = (float)(1.0 / 24);
+
+/**
+ * sin and cos of one angle (radians, any sign; accuracy degrades with the
+ * argument's own float resolution beyond a few turns)
+ */
+inline void sincos(float angle, float& s, float& c) {
+    float t = angle * INV_STEP;
+    int i = (int)t;
+    if (t < i) {
+        i--;  // floor for negative angles
+    }
+    float d = (t - i) * STEP;
+    float d2 = d * d;
+
+    float sinD = d * (1.0f - d2 * C3);
+    float cosD = 1.0f - d2 * (C2 - d2 * C4);
+
+    float s0 = SIN_TABLE[i & (TABLE_SIZE - 1)];
+    float c0 = SIN_TABLE[(i + QUARTER) & (TABLE_SIZE - 1)];
+    s = s0 * cosD + c0 * sinD;
+    c = c0 * cosD - s0 * sinD;
+}
+
+}  // namespace FastTrig
+
+#endif // FAST_TRIG_H
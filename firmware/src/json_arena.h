@@ -0,0 +1,110 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/**
+ * Fixed-buffer allocator for JsonDocument
+ *
+ * Documents built while handling a request allocate from a static buffer
+ * instead of the heap: blocks are bumped off the front, and the arena
+ * rewinds to empty as soon as the last live block is released, i.e. when
+ * the handler's documents go out of scope. Nothing is returned to the heap,
+ * so request handling cannot fragment it.
+ *
+ * If a document outgrows the buffer the overflow falls back to malloc, so
+ * oversized requests still work - they just lose the guarantee.
+ *
+ * Not thread-safe: use one arena per task.
+ */
+template <size_t N>
+class JsonArena : public ArduinoJson::Allocator {
+public:
+    JsonArena() : _used(0), _live(0), _last(nullptr) {}
+
+    void* allocate(size_t size) override {
+        size_t offset = _used;
+        size_t needed = HEADER + align(size);
+        if (needed > N - offset) {
+            return malloc(size);
+        }
+
+        _last = _buffer + offset + HEADER;
+        headerOf(_last)->size = size;
+        _used = offset + needed;
+        _live++;
+        return _last;
+    }
+
+    void deallocate(void* ptr) override {
+        if (!owns(ptr)) {
+            free(ptr);
+            return;
+        }
+
+        if (ptr == _last) {
+            _used = (uint8_t*)ptr - HEADER - _buffer;
+            _last = nullptr;
+        }
+        if (--_live == 0) {
+            _used = 0;
+            _last = nullptr;
+        }
+    }
+
+    void* reallocate(void* ptr, size_t size) override {
+        if (!owns(ptr)) {
+            return realloc(ptr, size);
+        }
+
+        Header* header = headerOf(ptr);
+
+        // Newest block (a growing string or pool) resizes in place
+        size_t offset = (uint8_t*)ptr - _buffer;
+        if (ptr == _last && align(size) <= N - offset) {
+            header->size = size;
+            _used = offset + align(size);
+            return ptr;
+        }
+        if (size <= header->size) {
+            header->size = size;
+            return ptr;
+        }
+
+        void* moved = allocate(size);
+        if (moved) {
+            memcpy(moved, ptr, header->size);
+            deallocate(ptr);
+        }
+        return moved;
+    }
+
+    // Bytes currently handed out from the buffer
+    size_t used() const { return _used; }
+
+private:
+    struct Header {
+        size_t size;
+    };
+
+    static const size_t ALIGN = alignof(max_align_t);
+    static const size_t HEADER = (sizeof(Header) + ALIGN - 1) & ~(ALIGN - 1);
+
+    static size_t align(size_t size) { return (size + ALIGN - 1) & ~(ALIGN - 1); }
+
+    static Header* headerOf(void* ptr) {
+        return reinterpret_cast<Header*>((uint8_t*)ptr - HEADER);
+    }
+
+    bool owns(const void* ptr) const {
+        return ptr >= _buffer && ptr < _buffer + N;
+    }
+
+    alignas(max_align_t) uint8_t _buffer[N];
+    size_t _used;
+    size_t _live;
+    void* _last;
+};
+
+#endif // JSON_ARENA_H
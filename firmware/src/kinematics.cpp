@@ -0,0 +1,390 @@
+#include "kinematics.h"
+#include "fast_trig.h"
+#include "units.h"
+
+// The kernels run for every interpolated segment: build them for speed
+// rather than size (the rest of the firmware is -Os) and keep them in IRAM,
+// so they never stall on a flash cache miss while WiFi is busy
+#pragma GCC optimize("O2")
+#define KINEMATICS_KERNEL IRAM_ATTR
+
+// Global instance
+Kinematics kinematics;
+
+static const float DEG = 0.017453292519943f;   // Radians per degree
+
+// =============================================================================
+// Small vector/matrix helpers
+// =============================================================================
+
+static void cross(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float norm3Squared(const float v[3]) {
+    return v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+}
+
+static float norm3(const float v[3]) {
+    return sqrtf(norm3Squared(v));
+}
+
+// Rotation vector (axis * angle) of R = a * b^T
+static void rotationVector(const float a[3][3], const float b[3][3], float w[3]) {
+    float r[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            r[i][j] = a[i][0] * b[j][0] + a[i][1] * b[j][1] + a[i][2] * b[j][2];
+        }
+    }
+
+    // vee(R - R^T) = 2 sin(angle) * axis
+    float skew[3] = { r[2][1] - r[1][2], r[0][2] - r[2][0], r[1][0] - r[0][1] };
+    float sinAngle = 0.5f * norm3(skew);
+    float cosAngle = 0.5f * (r[0][0] + r[1][1] + r[2][2] - 1.0f);
+
+    if (cosAngle > 0 && sinAngle < 0.05f) {
+        // Small rotation - every IK iteration along a path. angle / sin(angle)
+        // from the asin series, so no acos (error < 5e-7 relative)
+        float scale = 0.5f * (1.0f + sinAngle * sinAngle * (1.0f / 6));
+        for (int i = 0; i < 3; i++) {
+            w[i] = scale * skew[i];
+        }
+        return;
+    }
+
+    cosAngle = constrain(cosAngle, -1.0f, 1.0f);
+    float angle = acosf(cosAngle);
+
+    if (angle > 3.1f) {
+        // Near half a turn the skew part vanishes; take the axis from the
+        // symmetric part, led by its largest diagonal element
+        int k = 0;
+        if (r[1][1] > r[k][k]) k = 1;
+        if (r[2][2] > r[k][k]) k = 2;
+        float axis[3];
+        axis[k] = sqrtf(max((r[k][k] - cosAngle) / (1.0f - cosAngle), 0.0f));
+        for (int i = 0; i < 3; i++) {
+            if (i != k) {
+                axis[i] = (r[k][i] + r[i][k]) / (2.0f * (1.0f - cosAngle) * axis[k]);
+            }
+        }
+        if (skew[k] < 0) {
+            angle = -angle;
+        }
+        for (int i = 0; i < 3; i++) {
+            w[i] = axis[i] * angle;
+        }
+        return;
+    }
+
+    float scale = angle / (2.0f * sinAngle);
+    for (int i = 0; i < 3; i++) {
+        w[i] = scale * skew[i];
+    }
+}
+
+// Solve A x = b in place for symmetric positive definite A (Cholesky).
+// The FPU has no divide instruction, so each pivot is inverted once and
+// everything else multiplies.
+static bool solveSpd(float a[6][6], float b[6]) {
+    float inverse[6];
+    for (int j = 0; j < 6; j++) {
+        float d = a[j][j];
+        for (int k = 0; k < j; k++) {
+            d -= a[j][k] * a[j][k];
+        }
+        if (d <= 0) {
+            return false;
+        }
+        inverse[j] = 1.0f / sqrtf(d);
+        for (int i = j + 1; i < 6; i++) {
+            float s = a[i][j];
+            for (int k = 0; k < j; k++) {
+                s -= a[i][k] * a[j][k];
+            }
+            a[i][j] = s * inverse[j];
+        }
+    }
+
+    // L y = b, then L^T x = y
+    for (int i = 0; i < 6; i++) {
+        for (int k = 0; k < i; k++) {
+            b[i] -= a[i][k] * b[k];
+        }
+        b[i] *= inverse[i];
+    }
+    for (int i = 5; i >= 0; i--) {
+        for (int k = i + 1; k < 6; k++) {
+            b[i] -= a[k][i] * b[k];
+        }
+        b[i] *= inverse[i];
+    }
+    return true;
+}
+
+// Scale v down so its length is at most limit
+static void clampLength(float v[3], float limit) {
+    if (norm3Squared(v) > limit * limit) {
+        float length = norm3(v);
+        for (int i = 0; i < 3; i++) {
+            v[i] *= limit / length;
+        }
+    }
+}
+
+// =============================================================================
+// Kinematics
+// =============================================================================
+
+// Joint angles are converted with the degree scales of JOINT_UNITS
+constexpr bool chainIsRotary(uint8_t joint) {
+    return joint >= KINEMATICS_JOINTS ||
+           (JOINT_UNITS[joint].unit == JointUnit::DEGREES && chainIsRotary(joint + 1));
+}
+static_assert(chainIsRotary(0), "Kinematic chain joints must be rotary in JOINT_UNITS");
+
+Kinematics::Kinematics() {
+    for (int i = 0; i < KINEMATICS_JOINTS; i++) {
+        const DhParameters& dh = DH_PARAMETERS[i];
+        _sinAlpha[i] = sinf(dh.alpha * DEG);
+        _cosAlpha[i] = cosf(dh.alpha * DEG);
+        _thetaOffset[i] = dh.thetaOffset * DEG;
+        _stepsPerRad[i] = (float)(Units::stepsPerUnit(i) * RAD_TO_DEG);
+    }
+}
+
+KINEMATICS_KERNEL void Kinematics::forwardChain(const float angles[], Frame joints[]) const {
+    static const Frame BASE = {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, {0, 0, 0}};
+    const Frame* previous = &BASE;
+
+    for (int i = 0; i < KINEMATICS_JOINTS; i++) {
+        float st, ct;
+        FastTrig::sincos(angles[i], st, ct);
+        float sa = _sinAlpha[i];
+        float ca = _cosAlpha[i];
+        float a = DH_PARAMETERS[i].a;
+        float d = DH_PARAMETERS[i].d;
+
+        // previous * Rz(theta) Tz(d) Tx(a) Rx(alpha), exploiting the zeros
+        // of the link transform: 27 multiplies instead of a full 4x4 product
+        const Frame& p = *previous;
+        Frame& out = joints[i];
+        for (int k = 0; k < 3; k++) {
+            float x = p.r[k][0] * ct + p.r[k][1] * st;   // Rotated X axis
+            float y = p.r[k][1] * ct - p.r[k][0] * st;   // Rotated Y, before the twist
+            out.r[k][0] = x;
+            out.r[k][1] = y * ca + p.r[k][2] * sa;
+            out.r[k][2] = p.r[k][2] * ca - y * sa;
+            out.p[k] = p.p[k] + x * a + p.r[k][2] * d;
+        }
+        previous = &out;
+    }
+
+    // Tool centre point along the flange Z axis
+    Frame& flange = joints[KINEMATICS_JOINTS - 1];
+    for (int i = 0; i < 3; i++) {
+        flange.p[i] += flange.r[i][2] * KINEMATICS_TOOL_LENGTH;
+    }
+}
+
+void Kinematics::forward(const float angles[], Frame& tool) const {
+    Frame joints[KINEMATICS_JOINTS];
+    forwardChain(angles, joints);
+    tool = joints[KINEMATICS_JOINTS - 1];
+}
+
+KINEMATICS_KERNEL bool Kinematics::inverse(const Frame& target, const float seed[], float angles[]) const {
+    const float w = IK_ORIENTATION_WEIGHT_MM;
+    float q[KINEMATICS_JOINTS];
+    memcpy(q, seed, sizeof(q));
+
+    for (int iteration = 0; iteration <= IK_MAX_ITERATIONS; iteration++) {
+        Frame joints[KINEMATICS_JOINTS];
+        forwardChain(q, joints);
+        const Frame& tool = joints[KINEMATICS_JOINTS - 1];
+
+        float positionError[3] = {
+            target.p[0] - tool.p[0], target.p[1] - tool.p[1], target.p[2] - tool.p[2]
+        };
+        float orientationError[3];
+        rotationVector(target.r, tool.r, orientationError);
+
+        // Squared norms: no square roots on the converged path
+        bool positionOk = norm3Squared(positionError) <
+                          IK_POSITION_TOLERANCE_MM * IK_POSITION_TOLERANCE_MM;
+        if (positionOk && norm3Squared(orientationError) <
+                          IK_ORIENTATION_TOLERANCE_RAD * IK_ORIENTATION_TOLERANCE_RAD) {
+            memcpy(angles, q, sizeof(q));
+            return true;
+        }
+        if (iteration == IK_MAX_ITERATIONS) {
+            break;
+        }
+
+        // Weighted task-space error, clamped so far targets are approached
+        // in steps the linearisation can follow
+        float error[6];
+        for (int i = 0; i < 3; i++) {
+            error[i] = positionError[i];
+            error[3 + i] = orientationError[i] * w;
+        }
+        clampLength(error, IK_MAX_STEP_MM);
+        clampLength(error + 3, IK_MAX_STEP_MM);
+
+        // Geometric Jacobian: joint i turns about z of frame i-1
+        float jacobian[6][KINEMATICS_JOINTS];
+        for (int i = 0; i < KINEMATICS_JOINTS; i++) {
+            float axis[3] = {0, 0, 1};
+            float origin[3] = {0, 0, 0};
+            if (i > 0) {
+                for (int k = 0; k < 3; k++) {
+                    axis[k] = joints[i - 1].r[k][2];
+                    origin[k] = joints[i - 1].p[k];
+                }
+            }
+            float arm[3] = { tool.p[0] - origin[0], tool.p[1] - origin[1], tool.p[2] - origin[2] };
+            float linear[3];
+            cross(axis, arm, linear);
+            for (int k = 0; k < 3; k++) {
+                jacobian[k][i] = linear[k];
+                jacobian[3 + k][i] = axis[k] * w;
+            }
+        }
+
+        // dq = J^T (J J^T + lambda^2 I)^-1 e
+        float system[6][6];
+        for (int r = 0; r < 6; r++) {
+            for (int c = 0; c <= r; c++) {
+                float s = 0;
+                for (int k = 0; k < KINEMATICS_JOINTS; k++) {
+                    s += jacobian[r][k] * jacobian[c][k];
+                }
+                system[r][c] = system[c][r] = s;
+            }
+            system[r][r] += IK_DAMPING_MM * IK_DAMPING_MM;
+        }
+        if (!solveSpd(system, error)) {
+            return false;
+        }
+
+        float stepSize = 0;
+        for (int k = 0; k < KINEMATICS_JOINTS; k++) {
+            float dq = 0;
+            for (int r = 0; r < 6; r++) {
+                dq += jacobian[r][k] * error[r];
+            }
+            q[k] += dq;
+            stepSize += dq * dq;
+        }
+
+        // A chain with fewer than six joints cannot match every orientation:
+        // accept the closest one once the position is reached and it settles
+        if (KINEMATICS_JOINTS < 6 && positionOk && stepSize < 1e-10f) {
+            memcpy(angles, q, sizeof(q));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Kinematics::stepsToAngles(const long steps[], float angles[]) const {
+    for (int i = 0; i < KINEMATICS_JOINTS; i++) {
+        angles[i] = steps[i] / _stepsPerRad[i] + _thetaOffset[i];
+    }
+}
+
+void Kinematics::anglesToSteps(const float angles[], long steps[]) const {
+    for (int i = 0; i < KINEMATICS_JOINTS; i++) {
+        steps[i] = lroundf((angles[i] - _thetaOffset[i]) * _stepsPerRad[i]);
+    }
+}
+
+void Kinematics::poseFromSteps(const long steps[], Pose& pose) const {
+    float angles[KINEMATICS_JOINTS];
+    stepsToAngles(steps, angles);
+    Frame tool;
+    forward(angles, tool);
+    frameToPose(tool, pose);
+}
+
+void Kinematics::poseToFrame(const Pose& pose, Frame& frame) {
+    float sa = sinf(pose.a * DEG), ca = cosf(pose.a * DEG);
+    float sb = sinf(pose.b * DEG), cb = cosf(pose.b * DEG);
+    float sc = sinf(pose.c * DEG), cc = cosf(pose.c * DEG);
+
+    // Rz(C) * Ry(B) * Rx(A)
+    frame.r[0][0] = cc * cb;
+    frame.r[0][1] = cc * sb * sa - sc * ca;
+    frame.r[0][2] = cc * sb * ca + sc * sa;
+    frame.r[1][0] = sc * cb;
+    frame.r[1][1] = sc * sb * sa + cc * ca;
+    frame.r[1][2] = sc * sb * ca - cc * sa;
+    frame.r[2][0] = -sb;
+    frame.r[2][1] = cb * sa;
+    frame.r[2][2] = cb * ca;
+
+    frame.p[0] = pose.x;
+    frame.p[1] = pose.y;
+    frame.p[2] = pose.z;
+}
+
+void Kinematics::frameToPose(const Frame& frame, Pose& pose) {
+    pose.x = frame.p[0];
+    pose.y = frame.p[1];
+    pose.z = frame.p[2];
+
+    float cb = sqrtf(frame.r[0][0] * frame.r[0][0] + frame.r[1][0] * frame.r[1][0]);
+    pose.b = atan2f(-frame.r[2][0], cb) / DEG;
+    if (cb > 1e-6f) {
+        pose.a = atan2f(frame.r[2][1], frame.r[2][2]) / DEG;
+        pose.c = atan2f(frame.r[1][0], frame.r[0][0]) / DEG;
+    } else {
+        // B = +-90: only A - C (or A + C) is defined, put it all in A
+        float sb = frame.r[2][0] < 0 ? 1.0f : -1.0f;
+        pose.a = atan2f(sb * frame.r[0][1], frame.r[1][1]) / DEG;
+        pose.c = 0;
+    }
+}
+
+void Kinematics::beginPath(const Frame& from, const Frame& to, LinearPath& path) {
+    path.from = from;
+    for (int i = 0; i < 3; i++) {
+        path.delta[i] = to.p[i] - from.p[i];
+    }
+    path.length = norm3(path.delta);
+
+    // Fixed rotation axis and total angle of R1 R0^T, worked out once
+    float w[3];
+    rotationVector(to.r, from.r, w);
+    path.angle = norm3(w);
+    for (int i = 0; i < 3; i++) {
+        path.axis[i] = path.angle > 1e-9f ? w[i] / path.angle : 0.0f;
+    }
+}
+
+KINEMATICS_KERNEL void Kinematics::pathPoint(const LinearPath& path, float t, Frame& out) {
+    for (int i = 0; i < 3; i++) {
+        out.p[i] = path.from.p[i] + path.delta[i] * t;
+    }
+
+    // R(t) = Rot(axis, t * angle) * R0 (Rodrigues)
+    float s, c;
+    FastTrig::sincos(path.angle * t, s, c);
+    float v = 1.0f - c;
+    const float* k = path.axis;
+    float step[3][3] = {
+        {1.0f - v * (k[1] * k[1] + k[2] * k[2]), v * k[0] * k[1] - s * k[2], v * k[0] * k[2] + s * k[1]},
+        {v * k[0] * k[1] + s * k[2], 1.0f - v * (k[0] * k[0] + k[2] * k[2]), v * k[1] * k[2] - s * k[0]},
+        {v * k[0] * k[2] - s * k[1], v * k[1] * k[2] + s * k[0], 1.0f - v * (k[0] * k[0] + k[1] * k[1])}
+    };
+    const float (*r0)[3] = path.from.r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            out.r[i][j] = step[i][0] * r0[0][j] + step[i][1] * r0[1][j] + step[i][2] * r0[2][j];
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Tool pose as used by G-code: position in mm, orientation as fixed-axis
+ * angles in degrees (A about X, then B about Y, then C about Z, i.e.
+ * R = Rz(C) * Ry(B) * Rx(A)), all in the base frame
+ */
+struct Pose {
+    float x, y, z;
+    float a, b, c;
+};
+
+/**
+ * Homogeneous transform (rotation + translation), base frame
+ */
+struct Frame {
+    float r[3][3];
+    float p[3];
+};
+
+/**
+ * Straight line between two frames, prepared once by Kinematics::beginPath
+ * so each interpolated point costs one sin/cos pair
+ */
+struct LinearPath {
+    Frame from;
+    float delta[3];     // Translation to the end (mm)
+    float length;       // mm
+    float axis[3];      // Unit rotation axis (base frame)
+    float angle;        // Total rotation (radians)
+};
+
+/**
+ * Forward/inverse kinematics of the arm (DH_PARAMETERS in config.h)
+ *
+ * Single precision throughout - the ESP32 FPU handles float natively, and
+ * the chain is only a few hundred mm long, so float resolves well below a
+ * micrometre. Trig terms that do not depend on the joint angles (link
+ * twists) and the step/radian scales are computed once in the constructor;
+ * joint sin/cos come from a lookup table (fast_trig.h). The per-segment
+ * kernels (FK, IK, path points) are built -O2 into IRAM. Cycle counts per
+ * board: bench/kinematics_bench.cpp.
+ *
+ * IK is numerical (damped least squares on the geometric Jacobian), so it
+ * works for any DH table, including chains with fewer than six joints. It
+ * is seeded with a nearby solution - the previous waypoint of a path -
+ * and then converges in one or two iterations.
+ *
+ * All methods are const and reentrant: the motion task plans with it while
+ * the web server computes status poses.
+ */
+class Kinematics {
+public:
+    Kinematics();
+
+    /**
+     * Tool frame for the given joint angles
+     * @param angles DH joint angles (radians), KINEMATICS_JOINTS entries
+     */
+    void forward(const float angles[], Frame& tool) const;
+
+    /**
+     * Joint angles reaching a tool frame
+     * @param target Desired tool frame
+     * @param seed Starting angles (radians), usually the current solution
+     * @param angles Out: solution (may alias seed)
+     * @return false if it did not converge (target out of reach)
+     */
+    bool inverse(const Frame& target, const float seed[], float angles[]) const;
+
+    /**
+     * Convert motor positions to DH joint angles and back
+     * Both read/write KINEMATICS_JOINTS entries (the joints in chainMask())
+     */
+    void stepsToAngles(const long steps[], float angles[]) const;
+    void anglesToSteps(const float angles[], long steps[]) const;
+
+    /**
+     * Tool pose for motor positions (convenience for reports)
+     */
+    void poseFromSteps(const long steps[], Pose& pose) const;
+
+    // Bits of the joints in the chain (all must be homed for Cartesian moves)
+    static uint8_t chainMask() { return (1 << KINEMATICS_JOINTS) - 1; }
+
+    static void poseToFrame(const Pose& pose, Frame& frame);
+    static void frameToPose(const Frame& frame, Pose& pose);
+
+    /**
+     * Prepare the straight line from one frame to another
+     */
+    static void beginPath(const Frame& from, const Frame& to, LinearPath& path);
+
+    /**
+     * Point at fraction t along a path: linear in position, turning at
+     * constant angular velocity about the path's fixed axis
+     */
+    static void pathPoint(const LinearPath& path, float t, Frame& out);
+
+private:
+    float _sinAlpha[KINEMATICS_JOINTS];
+    float _cosAlpha[KINEMATICS_JOINTS];
+    float _thetaOffset[KINEMATICS_JOINTS];  // Radians
+    float _stepsPerRad[KINEMATICS_JOINTS];
+
+    // Frames of every link (joints[i] = frame i+1), for the Jacobian
+    void forwardChain(const float angles[], Frame joints[]) const;
+};
+
+// Global kinematics instance
+extern Kinematics kinematics;
+
+#endif // KINEMATICS_H
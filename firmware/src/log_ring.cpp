@@ -0,0 +1,60 @@
+#include "log_ring.h"
+
+// Global instance
+LogRing logRing;
+
+LogRing::LogRing()
+    : _head(0), _tail(0), _dropped(0), _droppedReported(0) {
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    _lock = unlocked;
+}
+
+size_t LogRing::write(const uint8_t* data, size_t length) {
+    portENTER_CRITICAL(&_lock);
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    size_t space = LOG_RING_SIZE - (head - _tail.load(std::memory_order_acquire));
+    if (length > space) {
+        portEXIT_CRITICAL(&_lock);
+        _dropped.fetch_add(length, std::memory_order_relaxed);
+        return length;  // Callers do not retry
+    }
+
+    size_t offset = head % LOG_RING_SIZE;
+    size_t first = min(length, (size_t)LOG_RING_SIZE - offset);
+    memcpy(_buffer + offset, data, first);
+    memcpy(_buffer, data + first, length - first);
+    _head.store(head + length, std::memory_order_release);
+    portEXIT_CRITICAL(&_lock);
+    return length;
+}
+
+size_t LogRing::pending() const {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+}
+
+size_t LogRing::drain(HardwareSerial& out) {
+    size_t written = 0;
+    int room = out.availableForWrite();
+
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    while (tail != head && room > 0) {
+        size_t offset = tail % LOG_RING_SIZE;
+        size_t chunk = min((size_t)(head - tail), (size_t)LOG_RING_SIZE - offset);
+        chunk = min(chunk, (size_t)room);
+        out.write(_buffer + offset, chunk);
+        tail += chunk;
+        written += chunk;
+        room -= chunk;
+    }
+    _tail.store(tail, std::memory_order_release);
+
+    // Report losses once the backlog is out
+    uint32_t dropped = getDroppedBytes();
+    if (tail == head && dropped != _droppedReported && room >= 48) {
+        written += out.printf("log: %lu bytes dropped\n",
+                              (unsigned long)(dropped - _droppedReported));
+        _droppedReported = dropped;
+    }
+    return written;
+}
@@ -0,0 +1,53 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+
+/**
+ * Debug log buffered in RAM (behind DEBUG_PRINT/DEBUG_PRINTF, plus status
+ * lines from loop())
+ *
+ * Any task may print; a write only formats on the caller's stack and
+ * copies the bytes into a ring under a spinlock, so logging never waits
+ * for the UART - the AsyncTCP task and the motion task in particular.
+ * The serial task drains the ring between command replies, as much as the
+ * TX buffer takes without blocking.
+ *
+ * A write that does not fit is dropped whole and counted; the next drain
+ * reports the loss with a "log: N bytes dropped" line. Printing from an
+ * interrupt is not supported (Print::printf may allocate).
+ */
+class LogRing : public Print {
+public:
+    LogRing();
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t length) override;
+
+    /**
+     * Write buffered log bytes to out without blocking (single consumer)
+     * @return Bytes written
+     */
+    size_t drain(HardwareSerial& out);
+
+    // Bytes waiting to be drained
+    size_t pending() const;
+
+    uint32_t getDroppedBytes() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    uint8_t _buffer[LOG_RING_SIZE];
+    std::atomic<uint32_t> _head;     // Next byte to write (producers, under _lock)
+    std::atomic<uint32_t> _tail;     // Next byte to drain (consumer)
+    portMUX_TYPE _lock;
+    std::atomic<uint32_t> _dropped;
+    uint32_t _droppedReported;       // Consumer
+};
+
+// Global log ring
+extern LogRing logRing;
+
+#endif // LOG_RING_H
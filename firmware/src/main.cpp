@@ -6,6 +6,17 @@
  *   - WiFi connection and web server
  *   - Serial command interface
  *   - Motor control loop
+ *
+ * Threading (see motion_task.h):
+ *   core 1  motion task   - motion queue, encoder checks, program/trajectory
+ *                           playback, executes every command
+ *   core 0  serial task   - serial ingest, M154 auto-reports, debug log
+ *   core 0  AsyncTCP      - HTTP / WebSocket ingest, HTTP replies
+ *   core 1  loop()        - WiFi housekeeping, WebSocket replies and
+ *                           telemetry push, sync beacons, status LED
+ *
+ * setup() never waits for WiFi: serial commands are accepted as soon as
+ * the tasks are up, and the web UI address is logged once the link is.
  */
 
 #include <Arduino.h>
@@ -13,13 +24,29 @@
 #include "motor_controller.h"
 #include "command_parser.h"
 #include "web_server.h"
+#include "serial_reader.h"
+#include "program_store.h"
+#include "program_player.h"
+#include "trajectory.h"
+#include "motion_task.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "auto_report.h"
+#include "arm_sync.h"
+#include "encoder_monitor.h"
+#include "log_ring.h"
+
+// Set when serial input is read by its own task instead of loop()
+bool serialTaskRunning = false;
 
-// Serial input buffer
-String serialBuffer = "";
-bool serialComplete = false;
+// Set once the web UI address has been logged
+bool wifiAnnounced = false;
 
 // Forward declarations
-void handleSerialInput();
+void handleSerialLine(const char* line, size_t length);
+void handleSerialFrame(const uint8_t* frame, size_t length);
+void handleSerialIdle();
+void flushLog();
 void handleStatusLED();
 
 // Status LED timing
@@ -27,7 +54,9 @@ unsigned long lastStatusBlink = 0;
 const unsigned long STATUS_BLINK_INTERVAL = 1000;
 
 void setup() {
-    // Initialize serial
+    // Initialize serial (buffer sizes must be set before begin)
+    Serial.setRxBufferSize(SERIAL_RX_BUFFER_SIZE);
+    Serial.setTxBufferSize(SERIAL_TX_BUFFER_SIZE);
     Serial.begin(SERIAL_BAUD_RATE);
     while (!Serial && millis() < 3000) {
         // Wait up to 3 seconds for serial
@@ -40,70 +69,163 @@ void setup() {
     Serial.println("=================================");
     Serial.println();
 
-    // Initialize motor controller
-    motors.begin();
+    // Cycle-counter bucket bounds for this CPU clock
+    metrics.begin();
 
-    // Initialize WiFi and web server
-    Serial.println("Connecting to WiFi...");
-    if (webServer.begin(WIFI_SSID, WIFI_PASSWORD)) {
-        Serial.print("WiFi connected! IP: ");
-        Serial.println(webServer.getIPAddress());
-        Serial.print("Web UI: http://");
-        Serial.println(webServer.getIPAddress());
-    } else {
-        Serial.println("WiFi connection failed!");
-        Serial.println("Serial-only mode active");
+    // Initialize motor controller; nothing can run without every stepper
+    if (!motors.begin()) {
+        for (;;) {
+            Serial.printf("error: Motors not available: %s\n", motors.getError());
+            flushLog();
+            delay(1000);
+        }
+    }
+    if (!encoders.begin()) {
+        Serial.printf("error: Encoders not available: %s\n", encoders.getError());
     }
+    telemetry.capture();
+
+    // Stored programs (LittleFS)
+    if (!programStore.begin()) {
+        Serial.println("error: Program storage not available");
+    }
+    trajectoryPlayer.begin();
+
+    // Serial command ingest
+    serialReader.begin(handleSerialLine, handleSerialFrame);
+    serialReader.setIdleHandler(handleSerialIdle);
+
+    // Start WiFi and the web server (connects in the background)
+    flushLog();
+    Serial.println("Connecting to WiFi in the background...");
+    if (!webServer.begin(WIFI_SSID, WIFI_PASSWORD)) {
+        Serial.println("Web server not started - serial-only mode");
+    }
+    flushLog();
 
     Serial.println();
     Serial.println("Ready. Type '?' for status or 'M17' to enable motors.");
-    Serial.println("Commands: G0, G1, G28, M17, M18, M112, M114, M503");
+    Serial.println("Commands: G0, G1, G28, M17, M18, M112, M114, M503, M20-M30");
     Serial.println();
+
+    #if MOTION_TASK_ENABLED
+    if (!motionTask.start()) {
+        Serial.println("error: Motion task not started, running motion from loop()");
+    }
+    #endif
+
+    #if SERIAL_TASK_ENABLED
+    serialTaskRunning = serialReader.startTask();
+    if (!serialTaskRunning) {
+        Serial.println("error: Serial task not started, polling from loop()");
+    }
+    #endif
+    flushLog();
 }
 
 void loop() {
     // FastAccelStepper uses hardware timers - no run() needed
-    // Motors are controlled automatically via MCPWM/RMT peripherals
+    // Motors are controlled automatically via MCPWM/RMT peripherals;
+    // queued segments are dispatched by the motion task (or here without it)
+    if (!motionTask.isRunning()) {
+        motionTask.step();
+    }
 
-    // Handle serial input
-    handleSerialInput();
+    // Handle serial input (unless the serial task owns it)
+    if (!serialTaskRunning) {
+        serialReader.poll();
+    }
 
     // Handle web server
     webServer.loop();
+    if (!wifiAnnounced && webServer.isConnected()) {
+        wifiAnnounced = true;
+        String ip = webServer.getIPAddress();
+        logRing.printf("WiFi connected! IP: %s\nWeb UI: http://%s\n", ip.c_str(), ip.c_str());
+    }
+
+    // Multi-arm sync beacons (master only)
+    armSync.loop();
 
     // Status indicator (optional)
     handleStatusLED();
 }
 
 /**
- * Handle incoming serial commands
- * Accumulates characters until newline, then executes
+ * Execute a complete serial command line on the motion task
+ * The line points into the serial reader's ring buffer (no copy); it stays
+ * valid because run() waits for the command to finish
+ *
+ * Every reply ends with exactly one "ok F:<free queue slots>" or "error: ..."
+ * line, so a host can pipeline commands and count queue credits.
  */
-void handleSerialInput() {
-    while (Serial.available()) {
-        char c = Serial.read();
-
-        if (c == '\n' || c == '\r') {
-            if (serialBuffer.length() > 0) {
-                // Execute command
-                CommandResult result = commandParser.execute(serialBuffer);
-
-                // Print result
-                Serial.println(result.message);
-
-                // Clear buffer
-                serialBuffer = "";
-            }
-        } else {
-            // Accumulate character
-            serialBuffer += c;
-
-            // Prevent buffer overflow
-            if (serialBuffer.length() > 256) {
-                Serial.println("error: Command too long");
-                serialBuffer = "";
-            }
+void handleSerialLine(const char* line, size_t length) {
+    CommandResult result;
+    size_t queueFree = 0;
+    motionTask.run(MotionTask::CHANNEL_SERIAL, [&] {
+        result = commandParser.execute(line, length);
+        queueFree = motors.getQueueFree();
+    });
+
+    if (!result.success) {
+        Serial.println(result.message);
+        return;
+    }
+    if (result.length > 0 && strcmp(result.message, "ok") != 0) {
+        Serial.println(result.message);
+    }
+    Serial.printf("ok F:%u\n", (unsigned)queueFree);
+}
+
+/**
+ * Execute a binary move frame (bypasses the G-code parser)
+ */
+void handleSerialFrame(const uint8_t* frame, size_t length) {
+    motionTask.run(MotionTask::CHANNEL_SERIAL, [&] {
+        BinaryProtocol::handleFrame(frame, length, Serial);
+    });
+}
+
+/**
+ * Write out buffered debug output and send a due M154 auto-report (on the
+ * serial reader's task, between replies)
+ * A frame that does not fit in the TX buffer waits for a later poll
+ */
+void handleSerialIdle() {
+    logRing.drain(Serial);
+
+    uint32_t now = millis();
+    ReportFrame frame;
+    if (!serialReport.poll(now, frame)) {
+        return;
+    }
+
+    if (serialReport.getFormat() == ReportFormat::BINARY) {
+        uint8_t buffer[BINARY_MAX_STATUS_SIZE];
+        size_t length = AutoReport::encodeBinary(frame, buffer, sizeof(buffer));
+        if (length == 0 || Serial.availableForWrite() < (int)length) {
+            return;
+        }
+        Serial.write(buffer, length);
+    } else {
+        char line[AUTO_REPORT_LINE_SIZE];
+        size_t length = AutoReport::formatText(frame, line, sizeof(line));
+        if (length == 0 || Serial.availableForWrite() < (int)length + 2) {
+            return;
         }
+        Serial.write((const uint8_t*)line, length);
+        Serial.println();
+    }
+    serialReport.commit(frame, now);
+}
+
+/**
+ * Write out all buffered debug output, waiting for the UART (setup only)
+ */
+void flushLog() {
+    while (logRing.pending() > 0) {
+        logRing.drain(Serial);
+        delay(1);
     }
 }
 
@@ -116,14 +238,15 @@ void handleSerialInput() {
 void handleStatusLED() {
     #ifdef LED_BUILTIN
     unsigned long now = millis();
+    MotionSnapshot snapshot = telemetry.get();
 
-    if (!motors.isEnabled()) {
+    if (!snapshot.enabled) {
         // Disabled - LED off
         digitalWrite(LED_BUILTIN, LOW);
         return;
     }
 
-    unsigned long interval = motors.isAnyMoving() ? 100 : STATUS_BLINK_INTERVAL;
+    unsigned long interval = snapshot.isMoving() ? 100 : STATUS_BLINK_INTERVAL;
 
     if (now - lastStatusBlink >= interval) {
         lastStatusBlink = now;
@@ -0,0 +1,215 @@
+#include "metrics.h"
+#include "serial_reader.h"
+#include "telemetry.h"
+
+// Global instance
+Metrics metrics;
+
+// =============================================================================
+// LatencyHistogram
+// =============================================================================
+
+const uint32_t LatencyHistogram::BOUNDS_US[BUCKET_COUNT - 1] = {
+    5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000
+};
+
+uint32_t LatencyHistogram::_boundCycles[BUCKET_COUNT - 1];
+
+void LatencyHistogram::setClock(uint32_t cpuMHz) {
+    for (int i = 0; i < BUCKET_COUNT - 1; i++) {
+        _boundCycles[i] = BOUNDS_US[i] * cpuMHz;
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _maxCycles = 0;
+    _sumCycles = 0;
+}
+
+uint64_t LatencyHistogram::sumCycles() const {
+    // Not atomic on a 32-bit core: reread if the writer got in between
+    uint64_t sum;
+    do {
+        sum = _sumCycles;
+    } while (sum != _sumCycles);
+    return sum;
+}
+
+uint32_t LatencyHistogram::percentileUs(uint32_t percent) const {
+    uint32_t total = _count;
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t needed = ((uint64_t)total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT - 1; i++) {
+        seen += _buckets[i];
+        if (seen >= needed) {
+            return BOUNDS_US[i];
+        }
+    }
+    return UINT32_MAX;
+}
+
+// =============================================================================
+// Metrics
+// =============================================================================
+
+Metrics::Metrics()
+    : _cpuMHz(240), _commands(0), _commandErrors(0), _commandBusy(0) {
+    for (int i = 0; i < 4; i++) {
+        _httpResponses[i] = 0;
+    }
+    LatencyHistogram::setClock(_cpuMHz);
+}
+
+void Metrics::begin() {
+    _cpuMHz = ESP.getCpuFreqMHz();
+    LatencyHistogram::setClock(_cpuMHz);
+}
+
+const char* Metrics::sectionName(Section section) {
+    switch (section) {
+        case PARSE:          return "parse";
+        case PLAN:           return "plan";
+        case DISPATCH:       return "dispatch";
+        case MOTION_STEP:    return "motion_step";
+        case SERIAL_HANDOFF: return "serial_handoff";
+        case WEB_HANDOFF:    return "web_handoff";
+        case HTTP:           return "http";
+        case WEB_DEFERRED:   return "web_deferred";
+        case WS_DEFERRED:    return "ws_deferred";
+        default:             return "unknown";
+    }
+}
+
+void Metrics::countCommand(bool success, bool busy) {
+    _commands++;
+    if (busy) {
+        _commandBusy++;
+    } else if (!success) {
+        _commandErrors++;
+    }
+}
+
+void Metrics::countHttpResponse(int code) {
+    int statusClass = code / 100;
+    if (statusClass >= 2 && statusClass <= 5) {
+        _httpResponses[statusClass - 2].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t Metrics::getHttpResponses(int statusClass) const {
+    return (statusClass >= 2 && statusClass <= 5)
+        ? _httpResponses[statusClass - 2].load(std::memory_order_relaxed) : 0;
+}
+
+void Metrics::reset() {
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        _histograms[i].reset();
+    }
+    motionQueue.reset();
+    serialRing.reset();
+}
+
+// Microseconds as seconds ("0.000250"), exact
+static void printSeconds(Print& out, uint32_t us) {
+    out.printf("%lu.%06lu", (unsigned long)(us / 1000000), (unsigned long)(us % 1000000));
+}
+
+void Metrics::writePrometheus(Print& out) const {
+    out.print("# HELP roboarm_latency_seconds Time spent in each instrumented section.\n"
+              "# TYPE roboarm_latency_seconds histogram\n");
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        const LatencyHistogram& histogram = _histograms[s];
+        const char* name = sectionName((Section)s);
+
+        // Cumulative buckets; the count is their total, so the two agree even
+        // while a sample is being recorded
+        uint32_t cumulative = 0;
+        for (int i = 0; i < LatencyHistogram::BUCKET_COUNT - 1; i++) {
+            cumulative += histogram.bucket(i);
+            out.printf("roboarm_latency_seconds_bucket{section=\"%s\",le=\"", name);
+            printSeconds(out, LatencyHistogram::BOUNDS_US[i]);
+            out.printf("\"} %lu\n", (unsigned long)cumulative);
+        }
+        cumulative += histogram.bucket(LatencyHistogram::BUCKET_COUNT - 1);
+        out.printf("roboarm_latency_seconds_bucket{section=\"%s\",le=\"+Inf\"} %lu\n",
+                   name, (unsigned long)cumulative);
+        out.printf("roboarm_latency_seconds_sum{section=\"%s\"} ", name);
+        printSeconds(out, toMicros(histogram.sumCycles()));
+        out.printf("\nroboarm_latency_seconds_count{section=\"%s\"} %lu\n",
+                   name, (unsigned long)cumulative);
+    }
+
+    out.print("# HELP roboarm_latency_max_seconds Longest sample since the last reset.\n"
+              "# TYPE roboarm_latency_max_seconds gauge\n");
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        out.printf("roboarm_latency_max_seconds{section=\"%s\"} ", sectionName((Section)s));
+        printSeconds(out, toMicros(_histograms[s].maxCycles()));
+        out.print("\n");
+    }
+
+    out.printf("# HELP roboarm_commands_total Commands executed by the parser.\n"
+               "# TYPE roboarm_commands_total counter\n"
+               "roboarm_commands_total{result=\"ok\"} %lu\n"
+               "roboarm_commands_total{result=\"error\"} %lu\n"
+               "roboarm_commands_total{result=\"busy\"} %lu\n",
+               (unsigned long)(_commands - _commandErrors - _commandBusy),
+               (unsigned long)_commandErrors, (unsigned long)_commandBusy);
+
+    out.print("# HELP roboarm_http_responses_total API responses by status class.\n"
+              "# TYPE roboarm_http_responses_total counter\n");
+    for (int i = 0; i < 4; i++) {
+        out.printf("roboarm_http_responses_total{code=\"%dxx\"} %lu\n", i + 2,
+                   (unsigned long)getHttpResponses(i + 2));
+    }
+
+    out.printf("# HELP roboarm_serial_overflows_total Serial lines dropped for length.\n"
+               "# TYPE roboarm_serial_overflows_total counter\n"
+               "roboarm_serial_overflows_total %lu\n",
+               (unsigned long)serialReader.getOverflowCount());
+
+    MotionSnapshot snapshot = telemetry.get();
+    out.printf("# HELP roboarm_queue_depth Entries in use now.\n"
+               "# TYPE roboarm_queue_depth gauge\n"
+               "roboarm_queue_depth{queue=\"motion\"} %u\n"
+               "# HELP roboarm_queue_high_water Most entries in use since the last reset.\n"
+               "# TYPE roboarm_queue_high_water gauge\n"
+               "roboarm_queue_high_water{queue=\"motion\"} %lu\n"
+               "roboarm_queue_high_water{queue=\"serial_ring\"} %lu\n"
+               "# HELP roboarm_queue_capacity Size of each queue.\n"
+               "# TYPE roboarm_queue_capacity gauge\n"
+               "roboarm_queue_capacity{queue=\"motion\"} %u\n"
+               "roboarm_queue_capacity{queue=\"serial_ring\"} %u\n",
+               (unsigned)snapshot.queueDepth, (unsigned long)motionQueue.get(),
+               (unsigned long)serialRing.get(), (unsigned)MOTION_QUEUE_SIZE,
+               (unsigned)SERIAL_RING_SIZE);
+
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    out.printf("# HELP roboarm_heap_free_bytes Free internal heap.\n"
+               "# TYPE roboarm_heap_free_bytes gauge\n"
+               "roboarm_heap_free_bytes %lu\n"
+               "# HELP roboarm_heap_min_free_bytes Lowest free heap since boot.\n"
+               "# TYPE roboarm_heap_min_free_bytes gauge\n"
+               "roboarm_heap_min_free_bytes %lu\n"
+               "# HELP roboarm_heap_largest_block_bytes Largest allocatable block.\n"
+               "# TYPE roboarm_heap_largest_block_bytes gauge\n"
+               "roboarm_heap_largest_block_bytes %lu\n"
+               "# HELP roboarm_heap_fragmentation_ratio 1 - largest block / free heap.\n"
+               "# TYPE roboarm_heap_fragmentation_ratio gauge\n"
+               "roboarm_heap_fragmentation_ratio %.3f\n"
+               "# HELP roboarm_uptime_seconds Time since boot.\n"
+               "# TYPE roboarm_uptime_seconds counter\n"
+               "roboarm_uptime_seconds %lu\n",
+               (unsigned long)freeHeap, (unsigned long)ESP.getMinFreeHeap(),
+               (unsigned long)largest,
+               freeHeap ? 1.0f - (float)largest / freeHeap : 0.0f,
+               (unsigned long)(millis() / 1000));
+}
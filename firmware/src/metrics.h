@@ -0,0 +1,203 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+/**
+ * Latency histogram with fixed buckets
+ *
+ * Samples are CPU cycles (ESP.getCycleCount), sorted into buckets whose
+ * bounds were converted from microseconds once in Metrics::begin(), so
+ * record() is a few compares and adds - no division, no locks.
+ *
+ * Each histogram has a single writer task (see Metrics::Timer); readers
+ * on other tasks may see a sample half-recorded (count ahead of the
+ * buckets), which a monitoring scrape tolerates. The cycle counter is per
+ * core, so a timed section must not migrate - all writers are pinned.
+ */
+class LatencyHistogram {
+public:
+    static const int BUCKET_COUNT = 13;   // The last one is +Inf
+
+    // Upper bucket bounds (microseconds)
+    static const uint32_t BOUNDS_US[BUCKET_COUNT - 1];
+
+    LatencyHistogram() { reset(); }
+
+    void record(uint32_t cycles) {
+        int i = 0;
+        while (i < BUCKET_COUNT - 1 && cycles > _boundCycles[i]) {
+            i++;
+        }
+        _buckets[i]++;
+        _count++;
+        _sumCycles += cycles;
+        if (cycles > _maxCycles) {
+            _maxCycles = cycles;
+        }
+    }
+
+    void reset();
+
+    uint32_t count() const { return _count; }
+    uint32_t bucket(int i) const { return _buckets[i]; }
+    uint32_t maxCycles() const { return _maxCycles; }
+    uint64_t sumCycles() const;
+
+    // Smallest bucket bound covering the given share of samples (us;
+    // UINT32_MAX if it lies in the +Inf bucket)
+    uint32_t percentileUs(uint32_t percent) const;
+
+    // Convert the bucket bounds for this clock (Metrics::begin)
+    static void setClock(uint32_t cpuMHz);
+
+private:
+    static uint32_t _boundCycles[BUCKET_COUNT - 1];
+
+    volatile uint32_t _buckets[BUCKET_COUNT];
+    volatile uint32_t _count;
+    volatile uint32_t _maxCycles;
+    volatile uint64_t _sumCycles;
+};
+
+/**
+ * Largest value seen (queue depths)
+ */
+class HighWater {
+public:
+    HighWater() : _max(0) {}
+    void note(uint32_t value) {
+        if (value > _max) {
+            _max = value;
+        }
+    }
+    uint32_t get() const { return _max; }
+    void reset() { _max = 0; }
+
+private:
+    volatile uint32_t _max;
+};
+
+/**
+ * Instrumentation of the command and motion paths
+ *
+ * Timed sections (each with one writer task):
+ *   PARSE          commandParser.execute            motion task
+ *   PLAN           queueMove: profile + look-ahead  motion task
+ *   DISPATCH       handing a segment to the steppers motion task
+ *   MOTION_STEP    one MotionTask::step()           motion task
+ *   SERIAL_HANDOFF serial line -> motion task -> reply, incl. execution
+ *   WEB_HANDOFF    the same for HTTP/WebSocket      AsyncTCP
+ *   HTTP           API request handlers             AsyncTCP
+ *   WEB_DEFERRED   deferred HTTP request, handed to AsyncTCP
+ *                  the motion task until the reply
+ *                  is sent
+ *   WS_DEFERRED    the same for WebSocket messages  loop()
+ *
+ * plus counters, queue high-water marks and heap statistics. Read with
+ * M850 or GET /api/metrics; M850 R1 resets the histograms and marks.
+ */
+class Metrics {
+public:
+    enum Section : uint8_t {
+        PARSE,
+        PLAN,
+        DISPATCH,
+        MOTION_STEP,
+        SERIAL_HANDOFF,
+        WEB_HANDOFF,
+        HTTP,
+        WEB_DEFERRED,
+        WS_DEFERRED,
+        SECTION_COUNT
+    };
+
+    /**
+     * Times the enclosing scope into a histogram
+     */
+    class Timer {
+    public:
+        explicit Timer(Section section);
+        ~Timer();
+
+    private:
+        #if METRICS_ENABLED
+        Section _section;
+        uint32_t _start;
+        #endif
+    };
+
+    Metrics();
+
+    /**
+     * Read the CPU clock for the bucket bounds (call once in setup)
+     */
+    void begin();
+
+    void record(Section section, uint32_t cycles) { _histograms[section].record(cycles); }
+
+    // For spans that start and end on different cores (the cycle counters
+    // are per core), timed with micros() instead
+    void recordMicros(Section section, uint32_t us) {
+        record(section, us < UINT32_MAX / _cpuMHz ? us * _cpuMHz : UINT32_MAX);
+    }
+    const LatencyHistogram& histogram(Section section) const { return _histograms[section]; }
+    static const char* sectionName(Section section);
+
+    // Command outcomes (motion task)
+    void countCommand(bool success, bool busy);
+    uint32_t getCommandCount() const { return _commands; }
+    uint32_t getCommandErrors() const { return _commandErrors; }
+    uint32_t getCommandBusy() const { return _commandBusy; }
+
+    // HTTP responses by status class, 2xx..5xx (AsyncTCP)
+    void countHttpResponse(int code);
+    uint32_t getHttpResponses(int statusClass) const;
+
+    HighWater motionQueue;   // Motion queue depth
+    HighWater serialRing;    // Bytes buffered in the serial line reader
+
+    /**
+     * Reset histograms and high-water marks (counters keep running, as
+     * Prometheus expects)
+     */
+    void reset();
+
+    /**
+     * Cycles to microseconds at the current clock
+     */
+    uint32_t toMicros(uint64_t cycles) const { return cycles / _cpuMHz; }
+
+    /**
+     * Write everything in the Prometheus text exposition format
+     */
+    void writePrometheus(Print& out) const;
+
+private:
+    LatencyHistogram _histograms[SECTION_COUNT];
+    uint32_t _cpuMHz;
+    volatile uint32_t _commands;
+    volatile uint32_t _commandErrors;
+    volatile uint32_t _commandBusy;
+    std::atomic<uint32_t> _httpResponses[4];   // 2xx, 3xx, 4xx, 5xx
+};
+
+// Global metrics instance
+extern Metrics metrics;
+
+#if METRICS_ENABLED
+inline Metrics::Timer::Timer(Section section)
+    : _section(section), _start(ESP.getCycleCount()) {
+}
+
+inline Metrics::Timer::~Timer() {
+    metrics.record(_section, ESP.getCycleCount() - _start);
+}
+#else
+inline Metrics::Timer::Timer(Section) {}
+inline Metrics::Timer::~Timer() {}
+#endif
+
+#endif // METRICS_H
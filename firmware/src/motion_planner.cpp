@@ -0,0 +1,260 @@
+#include "motion_planner.h"
+
+namespace {
+
+// Integer square root (floor) for 64-bit values
+uint32_t isqrt64(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)result;
+}
+
+// Speed a joint may carry from one segment into the next
+uint32_t junctionLimit(const MotionSegment& from, const MotionSegment& to, int joint) {
+    #if LOOKAHEAD_ENABLED
+    long a = from.delta[joint];
+    long b = to.delta[joint];
+
+    // Must stop if the joint stops, starts or reverses at the junction
+    if (a == 0 || b == 0 || (a > 0) != (b > 0)) {
+        return 0;
+    }
+
+    return min(from.speedHz[joint], to.speedHz[joint]);
+    #else
+    (void)from;
+    (void)to;
+    (void)joint;
+    return 0;
+    #endif
+}
+
+// A coordinated segment keeps its joints in step only while they all run
+// at the same fraction of their cruise speeds, so the junction speeds are
+// scaled down together to the fraction the tightest joint allows. The
+// fraction is taken against the segment that ends at the junction if it is
+// coordinated, otherwise against the one that starts there.
+void coordinateJunction(const MotionSegment& from, const MotionSegment& to,
+                        uint32_t exit[MOTOR_COUNT]) {
+    const MotionSegment& basis = from.coordinated ? from : to;
+    int lead = -1;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        bool involved = (from.coordinated && from.delta[i] != 0) ||
+                        (to.coordinated && to.delta[i] != 0);
+        if (!involved) continue;
+
+        // A joint that starts or stops here holds the whole path at rest
+        if (basis.delta[i] == 0) {
+            lead = i;
+            exit[i] = 0;
+            break;
+        }
+
+        // exit_i / v_i < exit_lead / v_lead  <=>  exit_i * v_lead < exit_lead * v_i
+        if (lead < 0 ||
+            (uint64_t)exit[i] * basis.speedHz[lead] < (uint64_t)exit[lead] * basis.speedHz[i]) {
+            lead = i;
+        }
+    }
+
+    if (lead < 0) {
+        return;
+    }
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (basis.delta[i] == 0 || exit[lead] == 0) {
+            exit[i] = 0;
+        } else if (i != lead) {
+            exit[i] = (uint32_t)((uint64_t)basis.speedHz[i] * exit[lead] / basis.speedHz[lead]);
+        }
+    }
+}
+
+// Steps of a constant-jerk ramp: accel * t^2 / 6 with t = rampAccel / jerk
+uint32_t rampSteps(uint32_t accel, uint32_t rampAccel, uint32_t jerk) {
+    uint64_t steps = (uint64_t)accel * rampAccel / jerk * rampAccel / jerk / 6;
+    return steps > UINT32_MAX ? UINT32_MAX : (uint32_t)steps;
+}
+
+}  // namespace
+
+namespace MotionPlanner {
+
+void computeProfile(MotionSegment& segment,
+                    const uint32_t maxSpeedHz[MOTOR_COUNT],
+                    const uint32_t maxAccel[MOTOR_COUNT],
+                    const uint32_t jerk[MOTOR_COUNT]) {
+    memcpy(segment.speedHz, maxSpeedHz, sizeof(segment.speedHz));
+    memcpy(segment.accel, maxAccel, sizeof(segment.accel));
+
+    uint32_t distance[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        segment.exitSpeedHz[i] = 0;
+        distance[i] = labs(segment.delta[i]);
+    }
+
+    if (segment.coordinated) {
+        computeCoordinatedProfile(distance, segment.speedHz, segment.accel);
+    }
+    computeJerkRamps(distance, segment.accel, jerk, segment.coordinated,
+                     segment.linearAccelSteps);
+}
+
+void computeJerkRamps(const uint32_t distance[MOTOR_COUNT],
+                      const uint32_t accel[MOTOR_COUNT],
+                      const uint32_t jerk[MOTOR_COUNT], bool coordinated,
+                      uint32_t steps[MOTOR_COUNT]) {
+    // Joint with the longest ramp time: a_i / j_i > a_lead / j_lead
+    int lead = -1;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        steps[i] = 0;
+        if (distance[i] == 0 || jerk[i] == 0) continue;
+        if (lead < 0 || (uint64_t)accel[i] * jerk[lead] > (uint64_t)accel[lead] * jerk[i]) {
+            lead = i;
+        }
+    }
+
+    if (lead < 0) {
+        return;  // Trapezoids all round
+    }
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (distance[i] == 0) continue;
+        if (coordinated) {
+            steps[i] = rampSteps(accel[i], accel[lead], jerk[lead]);
+        } else if (jerk[i] > 0) {
+            steps[i] = rampSteps(accel[i], accel[i], jerk[i]);
+        }
+    }
+}
+
+/**
+ * Coordinated move profile
+ *
+ * Treat the move as a path parameter s going 0..1. Joint i travels d_i * s,
+ * so its speed is d_i * ds/dt and its accel is d_i * d2s/dt2. The path can
+ * go no faster than the tightest joint allows:
+ *
+ *   ds/dt   <= min(vmax_i / d_i)
+ *   d2s/dt2 <= min(amax_i / d_i)
+ *
+ * The limiting joint (lead) runs at its own limits; every other joint i gets
+ * v_i = vmax_lead * d_i / d_lead (same for accel). All joints then follow
+ * the same normalized trapezoid and arrive together. Everything is integer:
+ * lead selection uses 64-bit cross-multiplication, no division until the
+ * final scale.
+ */
+void computeCoordinatedProfile(const uint32_t distance[MOTOR_COUNT],
+                               uint32_t speedHz[MOTOR_COUNT],
+                               uint32_t accel[MOTOR_COUNT]) {
+    int speedLead = -1;
+    int accelLead = -1;
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (distance[i] == 0) continue;
+
+        // vmax_i / d_i < vmax_lead / d_lead  <=>  vmax_i * d_lead < vmax_lead * d_i
+        if (speedLead < 0 ||
+            (uint64_t)speedHz[i] * distance[speedLead] <
+            (uint64_t)speedHz[speedLead] * distance[i]) {
+            speedLead = i;
+        }
+        if (accelLead < 0 ||
+            (uint64_t)accel[i] * distance[accelLead] <
+            (uint64_t)accel[accelLead] * distance[i]) {
+            accelLead = i;
+        }
+    }
+
+    if (speedLead < 0) {
+        return;  // Nothing moves
+    }
+
+    const uint64_t leadSpeed = speedHz[speedLead];
+    const uint64_t leadAccel = accel[accelLead];
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (distance[i] == 0) continue;
+
+        uint64_t v = leadSpeed * distance[i] / distance[speedLead];
+        uint64_t a = leadAccel * distance[i] / distance[accelLead];
+
+        // Never drop to zero - FastAccelStepper rejects 0 Hz / 0 accel
+        speedHz[i] = v > 0 ? (uint32_t)v : 1;
+        accel[i] = a > 0 ? (uint32_t)a : 1;
+    }
+}
+
+void replan(MotionSegment* active, MotionQueue& queue) {
+    size_t count = queue.size();
+    if (count == 0) {
+        return;
+    }
+
+    // Newest segment always ends at rest
+    MotionSegment& newest = queue.at(count - 1);
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        newest.exitSpeedHz[i] = 0;
+    }
+
+    // Walk backwards, propagating how fast each junction may be entered
+    for (size_t k = count; k > 0; k--) {
+        MotionSegment& segment = queue.at(k - 1);
+        MotionSegment* previous = (k > 1) ? &queue.at(k - 2) : active;
+        if (!previous) {
+            break;
+        }
+
+        uint32_t exit[MOTOR_COUNT];
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            uint32_t entry = maxEntrySpeed(segment.exitSpeedHz[i], segment.accel[i],
+                                           labs(segment.delta[i]));
+            exit[i] = min(junctionLimit(*previous, segment, i), entry);
+        }
+        if (previous->coordinated || segment.coordinated) {
+            coordinateJunction(*previous, segment, exit);
+        }
+
+        bool changed = false;
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            if (exit[i] != previous->exitSpeedHz[i]) {
+                previous->exitSpeedHz[i] = exit[i];
+                changed = true;
+            }
+        }
+
+        // Nothing further back can change (except across the new junction)
+        if (!changed && k < count) {
+            break;
+        }
+    }
+}
+
+uint32_t brakingDistance(uint32_t fromHz, uint32_t toHz, uint32_t accel) {
+    if (fromHz <= toHz || accel == 0) {
+        return 0;
+    }
+    uint64_t diff = (uint64_t)fromHz * fromHz - (uint64_t)toHz * toHz;
+    return (uint32_t)(diff / (2ULL * accel));
+}
+
+uint32_t maxEntrySpeed(uint32_t exitHz, uint32_t accel, uint32_t distance) {
+    return isqrt64((uint64_t)exitHz * exitHz + 2ULL * accel * distance);
+}
+
+}  // namespace MotionPlanner
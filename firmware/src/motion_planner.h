@@ -0,0 +1,99 @@
+#ifndef MOTION_PLANNER_H
+#define MOTION_PLANNER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "ring_buffer.h"
+
+/**
+ * A buffered multi-joint move waiting in the motion queue
+ *
+ * Everything below `coordinated` is filled in by the planner when the
+ * segment is queued, so dispatching it is just setSpeedInHz/moveTo.
+ */
+struct MotionSegment {
+    long positions[MOTOR_COUNT];  // Absolute targets (joints in jointMask)
+    uint8_t jointMask;            // Bit n set = joint n+1 moves
+    bool coordinated;             // All joints arrive at the same time
+
+    long delta[MOTOR_COUNT];            // Signed travel from the previous segment's end
+    uint32_t speedHz[MOTOR_COUNT];      // Cruise speed for this segment
+    uint32_t accel[MOTOR_COUNT];        // Acceleration for this segment
+    uint32_t exitSpeedHz[MOTOR_COUNT];  // Planned speed at the junction into the next segment
+    uint32_t linearAccelSteps[MOTOR_COUNT];  // S-curve ramp length (0 = trapezoid)
+};
+
+typedef RingBuffer<MotionSegment, MOTION_QUEUE_SIZE> MotionQueue;
+
+/**
+ * Look-ahead planner
+ *
+ * Works out how fast each joint may still be moving at every junction
+ * between queued segments. A joint keeps moving through a junction only if
+ * it travels in the same direction on both sides; the junction speed is
+ * capped by both segments' cruise speeds and by what the joint can still
+ * brake from before the end of the queue (backward pass, v^2 = ve^2 + 2ad).
+ * At a junction with a coordinated segment on either side those per-joint
+ * limits become one path-speed ratio, the tightest joint's, applied to
+ * every joint, so the joints stay in proportion through the junction.
+ *
+ * All math is integer (speeds in Hz, accel in steps/s^2).
+ */
+namespace MotionPlanner {
+
+/**
+ * Fill speedHz/accel/linearAccelSteps for a segment from per-joint limits
+ * Coordinated segments are rescaled so every joint arrives together.
+ */
+void computeProfile(MotionSegment& segment,
+                    const uint32_t maxSpeedHz[MOTOR_COUNT],
+                    const uint32_t maxAccel[MOTOR_COUNT],
+                    const uint32_t jerk[MOTOR_COUNT]);
+
+/**
+ * S-curve ramp lengths for FastAccelStepper's setLinearAcceleration()
+ *
+ * Ramping the acceleration up at a constant jerk j takes t = a / j and
+ * covers a t^2 / 6 steps. Independent joints each use their own t; in a
+ * coordinated move all joints share the longest t, so their normalized
+ * profiles stay identical and they still arrive together.
+ * @param distance Absolute travel per joint (0 = joint not moving)
+ * @param accel Acceleration of each joint in this move
+ * @param jerk Jerk limit per joint (0 = no limit)
+ * @param steps Out: linear-acceleration steps per joint
+ */
+void computeJerkRamps(const uint32_t distance[MOTOR_COUNT],
+                      const uint32_t accel[MOTOR_COUNT],
+                      const uint32_t jerk[MOTOR_COUNT], bool coordinated,
+                      uint32_t steps[MOTOR_COUNT]);
+
+/**
+ * Compute per-joint speed/accel so every joint finishes at the same time
+ * @param distance Absolute travel per joint (0 = joint not moving)
+ * @param speedHz In: limits, out: scaled speeds
+ * @param accel In: limits, out: scaled accelerations
+ */
+void computeCoordinatedProfile(const uint32_t distance[MOTOR_COUNT],
+                               uint32_t speedHz[MOTOR_COUNT],
+                               uint32_t accel[MOTOR_COUNT]);
+
+/**
+ * Recompute junction exit speeds after a segment was appended
+ * @param active Segment currently executing (nullptr if none)
+ * @param queue Pending segments, oldest first
+ */
+void replan(MotionSegment* active, MotionQueue& queue);
+
+/**
+ * Steps needed to slow from one speed to another at the given acceleration
+ */
+uint32_t brakingDistance(uint32_t fromHz, uint32_t toHz, uint32_t accel);
+
+/**
+ * Highest entry speed that can still slow to exitHz within distance steps
+ */
+uint32_t maxEntrySpeed(uint32_t exitHz, uint32_t accel, uint32_t distance);
+
+}  // namespace MotionPlanner
+
+#endif // MOTION_PLANNER_H
@@ -0,0 +1,134 @@
+#include "motion_task.h"
+#include "motor_controller.h"
+#include "program_player.h"
+#include "trajectory.h"
+#include "cartesian_planner.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "arm_sync.h"
+#include "encoder_monitor.h"
+#include "trace.h"
+
+// Global instance
+MotionTask motionTask;
+
+MotionTask::MotionTask() : _task(nullptr) {
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        _done[i] = nullptr;
+    }
+}
+
+bool MotionTask::start() {
+    if (_task) {
+        return true;
+    }
+
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        _done[i] = xSemaphoreCreateBinary();
+        if (!_done[i]) {
+            return false;
+        }
+    }
+
+    TaskHandle_t task = nullptr;
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry, "motion", MOTION_TASK_STACK_SIZE, this,
+        MOTION_TASK_PRIORITY, &task, MOTION_TASK_CORE);
+    if (created != pdPASS) {
+        return false;
+    }
+
+    _task = task;
+    DEBUG_PRINTF("MotionTask: running on core %d\n", MOTION_TASK_CORE);
+    return true;
+}
+
+void MotionTask::submit(Channel channel, const Request& request) {
+    // Inline before the task exists, and for requests made by the task itself
+    if (!_task || xTaskGetCurrentTaskHandle() == _task) {
+        request.fn(request.context);
+        telemetry.capture();
+        return;
+    }
+
+    Metrics::Timer timer(channel == CHANNEL_SERIAL ? Metrics::SERIAL_HANDOFF
+                                                   : Metrics::WEB_HANDOFF);
+
+    // Callers wait for completion, so the queue only fills if a channel
+    // is shared between tasks or has post()ed requests ahead
+    while (!_queues[channel].push(request)) {
+        vTaskDelay(1);
+    }
+
+    xTaskNotifyGive(_task);
+    xSemaphoreTake(_done[channel], portMAX_DELAY);
+}
+
+bool MotionTask::post(Channel channel, void (*fn)(void*), void* context) {
+    Request request = { fn, context, false };
+    if (!_task || xTaskGetCurrentTaskHandle() == _task) {
+        fn(context);
+        telemetry.capture();
+        return true;
+    }
+
+    if (!_queues[channel].push(request)) {
+        return false;
+    }
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+void MotionTask::wake() {
+    if (_task) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+void IRAM_ATTR MotionTask::wakeFromISR() {
+    if (_task) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(_task, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+void MotionTask::step() {
+    Metrics::Timer timer(Metrics::MOTION_STEP);
+
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        Request request;
+        while (_queues[i].pop(request)) {
+            request.fn(request.context);
+
+            // Publish before replying, so the caller's next status read
+            // already reflects its own command
+            telemetry.capture();
+            if (request.wait) {
+                xSemaphoreGive(_done[i]);
+            }
+        }
+    }
+
+    // Release a synchronized start just before the queue is dispatched
+    armSync.update();
+
+    // Hand the next segments to the steppers, then top the queue up
+    motors.update();
+    encoders.update();
+    programPlayer.update();
+    trajectoryPlayer.update();
+    cartesianPlanner.update();
+    trace.update();
+
+    telemetry.update();
+}
+
+void MotionTask::taskEntry(void* param) {
+    MotionTask* task = static_cast<MotionTask*>(param);
+    for (;;) {
+        // Woken early by submit()
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MOTION_TASK_INTERVAL_MS));
+        task->step();
+    }
+}
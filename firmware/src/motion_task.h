@@ -0,0 +1,110 @@
+#ifndef MOTION_TASK_H
+#define MOTION_TASK_H
+
+#include <Arduino.h>
+#include <type_traits>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "spsc_queue.h"
+
+/**
+ * Motion task - sole owner of the motion state
+ *
+ * A FreeRTOS task pinned to MOTION_TASK_CORE runs the motion queue
+ * dispatcher, the program/trajectory players and the Cartesian planner.
+ * Everything that changes motion state (command execution, enable,
+ * batches, uploads that swap the stored trajectory) is handed to it with
+ * run(), so `motors` and the players are only ever touched from one task.
+ *
+ * It is also the only writer of the telemetry snapshot (telemetry.h),
+ * published at a fixed rate and after every request.
+ *
+ * Each ingest path has its own channel (a lock-free SPSC queue), so there
+ * is exactly one producer per queue:
+ *   CHANNEL_SERIAL - serial reader (serial task or loop)
+ *   CHANNEL_WEB    - AsyncTCP task (HTTP handlers and WebSocket)
+ *
+ * run() blocks the caller until the motion task has executed the request;
+ * post() only enqueues it, for callers that must not wait (the web
+ * handlers hand their work over; AsyncTCP sends the HTTP reply once it is
+ * done, loop() the WebSocket reply).
+ * Before start() (or if the task could not be created) requests execute
+ * inline, and loop() drives step() itself.
+ */
+class MotionTask {
+public:
+    enum Channel : uint8_t {
+        CHANNEL_SERIAL,
+        CHANNEL_WEB,
+        CHANNEL_COUNT
+    };
+
+    MotionTask();
+
+    /**
+     * Create the pinned motion task
+     * @return true if the task is running
+     */
+    bool start();
+
+    bool isRunning() const { return _task != nullptr; }
+
+    /**
+     * Execute fn on the motion task and wait for it to finish
+     * Each channel must only be used from a single task.
+     * @param channel Caller's ingest channel
+     * @param fn Callable taking no arguments (typically a capturing lambda)
+     */
+    template <typename F>
+    void run(Channel channel, F&& fn) {
+        typedef typename std::remove_reference<F>::type Fn;
+        Request request = { &invoke<Fn>, (void*)&fn, true };
+        submit(channel, request);
+    }
+
+    /**
+     * Queue fn(context) on the motion task without waiting for it
+     * The caller keeps context alive until fn has run and signals its own
+     * completion from fn.
+     * @return false if the channel queue is full
+     */
+    bool post(Channel channel, void (*fn)(void*), void* context);
+
+    /**
+     * Run step() now instead of at the next MOTION_TASK_INTERVAL_MS tick
+     * (wakeFromISR from interrupt handlers)
+     */
+    void wake();
+    void wakeFromISR();
+
+    /**
+     * One iteration: execute queued requests, then dispatch motion
+     * (called by the task, or from loop() when the task is not running)
+     */
+    void step();
+
+private:
+    struct Request {
+        void (*fn)(void*);
+        void* context;
+        bool wait;          // Caller blocks on _done (run)
+    };
+
+    TaskHandle_t _task;
+    SpscQueue<Request, MOTION_CHANNEL_DEPTH> _queues[CHANNEL_COUNT];
+    SemaphoreHandle_t _done[CHANNEL_COUNT];
+
+    void submit(Channel channel, const Request& request);
+
+    template <typename Fn>
+    static void invoke(void* context) { (*static_cast<Fn*>(context))(); }
+
+    static void taskEntry(void* param);
+};
+
+// Global motion task instance
+extern MotionTask motionTask;
+
+#endif // MOTION_TASK_H
@@ -1,20 +1,74 @@
 #include "motor_controller.h"
+#include "metrics.h"
+#include "trace.h"
+#include "settings_store.h"
 
 // Global instance
 MotorController motors;
 
-MotorController::MotorController() : _enabled(false) {
+/**
+ * Endstop edge latch, written by the pin interrupt
+ * Only the timestamp is taken in the ISR; the homing state machine checks
+ * the switch is really active (ENDSTOP_CONFIRM_US) and turns the timestamp
+ * into a position (steps since the edge at the known creep speed).
+ */
+struct EndstopLatch {
+    std::atomic<bool> armed;
+    std::atomic<bool> triggered;
+    std::atomic<uint32_t> timeUs;
+};
+
+static EndstopLatch endstopLatches[MOTOR_COUNT];
+
+static void IRAM_ATTR onEndstop(void* arg) {
+    EndstopLatch* latch = static_cast<EndstopLatch*>(arg);
+    if (latch->armed.load(std::memory_order_relaxed) &&
+        !latch->triggered.load(std::memory_order_relaxed)) {
+        latch->timeUs.store(micros(), std::memory_order_relaxed);
+        latch->triggered.store(true, std::memory_order_release);
+    }
+}
+
+static void armLatch(uint8_t joint, bool armed) {
+    endstopLatches[joint].triggered.store(false, std::memory_order_relaxed);
+    endstopLatches[joint].armed.store(armed, std::memory_order_release);
+}
+
+MotorController::MotorController()
+    : _enabled(false), _coordinated(DEFAULT_COORDINATED_MOVES),
+      _activeValid(false), _stopCount(0), _batchOpen(false), _batchStartDepth(0),
+      _startHeld(false),
+      _jogging(false), _lastJogMs(0), _homing(false), _homedMask(0), _error(nullptr) {
+    _homingError[0] = '\0';
     for (int i = 0; i < MOTOR_COUNT; i++) {
         _steppers[i] = nullptr;
+        _jogSpeedHz[i] = 0;
+        _originCount[i] = 0;
+        _homingPhase[i] = HomingPhase::IDLE;
+        _homingMoveStarted[i] = false;
     }
+    resetSettings();
 }
 
-void MotorController::begin() {
+bool MotorController::begin() {
     DEBUG_PRINTLN("MotorController: Initializing FastAccelStepper engine...");
 
     // Initialize the FastAccelStepper engine
     _engine.init();
 
+    // Tuned parameters saved with M500 replace the defaults
+    JointSettings saved[MOTOR_COUNT];
+    if (settingsStore.load(saved)) {
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            if (!setSettings(i, saved[i])) {
+                DEBUG_PRINTF("  Saved settings for J%d out of range - using defaults\n", i + 1);
+            }
+        }
+        DEBUG_PRINTLN("MotorController: Loaded saved settings");
+    } else if (settingsStore.getError()) {
+        DEBUG_PRINTF("MotorController: %s - using defaults\n", settingsStore.getError());
+    }
+
     // Initialize enable pin
     pinMode(MOTORS_ENABLE_PIN, OUTPUT);
     digitalWrite(MOTORS_ENABLE_PIN, HIGH);  // Disable motors initially (active LOW)
@@ -23,8 +77,11 @@ void MotorController::begin() {
     for (int i = 0; i < MOTOR_COUNT; i++) {
         const MotorConfig& cfg = MOTOR_CONFIGS[i];
 
-        // Connect stepper to step pin (FastAccelStepper uses hardware peripherals)
-        _steppers[i] = _engine.stepperConnectToPin(cfg.stepPin);
+        // Connect stepper to step pin (FastAccelStepper uses hardware peripherals).
+        // Its MCPWM/PCNT driver takes PCNT units from 0 up; joints with an
+        // encoder step from RMT instead so the encoders get units of their own
+        _steppers[i] = _engine.stepperConnectToPin(
+            cfg.stepPin, cfg.encoderCountsPerRev ? DRIVER_RMT : DRIVER_DONT_CARE);
 
         if (_steppers[i]) {
             // Configure direction pin
@@ -35,20 +92,31 @@ void MotorController::begin() {
             _steppers[i]->setAutoEnable(true);
 
             // Set motion parameters
-            _steppers[i]->setSpeedInHz(cfg.maxSpeedHz);
-            _steppers[i]->setAcceleration(cfg.acceleration);
+            _steppers[i]->setSpeedInHz(_maxSpeedHz[i]);
+            _steppers[i]->setAcceleration(_acceleration[i]);
 
-            DEBUG_PRINTF("  %s: Step=%d, Dir=%d, Speed=%lu Hz, Accel=%lu\n",
+            DEBUG_PRINTF("  %s: Step=%d, Dir=%d, Speed=%lu Hz, Accel=%lu, Jerk=%lu\n",
                          cfg.name, cfg.stepPin, cfg.dirPin,
-                         cfg.maxSpeedHz, cfg.acceleration);
+                         (unsigned long)_maxSpeedHz[i], (unsigned long)_acceleration[i],
+                         (unsigned long)_jerk[i]);
+
+            if (cfg.endstopPin >= 0) {
+                armLatch(i, false);
+                pinMode(cfg.endstopPin, ENDSTOP_ACTIVE_LOW ? INPUT_PULLUP : INPUT);
+                attachInterruptArg(digitalPinToInterrupt(cfg.endstopPin), onEndstop,
+                                   &endstopLatches[i], ENDSTOP_ACTIVE_LOW ? FALLING : RISING);
+            }
         } else {
             DEBUG_PRINTF("  ERROR: Failed to connect %s on pin %d\n",
                          cfg.name, cfg.stepPin);
+            _error = "Stepper failed to connect (step pin or driver)";
+            return false;
         }
     }
 
     _enabled = false;
     DEBUG_PRINTLN("MotorController: Ready (using FastAccelStepper hardware acceleration)");
+    return true;
 }
 
 void MotorController::setEnabled(bool enabled) {
@@ -66,13 +134,13 @@ void MotorController::setEnabled(bool enabled) {
 }
 
 bool MotorController::moveTo(uint8_t joint, long position) {
-    if (!isValidJoint(joint) || !_steppers[joint]) {
+    if (!isValidJoint(joint)) {
         DEBUG_PRINTF("Motors: Invalid joint %d\n", joint);
         return false;
     }
 
-    if (!_enabled) {
-        DEBUG_PRINTLN("Motors: Cannot move - motors disabled");
+    if (!_enabled || _jogging || _homing) {
+        DEBUG_PRINTLN("Motors: Cannot move - motors disabled, jogging or homing");
         return false;
     }
 
@@ -81,6 +149,9 @@ bool MotorController::moveTo(uint8_t joint, long position) {
         return false;
     }
 
+    _steppers[joint]->setSpeedInHz(_maxSpeedHz[joint]);
+    _steppers[joint]->setAcceleration(_acceleration[joint]);
+    _steppers[joint]->setLinearAcceleration(jerkRampSteps(joint));
     _steppers[joint]->moveTo(position);
 
     #if DEBUG_MOTORS
@@ -91,7 +162,7 @@ bool MotorController::moveTo(uint8_t joint, long position) {
 }
 
 bool MotorController::moveRelative(uint8_t joint, long steps) {
-    if (!isValidJoint(joint) || !_steppers[joint]) {
+    if (!isValidJoint(joint)) {
         return false;
     }
 
@@ -99,17 +170,19 @@ bool MotorController::moveRelative(uint8_t joint, long steps) {
     return moveTo(joint, newPosition);
 }
 
-bool MotorController::moveToMultiple(const long positions[MOTOR_COUNT]) {
-    if (!_enabled) {
-        DEBUG_PRINTLN("Motors: Cannot move - motors disabled");
+bool MotorController::moveToMultiple(const long positions[MOTOR_COUNT], uint8_t jointMask,
+                                     bool coordinated) {
+    if (!_enabled || _jogging || _homing) {
+        DEBUG_PRINTLN("Motors: Cannot move - motors disabled, jogging or homing");
         return false;
     }
 
     bool allValid = true;
 
     // Validate all positions first
+    jointMask &= ALL_JOINTS_MASK;
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        if (positions[i] != LONG_MIN && !isWithinLimits(i, positions[i])) {
+        if ((jointMask >> i) & 1 && !isWithinLimits(i, positions[i])) {
             DEBUG_PRINTF("Motors: J%d position %ld out of limits\n", i + 1, positions[i]);
             allValid = false;
         }
@@ -119,9 +192,29 @@ bool MotorController::moveToMultiple(const long positions[MOTOR_COUNT]) {
         return false;
     }
 
+    // Per-joint speed/accel for this move
+    uint32_t speedHz[MOTOR_COUNT];
+    uint32_t accel[MOTOR_COUNT];
+    uint32_t linearSteps[MOTOR_COUNT];
+    memcpy(speedHz, _maxSpeedHz, sizeof(speedHz));
+    memcpy(accel, _acceleration, sizeof(accel));
+
+    uint32_t distance[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        distance[i] = (jointMask >> i) & 1
+            ? labs(positions[i] - _steppers[i]->getCurrentPosition()) : 0;
+    }
+    if (coordinated) {
+        MotionPlanner::computeCoordinatedProfile(distance, speedHz, accel);
+    }
+    MotionPlanner::computeJerkRamps(distance, accel, _jerk, coordinated, linearSteps);
+
     // Apply all movements (FastAccelStepper starts them near-simultaneously)
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        if (positions[i] != LONG_MIN && _steppers[i]) {
+        if ((jointMask >> i) & 1) {
+            _steppers[i]->setSpeedInHz(speedHz[i]);
+            _steppers[i]->setAcceleration(accel[i]);
+            _steppers[i]->setLinearAcceleration(linearSteps[i]);
             _steppers[i]->moveTo(positions[i]);
 
             #if DEBUG_MOTORS
@@ -133,24 +226,558 @@ bool MotorController::moveToMultiple(const long positions[MOTOR_COUNT]) {
     return true;
 }
 
+bool MotorController::queueMove(const long positions[MOTOR_COUNT], uint8_t jointMask) {
+    return queueMove(positions, jointMask, 0, 0, _coordinated);
+}
+
+bool MotorController::queueMove(const long positions[MOTOR_COUNT], uint8_t jointMask,
+                                uint32_t speedHz, uint32_t accel, bool coordinated) {
+    if (!_enabled) {
+        DEBUG_PRINTLN("Motors: Cannot queue - motors disabled");
+        return false;
+    }
+
+    if (_jogging || _homing) {
+        DEBUG_PRINTLN("Motors: Cannot queue - jogging or homing");
+        return false;
+    }
+
+    if (_queue.full()) {
+        DEBUG_PRINTLN("Motors: Motion queue full");
+        return false;
+    }
+
+    // Validate up front so a bad segment never reaches the steppers
+    jointMask &= ALL_JOINTS_MASK;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if ((jointMask >> i) & 1 && !isWithinLimits(i, positions[i])) {
+            DEBUG_PRINTF("Motors: J%d position %ld out of limits\n", i + 1, positions[i]);
+            return false;
+        }
+    }
+
+    {
+        Metrics::Timer timer(Metrics::PLAN);
+
+        MotionSegment segment;
+        memcpy(segment.positions, positions, sizeof(segment.positions));
+        segment.jointMask = jointMask;
+        segment.coordinated = coordinated;
+
+        // Plan relative to where the previous segment ends, within this move's caps
+        uint32_t maxSpeed[MOTOR_COUNT];
+        uint32_t maxAccel[MOTOR_COUNT];
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            segment.delta[i] = (jointMask >> i) & 1
+                ? positions[i] - getPlannedPosition(i) : 0;
+            maxSpeed[i] = (speedHz > 0) ? min(speedHz, _maxSpeedHz[i]) : _maxSpeedHz[i];
+            maxAccel[i] = (accel > 0) ? min(accel, _acceleration[i]) : _acceleration[i];
+        }
+        MotionPlanner::computeProfile(segment, maxSpeed, maxAccel, _jerk);
+
+        _queue.push(segment);
+        MotionPlanner::replan(_activeValid ? &_active : nullptr, _queue);
+        metrics.motionQueue.note(_queue.size());
+    }
+
+    // Start immediately if idle
+    update();
+    return true;
+}
+
+bool MotorController::queueMove(const MoveRequest& move) {
+    if (!move.relative) {
+        return queueMove(move.positions, move.jointMask, move.speedHz, move.accel,
+                         move.coordinated);
+    }
+
+    long positions[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        positions[i] = (move.jointMask >> i) & 1 ? getPlannedPosition(i) + move.positions[i] : 0;
+    }
+    return queueMove(positions, move.jointMask, move.speedHz, move.accel, move.coordinated);
+}
+
+bool MotorController::jog(const long speedsHz[MOTOR_COUNT]) {
+    if (!_enabled || _homing) {
+        DEBUG_PRINTLN("Motors: Cannot jog - motors disabled or homing");
+        return false;
+    }
+
+    if (!_jogging) {
+        bool stopping = true;
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            stopping = stopping && speedsHz[i] == 0;
+        }
+        if (stopping) {
+            return true;  // Nothing jogging, nothing to stop
+        }
+    }
+
+    // Jogging only starts from rest; queued and direct moves finish first
+    if (!_jogging && (_activeValid || !_queue.empty() || _batchOpen || isAnyMoving())) {
+        DEBUG_PRINTLN("Motors: Cannot jog - moves in progress");
+        return false;
+    }
+
+    _jogging = true;
+    _lastJogMs = millis();
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        applyJogSpeed(i, speedsHz[i]);
+    }
+    return true;
+}
+
+void MotorController::stopJog() {
+    if (!_jogging) {
+        return;
+    }
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        applyJogSpeed(i, 0);
+    }
+}
+
+void MotorController::applyJogSpeed(uint8_t joint, long speedHz) {
+    FastAccelStepper* stepper = _steppers[joint];
+    long limit = _maxSpeedHz[joint];
+    speedHz = constrain(speedHz, -limit, limit);
+
+    // Never drive further into a soft limit
+    long position = stepper->getCurrentPosition();
+    if ((speedHz > 0 && position >= _limitMax[joint]) ||
+        (speedHz < 0 && position <= _limitMin[joint])) {
+        speedHz = 0;
+    }
+
+    _jogSpeedHz[joint] = speedHz;
+    if (speedHz == 0) {
+        if (stepper->isRunning()) {
+            stepper->stopMove();  // Decelerate, don't force-stop
+        }
+        return;
+    }
+
+    stepper->setSpeedInHz(speedHz > 0 ? speedHz : -speedHz);
+    stepper->setAcceleration(_acceleration[joint]);
+    stepper->setLinearAcceleration(jerkRampSteps(joint));
+
+    // Same direction, still accelerating or cruising: only change the speed
+    bool forward = speedHz > 0;
+    if (stepper->isRunning() && !stepper->isStopping() &&
+        (stepper->getCurrentSpeedInMilliHz() > 0) == forward) {
+        stepper->applySpeedAcceleration();
+    } else if (forward) {
+        stepper->runForward();
+    } else {
+        stepper->runBackward();
+    }
+}
+
+bool MotorController::nearJogLimit(uint8_t joint) const {
+    FastAccelStepper* stepper = _steppers[joint];
+    int64_t speed = stepper->getCurrentSpeedInMilliHz() / 1000;
+    if (speed == 0) {
+        return false;
+    }
+
+    // Braking distance at the joint's deceleration (an S-curve adds less
+    // than its ramp length), plus one control period
+    int64_t distance = speed * speed / (2 * (int64_t)_acceleration[joint]) +
+                       jerkRampSteps(joint);
+    int64_t margin = (speed < 0 ? -speed : speed) * MOTION_TASK_INTERVAL_MS / 1000 + 1;
+    int64_t position = stepper->getCurrentPosition();
+    if (speed > 0) {
+        return position + distance + margin >= _limitMax[joint];
+    }
+    return position - distance - margin <= _limitMin[joint];
+}
+
+void MotorController::updateJog() {
+    bool expired = millis() - _lastJogMs > JOG_WATCHDOG_MS;
+    bool active = false;
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (_jogSpeedHz[i] != 0 && (expired || nearJogLimit(i))) {
+            #if DEBUG_MOTORS
+            DEBUG_PRINTF("Motors: %s jog %s\n", MOTOR_CONFIGS[i].name,
+                         expired ? "watchdog expired" : "at soft limit");
+            #endif
+            applyJogSpeed(i, 0);
+        }
+
+        if (_jogSpeedHz[i] != 0 || _steppers[i]->isRunning()) {
+            active = true;
+        }
+    }
+
+    // Back to queued motion once every joint has come to rest
+    if (!active) {
+        _jogging = false;
+    }
+}
+
+bool MotorController::startHoming(uint8_t mask) {
+    if (!_enabled) {
+        DEBUG_PRINTLN("Motors: Cannot home - motors disabled");
+        return false;
+    }
+
+    if (_homing || _jogging || _activeValid || !_queue.empty() || _batchOpen || isAnyMoving()) {
+        DEBUG_PRINTLN("Motors: Cannot home - moves in progress");
+        return false;
+    }
+
+    _homingError[0] = '\0';
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (!((mask >> i) & 1)) {
+            continue;
+        }
+
+        _homedMask &= ~(1 << i);
+        if (MOTOR_CONFIGS[i].endstopPin < 0) {
+            // No switch: the current position is home
+            _steppers[i]->setCurrentPosition(0);
+            _originCount[i]++;
+            _homedMask |= 1 << i;
+            _homingPhase[i] = HomingPhase::DONE;
+            continue;
+        }
+
+        // Already on the switch: back off first
+        enterHomingPhase(i, isEndstopActive(i) ? HomingPhase::BACKOFF : HomingPhase::SEEK);
+        _homing = true;
+    }
+
+    if (_homing) {
+        DEBUG_PRINTLN("Motors: Homing...");
+    }
+    return true;
+}
+
+HomingPhase MotorController::getHomingPhase(uint8_t joint) const {
+    return isValidJoint(joint) ? _homingPhase[joint] : HomingPhase::IDLE;
+}
+
+const char* MotorController::homingPhaseName(HomingPhase phase) {
+    switch (phase) {
+        case HomingPhase::IDLE:    return "idle";
+        case HomingPhase::SEEK:    return "seek";
+        case HomingPhase::BACKOFF: return "backoff";
+        case HomingPhase::CREEP:   return "creep";
+        case HomingPhase::DONE:    return "done";
+        case HomingPhase::FAILED:  return "failed";
+    }
+    return "unknown";
+}
+
+bool MotorController::isEndstopActive(uint8_t joint) const {
+    if (!isValidJoint(joint) || MOTOR_CONFIGS[joint].endstopPin < 0) {
+        return false;
+    }
+    return digitalRead(MOTOR_CONFIGS[joint].endstopPin) == (ENDSTOP_ACTIVE_LOW ? LOW : HIGH);
+}
+
+void MotorController::enterHomingPhase(uint8_t joint, HomingPhase phase) {
+    _homingPhase[joint] = phase;
+    _homingMoveStarted[joint] = false;
+    armLatch(joint, phase == HomingPhase::SEEK || phase == HomingPhase::CREEP);
+}
+
+void MotorController::failHoming(uint8_t joint, const char* reason) {
+    _steppers[joint]->forceStop();
+    armLatch(joint, false);
+    _homingPhase[joint] = HomingPhase::FAILED;
+    trace.trigger(TraceTrigger::HOMING);
+    if (!_homingError[0]) {
+        snprintf(_homingError, sizeof(_homingError), "J%d: %s", joint + 1, reason);  // First failure
+    }
+    DEBUG_PRINTF("Motors: Homing failed - %s\n", _homingError);
+}
+
+void MotorController::updateHoming() {
+    bool active = false;
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        HomingPhase phase = _homingPhase[i];
+        if (phase != HomingPhase::SEEK && phase != HomingPhase::BACKOFF &&
+            phase != HomingPhase::CREEP) {
+            continue;
+        }
+        active = true;
+
+        FastAccelStepper* stepper = _steppers[i];
+        int8_t dir = MOTOR_CONFIGS[i].homeDir < 0 ? -1 : 1;
+
+        // Each phase's move is issued once the previous one has settled
+        if (!_homingMoveStarted[i]) {
+            if (stepper->isRunning()) {
+                continue;
+            }
+
+            // Homing moves are slow; plain trapezoids keep the stop short
+            stepper->setLinearAcceleration(0);
+            if (phase == HomingPhase::SEEK) {
+                // Bounded by the full travel range, so a dead switch fails
+                int32_t travel = _limitMax[i] - _limitMin[i] +
+                                 2 * HOMING_BACKOFF_STEPS;
+                stepper->setSpeedInHz(min((uint32_t)HOMING_SEEK_SPEED_HZ, _maxSpeedHz[i]));
+                stepper->setAcceleration(HOMING_SEEK_ACCEL);
+                stepper->move(dir * travel);
+            } else if (phase == HomingPhase::BACKOFF) {
+                stepper->setSpeedInHz(min((uint32_t)HOMING_SEEK_SPEED_HZ, _maxSpeedHz[i]));
+                stepper->setAcceleration(HOMING_SEEK_ACCEL);
+                stepper->move(-dir * HOMING_BACKOFF_STEPS);
+            } else {
+                stepper->setSpeedInHz(HOMING_CREEP_SPEED_HZ);
+                stepper->setAcceleration(HOMING_SEEK_ACCEL);
+                stepper->move(dir * 2 * HOMING_BACKOFF_STEPS);
+            }
+            _homingMoveStarted[i] = true;
+            continue;
+        }
+
+        bool triggered = endstopLatches[i].triggered.load(std::memory_order_acquire);
+
+        // An edge only counts if the switch still reads active a moment
+        // later; a glitch (GPIO 36/39 under WiFi/ADC) re-arms the latch
+        if (triggered) {
+            uint32_t sinceUs = micros() - endstopLatches[i].timeUs.load(std::memory_order_relaxed);
+            if (sinceUs < ENDSTOP_CONFIRM_US) {
+                continue;
+            }
+            if (!isEndstopActive(i)) {
+                armLatch(i, true);
+                triggered = false;
+            }
+        }
+
+        if (phase == HomingPhase::SEEK) {
+            if (triggered) {
+                stepper->forceStop();
+                enterHomingPhase(i, HomingPhase::BACKOFF);
+            } else if (!stepper->isRunning()) {
+                failHoming(i, "endstop not found");
+            }
+        } else if (phase == HomingPhase::BACKOFF) {
+            if (stepper->isRunning()) {
+                continue;
+            }
+            if (isEndstopActive(i)) {
+                failHoming(i, "endstop stuck active");
+            } else {
+                enterHomingPhase(i, HomingPhase::CREEP);
+            }
+        } else if (triggered) {
+            // Steps made since the edge, at the constant creep speed
+            uint32_t elapsedUs = micros() -
+                endstopLatches[i].timeUs.load(std::memory_order_relaxed);
+            int32_t overshoot = (int32_t)(((uint64_t)elapsedUs * HOMING_CREEP_SPEED_HZ
+                                           + 500000) / 1000000);
+            stepper->forceStopAndNewPosition(dir * overshoot);
+            _originCount[i]++;
+            armLatch(i, false);
+            _homingPhase[i] = HomingPhase::DONE;
+            _homedMask |= 1 << i;
+            DEBUG_PRINTF("Motors: %s homed\n", MOTOR_CONFIGS[i].name);
+        } else if (!stepper->isRunning()) {
+            failHoming(i, "endstop lost on creep");
+        }
+    }
+
+    if (!active) {
+        _homing = false;
+        DEBUG_PRINTLN(_homingError[0] ? "Motors: Homing finished with errors"
+                                      : "Motors: Homing complete");
+    }
+}
+
+void MotorController::abortHoming() {
+    if (!_homing) {
+        return;
+    }
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (_homingPhase[i] != HomingPhase::DONE && _homingPhase[i] != HomingPhase::FAILED) {
+            _homingPhase[i] = HomingPhase::IDLE;
+        }
+        if (MOTOR_CONFIGS[i].endstopPin >= 0) {
+            armLatch(i, false);
+        }
+    }
+    _homing = false;
+    DEBUG_PRINTLN("Motors: Homing aborted");
+}
+
+void MotorController::update() {
+    if (!_enabled) {
+        return;
+    }
+
+    if (_homing) {
+        updateHoming();
+        return;
+    }
+
+    if (_jogging) {
+        updateJog();
+        return;
+    }
+
+    // Queued moves wait for a synchronized start
+    if (_startHeld) {
+        return;
+    }
+
+    // Batch segments may still be rolled back; everything queued before
+    // the batch can run as usual
+    size_t dispatchable = _batchOpen ? _batchStartDepth : _queue.size();
+
+    if (_activeValid) {
+        if (!isAnyMoving()) {
+            _activeValid = false;  // Segment finished
+        } else if (dispatchable == 0 || !readyForNextSegment()) {
+            return;
+        }
+    } else if (isAnyMoving()) {
+        return;  // Busy with a direct (unqueued) move
+    }
+
+    if (dispatchable == 0 || !_queue.pop(_active)) {
+        return;
+    }
+    if (_batchOpen) {
+        _batchStartDepth--;
+    }
+    _activeValid = true;
+    dispatchSegment(_active);
+}
+
+bool MotorController::readyForNextSegment() const {
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (_active.delta[i] == 0 || !_steppers[i]->isRunning()) {
+            continue;
+        }
+
+        // Joint has to come to rest at this junction
+        uint32_t exitHz = _active.exitSpeedHz[i];
+        if (exitHz == 0) {
+            return false;
+        }
+
+        long remaining = _active.positions[i] - _steppers[i]->getCurrentPosition();
+        if ((remaining > 0) != (_active.delta[i] > 0)) {
+            continue;  // Already at (or past) the junction
+        }
+
+        // FastAccelStepper ramps down to a stop at the target, so it passes
+        // the junction speed exitHz at exitHz^2 / 2a before the junction.
+        // Hand over there (plus a margin for update() call latency), while
+        // the joint is still running at least the planned exit speed
+        uint32_t speedHz = labs(_steppers[i]->getCurrentSpeedInMilliHz()) / 1000;
+        uint32_t handoff = MotionPlanner::brakingDistance(exitHz, 0, _active.accel[i]) +
+                           (uint32_t)((uint64_t)speedHz * PLANNER_HANDOFF_MARGIN_US / 1000000);
+
+        if ((uint32_t)labs(remaining) > handoff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MotorController::dispatchSegment(const MotionSegment& segment) {
+    Metrics::Timer timer(Metrics::DISPATCH);
+
+    // Joints still running from the previous segment are retargeted on the
+    // fly; FastAccelStepper ramps from their current speed without stopping
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if ((segment.jointMask >> i) & 1) {
+            _steppers[i]->setSpeedInHz(segment.speedHz[i]);
+            _steppers[i]->setAcceleration(segment.accel[i]);
+            _steppers[i]->setLinearAcceleration(segment.linearAccelSteps[i]);
+            _steppers[i]->moveTo(segment.positions[i]);
+
+            #if DEBUG_MOTORS
+            DEBUG_PRINTF("Motors: %s -> %ld (exit %lu Hz)\n", MOTOR_CONFIGS[i].name,
+                         segment.positions[i], segment.exitSpeedHz[i]);
+            #endif
+        }
+    }
+}
+
+void MotorController::clearQueue() {
+    _queue.clear();
+    _batchStartDepth = 0;
+}
+
+void MotorController::beginBatch() {
+    _batchOpen = true;
+    _batchStartDepth = _queue.size();
+}
+
+void MotorController::commitBatch() {
+    _batchOpen = false;
+    update();
+}
+
+void MotorController::abortBatch() {
+    if (!_batchOpen) {
+        return;
+    }
+    _queue.truncate(_batchStartDepth);
+    _batchOpen = false;
+
+    // The old tail must end at rest again
+    MotionPlanner::replan(_activeValid ? &_active : nullptr, _queue);
+    if (_queue.empty() && _activeValid) {
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            _active.exitSpeedHz[i] = 0;
+        }
+    }
+    update();
+}
+
+long MotorController::getPlannedPosition(uint8_t joint) const {
+    if (!isValidJoint(joint)) {
+        return 0;
+    }
+
+    // Newest queued target for this joint wins
+    for (size_t i = _queue.size(); i > 0; i--) {
+        const MotionSegment& segment = _queue.at(i - 1);
+        if ((segment.jointMask >> joint) & 1) {
+            return segment.positions[joint];
+        }
+    }
+
+    if (_steppers[joint]->isRunning()) {
+        return _steppers[joint]->targetPos();
+    }
+    return _steppers[joint]->getCurrentPosition();
+}
+
 void MotorController::stop(uint8_t joint) {
-    if (isValidJoint(joint) && _steppers[joint]) {
+    if (isValidJoint(joint)) {
         _steppers[joint]->forceStop();
         DEBUG_PRINTF("Motors: %s STOPPED\n", MOTOR_CONFIGS[joint].name);
     }
 }
 
 void MotorController::stopAll() {
+    _stopCount++;
+    clearQueue();
+    _activeValid = false;
+    _jogging = false;
+    _startHeld = false;
+    abortHoming();
+
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        if (_steppers[i]) {
-            _steppers[i]->forceStop();
-        }
+        _jogSpeedHz[i] = 0;
+        _steppers[i]->forceStop();
     }
     DEBUG_PRINTLN("Motors: ALL STOPPED (emergency)");
 }
 
 bool MotorController::isMoving(uint8_t joint) const {
-    if (!isValidJoint(joint) || !_steppers[joint]) {
+    if (!isValidJoint(joint)) {
         return false;
     }
     return _steppers[joint]->isRunning();
@@ -158,7 +785,7 @@ bool MotorController::isMoving(uint8_t joint) const {
 
 bool MotorController::isAnyMoving() const {
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        if (_steppers[i] && _steppers[i]->isRunning()) {
+        if (_steppers[i]->isRunning()) {
             return true;
         }
     }
@@ -166,58 +793,172 @@ bool MotorController::isAnyMoving() const {
 }
 
 long MotorController::getPosition(uint8_t joint) const {
-    if (!isValidJoint(joint) || !_steppers[joint]) {
+    if (!isValidJoint(joint)) {
         return 0;
     }
     return _steppers[joint]->getCurrentPosition();
 }
 
 long MotorController::getTargetPosition(uint8_t joint) const {
-    if (!isValidJoint(joint) || !_steppers[joint]) {
+    if (!isValidJoint(joint)) {
         return 0;
     }
     return _steppers[joint]->targetPos();
 }
 
 long MotorController::getDistanceToGo(uint8_t joint) const {
-    if (!isValidJoint(joint) || !_steppers[joint]) {
+    if (!isValidJoint(joint)) {
         return 0;
     }
     return _steppers[joint]->targetPos() - _steppers[joint]->getCurrentPosition();
 }
 
+int32_t MotorController::getSpeedMilliHz(uint8_t joint) const {
+    if (!isValidJoint(joint)) {
+        return 0;
+    }
+    return _steppers[joint]->getCurrentSpeedInMilliHz();
+}
+
 void MotorController::setZero(uint8_t joint) {
-    if (isValidJoint(joint) && _steppers[joint]) {
+    if (isValidJoint(joint)) {
         _steppers[joint]->setCurrentPosition(0);
+        _originCount[joint]++;
         DEBUG_PRINTF("Motors: %s zeroed\n", MOTOR_CONFIGS[joint].name);
     }
 }
 
 void MotorController::setZeroAll() {
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        if (_steppers[i]) {
-            _steppers[i]->setCurrentPosition(0);
-        }
+        _steppers[i]->setCurrentPosition(0);
+        _originCount[i]++;
     }
     DEBUG_PRINTLN("Motors: All joints zeroed");
 }
 
+void MotorController::setPosition(uint8_t joint, long position) {
+    if (isValidJoint(joint)) {
+        _steppers[joint]->setCurrentPosition(position);
+        _originCount[joint]++;
+    }
+}
+
 void MotorController::setMaxSpeed(uint8_t joint, uint32_t speedHz) {
-    if (isValidJoint(joint) && _steppers[joint]) {
+    if (isValidJoint(joint)) {
         // Clamp to safety limit
         if (speedHz > MAX_SPEED_HZ) {
             speedHz = MAX_SPEED_HZ;
         }
+        _maxSpeedHz[joint] = speedHz;
         _steppers[joint]->setSpeedInHz(speedHz);
     }
 }
 
 void MotorController::setAcceleration(uint8_t joint, uint32_t acceleration) {
-    if (isValidJoint(joint) && _steppers[joint]) {
+    if (isValidJoint(joint) && acceleration > 0) {
+        _acceleration[joint] = acceleration;
         _steppers[joint]->setAcceleration(acceleration);
     }
 }
 
+void MotorController::setJerk(uint8_t joint, uint32_t jerk) {
+    if (isValidJoint(joint)) {
+        _jerk[joint] = jerk;
+    }
+}
+
+uint32_t MotorController::getJerk(uint8_t joint) const {
+    return isValidJoint(joint) ? _jerk[joint] : 0;
+}
+
+uint32_t MotorController::jerkRampSteps(uint8_t joint) const {
+    uint32_t distance[MOTOR_COUNT] = {0};
+    uint32_t steps[MOTOR_COUNT];
+    distance[joint] = 1;
+    MotionPlanner::computeJerkRamps(distance, _acceleration, _jerk, false, steps);
+    return steps[joint];
+}
+
+uint32_t MotorController::getMaxSpeed(uint8_t joint) const {
+    return isValidJoint(joint) ? _maxSpeedHz[joint] : 0;
+}
+
+uint32_t MotorController::getAcceleration(uint8_t joint) const {
+    return isValidJoint(joint) ? _acceleration[joint] : 0;
+}
+
+bool MotorController::setLimits(uint8_t joint, int32_t limitMin, int32_t limitMax) {
+    if (!isValidJoint(joint) || limitMin >= limitMax) {
+        return false;
+    }
+    _limitMin[joint] = limitMin;
+    _limitMax[joint] = limitMax;
+    return true;
+}
+
+int32_t MotorController::getLimitMin(uint8_t joint) const {
+    return isValidJoint(joint) ? _limitMin[joint] : 0;
+}
+
+int32_t MotorController::getLimitMax(uint8_t joint) const {
+    return isValidJoint(joint) ? _limitMax[joint] : 0;
+}
+
+JointSettings MotorController::getSettings(uint8_t joint) const {
+    JointSettings settings = {
+        getMaxSpeed(joint), getAcceleration(joint), getJerk(joint),
+        getLimitMin(joint), getLimitMax(joint)
+    };
+    return settings;
+}
+
+bool MotorController::isValidSettings(const JointSettings& settings) {
+    return settings.maxSpeedHz > 0 && settings.maxSpeedHz <= MAX_SPEED_HZ &&
+           settings.acceleration > 0 &&
+           settings.limitMin < settings.limitMax;
+}
+
+bool MotorController::setSettings(uint8_t joint, const JointSettings& settings) {
+    if (!isValidJoint(joint) || !isValidSettings(settings)) {
+        return false;
+    }
+
+    // Before begin() there are no steppers yet; begin() applies the values
+    _maxSpeedHz[joint] = settings.maxSpeedHz;
+    _acceleration[joint] = settings.acceleration;
+    if (_steppers[joint]) {
+        _steppers[joint]->setSpeedInHz(settings.maxSpeedHz);
+        _steppers[joint]->setAcceleration(settings.acceleration);
+    }
+    _jerk[joint] = settings.jerk;
+    _limitMin[joint] = settings.limitMin;
+    _limitMax[joint] = settings.limitMax;
+    return true;
+}
+
+JointSettings MotorController::getDefaultSettings(uint8_t joint) {
+    JointSettings settings = {
+        MOTOR_CONFIGS[joint].maxSpeedHz, MOTOR_CONFIGS[joint].acceleration,
+        MOTOR_CONFIGS[joint].jerk, POSITION_LIMITS_MIN[joint], POSITION_LIMITS_MAX[joint]
+    };
+    return settings;
+}
+
+void MotorController::resetSettings() {
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        JointSettings defaults = getDefaultSettings(i);
+        _maxSpeedHz[i] = defaults.maxSpeedHz;
+        _acceleration[i] = defaults.acceleration;
+        _jerk[i] = defaults.jerk;
+        _limitMin[i] = defaults.limitMin;
+        _limitMax[i] = defaults.limitMax;
+        if (_steppers[i]) {  // Also called by the constructor, before begin()
+            _steppers[i]->setSpeedInHz(_maxSpeedHz[i]);
+            _steppers[i]->setAcceleration(_acceleration[i]);
+        }
+    }
+}
+
 const MotorConfig& MotorController::getConfig(uint8_t joint) const {
     // Return first config if invalid (shouldn't happen)
     if (!isValidJoint(joint)) {
@@ -237,6 +978,6 @@ bool MotorController::isWithinLimits(uint8_t joint, long position) const {
     if (!isValidJoint(joint)) {
         return false;
     }
-    return position >= POSITION_LIMITS_MIN[joint] &&
-           position <= POSITION_LIMITS_MAX[joint];
+    return position >= _limitMin[joint] &&
+           position <= _limitMax[joint];
 }
@@ -2,8 +2,46 @@
 #define MOTOR_CONTROLLER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include <FastAccelStepper.h>
 #include "config.h"
+#include "motion_planner.h"
+
+/**
+ * One move, as submitted directly (without G-code) by the web API
+ */
+struct MoveRequest {
+    long positions[MOTOR_COUNT];  // Only joints in jointMask are read
+    uint8_t jointMask;            // Bit n set = joint n+1 moves
+    bool relative;                // Positions are offsets from the planned end
+    bool coordinated;             // All joints arrive together
+    uint32_t speedHz;             // Per-joint speed cap (0 = joint limits)
+    uint32_t accel;               // Per-joint acceleration cap (0 = joint limits)
+};
+
+/**
+ * A joint's tunable motion parameters (M201/M203/M205/M208, saved by M500)
+ * Defaults come from MOTOR_CONFIGS and POSITION_LIMITS_MIN/MAX.
+ */
+struct JointSettings {
+    uint32_t maxSpeedHz;     // steps/s
+    uint32_t acceleration;   // steps/s^2
+    uint32_t jerk;           // steps/s^3 (0 = trapezoidal ramps)
+    int32_t limitMin;        // Soft position limits, steps
+    int32_t limitMax;
+};
+
+/**
+ * Per-joint homing progress (see startHoming)
+ */
+enum class HomingPhase : uint8_t {
+    IDLE,      // Not homing (check isHomed)
+    SEEK,      // Fast move towards the switch
+    BACKOFF,   // Moving off the switch again
+    CREEP,     // Slow approach; the switch edge latches the position
+    DONE,      // Homed
+    FAILED     // Switch not found or stuck (see getHomingError)
+};
 
 /**
  * Motor Controller for 6-axis robotic arm
@@ -11,6 +49,21 @@
  * Uses FastAccelStepper library for hardware-accelerated pulse generation.
  * FastAccelStepper uses ESP32's MCPWM/RMT peripherals for up to 200k steps/sec.
  * All movements are non-blocking - the hardware handles pulse timing.
+ *
+ * Queued moves (queueMove) are stored in a fixed-size ring buffer and
+ * dispatched by update(). The look-ahead planner (motion_planner.h) gives
+ * each junction an exit speed; joints that can keep moving are retargeted
+ * exit^2 / (2 a) before the junction, plus PLANNER_HANDOFF_MARGIN_US at the
+ * current speed, while still at least at the exit speed, so they pass
+ * through the junction instead of stopping.
+ *
+ * Homing (startHoming) runs a non-blocking seek/back-off/creep state machine
+ * for every selected joint at once; the final position is latched from the
+ * endstop interrupt's timestamp.
+ *
+ * Jog mode (jog) runs joints continuously at commanded signed speeds for
+ * teleoperation; each new command only changes the speed, without
+ * restarting a ramp. Queued moves are refused while jogging.
  */
 class MotorController {
 public:
@@ -18,9 +71,15 @@ public:
 
     /**
      * Initialize all motors with their configurations
-     * Must be called in setup()
+     * Settings saved with M500 (settings_store.h) replace the config.h
+     * defaults. Must be called in setup()
+     * @return false if a joint's stepper could not be connected (see
+     *         getError); nothing else may be called then, since every
+     *         other method relies on all MOTOR_COUNT steppers existing
      */
-    void begin();
+    bool begin();
+
+    const char* getError() const { return _error; }
 
     /**
      * Enable/disable all stepper drivers
@@ -51,10 +110,127 @@ public:
 
     /**
      * Move multiple joints simultaneously
-     * @param positions Array of 6 target positions (LONG_MIN to skip)
+     * @param positions Target positions, one per joint
+     * @param jointMask Joints to move (bit n = joint n+1); the others are not read
+     * @param coordinated Rescale speed/accel so all joints finish together
      * @return true if command accepted
      */
-    bool moveToMultiple(const long positions[MOTOR_COUNT]);
+    bool moveToMultiple(const long positions[MOTOR_COUNT], uint8_t jointMask,
+                        bool coordinated = false);
+
+    /**
+     * Append a multi-joint move to the motion queue
+     * Uses the current coordinated-move mode (see setCoordinated)
+     * @param positions Absolute target positions, one per joint
+     * @param jointMask Joints to move (bit n = joint n+1)
+     * @return true if queued, false if disabled, out of limits or queue full
+     */
+    bool queueMove(const long positions[MOTOR_COUNT], uint8_t jointMask);
+
+    /**
+     * Append a move with its own speed/acceleration caps
+     * @param positions Absolute target positions, one per joint
+     * @param jointMask Joints to move (bit n = joint n+1)
+     * @param speedHz Cap on every joint's speed for this move (0 = joint limits)
+     * @param accel Cap on every joint's acceleration (0 = joint limits)
+     * @param coordinated All joints arrive together
+     * @return true if queued, false if disabled, out of limits or queue full
+     */
+    bool queueMove(const long positions[MOTOR_COUNT], uint8_t jointMask,
+                   uint32_t speedHz, uint32_t accel, bool coordinated);
+
+    /**
+     * Append a move described by a MoveRequest
+     * Relative positions are resolved against the end of the queue.
+     * @return true if queued, false if disabled, out of limits or queue full
+     */
+    bool queueMove(const MoveRequest& move);
+
+    /**
+     * Dispatch the next queued segment once the current one reaches its
+     * junction hand-off point. Must be called frequently from loop()
+     */
+    void update();
+
+    /**
+     * Discard all queued segments (does not stop the current move)
+     */
+    void clearQueue();
+
+    /**
+     * Run joints continuously at signed speeds (velocity/jog mode)
+     * Each call replaces the whole velocity vector (0 = ramp down to a stop)
+     * and re-arms the watchdog: without a new call within JOG_WATCHDOG_MS,
+     * every joint ramps down. Speeds are capped at the joint limits, and
+     * joints brake so they stop at their soft position limits.
+     * @param speedsHz Signed speeds in steps/s
+     * @return false if disabled or queued/direct moves are running
+     */
+    bool jog(const long speedsHz[MOTOR_COUNT]);
+
+    /**
+     * Ramp all jogging joints down (jog mode ends once they stop)
+     */
+    void stopJog();
+
+    bool isJogging() const { return _jogging; }
+
+    /**
+     * Home joints against their endstops, all in parallel
+     * Joints without an endstop are just zeroed. Progresses in update();
+     * moves and jogging are refused until every selected joint is done.
+     * @param mask Bit n set = home joint n+1
+     * @return false if disabled or moves are in progress
+     */
+    bool startHoming(uint8_t mask);
+
+    bool isHoming() const { return _homing; }
+    HomingPhase getHomingPhase(uint8_t joint) const;
+    bool isHomed(uint8_t joint) const { return (_homedMask >> joint) & 1; }
+    uint8_t getHomedMask() const { return _homedMask; }
+    const char* getHomingError() const { return _homingError; }
+    static const char* homingPhaseName(HomingPhase phase);
+
+    /**
+     * Current (debounce-free) endstop input state
+     */
+    bool isEndstopActive(uint8_t joint) const;
+
+    /**
+     * Group queued moves into an all-or-nothing batch
+     * Between beginBatch() and commitBatch()/abortBatch() queued segments
+     * are held back from the steppers; abortBatch() removes them again.
+     */
+    void beginBatch();
+    void commitBatch();
+    void abortBatch();
+    bool isBatchOpen() const { return _batchOpen; }
+
+    /**
+     * Hold queued segments back until a synchronized start (arm_sync.h)
+     * releases them; stopAll() clears the hold
+     */
+    void setStartHold(bool held) { _startHeld = held; }
+    bool isStartHeld() const { return _startHeld; }
+
+    /**
+     * Motion queue state
+     */
+    bool isQueueFull() const { return _queue.full(); }
+    size_t getQueueDepth() const { return _queue.size(); }
+    size_t getQueueFree() const { return _queue.available(); }
+
+    /**
+     * Enable/disable coordinated moves for subsequently queued segments
+     */
+    void setCoordinated(bool coordinated) { _coordinated = coordinated; }
+    bool isCoordinated() const { return _coordinated; }
+
+    /**
+     * Get the position a joint will be at once all queued moves complete
+     * (used as the base for relative moves)
+     */
+    long getPlannedPosition(uint8_t joint) const;
 
     /**
      * Stop a single joint immediately
@@ -62,10 +238,16 @@ public:
     void stop(uint8_t joint);
 
     /**
-     * Stop all joints immediately (emergency stop)
+     * Stop all joints immediately and clear the motion queue (emergency stop)
      */
     void stopAll();
 
+    /**
+     * Number of stopAll() calls so far - lets planners that feed the queue
+     * notice that it was flushed under them
+     */
+    uint32_t getStopCount() const { return _stopCount; }
+
     /**
      * Check if a specific joint is moving
      */
@@ -91,6 +273,11 @@ public:
      */
     long getDistanceToGo(uint8_t joint) const;
 
+    /**
+     * Get current signed speed of a joint in steps/s x 1000
+     */
+    int32_t getSpeedMilliHz(uint8_t joint) const;
+
     /**
      * Set current position as zero for a joint (does not move)
      */
@@ -101,6 +288,20 @@ public:
      */
     void setZeroAll();
 
+    /**
+     * Redefine the current position of a stopped joint (does not move),
+     * e.g. to the position an encoder measured
+     */
+    void setPosition(uint8_t joint, long position);
+
+    /**
+     * Number of times the joint's position was redefined (zeroing, homing,
+     * setPosition) - lets position observers re-reference
+     */
+    uint32_t getOriginCount(uint8_t joint) const {
+        return isValidJoint(joint) ? _originCount[joint] : 0;
+    }
+
     /**
      * Set maximum speed for a joint
      * @param joint Joint index
@@ -115,6 +316,47 @@ public:
      */
     void setAcceleration(uint8_t joint, uint32_t acceleration);
 
+    /**
+     * Set the jerk limit for a joint (applies to moves queued afterwards)
+     * @param joint Joint index
+     * @param jerk Jerk in steps/second^3, 0 for trapezoidal ramps
+     */
+    void setJerk(uint8_t joint, uint32_t jerk);
+
+    /**
+     * Get the configured (unscaled) speed/acceleration/jerk limits for a joint
+     */
+    uint32_t getMaxSpeed(uint8_t joint) const;
+    uint32_t getAcceleration(uint8_t joint) const;
+    uint32_t getJerk(uint8_t joint) const;
+
+    /**
+     * Set the soft position limits of a joint (steps)
+     * @return false if min is not below max
+     */
+    bool setLimits(uint8_t joint, int32_t limitMin, int32_t limitMax);
+    int32_t getLimitMin(uint8_t joint) const;
+    int32_t getLimitMax(uint8_t joint) const;
+
+    /**
+     * All tunable parameters of a joint at once (for saving and loading)
+     * Moves already queued keep the limits they were planned with.
+     * @return false (nothing changed) if a value is out of range
+     */
+    JointSettings getSettings(uint8_t joint) const;
+    bool setSettings(uint8_t joint, const JointSettings& settings);
+
+    // Speed 1..MAX_SPEED_HZ, acceleration > 0, limitMin < limitMax
+    static bool isValidSettings(const JointSettings& settings);
+
+    /**
+     * Back to the config.h defaults (M502)
+     */
+    void resetSettings();
+
+    // The config.h defaults resetSettings() restores
+    static JointSettings getDefaultSettings(uint8_t joint);
+
     /**
      * Get motor configuration for a joint
      */
@@ -129,9 +371,55 @@ private:
     FastAccelStepperEngine _engine;
     FastAccelStepper* _steppers[MOTOR_COUNT];
     bool _enabled;
+    bool _coordinated;
+    MotionQueue _queue;
+    MotionSegment _active;   // Segment currently executing
+    bool _activeValid;
+    uint32_t _stopCount;
+    uint32_t _originCount[MOTOR_COUNT];
+    bool _batchOpen;          // Hold queued segments back (see beginBatch)
+    size_t _batchStartDepth;  // Queue depth when the batch began
+    bool _startHeld;          // Waiting for a synchronized start
+
+    // Jog mode
+    bool _jogging;
+    long _jogSpeedHz[MOTOR_COUNT];   // Commanded signed speeds (0 = stopping)
+    unsigned long _lastJogMs;        // Watchdog: time of the last jog()
+
+    // Per-joint limits used for every move (coordinated moves scale these)
+    uint32_t _maxSpeedHz[MOTOR_COUNT];
+    uint32_t _acceleration[MOTOR_COUNT];
+    uint32_t _jerk[MOTOR_COUNT];
+    int32_t _limitMin[MOTOR_COUNT];
+    int32_t _limitMax[MOTOR_COUNT];
+
+    // S-curve ramp length of a joint at its own limits (direct moves, jog)
+    uint32_t jerkRampSteps(uint8_t joint) const;
 
     bool isValidJoint(uint8_t joint) const { return joint < MOTOR_COUNT; }
     bool isWithinLimits(uint8_t joint, long position) const;
+
+    // Homing
+    bool _homing;
+    HomingPhase _homingPhase[MOTOR_COUNT];
+    bool _homingMoveStarted[MOTOR_COUNT];   // Phase move issued (steppers settle first)
+    uint8_t _homedMask;
+    char _homingError[48];
+    const char* _error;       // Why begin() failed
+
+    void enterHomingPhase(uint8_t joint, HomingPhase phase);
+    void failHoming(uint8_t joint, const char* reason);
+    void updateHoming();
+    void abortHoming();
+
+    // Jog helpers
+    void applyJogSpeed(uint8_t joint, long speedHz);
+    bool nearJogLimit(uint8_t joint) const;
+    void updateJog();
+
+    // Look-ahead execution helpers
+    bool readyForNextSegment() const;
+    void dispatchSegment(const MotionSegment& segment);
 };
 
 // Global motor controller instance
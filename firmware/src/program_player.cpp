@@ -0,0 +1,274 @@
+#include "program_player.h"
+#include "command_parser.h"
+#include "motor_controller.h"
+
+// Global instance
+ProgramPlayer programPlayer;
+
+ProgramPlayer::ProgramPlayer()
+    : _state(PlaybackState::IDLE), _fileSize(0), _bytesExecuted(0),
+      _lineNumber(0), _current(0), _blockPos(0), _eof(false),
+      _carryLength(0), _line(nullptr), _lineLength(0), _lineBytes(0),
+      _linePending(false) {
+    _name[0] = '\0';
+    _error[0] = '\0';
+    _blockLength[0] = 0;
+    _blockLength[1] = 0;
+}
+
+bool ProgramPlayer::select(const char* name) {
+    if (isActive() || !programStore.exists(name)) {
+        return false;
+    }
+
+    File file = programStore.open(name);
+    if (!file) {
+        return false;
+    }
+    _fileSize = file.size();
+    file.close();
+
+    strncpy(_name, name, PROGRAM_NAME_MAX_LENGTH);
+    _name[PROGRAM_NAME_MAX_LENGTH] = '\0';
+    _bytesExecuted = 0;
+    _lineNumber = 0;
+    _error[0] = '\0';
+    _state = PlaybackState::READY;
+    return true;
+}
+
+bool ProgramPlayer::start() {
+    switch (_state) {
+        case PlaybackState::IDLE:
+            return false;
+
+        case PlaybackState::PLAYING:
+            return true;
+
+        case PlaybackState::PAUSED:
+            _state = PlaybackState::PLAYING;
+            DEBUG_PRINTF("Program: %s resumed\n", _name);
+            return true;
+
+        default:
+            // READY, FINISHED or FAILED - run from the top
+            if (!rewind()) {
+                return false;
+            }
+            _state = PlaybackState::PLAYING;
+            DEBUG_PRINTF("Program: %s started\n", _name);
+            return true;
+    }
+}
+
+void ProgramPlayer::pause() {
+    if (_state == PlaybackState::PLAYING) {
+        _state = PlaybackState::PAUSED;
+    }
+}
+
+void ProgramPlayer::abort() {
+    if (!isActive()) {
+        return;
+    }
+    motors.stopAll();
+    finish(PlaybackState::READY);
+    DEBUG_PRINTF("Program: %s aborted\n", _name);
+}
+
+void ProgramPlayer::update() {
+    if (_state != PlaybackState::PLAYING) {
+        return;
+    }
+
+    for (int n = 0; n < PROGRAM_LINES_PER_UPDATE; n++) {
+        if (!_linePending) {
+            if (!nextLine()) {
+                // nextLine() sets FAILED itself on a bad line
+                if (_state == PlaybackState::PLAYING) {
+                    finish(PlaybackState::FINISHED);
+                    DEBUG_PRINTF("Program: %s finished\n", _name);
+                }
+                return;
+            }
+            _linePending = true;
+            _lineNumber++;
+
+            // Strip ';' comment
+            const char* comment = (const char*)memchr(_line, ';', _lineLength);
+            if (comment) {
+                _lineLength = comment - _line;
+            }
+        }
+
+        // Wait for a free slot rather than bouncing off "Queue full"
+        if (CommandParser::isQueuedMove(_line, _lineLength) && motors.isQueueFull()) {
+            break;
+        }
+
+        CommandResult result = commandParser.execute(_line, _lineLength);
+        if (!result.success) {
+            if (result.busy) {
+                break;  // Retry this line on the next update
+            }
+            snprintf(_error, sizeof(_error), "Line %lu: %.128s",
+                     (unsigned long)_lineNumber, result.message);
+            finish(PlaybackState::FAILED);
+            DEBUG_PRINTF("Program: %s\n", _error);
+            return;
+        }
+
+        _linePending = false;
+        _bytesExecuted += _lineBytes;
+
+        // The line itself may have paused or stopped playback (M25, M112)
+        if (_state != PlaybackState::PLAYING) {
+            return;
+        }
+    }
+
+    // Read ahead while the queue drains
+    prefetch();
+}
+
+const char* ProgramPlayer::stateName(PlaybackState state) {
+    switch (state) {
+        case PlaybackState::IDLE:     return "idle";
+        case PlaybackState::READY:    return "ready";
+        case PlaybackState::PLAYING:  return "playing";
+        case PlaybackState::PAUSED:   return "paused";
+        case PlaybackState::FINISHED: return "finished";
+        case PlaybackState::FAILED:   return "failed";
+    }
+    return "unknown";
+}
+
+bool ProgramPlayer::rewind() {
+    if (_file) {
+        _file.close();
+    }
+
+    _file = programStore.open(_name);
+    if (!_file) {
+        return false;
+    }
+
+    _fileSize = _file.size();
+    _bytesExecuted = 0;
+    _lineNumber = 0;
+    _error[0] = '\0';
+    _blockLength[0] = 0;
+    _blockLength[1] = 0;
+    _current = 0;
+    _blockPos = 0;
+    _eof = false;
+    _carryLength = 0;
+    _linePending = false;
+
+    // First block synchronously, second on the first update()
+    loadBlock(0);
+    return true;
+}
+
+bool ProgramPlayer::loadBlock(uint8_t index) {
+    size_t n = _file.read((uint8_t*)_blocks[index], PROGRAM_BLOCK_SIZE);
+    _blockLength[index] = n;
+    if (n < PROGRAM_BLOCK_SIZE) {
+        _eof = true;
+    }
+    return n > 0;
+}
+
+void ProgramPlayer::prefetch() {
+    uint8_t next = _current ^ 1;
+    if (!_eof && _blockLength[next] == 0) {
+        loadBlock(next);
+    }
+}
+
+bool ProgramPlayer::nextLine() {
+    _carryLength = 0;
+
+    while (true) {
+        size_t length = _blockLength[_current];
+
+        if (_blockPos < length) {
+            const char* start = _blocks[_current] + _blockPos;
+            const char* newline = (const char*)memchr(start, '\n', length - _blockPos);
+
+            if (newline) {
+                size_t n = newline - start;
+                _blockPos += n + 1;
+
+                if (_carryLength == 0) {
+                    // Whole line inside this block - use it in place
+                    if (n > COMMAND_MAX_LENGTH) {
+                        return appendCarry(start, n);  // Reports the error
+                    }
+                    _line = start;
+                    _lineLength = n;
+                    _lineBytes = n + 1;
+                    return true;
+                }
+
+                if (!appendCarry(start, n)) {
+                    return false;
+                }
+                _line = _carry;
+                _lineLength = _carryLength;
+                _lineBytes = _carryLength + 1;
+                return true;
+            }
+
+            // Line continues in the next block
+            if (!appendCarry(start, length - _blockPos)) {
+                return false;
+            }
+        }
+
+        // Current block used up - move to the other one, reading it now
+        // only if the read-ahead has not caught up
+        _blockLength[_current] = 0;
+        _blockPos = 0;
+        uint8_t next = _current ^ 1;
+        if (_blockLength[next] == 0 && !_eof) {
+            loadBlock(next);
+        }
+
+        if (_blockLength[next] == 0) {
+            // End of file; the last line may lack a newline
+            if (_carryLength > 0) {
+                _line = _carry;
+                _lineLength = _carryLength;
+                _lineBytes = _carryLength;
+                return true;
+            }
+            return false;
+        }
+
+        _current = next;
+    }
+}
+
+bool ProgramPlayer::appendCarry(const char* data, size_t length) {
+    if (_carryLength + length > sizeof(_carry)) {
+        snprintf(_error, sizeof(_error), "Line %lu: error: Line too long",
+                 (unsigned long)_lineNumber + 1);
+        finish(PlaybackState::FAILED);
+        return false;
+    }
+
+    memcpy(_carry + _carryLength, data, length);
+    _carryLength += length;
+    return true;
+}
+
+void ProgramPlayer::finish(PlaybackState state) {
+    if (_file) {
+        _file.close();
+    }
+    _linePending = false;
+    _blockLength[0] = 0;
+    _blockLength[1] = 0;
+    _state = state;
+}
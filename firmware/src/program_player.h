@@ -0,0 +1,115 @@
+#ifndef PROGRAM_PLAYER_H
+#define PROGRAM_PLAYER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "program_store.h"
+
+/**
+ * Plays a stored G-code program from flash into the motion queue
+ *
+ * update() is called from loop(). It executes lines while the motion queue
+ * has room, then reads ahead: the file is read in PROGRAM_BLOCK_SIZE blocks
+ * into two buffers, and while lines are taken from one the other is filled,
+ * so the queue is topped up from RAM and a flash read only happens while
+ * segments are still buffered ahead of the steppers.
+ *
+ * Lines are passed to the command parser unchanged except that ';'
+ * comments are stripped. The first failing line stops playback and is
+ * reported by M27.
+ */
+
+enum class PlaybackState : uint8_t {
+    IDLE,       // No program selected
+    READY,      // Selected, not started
+    PLAYING,
+    PAUSED,     // Not feeding the queue; queued moves still run
+    FINISHED,
+    FAILED      // Stopped by an error
+};
+
+class ProgramPlayer {
+public:
+    ProgramPlayer();
+
+    /**
+     * Select a stored program (M23)
+     * @return false if it does not exist or a program is running
+     */
+    bool select(const char* name);
+
+    /**
+     * Start the selected program, or resume it when paused (M24)
+     * @return false if nothing is selected or the file cannot be opened
+     */
+    bool start();
+
+    /**
+     * Stop feeding the queue; moves already queued still run (M25)
+     */
+    void pause();
+
+    /**
+     * Stop playback, motion and clear the queue (M524 / M112)
+     */
+    void abort();
+
+    /**
+     * Feed the motion queue (call from loop)
+     */
+    void update();
+
+    PlaybackState getState() const { return _state; }
+    static const char* stateName(PlaybackState state);
+
+    // Playing or paused - the program file is open
+    bool isActive() const {
+        return _state == PlaybackState::PLAYING || _state == PlaybackState::PAUSED;
+    }
+
+    const char* getName() const { return _name; }
+    size_t getFileSize() const { return _fileSize; }
+    size_t getBytesExecuted() const { return _bytesExecuted; }
+    uint32_t getLineNumber() const { return _lineNumber; }
+
+    // Failing line and its error message (FAILED state)
+    const char* getError() const { return _error; }
+
+private:
+    PlaybackState _state;
+    char _name[PROGRAM_NAME_MAX_LENGTH + 1];
+    File _file;
+    size_t _fileSize;
+    size_t _bytesExecuted;
+    uint32_t _lineNumber;
+    char _error[160];
+
+    // Double-buffered file blocks; length 0 = empty
+    char _blocks[2][PROGRAM_BLOCK_SIZE];
+    size_t _blockLength[2];
+    uint8_t _current;       // Block lines are taken from
+    size_t _blockPos;       // Read position within the current block
+    bool _eof;              // All of the file has been read into blocks
+
+    // A line split across two blocks is joined here
+    char _carry[COMMAND_MAX_LENGTH];
+    size_t _carryLength;
+
+    // Line waiting to be executed (points into a block or _carry)
+    const char* _line;
+    size_t _lineLength;
+    size_t _lineBytes;      // Bytes of file the line used (incl. comment, newline)
+    bool _linePending;
+
+    bool rewind();
+    bool loadBlock(uint8_t index);
+    void prefetch();
+    bool nextLine();
+    bool appendCarry(const char* data, size_t length);
+    void finish(PlaybackState state);
+};
+
+// Global program player instance
+extern ProgramPlayer programPlayer;
+
+#endif // PROGRAM_PLAYER_H
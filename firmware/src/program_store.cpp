@@ -0,0 +1,229 @@
+#include "program_store.h"
+
+// Global instance
+ProgramStore programStore;
+
+// Upload is written here and renamed into place when complete
+static const char* UPLOAD_TEMP_PATH = PROGRAM_DIR "/.upload";
+
+// PROGRAM_DIR + '/' + name + NUL
+static const size_t PATH_SIZE = sizeof(PROGRAM_DIR) + PROGRAM_NAME_MAX_LENGTH + 1;
+
+ProgramStore::ProgramStore()
+    : _mounted(false), _uploadOwner(nullptr), _uploadTotal(0),
+      _uploadWritten(0), _uploadLastWrite(0), _uploadError("") {
+    _uploadName[0] = '\0';
+}
+
+bool ProgramStore::begin() {
+    // Format on first boot (or after a partition table change)
+    if (!LittleFS.begin(true)) {
+        DEBUG_PRINTLN("ProgramStore: LittleFS mount FAILED");
+        _mounted = false;
+        return false;
+    }
+
+    if (!LittleFS.exists(PROGRAM_DIR)) {
+        LittleFS.mkdir(PROGRAM_DIR);
+    }
+
+    // Left over from an interrupted upload
+    if (LittleFS.exists(UPLOAD_TEMP_PATH)) {
+        LittleFS.remove(UPLOAD_TEMP_PATH);
+    }
+
+    _mounted = true;
+    DEBUG_PRINTF("ProgramStore: %u/%u bytes used\n",
+                 (unsigned)usedBytes(), (unsigned)totalBytes());
+    return true;
+}
+
+bool ProgramStore::isValidName(const char* name, size_t length) {
+    if (length == 0 || length > PROGRAM_NAME_MAX_LENGTH || name[0] == '.') {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        char c = name[i];
+        if (!isAlphaNumeric(c) && c != '_' && c != '-' && c != '.') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ProgramStore::makePath(char* path, size_t size, const char* name) {
+    snprintf(path, size, "%s/%s", PROGRAM_DIR, name);
+}
+
+size_t ProgramStore::list(ProgramInfo* out, size_t max) {
+    if (!_mounted) {
+        return 0;
+    }
+
+    File dir = LittleFS.open(PROGRAM_DIR);
+    if (!dir || !dir.isDirectory()) {
+        return 0;
+    }
+
+    size_t count = 0;
+    File file = dir.openNextFile();
+    while (file && count < max) {
+        // name() may or may not include the directory depending on core version
+        const char* name = file.name();
+        const char* slash = strrchr(name, '/');
+        if (slash) {
+            name = slash + 1;
+        }
+
+        if (!file.isDirectory() && isValidName(name, strlen(name))) {
+            strncpy(out[count].name, name, PROGRAM_NAME_MAX_LENGTH);
+            out[count].name[PROGRAM_NAME_MAX_LENGTH] = '\0';
+            out[count].size = file.size();
+            count++;
+        }
+
+        file.close();
+        file = dir.openNextFile();
+    }
+
+    dir.close();
+    return count;
+}
+
+bool ProgramStore::exists(const char* name) {
+    if (!_mounted) {
+        return false;
+    }
+    char path[PATH_SIZE];
+    makePath(path, sizeof(path), name);
+    return LittleFS.exists(path);
+}
+
+bool ProgramStore::remove(const char* name) {
+    if (!exists(name)) {
+        return false;
+    }
+    char path[PATH_SIZE];
+    makePath(path, sizeof(path), name);
+    return LittleFS.remove(path);
+}
+
+File ProgramStore::open(const char* name) {
+    if (!_mounted) {
+        return File();
+    }
+    char path[PATH_SIZE];
+    makePath(path, sizeof(path), name);
+    return LittleFS.open(path, FILE_READ);
+}
+
+size_t ProgramStore::totalBytes() {
+    return _mounted ? LittleFS.totalBytes() : 0;
+}
+
+size_t ProgramStore::usedBytes() {
+    return _mounted ? LittleFS.usedBytes() : 0;
+}
+
+bool ProgramStore::beginUpload(const void* owner, const char* name, size_t total) {
+    if (!_mounted) {
+        _uploadError = "Filesystem not mounted";
+        return false;
+    }
+
+    if (!isValidName(name, strlen(name))) {
+        _uploadError = "Invalid program name";
+        return false;
+    }
+
+    // A client that disconnected mid-upload never sends its last chunk
+    if (_uploadOwner) {
+        if (millis() - _uploadLastWrite < PROGRAM_UPLOAD_TIMEOUT_MS) {
+            _uploadError = "Another upload is in progress";
+            return false;
+        }
+        abortUpload();
+    }
+
+    // Replacing a program frees its space once the rename happens, but the
+    // new copy has to fit alongside it until then
+    if (usedBytes() + total > totalBytes()) {
+        _uploadError = "Not enough space";
+        return false;
+    }
+
+    _uploadFile = LittleFS.open(UPLOAD_TEMP_PATH, FILE_WRITE);
+    if (!_uploadFile) {
+        _uploadError = "Cannot create file";
+        return false;
+    }
+
+    strncpy(_uploadName, name, PROGRAM_NAME_MAX_LENGTH);
+    _uploadName[PROGRAM_NAME_MAX_LENGTH] = '\0';
+    _uploadOwner = owner;
+    _uploadTotal = total;
+    _uploadWritten = 0;
+    _uploadLastWrite = millis();
+
+    DEBUG_PRINTF("ProgramStore: receiving %s (%u bytes)\n", _uploadName, (unsigned)total);
+
+    // Empty program - nothing more will arrive
+    if (total == 0) {
+        return commitUpload();
+    }
+    return true;
+}
+
+bool ProgramStore::writeUpload(const void* owner, const uint8_t* data, size_t len) {
+    if (!owner || owner != _uploadOwner) {
+        _uploadError = "No upload in progress";
+        return false;
+    }
+
+    if (_uploadWritten + len > _uploadTotal ||
+        _uploadFile.write(data, len) != len) {
+        abortUpload();
+        _uploadError = "Write failed";
+        return false;
+    }
+
+    _uploadWritten += len;
+    _uploadLastWrite = millis();
+
+    if (_uploadWritten == _uploadTotal) {
+        return commitUpload();
+    }
+    return true;
+}
+
+void ProgramStore::abortUpload() {
+    if (!_uploadOwner) {
+        return;
+    }
+
+    _uploadFile.close();
+    LittleFS.remove(UPLOAD_TEMP_PATH);
+    _uploadOwner = nullptr;
+    DEBUG_PRINTF("ProgramStore: upload of %s discarded\n", _uploadName);
+}
+
+bool ProgramStore::commitUpload() {
+    _uploadFile.close();
+    _uploadOwner = nullptr;
+
+    char path[PATH_SIZE];
+    makePath(path, sizeof(path), _uploadName);
+
+    if (LittleFS.exists(path)) {
+        LittleFS.remove(path);
+    }
+    if (!LittleFS.rename(UPLOAD_TEMP_PATH, path)) {
+        LittleFS.remove(UPLOAD_TEMP_PATH);
+        _uploadError = "Rename failed";
+        return false;
+    }
+
+    DEBUG_PRINTF("ProgramStore: stored %s\n", _uploadName);
+    return true;
+}
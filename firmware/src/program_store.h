@@ -0,0 +1,111 @@
+#ifndef PROGRAM_STORE_H
+#define PROGRAM_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "config.h"
+
+/**
+ * On-flash storage for G-code programs
+ *
+ * Programs live as plain text files in PROGRAM_DIR on LittleFS. Uploads
+ * are streamed chunk by chunk into a temporary file and renamed into
+ * place only once the last byte has been written, so a dropped
+ * connection never leaves a truncated program behind.
+ *
+ * Names are 1-PROGRAM_NAME_MAX_LENGTH characters of [A-Za-z0-9_.-] and
+ * may not start with '.'.
+ */
+
+struct ProgramInfo {
+    char name[PROGRAM_NAME_MAX_LENGTH + 1];
+    size_t size;
+};
+
+class ProgramStore {
+public:
+    static const size_t MAX_PROGRAMS = 32;
+
+    ProgramStore();
+
+    /**
+     * Mount the filesystem (formats it on first use)
+     * @return true if mounted
+     */
+    bool begin();
+
+    bool isMounted() const { return _mounted; }
+
+    /**
+     * Check a program name (not NUL-terminated)
+     */
+    static bool isValidName(const char* name, size_t length);
+
+    /**
+     * Build the file path for a program name
+     */
+    static void makePath(char* path, size_t size, const char* name);
+
+    /**
+     * List stored programs
+     * @return Number of entries written to out
+     */
+    size_t list(ProgramInfo* out, size_t max);
+
+    bool exists(const char* name);
+    bool remove(const char* name);
+
+    /**
+     * Open a stored program for reading
+     */
+    File open(const char* name);
+
+    size_t totalBytes();
+    size_t usedBytes();
+
+    /**
+     * Start a streamed upload
+     * @param owner Opaque upload owner (the HTTP request); later chunks
+     *              from any other owner are ignored
+     * @param total Final size in bytes
+     * @return false if the name is invalid, space is short or another
+     *         upload is in progress
+     */
+    bool beginUpload(const void* owner, const char* name, size_t total);
+
+    /**
+     * Append a chunk to the upload owned by owner
+     * The program is committed when the last byte has been written.
+     * @return false on write failure (the upload is discarded)
+     */
+    bool writeUpload(const void* owner, const uint8_t* data, size_t len);
+
+    /**
+     * Discard an unfinished upload
+     */
+    void abortUpload();
+
+    bool isUploading() const { return _uploadOwner != nullptr; }
+    bool isUploadOwner(const void* owner) const { return owner && owner == _uploadOwner; }
+
+    // Reason the last upload call failed
+    const char* getUploadError() const { return _uploadError; }
+
+private:
+    bool _mounted;
+
+    File _uploadFile;
+    const void* _uploadOwner;
+    char _uploadName[PROGRAM_NAME_MAX_LENGTH + 1];
+    size_t _uploadTotal;
+    size_t _uploadWritten;
+    unsigned long _uploadLastWrite;
+    const char* _uploadError;
+
+    bool commitUpload();
+};
+
+// Global program store instance
+extern ProgramStore programStore;
+
+#endif // PROGRAM_STORE_H
@@ -0,0 +1,76 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+
+/**
+ * Fixed-capacity FIFO ring buffer
+ *
+ * Storage is allocated inline (no heap), so instances can live in globals
+ * or inside other objects. Not thread-safe - callers must serialize access.
+ */
+template <typename T, size_t N>
+class RingBuffer {
+public:
+    RingBuffer() : _head(0), _tail(0), _count(0) {}
+
+    /**
+     * Append an item at the back
+     * @return false if the buffer is full
+     */
+    bool push(const T& item) {
+        if (full()) {
+            return false;
+        }
+        _items[_head] = item;
+        _head = (_head + 1) % N;
+        _count++;
+        return true;
+    }
+
+    /**
+     * Remove the item at the front
+     * @return false if the buffer is empty
+     */
+    bool pop(T& item) {
+        if (empty()) {
+            return false;
+        }
+        item = _items[_tail];
+        _tail = (_tail + 1) % N;
+        _count--;
+        return true;
+    }
+
+    /**
+     * Drop newest items until only count remain
+     */
+    void truncate(size_t count) {
+        while (_count > count) {
+            _head = (_head + N - 1) % N;
+            _count--;
+        }
+    }
+
+    /**
+     * Access an item by age (0 = oldest, size()-1 = newest)
+     */
+    T& at(size_t index) { return _items[(_tail + index) % N]; }
+    const T& at(size_t index) const { return _items[(_tail + index) % N]; }
+
+    void clear() { _head = _tail = _count = 0; }
+
+    size_t size() const { return _count; }
+    size_t available() const { return N - _count; }
+    static constexpr size_t capacity() { return N; }
+    bool empty() const { return _count == 0; }
+    bool full() const { return _count == N; }
+
+private:
+    T _items[N];
+    size_t _head;   // Next slot to write
+    size_t _tail;   // Oldest item
+    size_t _count;
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,166 @@
+#include "serial_reader.h"
+#include "metrics.h"
+
+// Global instance
+SerialLineReader serialReader(Serial, SERIAL_BAUD_RATE);
+
+SerialLineReader::SerialLineReader(HardwareSerial& serial, uint32_t baudRate)
+    : _serial(serial), _handler(nullptr), _frameHandler(nullptr), _idleHandler(nullptr),
+      _baudRate(baudRate), _pendingBaud(0),
+      _head(0), _lineStart(0), _scan(0), _discarding(false),
+      _inFrame(false), _frameLength(0), _overflows(0) {
+}
+
+void SerialLineReader::begin(LineHandler handler, FrameHandler frameHandler) {
+    _handler = handler;
+    _frameHandler = frameHandler;
+    _head = _lineStart = _scan = 0;
+    _discarding = false;
+    _inFrame = false;
+}
+
+size_t SerialLineReader::poll() {
+    size_t total = 0;
+
+    // Bulk read into the free, contiguous part of the ring
+    int available = _serial.available();
+    while (available > 0) {
+        uint32_t used = _head - _lineStart;
+        size_t space = SERIAL_RING_SIZE - used;
+        size_t contiguous = SERIAL_RING_SIZE - (_head & RING_MASK);
+        size_t chunk = min(min(space, contiguous), (size_t)available);
+        if (chunk == 0) {
+            break;  // Ring full of an unterminated line (handled below)
+        }
+
+        size_t n = _serial.readBytes(&_ring[_head & RING_MASK], chunk);
+        if (n == 0) {
+            break;
+        }
+        _head += n;
+        total += n;
+        available -= n;
+        metrics.serialRing.note(_head - _lineStart);
+
+        // Split complete lines and frames
+        while (_scan != _head) {
+            if (_inFrame) {
+                scanFrameByte();
+                continue;
+            }
+
+            char c = _ring[_scan & RING_MASK];
+            _scan++;
+
+            if ((uint8_t)c == BINARY_SYNC && _frameHandler &&
+                !_discarding && _scan - 1 == _lineStart) {
+                _inFrame = true;
+                _frameLength = BINARY_HEADER_SIZE;
+                continue;
+            }
+
+            if (c == '\n' || c == '\r') {
+                if (_discarding) {
+                    _discarding = false;
+                } else if (_scan - 1 != _lineStart) {
+                    dispatchLine(_lineStart, _scan - 1);
+                }
+                _lineStart = _scan;
+            } else if (!_discarding && _scan - _lineStart > COMMAND_MAX_LENGTH) {
+                _serial.println("error: Command too long");
+                _overflows++;
+                _discarding = true;
+            }
+
+            if (_discarding) {
+                _lineStart = _scan;  // Drop bytes as they arrive
+            }
+        }
+    }
+
+    applyPendingBaudRate();
+
+    if (_idleHandler) {
+        _idleHandler();
+    }
+    return total;
+}
+
+void SerialLineReader::scanFrameByte() {
+    _scan++;
+    size_t count = _scan - _lineStart;
+
+    if (count == BINARY_HEADER_SIZE) {
+        size_t length = BinaryProtocol::frameLength(linearize(_lineStart, count));
+        if (length == 0) {
+            // Unknown length - hand over the header so it gets a BAD_FRAME ack
+            dispatchFrame(_lineStart, _scan);
+            _inFrame = false;
+            _lineStart = _scan;
+            return;
+        }
+        _frameLength = length;
+    }
+
+    if (count >= _frameLength && count > BINARY_HEADER_SIZE) {
+        dispatchFrame(_lineStart, _scan);
+        _inFrame = false;
+        _lineStart = _scan;
+    }
+}
+
+const uint8_t* SerialLineReader::linearize(uint32_t start, size_t length) {
+    size_t offset = start & RING_MASK;
+
+    if (offset + length <= SERIAL_RING_SIZE) {
+        // Contiguous - hand out a span into the ring
+        return &_ring[offset];
+    }
+
+    // Wrapped around the end of the ring - copy into scratch
+    size_t first = SERIAL_RING_SIZE - offset;
+    memcpy(_scratch, &_ring[offset], first);
+    memcpy(_scratch + first, &_ring[0], length - first);
+    return (const uint8_t*)_scratch;
+}
+
+void SerialLineReader::dispatchLine(uint32_t start, uint32_t end) {
+    if (_handler) {
+        _handler((const char*)linearize(start, end - start), end - start);
+    }
+}
+
+void SerialLineReader::dispatchFrame(uint32_t start, uint32_t end) {
+    if (_frameHandler) {
+        _frameHandler(linearize(start, end - start), end - start);
+    }
+}
+
+void SerialLineReader::applyPendingBaudRate() {
+    uint32_t baud = _pendingBaud;
+    if (baud == 0) {
+        return;
+    }
+    _pendingBaud = 0;
+
+    // Let the "ok" go out at the old rate first
+    _serial.flush();
+    _serial.updateBaudRate(baud);
+    _baudRate = baud;
+}
+
+bool SerialLineReader::startTask() {
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry, "serial", SERIAL_TASK_STACK_SIZE, this,
+        SERIAL_TASK_PRIORITY, nullptr, SERIAL_TASK_CORE);
+    return created == pdPASS;
+}
+
+void SerialLineReader::taskEntry(void* param) {
+    SerialLineReader* reader = static_cast<SerialLineReader*>(param);
+    for (;;) {
+        if (reader->poll() == 0) {
+            vTaskDelay(1);
+        }
+    }
+}
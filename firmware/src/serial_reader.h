@@ -0,0 +1,114 @@
+#ifndef SERIAL_READER_H
+#define SERIAL_READER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "binary_protocol.h"
+
+/**
+ * Framed line reader for the Serial command path
+ *
+ * Incoming bytes are pulled in bulk (Serial.readBytes) into a preallocated
+ * ring buffer and split on '\n' / '\r'. Each complete line is passed to the
+ * handler as a pointer/length span straight into the ring; only lines that
+ * wrap around the end of the ring are copied into a small scratch buffer.
+ * Lines longer than COMMAND_MAX_LENGTH are dropped with an error.
+ *
+ * A line that starts with BINARY_SYNC is read as a binary frame instead
+ * (see binary_protocol.h); its length comes from the frame header, so
+ * payload bytes may contain '\n'.
+ *
+ * poll() can be called from loop(), or startTask() runs it in its own
+ * FreeRTOS task (SERIAL_TASK_ENABLED) so WiFi work cannot starve it.
+ */
+class SerialLineReader {
+public:
+    // Called for every complete, non-empty line (not NUL-terminated)
+    typedef void (*LineHandler)(const char* line, size_t length);
+
+    // Called for every complete binary frame
+    typedef void (*FrameHandler)(const uint8_t* frame, size_t length);
+
+    // Called at the end of every poll, between replies
+    typedef void (*IdleHandler)();
+
+    SerialLineReader(HardwareSerial& serial, uint32_t baudRate);
+
+    /**
+     * Set the handlers for complete lines and binary frames
+     * Serial itself must already be started
+     * @param frameHandler nullptr to treat 0xA5 as ordinary text
+     */
+    void begin(LineHandler handler, FrameHandler frameHandler = nullptr);
+
+    /**
+     * Set a handler for unsolicited output (M154 auto-reports); running it
+     * on the reader's task keeps it from splitting a command reply
+     */
+    void setIdleHandler(IdleHandler handler) { _idleHandler = handler; }
+
+    /**
+     * Switch baud rate once the current reply has been sent
+     * (applied at the end of the next poll)
+     */
+    void requestBaudRate(uint32_t baud) { _pendingBaud = baud; }
+
+    /**
+     * Current link baud rate
+     */
+    uint32_t getBaudRate() const { return _baudRate; }
+
+    /**
+     * Read whatever is available and dispatch complete lines
+     * @return number of bytes read
+     */
+    size_t poll();
+
+    /**
+     * Run poll() continuously in a pinned FreeRTOS task
+     * @return true if the task was created
+     */
+    bool startTask();
+
+    /**
+     * Number of lines dropped for being too long
+     */
+    uint32_t getOverflowCount() const { return _overflows; }
+
+private:
+    static const size_t RING_MASK = SERIAL_RING_SIZE - 1;
+    static_assert((SERIAL_RING_SIZE & RING_MASK) == 0, "SERIAL_RING_SIZE must be a power of two");
+    static_assert(SERIAL_RING_SIZE > COMMAND_MAX_LENGTH, "SERIAL_RING_SIZE too small");
+    static_assert(COMMAND_MAX_LENGTH >= BINARY_MAX_FRAME_SIZE, "Scratch buffer too small for frames");
+
+    HardwareSerial& _serial;
+    LineHandler _handler;
+    FrameHandler _frameHandler;
+    IdleHandler _idleHandler;
+    uint32_t _baudRate;
+    volatile uint32_t _pendingBaud;
+
+    // Free-running counters; ring index = counter & RING_MASK
+    uint8_t _ring[SERIAL_RING_SIZE];
+    uint32_t _head;        // Next byte to write
+    uint32_t _lineStart;   // First byte of the current line
+    uint32_t _scan;        // Next byte to inspect for a terminator
+    bool _discarding;      // Dropping an overlong line until its terminator
+    bool _inFrame;         // Reading a binary frame
+    size_t _frameLength;   // Expected frame length (header size until known)
+    uint32_t _overflows;
+
+    char _scratch[COMMAND_MAX_LENGTH];  // Linearized copy of wrapped lines
+
+    void dispatchLine(uint32_t start, uint32_t end);
+    void dispatchFrame(uint32_t start, uint32_t end);
+    const uint8_t* linearize(uint32_t start, size_t length);
+    void scanFrameByte();
+    void applyPendingBaudRate();
+    static void taskEntry(void* param);
+};
+
+// Global serial reader instance
+extern SerialLineReader serialReader;
+
+#endif // SERIAL_READER_H
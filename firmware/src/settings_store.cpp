@@ -0,0 +1,91 @@
+#include "settings_store.h"
+
+// Global instance
+SettingsStore settingsStore;
+
+SettingsStore::SettingsStore() : _error(nullptr) {
+}
+
+bool SettingsStore::load(JointSettings out[MOTOR_COUNT]) {
+    _error = nullptr;
+    if (!_prefs.begin(SETTINGS_NVS_NAMESPACE, true)) {
+        // Namespace not created yet: nothing was ever saved
+        return false;
+    }
+
+    Blob blob;
+    size_t length = _prefs.getBytesLength(SETTINGS_NVS_KEY);
+    bool found = length > 0;
+    bool valid = length == sizeof(blob) &&
+                 _prefs.getBytes(SETTINGS_NVS_KEY, &blob, sizeof(blob)) == sizeof(blob);
+    _prefs.end();
+
+    if (!found) {
+        return false;
+    }
+    if (!valid || blob.version != VERSION || blob.jointCount != MOTOR_COUNT) {
+        _error = "Saved settings from another firmware version";
+        return false;
+    }
+
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        const Record& record = blob.joints[i];
+        out[i].maxSpeedHz = record.maxSpeedHz;
+        out[i].acceleration = record.acceleration;
+        out[i].jerk = record.jerk;
+        out[i].limitMin = record.limitMin;
+        out[i].limitMax = record.limitMax;
+    }
+    return true;
+}
+
+bool SettingsStore::save(const JointSettings settings[MOTOR_COUNT]) {
+    _error = nullptr;
+
+    Blob blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.version = VERSION;
+    blob.jointCount = MOTOR_COUNT;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        Record& record = blob.joints[i];
+        record.maxSpeedHz = settings[i].maxSpeedHz;
+        record.acceleration = settings[i].acceleration;
+        record.jerk = settings[i].jerk;
+        record.limitMin = settings[i].limitMin;
+        record.limitMax = settings[i].limitMax;
+    }
+
+    if (!_prefs.begin(SETTINGS_NVS_NAMESPACE, false)) {
+        _error = "Settings storage not available";
+        return false;
+    }
+    size_t written = _prefs.putBytes(SETTINGS_NVS_KEY, &blob, sizeof(blob));
+    _prefs.end();
+
+    if (written != sizeof(blob)) {
+        _error = "Settings write failed";
+        return false;
+    }
+    return true;
+}
+
+bool SettingsStore::erase() {
+    _error = nullptr;
+    if (!_prefs.begin(SETTINGS_NVS_NAMESPACE, false)) {
+        _error = "Settings storage not available";
+        return false;
+    }
+    // remove() fails if the key was never written, which is fine
+    _prefs.remove(SETTINGS_NVS_KEY);
+    _prefs.end();
+    return true;
+}
+
+bool SettingsStore::isSaved() {
+    if (!_prefs.begin(SETTINGS_NVS_NAMESPACE, true)) {
+        return false;
+    }
+    bool saved = _prefs.isKey(SETTINGS_NVS_KEY);
+    _prefs.end();
+    return saved;
+}
@@ -0,0 +1,75 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "motor_controller.h"
+
+/**
+ * Tuned joint parameters persisted in NVS
+ *
+ * M500 writes every joint's JointSettings as one small blob (a header
+ * with a format version and joint count, then fixed-size little-endian
+ * records), MotorController::begin() reads it back. A blob written by a
+ * different format version or joint count is ignored, so a firmware
+ * update falls back to the config.h defaults instead of misreading it.
+ *
+ * NVS writes stall both cores while flash is erased; callers only save
+ * while the arm is idle.
+ */
+class SettingsStore {
+public:
+    static const uint8_t VERSION = 1;
+
+    SettingsStore();
+
+    /**
+     * Read the saved settings
+     * @return false if nothing usable is stored (getError says why, or is
+     *         nullptr if nothing was ever saved)
+     */
+    bool load(JointSettings out[MOTOR_COUNT]);
+
+    /**
+     * Write settings for every joint
+     * @return false on a write failure (see getError)
+     */
+    bool save(const JointSettings settings[MOTOR_COUNT]);
+
+    /**
+     * Remove the saved settings (the next boot uses the defaults)
+     */
+    bool erase();
+
+    /**
+     * Check whether settings are saved
+     */
+    bool isSaved();
+
+    const char* getError() const { return _error; }
+
+private:
+    struct __attribute__((packed)) Record {
+        uint32_t maxSpeedHz;
+        uint32_t acceleration;
+        uint32_t jerk;
+        int32_t limitMin;
+        int32_t limitMax;
+    };
+
+    struct __attribute__((packed)) Blob {
+        uint8_t version;
+        uint8_t jointCount;
+        uint16_t reserved;
+        Record joints[MOTOR_COUNT];
+    };
+
+    Preferences _prefs;
+    const char* _error;
+};
+
+// Global settings store instance
+extern SettingsStore settingsStore;
+
+#endif // SETTINGS_STORE_H
@@ -0,0 +1,64 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Lock-free single-producer/single-consumer FIFO
+ *
+ * One task may push and one (other) task may pop, concurrently, without
+ * locks or critical sections: each index is written by exactly one side and
+ * published with release/acquire ordering, which is enough on the ESP32's
+ * dual cores. Indices run freely and are masked, so all N slots are usable.
+ * N must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    SpscQueue() : _head(0), _tail(0) {}
+
+    /**
+     * Append an item (producer side)
+     * @return false if the queue is full
+     */
+    bool push(const T& item) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest item (consumer side)
+     * @return false if the queue is empty
+     */
+    bool pop(T& item) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called from a third task
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+private:
+    T _items[N];
+    std::atomic<uint32_t> _head;   // Next slot to write (producer)
+    std::atomic<uint32_t> _tail;   // Oldest item (consumer)
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,67 @@
+#include "telemetry.h"
+#include "motor_controller.h"
+#include "encoder_monitor.h"
+
+// Global instance
+Telemetry telemetry;
+
+Telemetry::Telemetry() : _sequence(0), _lastCaptureUs(0) {
+    memset(&_snapshot, 0, sizeof(_snapshot));
+}
+
+void Telemetry::capture() {
+    // Read the steppers outside the write window so it stays short
+    MotionSnapshot snapshot;
+    snapshot.timestampUs = micros();
+    snapshot.movingMask = 0;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        snapshot.position[i] = motors.getPosition(i);
+        snapshot.target[i] = motors.getTargetPosition(i);
+        snapshot.speedMilliHz[i] = motors.getSpeedMilliHz(i);
+        snapshot.followingError[i] = encoders.getFollowingError(i);
+        if (motors.isMoving(i)) {
+            snapshot.movingMask |= 1 << i;
+        }
+    }
+    snapshot.enabled = motors.isEnabled();
+    snapshot.coordinated = motors.isCoordinated();
+    snapshot.jogging = motors.isJogging();
+    snapshot.homing = motors.isHoming();
+    snapshot.homedMask = motors.getHomedMask();
+    snapshot.queueDepth = motors.getQueueDepth();
+    snapshot.queueFree = motors.getQueueFree();
+    snapshot.encoderFaultMask = encoders.getFaultMask();
+
+    // Odd sequence = write in progress
+    uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    snapshot.sequence = sequence / 2 + 1;
+    memcpy(&_snapshot, &snapshot, sizeof(_snapshot));
+
+    _sequence.store(sequence + 2, std::memory_order_release);
+    _lastCaptureUs = snapshot.timestampUs;
+}
+
+void Telemetry::update() {
+    if (micros() - _lastCaptureUs >= TELEMETRY_PUBLISH_INTERVAL_US) {
+        capture();
+    }
+}
+
+void Telemetry::read(MotionSnapshot& out) const {
+    for (;;) {
+        uint32_t before = _sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;  // Writer is mid-copy (a few microseconds)
+        }
+
+        memcpy(&out, &_snapshot, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (_sequence.load(std::memory_order_relaxed) == before) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+/**
+ * Joint state captured at one instant by the motion task
+ */
+struct MotionSnapshot {
+    uint32_t sequence;          // Publish count (version)
+    uint32_t timestampUs;       // micros() at capture
+    int32_t position[MOTOR_COUNT];
+    int32_t target[MOTOR_COUNT];
+    int32_t speedMilliHz[MOTOR_COUNT];  // Signed, steps/s x 1000
+    uint8_t movingMask;         // Bit n set = joint n+1 running
+    bool enabled;
+    bool coordinated;
+    bool jogging;
+    bool homing;
+    uint8_t homedMask;          // Bit n set = joint n+1 homed
+    uint8_t queueDepth;
+    uint8_t queueFree;
+    int32_t followingError[MOTOR_COUNT];  // Steps, commanded - encoder (0 = no encoder)
+    uint8_t encoderFaultMask;   // Bit n set = joint n+1 faulted
+
+    bool isMoving() const { return movingMask != 0; }
+    int32_t distanceToGo(uint8_t joint) const { return target[joint] - position[joint]; }
+};
+
+/**
+ * Seqlock-published telemetry snapshot
+ *
+ * The motion task is the only writer: capture() reads every stepper once,
+ * back to back, and publishes the result. Readers on any task (serial
+ * replies, HTTP, WebSocket, status LED) copy the whole snapshot with
+ * read() - no locks, never blocking the writer, and never touching the
+ * stepper driver themselves.
+ *
+ * The sequence counter is odd while a write is in progress; a reader that
+ * sees an odd or changed counter retries its copy.
+ */
+class Telemetry {
+public:
+    Telemetry();
+
+    /**
+     * Capture and publish now (motion task only)
+     */
+    void capture();
+
+    /**
+     * Capture if TELEMETRY_PUBLISH_INTERVAL_US has elapsed (motion task only)
+     */
+    void update();
+
+    /**
+     * Copy the latest consistent snapshot (any task)
+     */
+    void read(MotionSnapshot& out) const;
+
+    /**
+     * Take and return a copy of the latest snapshot
+     */
+    MotionSnapshot get() const {
+        MotionSnapshot snapshot;
+        read(snapshot);
+        return snapshot;
+    }
+
+private:
+    std::atomic<uint32_t> _sequence;
+    MotionSnapshot _snapshot;
+    uint32_t _lastCaptureUs;
+};
+
+// Global telemetry instance
+extern Telemetry telemetry;
+
+#endif // TELEMETRY_H
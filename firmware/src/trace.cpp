@@ -0,0 +1,338 @@
+#include "trace.h"
+#include "motor_controller.h"
+#include "motion_task.h"
+
+// Global instance
+Trace trace;
+
+static_assert(TRACE_BLOCK_SIZE <= 65535 && TRACE_BLOCK_SIZE % 4 == 0,
+              "TRACE_BLOCK_SIZE must be a multiple of 4 below 64 KB");
+
+// Worst case for one delta sample: time + position/speed per joint as
+// 5-byte varints, then queue depth and flags
+static const size_t MAX_SAMPLE_BYTES = 5 * (1 + 2 * MOTOR_COUNT) + 2;
+static const size_t BLOCK_DATA_SIZE = TRACE_BLOCK_SIZE - sizeof(TraceBlockHeader);
+
+static_assert(BLOCK_DATA_SIZE >= MAX_SAMPLE_BYTES, "TRACE_BLOCK_SIZE too small");
+
+// Packed by construction; the host decoder (roboarm.trace) relies on it
+static_assert(sizeof(TraceFileHeader) == 32, "TraceFileHeader layout changed");
+static_assert(sizeof(TraceBlockHeader) == 16 + 8 * MOTOR_COUNT, "TraceBlockHeader layout changed");
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline void putVarint(uint8_t*& out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+}
+
+Trace::Trace()
+    : _timer(nullptr)
+    , _buffer(nullptr)
+    , _capacity(0)
+    , _inPsram(false)
+    , _state(TraceState::STOPPED)
+    , _generation(0)
+    , _samplePending(false)
+    , _pendingTrigger((uint8_t)TraceTrigger::NONE)
+    , _rateHz(TRACE_DEFAULT_RATE_HZ)
+    , _periodUs(1000000 / TRACE_DEFAULT_RATE_HZ)
+    , _postSamples(0)
+    , _remaining(0)
+    , _first(0)
+    , _blocks(0)
+    , _samples(0)
+    , _droppedSamples(0)
+    , _missed(0)
+    , _triggerSample(-1)
+    , _triggerReason(TraceTrigger::NONE)
+    , _lastUs(0)
+    , _error("") {
+    memset(_lastPosition, 0, sizeof(_lastPosition));
+    memset(_lastSpeed, 0, sizeof(_lastSpeed));
+}
+
+bool Trace::allocate() {
+    // PSRAM is only mapped when the core was built with BOARD_HAS_PSRAM
+    if (psramFound()) {
+        _buffer = (uint8_t*)ps_malloc(TRACE_PSRAM_SIZE);
+        if (_buffer) {
+            _capacity = TRACE_PSRAM_SIZE / TRACE_BLOCK_SIZE;
+            _inPsram = true;
+            return true;
+        }
+    }
+
+    _buffer = (uint8_t*)malloc(TRACE_DRAM_SIZE);
+    if (!_buffer) {
+        return false;
+    }
+    _capacity = TRACE_DRAM_SIZE / TRACE_BLOCK_SIZE;
+    _inPsram = false;
+    return true;
+}
+
+bool Trace::start(uint32_t rateHz, uint32_t postTriggerMs) {
+    if (rateHz < TRACE_MIN_RATE_HZ || rateHz > TRACE_MAX_RATE_HZ) {
+        _error = "Sample rate out of range";
+        return false;
+    }
+    if (!_buffer && !allocate()) {
+        _error = "No memory for the trace buffer";
+        return false;
+    }
+    if (!_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = timerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "trace";
+        args.skip_unhandled_events = true;  // Late ticks are counted, not replayed
+        if (esp_timer_create(&args, &_timer) != ESP_OK) {
+            _timer = nullptr;
+            _error = "No timer for the trace";
+            return false;
+        }
+    }
+
+    // Samples are taken on this task, so nothing else uses the settings or
+    // the ring while they change; a tick left from the last run is dropped
+    esp_timer_stop(_timer);
+    _samplePending.store(false, std::memory_order_relaxed);
+    _generation.fetch_add(1, std::memory_order_relaxed);
+    _state.store(postTriggerMs ? TraceState::ARMED : TraceState::RECORDING, std::memory_order_release);
+
+    _rateHz = rateHz;
+    _periodUs = 1000000 / rateHz;
+    _postSamples = postTriggerMs ? max((uint32_t)1, (uint32_t)((uint64_t)postTriggerMs * rateHz / 1000)) : 0;
+    _pendingTrigger.store((uint8_t)TraceTrigger::NONE, std::memory_order_relaxed);
+    _first = 0;
+    _blocks = 0;
+    _samples = 0;
+    _droppedSamples = 0;
+    _missed = 0;
+    _triggerSample = -1;
+    _triggerReason = TraceTrigger::NONE;
+
+    if (esp_timer_start_periodic(_timer, _periodUs) != ESP_OK) {
+        _state.store(TraceState::STOPPED, std::memory_order_release);
+        _error = "Could not start the trace timer";
+        return false;
+    }
+
+    DEBUG_PRINTF("Trace: %s at %lu Hz, %u KB %s\n", postTriggerMs ? "armed" : "recording",
+                 (unsigned long)rateHz, (unsigned)(getBufferSize() / 1024),
+                 _inPsram ? "PSRAM" : "DRAM");
+    _error = "";
+    return true;
+}
+
+void Trace::stop() {
+    _state.store(TraceState::STOPPED, std::memory_order_release);
+    if (_timer) {
+        esp_timer_stop(_timer);
+    }
+}
+
+void Trace::trigger(TraceTrigger reason) {
+    if (getState() != TraceState::ARMED) {
+        return;
+    }
+    // First trigger wins
+    uint8_t none = (uint8_t)TraceTrigger::NONE;
+    _pendingTrigger.compare_exchange_strong(none, (uint8_t)reason);
+}
+
+void Trace::timerCallback(void* arg) {
+    static_cast<Trace*>(arg)->_samplePending.store(true, std::memory_order_release);
+    motionTask.wake();
+}
+
+void Trace::update() {
+    if (_samplePending.exchange(false, std::memory_order_acquire)) {
+        sample();
+    }
+}
+
+TraceBlockHeader* Trace::block(size_t index) const {
+    return (TraceBlockHeader*)(_buffer + index * TRACE_BLOCK_SIZE);
+}
+
+void Trace::beginBlock(uint32_t timeUs, const int32_t position[], const int32_t speed[],
+                       uint8_t queueDepth, uint8_t flags) {
+    // Next slot, overwriting the oldest block once the ring is full
+    if (_blocks == _capacity) {
+        _droppedSamples += block(_first)->count;
+        _first = (_first + 1) % _capacity;
+    } else {
+        _blocks++;
+    }
+
+    TraceBlockHeader* header = block((_first + _blocks - 1) % _capacity);
+    header->firstSample = _samples;
+    header->timeUs = timeUs;
+    memcpy(header->position, position, sizeof(header->position));
+    memcpy(header->speedHz, speed, sizeof(header->speedHz));
+    header->queueDepth = queueDepth;
+    header->flags = flags;
+    header->count = 1;
+    header->length = 0;
+    header->reserved = 0;
+}
+
+void Trace::sample() {
+    TraceState state = _state.load(std::memory_order_acquire);
+    if (state == TraceState::STOPPED) {
+        return;
+    }
+
+    uint32_t now = micros();
+    int32_t position[MOTOR_COUNT];
+    int32_t speed[MOTOR_COUNT];
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        position[i] = motors.getPosition(i);
+        speed[i] = motors.getSpeedMilliHz(i) / 1000;
+    }
+    uint8_t queueDepth = motors.getQueueDepth();
+    uint8_t flags = (motors.isEnabled() ? TRACE_FLAG_ENABLED : 0) |
+                    (motors.isAnyMoving() ? TRACE_FLAG_MOVING : 0) |
+                    (motors.isJogging() ? TRACE_FLAG_JOGGING : 0) |
+                    (motors.isHoming() ? TRACE_FLAG_HOMING : 0);
+
+    if (state == TraceState::ARMED) {
+        uint8_t reason = _pendingTrigger.load(std::memory_order_relaxed);
+        if (reason != (uint8_t)TraceTrigger::NONE) {
+            _triggerReason = (TraceTrigger)reason;
+            _triggerSample = _samples;
+            _remaining = _postSamples;
+            state = TraceState::TRIGGERED;
+            _state.store(state, std::memory_order_release);
+        }
+    }
+
+    TraceBlockHeader* current = _blocks ? block((_first + _blocks - 1) % _capacity) : nullptr;
+    if (current && current->length + MAX_SAMPLE_BYTES <= BLOCK_DATA_SIZE) {
+        uint32_t elapsed = now - _lastUs;
+        uint32_t ticks = (elapsed + _periodUs / 2) / _periodUs;
+        if (ticks > 1) {
+            _missed += ticks - 1;
+        }
+
+        uint8_t* out = (uint8_t*)(current + 1) + current->length;
+        uint8_t* start = out;
+        putVarint(out, zigzag((int32_t)(elapsed - _periodUs)));
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            putVarint(out, zigzag(position[i] - _lastPosition[i]));
+            putVarint(out, zigzag(speed[i] - _lastSpeed[i]));
+        }
+        *out++ = queueDepth;
+        *out++ = flags;
+        current->length += out - start;
+        current->count++;
+    } else {
+        beginBlock(now, position, speed, queueDepth, flags);
+    }
+
+    memcpy(_lastPosition, position, sizeof(_lastPosition));
+    memcpy(_lastSpeed, speed, sizeof(_lastSpeed));
+    _lastUs = now;
+    _samples++;
+
+    if (state == TraceState::TRIGGERED) {
+        if (_remaining == 0) {
+            stop();
+        } else {
+            _remaining--;
+        }
+    }
+}
+
+uint32_t Trace::getSampleCount() const {
+    return _samples - _droppedSamples;
+}
+
+uint32_t Trace::getMissedSamples() const {
+    return _missed;
+}
+
+size_t Trace::downloadSize() const {
+    if (getState() != TraceState::STOPPED || _blocks == 0) {
+        return 0;
+    }
+    return sizeof(TraceFileHeader) + _blocks * TRACE_BLOCK_SIZE;
+}
+
+void Trace::fillHeader(TraceFileHeader& header) const {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "RBTR", 4);
+    header.version = 1;
+    header.joints = MOTOR_COUNT;
+    header.blockSize = TRACE_BLOCK_SIZE;
+    header.rateHz = _rateHz;
+    header.blockCount = _blocks;
+    header.sampleCount = getSampleCount();
+    header.triggerSample = -1;
+    if (_triggerSample >= 0 && _blocks) {
+        uint32_t first = block(_first)->firstSample;
+        if (_triggerSample >= first) {
+            header.triggerSample = (int32_t)(_triggerSample - first);
+        }
+    }
+    header.triggerReason = (uint8_t)_triggerReason;
+    header.missedSamples = _missed;
+}
+
+size_t Trace::read(uint32_t generation, size_t offset, uint8_t* out, size_t maxLength) const {
+    if (generation != getGeneration()) {
+        return 0;
+    }
+    size_t total = downloadSize();
+    if (offset >= total) {
+        return 0;
+    }
+
+    size_t copied = 0;
+    if (offset < sizeof(TraceFileHeader)) {
+        TraceFileHeader header;
+        fillHeader(header);
+        copied = min(sizeof(header) - offset, maxLength);
+        memcpy(out, (const uint8_t*)&header + offset, copied);
+    }
+
+    while (copied < maxLength && offset + copied < total) {
+        size_t position = offset + copied - sizeof(TraceFileHeader);
+        size_t within = position % TRACE_BLOCK_SIZE;
+        size_t length = min((size_t)TRACE_BLOCK_SIZE - within, maxLength - copied);
+        const uint8_t* source = (const uint8_t*)block((_first + position / TRACE_BLOCK_SIZE) % _capacity);
+        memcpy(out + copied, source + within, length);
+        copied += length;
+    }
+    return copied;
+}
+
+const char* Trace::stateName(TraceState state) {
+    switch (state) {
+        case TraceState::STOPPED:   return "stopped";
+        case TraceState::RECORDING: return "recording";
+        case TraceState::ARMED:     return "armed";
+        case TraceState::TRIGGERED: return "triggered";
+        default:                    return "unknown";
+    }
+}
+
+const char* Trace::triggerName(TraceTrigger reason) {
+    switch (reason) {
+        case TraceTrigger::NONE:    return "none";
+        case TraceTrigger::MANUAL:  return "manual";
+        case TraceTrigger::ESTOP:   return "estop";
+        case TraceTrigger::HOMING:  return "homing";
+        case TraceTrigger::PATH:    return "path";
+        case TraceTrigger::ENCODER: return "encoder";
+        default:                    return "unknown";
+    }
+}
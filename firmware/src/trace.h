@@ -0,0 +1,189 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+#include "config.h"
+
+enum class TraceState : uint8_t {
+    STOPPED,    // Not sampling; the buffer holds the last recording
+    RECORDING,  // Sampling until stopped, oldest blocks overwritten
+    ARMED,      // Recording, waiting for a trigger
+    TRIGGERED   // Recording the post-trigger window, then STOPPED
+};
+
+enum class TraceTrigger : uint8_t {
+    NONE,
+    MANUAL,     // M860 E1
+    ESTOP,      // M112
+    HOMING,     // A joint failed to home
+    PATH,       // A Cartesian move was cut short
+    ENCODER     // Following error fault
+};
+
+// Sample flags
+static const uint8_t TRACE_FLAG_ENABLED = 1 << 0;
+static const uint8_t TRACE_FLAG_MOVING = 1 << 1;
+static const uint8_t TRACE_FLAG_JOGGING = 1 << 2;
+static const uint8_t TRACE_FLAG_HOMING = 1 << 3;
+
+/**
+ * Download header (little-endian, followed by blockCount blocks of
+ * blockSize bytes, oldest first)
+ */
+struct TraceFileHeader {
+    char magic[4];              // "RBTR"
+    uint8_t version;
+    uint8_t joints;             // MOTOR_COUNT
+    uint16_t blockSize;
+    uint32_t rateHz;
+    uint32_t blockCount;
+    uint32_t sampleCount;
+    int32_t triggerSample;      // Index into the download, -1 if none
+    uint8_t triggerReason;      // TraceTrigger
+    uint8_t reserved[3];
+    uint32_t missedSamples;     // Timer ticks skipped while the sampler ran late
+};
+
+/**
+ * Block keyframe: the first sample of the block in full. The rest follow
+ * as zigzag varint deltas from the previous sample - time (us minus the
+ * sample period), then each joint's position and speed - and the raw
+ * queue depth and flags bytes, usually 15 bytes a sample.
+ */
+struct TraceBlockHeader {
+    uint32_t firstSample;       // Sample number since the recording started
+    uint32_t timeUs;            // micros() of the first sample
+    int32_t position[MOTOR_COUNT];
+    int32_t speedHz[MOTOR_COUNT];   // Signed steps/s
+    uint8_t queueDepth;
+    uint8_t flags;              // TRACE_FLAG_*
+    uint16_t count;             // Samples in the block, keyframe included
+    uint16_t length;            // Bytes of delta data after the header
+    uint16_t reserved;
+};
+
+/**
+ * High-rate motion trace recorder
+ *
+ * Samples every joint's position and speed, the queue depth and the
+ * motion flags at TRACE_MIN_RATE_HZ..TRACE_MAX_RATE_HZ. The samples are
+ * taken on the motion task (update(), called by MotionTask::step), the only
+ * task that changes that state, so a sample is always consistent. An
+ * esp_timer only marks a sample due and wakes the motion task, which steps
+ * at the sample rate while recording; without the motion task the trace
+ * samples at the loop() rate instead.
+ *
+ * Samples go into a ring of fixed-size blocks - PSRAM when the board has
+ * it (TRACE_PSRAM_SIZE), otherwise TRACE_DRAM_SIZE of heap, allocated on
+ * the first start. Each block opens with a keyframe and is decoded on its
+ * own, so overwriting the oldest block never breaks the rest.
+ *
+ * In trigger mode (start() with postTriggerMs) the recorder keeps the latest history until a
+ * trigger - E-stop, a homing or path fault, or M860 E1 - then records
+ * postTriggerMs more and stops, leaving the run-up to the event in the
+ * buffer. Everything but trigger() runs on the motion task; other tasks
+ * report triggers through an atomic, and downloads read the ring only while
+ * it is stopped.
+ */
+class Trace {
+public:
+    Trace();
+
+    /**
+     * Start recording (motion task)
+     * @param rateHz Sample rate
+     * @param postTriggerMs Trigger mode: record this long after a trigger
+     *        and stop; 0 = record until stop()
+     * @return false if no buffer could be allocated or the rate is out of
+     *         range (see getError)
+     */
+    bool start(uint32_t rateHz, uint32_t postTriggerMs = 0);
+
+    /**
+     * Stop recording; the buffer is kept for download
+     */
+    void stop();
+
+    /**
+     * Take the sample the timer marked due, if any (motion task)
+     */
+    void update();
+
+    /**
+     * Report a trigger event (any task; ignored unless ARMED)
+     */
+    void trigger(TraceTrigger reason);
+
+    TraceState getState() const { return _state.load(std::memory_order_acquire); }
+    static const char* stateName(TraceState state);
+    static const char* triggerName(TraceTrigger reason);
+
+    uint32_t getRateHz() const { return _rateHz; }
+    uint32_t getSampleCount() const;
+    uint32_t getMissedSamples() const;
+    TraceTrigger getTriggerReason() const { return _triggerReason; }
+    size_t getBufferSize() const { return _capacity * TRACE_BLOCK_SIZE; }
+    bool inPsram() const { return _inPsram; }
+
+    // Reason the last start() failed
+    const char* getError() const { return _error; }
+
+    /**
+     * Size of the download (0 while recording or if nothing was recorded)
+     */
+    size_t downloadSize() const;
+
+    /**
+     * Copy part of the download (header, then blocks oldest first)
+     * @param generation Value of getGeneration() when the download began;
+     *        a newer recording ends the copy early
+     * @return Bytes copied (0 at the end, or once the buffer was reused)
+     */
+    size_t read(uint32_t generation, size_t offset, uint8_t* out, size_t maxLength) const;
+
+    // Bumped by every start()
+    uint32_t getGeneration() const { return _generation.load(std::memory_order_acquire); }
+
+private:
+    esp_timer_handle_t _timer;
+    uint8_t* _buffer;
+    size_t _capacity;               // Blocks
+    bool _inPsram;
+
+    std::atomic<TraceState> _state;
+    std::atomic<uint32_t> _generation;
+    std::atomic<bool> _samplePending;       // Set by the timer
+    std::atomic<uint8_t> _pendingTrigger;   // TraceTrigger, from trigger()
+
+    // Sampler (motion task) state
+    uint32_t _rateHz;
+    uint32_t _periodUs;
+    uint32_t _postSamples;          // Trigger mode window; 0 = none
+    uint32_t _remaining;            // Post-trigger samples still to take
+    size_t _first;                  // Oldest block
+    size_t _blocks;                 // Blocks in use (the newest is being filled)
+    uint32_t _samples;              // Taken since start
+    uint32_t _droppedSamples;       // Oldest samples overwritten
+    uint32_t _missed;
+    int64_t _triggerSample;         // Sample number of the trigger, -1 none
+    TraceTrigger _triggerReason;
+    uint32_t _lastUs;
+    int32_t _lastPosition[MOTOR_COUNT];
+    int32_t _lastSpeed[MOTOR_COUNT];
+    const char* _error;
+
+    static void timerCallback(void* arg);
+    void sample();
+    bool allocate();
+    TraceBlockHeader* block(size_t index) const;
+    void beginBlock(uint32_t timeUs, const int32_t position[], const int32_t speed[],
+                    uint8_t queueDepth, uint8_t flags);
+    void fillHeader(TraceFileHeader& header) const;
+};
+
+// Global trace recorder instance
+extern Trace trace;
+
+#endif // TRACE_H
@@ -0,0 +1,227 @@
+#include "trajectory.h"
+#include "binary_protocol.h"
+#include "motor_controller.h"
+
+// Global instance
+TrajectoryPlayer trajectoryPlayer;
+
+TrajectoryPlayer::TrajectoryPlayer()
+    : _partition(nullptr), _lock(nullptr), _mapHandle(0), _records(nullptr), _recordCount(0),
+      _state(TrajectoryState::EMPTY), _index(0), _pass(0), _repeat(1),
+      _uploadOwner(nullptr), _uploadTotal(0), _uploadWritten(0),
+      _erasedUntil(0), _uploadError("") {
+}
+
+bool TrajectoryPlayer::begin() {
+    _lock = xSemaphoreCreateMutex();
+    _partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)TRAJECTORY_PARTITION_SUBTYPE,
+        TRAJECTORY_PARTITION_LABEL);
+
+    if (!_partition) {
+        DEBUG_PRINTLN("Trajectory: partition not found");
+        return false;
+    }
+
+    if (map()) {
+        DEBUG_PRINTF("Trajectory: %lu records\n", (unsigned long)_recordCount);
+    } else {
+        DEBUG_PRINTLN("Trajectory: none stored");
+    }
+    return true;
+}
+
+bool TrajectoryPlayer::start(uint32_t repeat) {
+    if (!_partition) {
+        return false;
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool startable = isValid() && !_uploadOwner;
+    if (startable) {
+        _index = 0;
+        _pass = 1;
+        _repeat = repeat;
+        _state = TrajectoryState::PLAYING;
+    }
+    xSemaphoreGive(_lock);
+    if (!startable) {
+        return false;
+    }
+
+    DEBUG_PRINTF("Trajectory: started (%lu records)\n", (unsigned long)_recordCount);
+    return true;
+}
+
+void TrajectoryPlayer::stop() {
+    if (_state != TrajectoryState::PLAYING) {
+        return;
+    }
+    motors.stopAll();
+    _state = TrajectoryState::READY;
+    DEBUG_PRINTLN("Trajectory: stopped");
+}
+
+void TrajectoryPlayer::update() {
+    if (_state != TrajectoryState::PLAYING) {
+        return;
+    }
+
+    for (int n = 0; n < TRAJECTORY_RECORDS_PER_UPDATE && !motors.isQueueFull(); n++) {
+        if (_index == _recordCount) {
+            if (_repeat != 0 && _pass >= _repeat) {
+                _state = TrajectoryState::FINISHED;
+                DEBUG_PRINTLN("Trajectory: finished");
+                return;
+            }
+            _index = 0;
+            _pass++;
+        }
+
+        // Straight from mapped flash into the planner
+        const TrajectoryRecord& record = _records[_index];
+        long positions[MOTOR_COUNT];
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            positions[i] = record.targets[i];
+        }
+
+        if (!motors.queueMove(positions, record.jointMask, record.speedHz, record.accel,
+                              record.flags & TRAJECTORY_FLAG_COORDINATED)) {
+            _state = TrajectoryState::FAILED;
+            DEBUG_PRINTF("Trajectory: record %lu rejected\n", (unsigned long)_index);
+            return;
+        }
+        _index++;
+    }
+}
+
+const char* TrajectoryPlayer::stateName(TrajectoryState state) {
+    switch (state) {
+        case TrajectoryState::EMPTY:    return "empty";
+        case TrajectoryState::READY:    return "ready";
+        case TrajectoryState::PLAYING:  return "playing";
+        case TrajectoryState::FINISHED: return "finished";
+        case TrajectoryState::FAILED:   return "failed";
+    }
+    return "unknown";
+}
+
+bool TrajectoryPlayer::beginUpload(const void* owner, size_t total) {
+    if (!_partition) {
+        _uploadError = "Trajectory partition not found";
+        return false;
+    }
+
+    if (total < sizeof(TrajectoryHeader) || total > _partition->size) {
+        _uploadError = "Bad trajectory size";
+        return false;
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool playing = _state == TrajectoryState::PLAYING;
+    if (!playing) {
+        // Flash is rewritten from here on - the old trajectory is gone
+        unmap();
+        _state = TrajectoryState::EMPTY;
+        _uploadOwner = owner;
+        _uploadTotal = total;
+        _uploadWritten = 0;
+        _erasedUntil = 0;
+    }
+    xSemaphoreGive(_lock);
+
+    if (playing) {
+        _uploadError = "Trajectory playing";
+        return false;
+    }
+    return true;
+}
+
+bool TrajectoryPlayer::writeUpload(const void* owner, const uint8_t* data, size_t len) {
+    if (!isUploadOwner(owner)) {
+        _uploadError = "No upload in progress";
+        return false;
+    }
+
+    if (_uploadWritten + len > _uploadTotal) {
+        _uploadOwner = nullptr;
+        _uploadError = "Upload larger than announced";
+        return false;
+    }
+
+    // Erase only the sectors this chunk reaches
+    size_t end = _uploadWritten + len;
+    if (end > _erasedUntil) {
+        size_t eraseEnd = (end + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+        if (esp_partition_erase_range(_partition, _erasedUntil, eraseEnd - _erasedUntil) != ESP_OK) {
+            _uploadOwner = nullptr;
+            _uploadError = "Flash erase failed";
+            return false;
+        }
+        _erasedUntil = eraseEnd;
+    }
+
+    if (esp_partition_write(_partition, _uploadWritten, data, len) != ESP_OK) {
+        _uploadOwner = nullptr;
+        _uploadError = "Flash write failed";
+        return false;
+    }
+    _uploadWritten = end;
+
+    if (_uploadWritten < _uploadTotal) {
+        return true;
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _uploadOwner = nullptr;
+    bool mapped = map();
+    xSemaphoreGive(_lock);
+    if (!mapped) {
+        _uploadError = "Invalid trajectory (header or CRC)";
+        return false;
+    }
+
+    DEBUG_PRINTF("Trajectory: stored %lu records\n", (unsigned long)_recordCount);
+    return true;
+}
+
+bool TrajectoryPlayer::map() {
+    unmap();
+
+    const void* base = nullptr;
+    if (esp_partition_mmap(_partition, 0, _partition->size, SPI_FLASH_MMAP_DATA,
+                           &base, &_mapHandle) != ESP_OK) {
+        return false;
+    }
+
+    const TrajectoryHeader* header = (const TrajectoryHeader*)base;
+    const TrajectoryRecord* records = (const TrajectoryRecord*)(header + 1);
+    size_t maxRecords = (_partition->size - sizeof(TrajectoryHeader)) / sizeof(TrajectoryRecord);
+
+    bool valid = memcmp(header->magic, TRAJECTORY_MAGIC, 4) == 0 &&
+                 header->version == TRAJECTORY_VERSION &&
+                 header->jointCount == MOTOR_COUNT &&
+                 header->recordSize == sizeof(TrajectoryRecord) &&
+                 header->recordCount > 0 &&
+                 header->recordCount <= maxRecords &&
+                 BinaryProtocol::crc16((const uint8_t*)records,
+                                       header->recordCount * sizeof(TrajectoryRecord)) == header->crc;
+
+    if (!valid) {
+        spi_flash_munmap(_mapHandle);
+        return false;
+    }
+
+    _records = records;
+    _recordCount = header->recordCount;
+    _state = TrajectoryState::READY;
+    return true;
+}
+
+void TrajectoryPlayer::unmap() {
+    if (_records) {
+        spi_flash_munmap(_mapHandle);
+        _records = nullptr;
+        _recordCount = 0;
+    }
+}
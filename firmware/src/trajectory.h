@@ -0,0 +1,144 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+
+/**
+ * Pre-compiled binary trajectories
+ *
+ * The host compiles a path offline (roboarm-cli compile) into packed
+ * fixed-size records and uploads it to the raw "traj" flash partition.
+ * The partition is memory-mapped, so playback reads records straight out
+ * of flash through the cache and hands them to the motion queue - no
+ * text, no tokenizing, no copies.
+ *
+ * File layout (little-endian):
+ *   TrajectoryHeader   16 bytes
+ *   TrajectoryRecord   36 bytes x recordCount
+ *
+ * The header CRC (CRC16-CCITT, as used by binary move frames) covers all
+ * records and is checked once when the trajectory is mapped.
+ *
+ * Playback runs on the motion task, uploads on the AsyncTCP task. While an
+ * upload owns the partition it is unmapped and start() refuses; _lock
+ * makes start() and the unmap/remap at either end of an upload exclusive.
+ */
+
+#define TRAJECTORY_MAGIC "RATJ"
+#define TRAJECTORY_VERSION 1
+
+// TrajectoryRecord::flags
+#define TRAJECTORY_FLAG_COORDINATED 0x01
+
+struct __attribute__((packed)) TrajectoryHeader {
+    char magic[4];          // "RATJ"
+    uint8_t version;
+    uint8_t jointCount;     // Must equal MOTOR_COUNT
+    uint16_t recordSize;    // sizeof(TrajectoryRecord)
+    uint32_t recordCount;
+    uint16_t crc;           // CRC16 over all records
+    uint16_t reserved;
+};
+
+struct __attribute__((packed)) TrajectoryRecord {
+    uint8_t jointMask;      // Bit n set = joint n+1 moves
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t targets[MOTOR_COUNT];  // Absolute positions (steps)
+    uint32_t speedHz;       // Speed cap for this move (0 = joint limits)
+    uint32_t accel;         // Acceleration cap (0 = joint limits)
+};
+
+enum class TrajectoryState : uint8_t {
+    EMPTY,      // No valid trajectory stored
+    READY,
+    PLAYING,
+    FINISHED,
+    FAILED      // A record was rejected (limits, motors disabled)
+};
+
+class TrajectoryPlayer {
+public:
+    TrajectoryPlayer();
+
+    /**
+     * Find and map the trajectory partition
+     * @return true if the partition exists (it may still be empty)
+     */
+    bool begin();
+
+    bool isAvailable() const { return _partition != nullptr; }
+    size_t getCapacity() const { return _partition ? _partition->size : 0; }
+
+    // Valid trajectory mapped
+    bool isValid() const { return _records != nullptr; }
+    uint32_t getRecordCount() const { return _recordCount; }
+
+    /**
+     * Start playback from the first record
+     * @param repeat Number of passes (0 = until stopped)
+     * @return false if there is no valid trajectory
+     */
+    bool start(uint32_t repeat = 1);
+
+    /**
+     * Stop feeding the queue, stop motion and clear the queue
+     */
+    void stop();
+
+    /**
+     * Feed the motion queue (call from loop)
+     */
+    void update();
+
+    TrajectoryState getState() const { return _state; }
+    static const char* stateName(TrajectoryState state);
+    bool isActive() const { return _state == TrajectoryState::PLAYING; }
+
+    uint32_t getIndex() const { return _index; }
+    uint32_t getPass() const { return _pass; }
+    uint32_t getRepeat() const { return _repeat; }
+
+    /**
+     * Streamed upload into the partition (erased sector by sector as
+     * data arrives). The trajectory is validated once complete. Safe to
+     * call from another task than playback.
+     * @param owner Opaque upload owner (the HTTP request)
+     */
+    bool beginUpload(const void* owner, size_t total);
+    bool writeUpload(const void* owner, const uint8_t* data, size_t len);
+    bool isUploadOwner(const void* owner) const { return owner && owner == _uploadOwner; }
+
+    // Reason the last upload call failed
+    const char* getUploadError() const { return _uploadError; }
+
+private:
+    const esp_partition_t* _partition;
+    SemaphoreHandle_t _lock;
+    spi_flash_mmap_handle_t _mapHandle;
+    const TrajectoryRecord* _records;   // Mapped flash, nullptr if invalid
+    uint32_t _recordCount;
+
+    TrajectoryState _state;
+    uint32_t _index;        // Next record to queue
+    uint32_t _pass;         // Current pass (1-based)
+    uint32_t _repeat;       // Passes to run, 0 = forever
+
+    const void* _uploadOwner;
+    size_t _uploadTotal;
+    size_t _uploadWritten;
+    size_t _erasedUntil;
+    const char* _uploadError;
+
+    bool map();
+    void unmap();
+};
+
+// Global trajectory player instance
+extern TrajectoryPlayer trajectoryPlayer;
+
+#endif // TRAJECTORY_H
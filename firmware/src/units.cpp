@@ -0,0 +1,41 @@
+#include "units.h"
+
+namespace Units {
+
+// Every joint's full range must convert within a long, and its factors
+// must keep one part in 2^24 of precision
+constexpr bool scalesFit(uint8_t joint) {
+    return joint >= MOTOR_COUNT ||
+           (JOINT_UNITS[joint].perMotorRev > 0 &&
+            stepsPerUnit(joint) * MAX_UNITS < 2147483647.0 &&
+            toQ24(stepsPerUnit(joint) / MILLI) > 1000 &&
+            toQ24(MILLI / stepsPerUnit(joint)) > 1000 &&
+            scalesFit(joint + 1));
+}
+static_assert(scalesFit(0), "JOINT_UNITS out of range for the fixed-point conversion");
+
+// One entry per possible joint, 0 past MOTOR_COUNT
+#define STEPS_PER_MILLI_Q24(joint) \
+    ((joint) < MOTOR_COUNT ? toQ24(stepsPerUnit(joint) / MILLI) : 0)
+#define MILLI_PER_STEP_Q24(joint) \
+    ((joint) < MOTOR_COUNT ? toQ24(MILLI / stepsPerUnit(joint)) : 0)
+
+const int64_t STEPS_PER_MILLI[MAX_JOINTS] = {
+    STEPS_PER_MILLI_Q24(0), STEPS_PER_MILLI_Q24(1), STEPS_PER_MILLI_Q24(2),
+    STEPS_PER_MILLI_Q24(3), STEPS_PER_MILLI_Q24(4), STEPS_PER_MILLI_Q24(5),
+    STEPS_PER_MILLI_Q24(6), STEPS_PER_MILLI_Q24(7),
+};
+
+const int64_t MILLI_PER_STEP[MAX_JOINTS] = {
+    MILLI_PER_STEP_Q24(0), MILLI_PER_STEP_Q24(1), MILLI_PER_STEP_Q24(2),
+    MILLI_PER_STEP_Q24(3), MILLI_PER_STEP_Q24(4), MILLI_PER_STEP_Q24(5),
+    MILLI_PER_STEP_Q24(6), MILLI_PER_STEP_Q24(7),
+};
+
+int format(int32_t milli, char* buffer, size_t size) {
+    uint32_t magnitude = milli < 0 ? 0u - (uint32_t)milli : (uint32_t)milli;
+    return snprintf(buffer, size, "%s%lu.%03lu", milli < 0 ? "-" : "",
+                    (unsigned long)(magnitude / MILLI), (unsigned long)(magnitude % MILLI));
+}
+
+}  // namespace Units
@@ -0,0 +1,72 @@
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Joint unit <-> step conversions (JOINT_UNITS in config.h)
+ *
+ * Joint-unit values are carried as fixed-point thousandths ("milli":
+ * 0.001 degree or 0.001 mm). Converting to or from steps is one 64-bit
+ * multiply and shift by a Q24 factor the compiler derives from JOINT_UNITS
+ * and MOTOR_CONFIGS, so the command path never touches the FPU or divides.
+ * Rounding the factors costs well under a step across POSITION_LIMITS.
+ */
+namespace Units {
+
+static const int32_t MILLI = 1000;       // Fixed-point values per unit
+static const int FRACTION_BITS = 24;     // Q24 conversion factors
+
+// Largest magnitude accepted, in units (keeps every product in range)
+static const int32_t MAX_UNITS = 100000;
+
+// Steps per degree/mm of a joint (compile-time only)
+constexpr double stepsPerUnit(uint8_t joint) {
+    return getFullRevolution(joint) / JOINT_UNITS[joint].perMotorRev;
+}
+
+// Round a positive factor to Q24
+constexpr int64_t toQ24(double value) {
+    return (int64_t)(value * (1LL << FRACTION_BITS) + 0.5);
+}
+
+// Per joint: Q24 steps per milli-unit, and milli-units per step
+extern const int64_t STEPS_PER_MILLI[MAX_JOINTS];
+extern const int64_t MILLI_PER_STEP[MAX_JOINTS];
+
+/**
+ * Milli-units to steps, rounded to the nearest step
+ */
+inline long toSteps(uint8_t joint, int32_t milli) {
+    return (long)(((int64_t)milli * STEPS_PER_MILLI[joint] +
+                   (1LL << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+}
+
+/**
+ * Steps to milli-units, rounded to the nearest thousandth
+ */
+inline int32_t fromSteps(uint8_t joint, long steps) {
+    return (int32_t)(((int64_t)steps * MILLI_PER_STEP[joint] +
+                      (1LL << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+}
+
+// Steps per unit, for reports
+inline float scale(uint8_t joint) {
+    return STEPS_PER_MILLI[joint] * (float)((double)MILLI / (1LL << FRACTION_BITS));
+}
+
+// "deg" or "mm"
+inline const char* name(uint8_t joint) {
+    return JOINT_UNITS[joint].unit == JointUnit::DEGREES ? "deg" : "mm";
+}
+
+/**
+ * Write a milli-unit value as a decimal ("-12.345")
+ * @return Characters written (snprintf semantics)
+ */
+int format(int32_t milli, char* buffer, size_t size);
+
+}  // namespace Units
+
+#endif // UNITS_H
@@ -1,54 +1,79 @@
 #include "web_server.h"
+#include "motion_task.h"
+#include "telemetry.h"
+#include "json_arena.h"
+#include "cartesian_planner.h"
+#include "units.h"
+#include "metrics.h"
+#include "trace.h"
+#include "encoder_monitor.h"
+#include "binary_protocol.h"
+#include "web_ui.h"
 
 // Global instance
 RoboarmWebServer webServer;
 
+// Documents built on the AsyncTCP task (HTTP handlers, WebSocket events),
+// on loop() (telemetry push) and on the motion task (deferred replies)
+// allocate from per-task static arenas
+static JsonArena<WEB_JSON_ARENA_SIZE> requestArena;
+static JsonArena<WEB_TELEMETRY_ARENA_SIZE> telemetryArena;
+static JsonArena<WEB_DEFERRED_ARENA_SIZE> deferredArena;
+
+static_assert((WS_DEFERRED_SLOTS & (WS_DEFERRED_SLOTS - 1)) == 0,
+              "WS_DEFERRED_SLOTS must be a power of two");
+static_assert(PROGRAM_NAME_MAX_LENGTH <= COMMAND_MAX_LENGTH,
+              "Program names are passed in DeferredRequest::command");
+
+static const char* const JOINT_KEYS[MAX_JOINTS] = { "j1", "j2", "j3", "j4", "j5", "j6", "j7", "j8" };
+static_assert(sizeof(JOINT_KEYS) / sizeof(JOINT_KEYS[0]) >= MOTOR_COUNT,
+              "JOINT_KEYS needs a key per motor");
+
 RoboarmWebServer::RoboarmWebServer(uint16_t port)
-    : _server(port), _connected(false) {
+    : _server(port), _ws("/ws"), _started(false), _linkUp(false), _lastLinkChange(0),
+      _telemetryIntervalMs(WS_TELEMETRY_INTERVAL_MS), _lastTelemetry(0),
+      _changeDriven(false), _report(ReportFormat::JSON), _wsHead(0), _wsTail(0) {
+    for (int i = 0; i < WEB_DEFERRED_SLOTS; i++) {
+        _deferred[i].state.store(DEFERRED_FREE);
+        _deferred[i].response = nullptr;
+        _deferred[i].waiter.store(nullptr);
+        _deferred[i].reply = nullptr;
+        _deferred[i].input = nullptr;
+    }
+    for (int i = 0; i < WS_DEFERRED_SLOTS; i++) {
+        _wsDeferred[i].state.store(DEFERRED_FREE);
+        _wsDeferred[i].response = nullptr;
+        _wsDeferred[i].waiter.store(nullptr);
+        _wsDeferred[i].reply = nullptr;
+        _wsDeferred[i].input = nullptr;
+    }
 }
 
 bool RoboarmWebServer::begin(const char* ssid, const char* password) {
-    DEBUG_PRINTLN("WebServer: Connecting to WiFi...");
-    DEBUG_PRINTF("  SSID: %s\n", ssid);
+    DEBUG_PRINTF("WebServer: Connecting to WiFi %s in the background\n", ssid);
 
+    // The station interface brings up the TCP/IP stack, so the server can
+    // listen before the link is up
     WiFi.mode(WIFI_STA);
     WiFi.setHostname(WIFI_HOSTNAME);
     WiFi.begin(ssid, password);
-
-    // Wait for connection with timeout
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(500);
-        DEBUG_PRINT(".");
-        attempts++;
-    }
-    DEBUG_PRINTLN();
-
-    if (WiFi.status() != WL_CONNECTED) {
-        DEBUG_PRINTLN("WebServer: WiFi connection FAILED");
-        _connected = false;
-        return false;
-    }
-
-    _connected = true;
-    DEBUG_PRINTLN("WebServer: WiFi connected!");
-    DEBUG_PRINTF("  IP Address: %s\n", WiFi.localIP().toString().c_str());
-    DEBUG_PRINTF("  Hostname: %s\n", WIFI_HOSTNAME);
+    _lastLinkChange = millis();
 
     // Setup routes and start server
     setupRoutes();
     _server.begin();
+    _started = true;
     DEBUG_PRINTLN("WebServer: HTTP server started");
 
     return true;
 }
 
 bool RoboarmWebServer::isConnected() const {
-    return _connected && WiFi.status() == WL_CONNECTED;
+    return _started && WiFi.status() == WL_CONNECTED;
 }
 
 String RoboarmWebServer::getIPAddress() const {
-    if (!_connected) {
+    if (!isConnected()) {
         return "Not connected";
     }
     return WiFi.localIP().toString();
@@ -57,18 +82,50 @@ String RoboarmWebServer::getIPAddress() const {
 void RoboarmWebServer::loop() {
     // ESPAsyncWebServer handles requests automatically
     // This method can be used for periodic tasks if needed
+    if (!_started) {
+        return;
+    }
+
+    // Also frees the slots of clients lost in a drop
+    sendWebSocketReplies();
 
-    // Reconnect WiFi if disconnected
-    if (_connected && WiFi.status() != WL_CONNECTED) {
-        DEBUG_PRINTLN("WebServer: WiFi disconnected, attempting reconnect...");
-        WiFi.reconnect();
+    // Follow the link; retry now and then while it is down
+    unsigned long now = millis();
+    bool linkUp = WiFi.status() == WL_CONNECTED;
+    if (linkUp != _linkUp) {
+        _linkUp = linkUp;
+        _lastLinkChange = now;
+        if (linkUp) {
+            DEBUG_PRINTF("WebServer: WiFi connected, IP %s (%s)\n",
+                         WiFi.localIP().toString().c_str(), WIFI_HOSTNAME);
+        } else {
+            DEBUG_PRINTLN("WebServer: WiFi disconnected");
+        }
+    }
+    if (!linkUp) {
+        if (now - _lastLinkChange >= WIFI_RECONNECT_INTERVAL_MS) {
+            DEBUG_PRINTLN("WebServer: WiFi still down, reconnecting...");
+            _lastLinkChange = now;
+            WiFi.reconnect();
+        }
+        return;
     }
+
+    // Push status frames (or change-driven reports) to WebSocket clients
+    if (_report.isEnabled()) {
+        sendReport();
+    } else if (_telemetryIntervalMs > 0 && now - _lastTelemetry >= _telemetryIntervalMs) {
+        _lastTelemetry = now;
+        sendTelemetry();
+    }
+
+    _ws.cleanupClients();
 }
 
 void RoboarmWebServer::setupRoutes() {
     // CORS headers for all responses
     DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
-    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, DELETE, OPTIONS");
     DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Content-Type");
 
     // Handle OPTIONS preflight requests
@@ -80,6 +137,13 @@ void RoboarmWebServer::setupRoutes() {
         }
     });
 
+    // WebSocket /ws - Streaming commands and telemetry
+    _ws.onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client,
+                       AwsEventType type, void* arg, uint8_t* data, size_t len) {
+        handleWebSocketEvent(client, type, arg, data, len);
+    });
+    _server.addHandler(&_ws);
+
     // GET /api/status - Get current status
     _server.on("/api/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleStatus(request);
@@ -94,12 +158,39 @@ void RoboarmWebServer::setupRoutes() {
         }
     );
 
-    // POST /api/move - Move joints (JSON)
+    // POST /api/move - Queue one move (JSON), straight to the motion queue
     _server.on("/api/move", HTTP_POST,
         [](AsyncWebServerRequest* request) {},
         nullptr,
         [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
-            handleMove(request, data, len);
+            const char* body = collectBody(request, data, len, index, total);
+            if (body) {
+                handleMove(request, body, total);
+            }
+        }
+    );
+
+    // POST /api/moves - Queue many moves (JSON array) all-or-nothing
+    _server.on("/api/moves", HTTP_POST,
+        [](AsyncWebServerRequest* request) {},
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            const char* body = collectBody(request, data, len, index, total);
+            if (body) {
+                handleMoves(request, body, total);
+            }
+        }
+    );
+
+    // POST /api/batch - Execute many commands atomically
+    _server.on("/api/batch", HTTP_POST,
+        [](AsyncWebServerRequest* request) {},
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            const char* body = collectBody(request, data, len, index, total);
+            if (body) {
+                executeBatch(request, body, total);
+            }
         }
     );
 
@@ -112,79 +203,110 @@ void RoboarmWebServer::setupRoutes() {
         }
     );
 
+    // GET /api/metrics - Instrumentation, Prometheus text format
+    _server.on("/api/metrics", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleMetrics(request);
+    });
+
+    // GET /api/trace - Download the motion trace (binary, see trace.h)
+    _server.on("/api/trace", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleTrace(request);
+    });
+
     // GET /api/config - Get configuration
     _server.on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleConfig(request);
     });
 
-    // GET / - Simple status page
+    // POST /api/config - Tune joint limits ({"motors": [{"joint": 1, ...}]})
+    _server.on("/api/config", HTTP_POST,
+        [](AsyncWebServerRequest* request) {},
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            const char* body = collectBody(request, data, len, index, total);
+            if (body) {
+                handleConfigUpdate(request, body, total);
+            }
+        }
+    );
+
+    // GET /api/programs - List stored programs
+    _server.on("/api/programs", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handlePrograms(request);
+    });
+
+    // POST /api/programs?name=X - Upload program, streamed to flash chunk by chunk
+    _server.on("/api/programs", HTTP_POST,
+        [this](AsyncWebServerRequest* request) {
+            // The body handler replies; an empty body never reaches it
+            if (request->contentLength() == 0) {
+                sendJsonError(request, 400, "Empty program");
+            }
+        },
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            handleProgramUpload(request, data, len, index, total);
+        }
+    );
+
+    // DELETE /api/programs?name=X - Delete program
+    _server.on("/api/programs", HTTP_DELETE, [this](AsyncWebServerRequest* request) {
+        handleProgramDelete(request);
+    });
+
+    // GET /api/trajectory - Stored trajectory info
+    _server.on("/api/trajectory", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleTrajectory(request);
+    });
+
+    // POST /api/trajectory - Upload compiled trajectory, written straight to flash
+    _server.on("/api/trajectory", HTTP_POST,
+        [this](AsyncWebServerRequest* request) {
+            if (request->contentLength() == 0) {
+                sendJsonError(request, 400, "Empty trajectory");
+            }
+        },
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            handleTrajectoryUpload(request, data, len, index, total);
+        }
+    );
+
+    // GET / - Web UI, gzipped in flash (web/index.html, see tools/embed_web_ui.py)
     _server.on("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        String html = R"rawhtml(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>Roboarm</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body { font-family: monospace; padding: 20px; background: #1a1a1a; color: #0f0; }
-        h1 { color: #0ff; }
-        pre { background: #000; padding: 10px; border: 1px solid #0f0; }
-        .btn { background: #0f0; color: #000; border: none; padding: 10px 20px; margin: 5px; cursor: pointer; }
-        .btn:hover { background: #0ff; }
-        input { background: #000; color: #0f0; border: 1px solid #0f0; padding: 5px; }
-    </style>
-</head>
-<body>
-    <h1>Roboarm Controller</h1>
-    <div>
-        <button class="btn" onclick="sendCmd('M17')">Enable</button>
-        <button class="btn" onclick="sendCmd('M18')">Disable</button>
-        <button class="btn" onclick="sendCmd('M112')">E-STOP</button>
-        <button class="btn" onclick="getStatus()">Status</button>
-    </div>
-    <div style="margin-top: 20px;">
-        <input type="text" id="cmd" placeholder="G0 J1:1000" style="width: 200px;">
-        <button class="btn" onclick="sendInput()">Send</button>
-    </div>
-    <pre id="output">Ready...</pre>
-    <script>
-        async function sendCmd(cmd) {
-            const res = await fetch("/api/command", {
-                method: "POST",
-                headers: {"Content-Type": "application/json"},
-                body: JSON.stringify({command: cmd})
-            });
-            const data = await res.json();
-            document.getElementById("output").textContent = JSON.stringify(data, null, 2);
-        }
-        async function getStatus() {
-            const res = await fetch("/api/status");
-            const data = await res.json();
-            document.getElementById("output").textContent = JSON.stringify(data, null, 2);
-        }
-        function sendInput() {
-            const cmd = document.getElementById("cmd").value;
-            if (cmd) sendCmd(cmd);
-        }
-        document.getElementById("cmd").addEventListener("keypress", (e) => {
-            if (e.key === "Enter") sendInput();
-        });
-    </script>
-</body>
-</html>
-)rawhtml";
-        request->send(200, "text/html", html);
+        handleIndex(request);
     });
 }
 
+void RoboarmWebServer::handleIndex(AsyncWebServerRequest* request) {
+    // The page only changes with the firmware; revalidate by ETag
+    if (request->hasHeader("If-None-Match") &&
+        request->getHeader("If-None-Match")->value() == WEB_UI_ETAG) {
+        AsyncWebServerResponse* response = request->beginResponse(304);
+        response->addHeader("ETag", WEB_UI_ETAG);
+        request->send(response);
+        return;
+    }
+
+    // Sent straight from flash, no RAM copy
+    AsyncWebServerResponse* response =
+        request->beginResponse_P(200, "text/html", WEB_UI_GZ, WEB_UI_GZ_LENGTH);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Cache-Control", WEB_UI_CACHE_CONTROL);
+    response->addHeader("ETag", WEB_UI_ETAG);
+    request->send(response);
+}
+
 void RoboarmWebServer::handleStatus(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    Metrics::Timer timer(Metrics::HTTP);
+    JsonDocument doc(&requestArena);
     buildStatusJson(doc);
     sendJsonResponse(request, 200, doc);
 }
 
 void RoboarmWebServer::handleCommand(AsyncWebServerRequest* request, uint8_t* data, size_t len) {
-    JsonDocument doc;
+    Metrics::Timer timer(Metrics::HTTP);
+    JsonDocument doc(&requestArena);
     DeserializationError error = deserializeJson(doc, data, len);
 
     if (error) {
@@ -197,54 +319,295 @@ void RoboarmWebServer::handleCommand(AsyncWebServerRequest* request, uint8_t* da
         sendJsonError(request, 400, "Missing 'command' field");
         return;
     }
+    if (strlen(command) > COMMAND_MAX_LENGTH) {
+        sendJsonError(request, 400, "Command too long");
+        return;
+    }
 
-    CommandResult result = commandParser.execute(String(command));
+    DeferredRequest* slot = claimDeferred(request, DEFERRED_COMMAND);
+    if (!slot) {
+        return;
+    }
+    strcpy(slot->command, command);
+    postDeferred(request, slot);
+}
 
-    JsonDocument response;
-    response["success"] = result.success;
-    response["message"] = result.message;
+/**
+ * Fill a MoveRequest from {"j1": 1000, ..., "units", "relative",
+ * "coordinated", "speed", "accel"}. With "units": "joint" the positions are
+ * degrees/mm (JOINT_UNITS); speed and accel stay in steps.
+ * @return nullptr on success, otherwise the error message
+ */
+static const char* parseMove(JsonVariantConst json, bool defaultCoordinated, MoveRequest& move) {
+    if (!json.is<JsonObjectConst>()) {
+        return "Move must be a JSON object";
+    }
+
+    const char* units = json["units"] | "steps";
+    bool jointUnits = strcmp(units, "joint") == 0;
+    if (!jointUnits && strcmp(units, "steps") != 0) {
+        return "'units' must be \"steps\" or \"joint\"";
+    }
+
+    move.jointMask = 0;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        JsonVariantConst value = json[JOINT_KEYS[i]];
+        if (value.isNull()) {
+            continue;
+        }
+        if (jointUnits) {
+            float position = value | NAN;
+            if (!(fabsf(position) <= Units::MAX_UNITS)) {
+                return "Joint positions must be numbers within range";
+            }
+            move.positions[i] = Units::toSteps(i, lroundf(position * Units::MILLI));
+        } else if (value.is<long>()) {
+            move.positions[i] = value.as<long>();
+        } else {
+            return "Joint positions must be integers";
+        }
+        move.jointMask |= 1 << i;
+    }
+    if (!move.jointMask) {
+        return "No joint positions specified. Use j1, j2, ...";
+    }
 
-    sendJsonResponse(request, result.success ? 200 : 400, response);
+    JsonVariantConst speed = json["speed"];
+    JsonVariantConst accel = json["accel"];
+    if ((!speed.isNull() && !speed.is<uint32_t>()) ||
+        (!accel.isNull() && !accel.is<uint32_t>())) {
+        return "'speed' and 'accel' must be non-negative integers";
+    }
+
+    move.relative = json["relative"] | false;
+    move.coordinated = json["coordinated"] | defaultCoordinated;
+    move.speedHz = speed | 0u;
+    move.accel = accel | 0u;
+    return nullptr;
 }
 
-void RoboarmWebServer::handleMove(AsyncWebServerRequest* request, uint8_t* data, size_t len) {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, data, len);
+void RoboarmWebServer::handleMove(AsyncWebServerRequest* request, const char* body, size_t len) {
+    Metrics::Timer timer(Metrics::HTTP);
+    JsonDocument doc(&requestArena);
+    DeserializationError error = deserializeJson(doc, body, len);
 
     if (error) {
         sendJsonError(request, 400, "Invalid JSON");
         return;
     }
 
-    // Build G0 command from JSON
-    String command = "G0";
-    bool hasJoint = false;
+    MoveRequest move;
+    const char* invalid = parseMove(doc, telemetry.get().coordinated, move);
+    if (invalid) {
+        sendJsonError(request, 400, invalid);
+        return;
+    }
+
+    DeferredRequest* slot = claimDeferred(request, DEFERRED_MOVE);
+    if (!slot) {
+        return;
+    }
+    slot->move = move;
+    postDeferred(request, slot);
+}
+
+void RoboarmWebServer::handleMoves(AsyncWebServerRequest* request, const char* body, size_t len) {
+    Metrics::Timer timer(Metrics::HTTP);
+    // A batch can never exceed the queue, so that bounds the scratch array.
+    // AsyncTCP runs all handlers on one task, so static scratch is safe.
+    static MoveRequest moves[MOTION_QUEUE_SIZE];
+    size_t count = 0;
+
+    JsonDocument doc(&requestArena);
+    if (deserializeJson(doc, body, len)) {
+        sendJsonError(request, 400, "Invalid JSON");
+        return;
+    }
+
+    JsonArrayConst array = doc.is<JsonArrayConst>() ? doc.as<JsonArrayConst>()
+                                                    : doc["moves"].as<JsonArrayConst>();
+    if (array.isNull() || array.size() == 0) {
+        sendJsonError(request, 400, "Missing 'moves' array");
+        return;
+    }
+    if (array.size() > MOTION_QUEUE_SIZE) {
+        sendJsonError(request, 413, "Too many moves");
+        return;
+    }
 
-    for (int i = 1; i <= MOTOR_COUNT; i++) {
-        String key = "j" + String(i);
-        if (doc[key].is<long>()) {
-            command += " J" + String(i) + ":" + String(doc[key].as<long>());
-            hasJoint = true;
+    bool defaultCoordinated = telemetry.get().coordinated;
+    for (JsonVariantConst item : array) {
+        const char* invalid = parseMove(item, defaultCoordinated, moves[count]);
+        if (invalid) {
+            char message[96];
+            snprintf(message, sizeof(message), "Move %u: %s", (unsigned)count, invalid);
+            sendJsonError(request, 400, message);
+            return;
         }
+        count++;
     }
 
-    if (!hasJoint) {
-        sendJsonError(request, 400, "No joint positions specified. Use j1, j2, ..., j6");
+    // All moves must fit, or none are queued (same rules as /api/batch)
+    DeferredRequest* slot = claimDeferred(request, DEFERRED_MOVES);
+    if (!slot || !attachInput(request, slot, malloc(count * sizeof(MoveRequest)))) {
         return;
     }
+    memcpy(slot->input, moves, count * sizeof(MoveRequest));
+    slot->count = count;
+    postDeferred(request, slot);
+}
+
+const char* RoboarmWebServer::collectBody(AsyncWebServerRequest* request, uint8_t* data,
+                                          size_t len, size_t index, size_t total) {
+    if (total > BATCH_MAX_BODY_SIZE) {
+        if (index == 0) {
+            sendJsonError(request, 413, "Request body too large");
+        }
+        return nullptr;
+    }
 
-    CommandResult result = commandParser.execute(command);
+    // Single chunk - no need to copy
+    if (index == 0 && len == total) {
+        return (const char*)data;
+    }
 
-    JsonDocument response;
-    response["success"] = result.success;
-    response["message"] = result.message;
-    response["command"] = command;
+    // Accumulate chunks; the request frees _tempObject when it is destroyed
+    if (index == 0) {
+        request->_tempObject = malloc(total);
+        if (!request->_tempObject) {
+            sendJsonError(request, 500, "Out of memory");
+            return nullptr;
+        }
+    }
+    if (!request->_tempObject) {
+        return nullptr;
+    }
 
-    sendJsonResponse(request, result.success ? 200 : 400, response);
+    memcpy((uint8_t*)request->_tempObject + index, data, len);
+    return index + len == total ? (const char*)request->_tempObject : nullptr;
+}
+
+// Command spans of a batch or WebSocket message. AsyncTCP runs all
+// handlers on one task, so static scratch is safe and keeps 3 KB off its
+// stack.
+static const size_t MAX_COMMANDS = 256;
+static const char* commandSpans[MAX_COMMANDS];
+static size_t commandLengths[MAX_COMMANDS];
+
+/**
+ * Split newline-separated commands into commandSpans (blank lines skipped)
+ * @return the number of commands, -1 if there are more than MAX_COMMANDS
+ */
+static int splitCommands(const char* text, size_t len) {
+    size_t count = 0;
+    size_t start = 0;
+    while (start < len) {
+        size_t end = start;
+        while (end < len && text[end] != '\n' && text[end] != '\r') {
+            end++;
+        }
+        if (end > start) {
+            if (count == MAX_COMMANDS) {
+                return -1;
+            }
+            commandSpans[count] = text + start;
+            commandLengths[count] = end - start;
+            count++;
+        }
+        start = end + 1;
+    }
+    return count;
+}
+
+/**
+ * Copy the first `count` spans into one heap block of NUL-terminated
+ * strings, so they outlive the request body
+ * @return the block (nullptr if out of memory, or for no commands)
+ */
+static char* packCommands(size_t count) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += commandLengths[i] + 1;
+    }
+    char* packed = size ? (char*)malloc(size) : nullptr;
+    if (!packed) {
+        return nullptr;
+    }
+
+    char* out = packed;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(out, commandSpans[i], commandLengths[i]);
+        out[commandLengths[i]] = '\0';
+        out += commandLengths[i] + 1;
+    }
+    return packed;
+}
+
+void RoboarmWebServer::executeBatch(AsyncWebServerRequest* request, const char* body, size_t len) {
+    Metrics::Timer timer(Metrics::HTTP);
+
+    // Collect command spans: JSON {"commands": [...]} / [...] or G-code lines
+    int count = 0;
+    JsonDocument doc(&requestArena);
+    size_t start = 0;
+    while (start < len && isspace((unsigned char)body[start])) {
+        start++;
+    }
+
+    if (start < len && (body[start] == '{' || body[start] == '[')) {
+        if (deserializeJson(doc, body, len)) {
+            sendJsonError(request, 400, "Invalid JSON");
+            return;
+        }
+        JsonArray array = doc.is<JsonArray>() ? doc.as<JsonArray>()
+                                              : doc["commands"].as<JsonArray>();
+        if (array.isNull()) {
+            sendJsonError(request, 400, "Missing 'commands' array");
+            return;
+        }
+        for (JsonVariant item : array) {
+            const char* command = item.as<const char*>();
+            if (!command) {
+                sendJsonError(request, 400, "Commands must be strings");
+                return;
+            }
+            if ((size_t)count == MAX_COMMANDS) {
+                sendJsonError(request, 413, "Too many commands");
+                return;
+            }
+            commandSpans[count] = command;
+            commandLengths[count] = strlen(command);
+            count++;
+        }
+    } else {
+        count = splitCommands(body + start, len - start);
+        if (count < 0) {
+            sendJsonError(request, 413, "Too many commands");
+            return;
+        }
+    }
+
+    // All moves must fit, or none are queued
+    size_t moves = 0;
+    for (int i = 0; i < count; i++) {
+        if (CommandParser::isQueuedMove(commandSpans[i], commandLengths[i])) {
+            moves++;
+        }
+    }
+
+    // The body goes away with the request, so the commands travel as a copy
+    DeferredRequest* slot = claimDeferred(request, DEFERRED_BATCH);
+    if (!slot || (count && !attachInput(request, slot, packCommands(count)))) {
+        return;
+    }
+    slot->count = count;
+    slot->moves = moves;
+    postDeferred(request, slot);
 }
 
 void RoboarmWebServer::handleEnable(AsyncWebServerRequest* request, uint8_t* data, size_t len) {
-    JsonDocument doc;
+    Metrics::Timer timer(Metrics::HTTP);
+    JsonDocument doc(&requestArena);
     DeserializationError error = deserializeJson(doc, data, len);
 
     if (error) {
@@ -252,64 +615,1107 @@ void RoboarmWebServer::handleEnable(AsyncWebServerRequest* request, uint8_t* dat
         return;
     }
 
-    bool enabled = doc["enabled"] | false;
-    motors.setEnabled(enabled);
+    DeferredRequest* slot = claimDeferred(request, DEFERRED_ENABLE);
+    if (!slot) {
+        return;
+    }
+    slot->enable = doc["enabled"] | false;
+    postDeferred(request, slot);
+}
+
+static const char OUT_OF_MEMORY[] = "{\"success\":false,\"error\":\"Out of memory\"}";
+
+/**
+ * Response to a deferred request
+ *
+ * Handed to request->send() as soon as the request is posted, but the
+ * status line and body are held back until the motion task has filled in
+ * the slot. _respond() waits up to WEB_DEFERRED_WAIT_MS for that - the
+ * motion task is woken by the post and usually answers well within it -
+ * and sends the reply right away. A reply that takes longer goes out from
+ * the first _ack() after it is DONE, at worst on the connection's next
+ * TCP poll (every 500 ms). Everything here runs on the AsyncTCP task.
+ */
+class RoboarmWebServer::DeferredResponse : public AsyncAbstractResponse {
+public:
+    explicit DeferredResponse(DeferredRequest* slot)
+        : _slot(slot), _body(nullptr), _offset(0) {
+        _contentType = "application/json";
+        slot->response = this;
+    }
+
+    ~DeferredResponse() override {
+        if (_slot) {
+            // Client gone before the reply was ready
+            _slot->response = nullptr;
+            if (_slot->state.load(std::memory_order_acquire) == DEFERRED_DONE) {
+                releaseDeferred(_slot);
+            }
+        }
+        free(_body);
+    }
+
+    bool _sourceValid() const override { return true; }
+
+    void _respond(AsyncWebServerRequest* request) override {
+        waitForReply();
+        _ack(request, 0, 0);
+    }
+
+    size_t _ack(AsyncWebServerRequest* request, size_t len, uint32_t time) override {
+        if (_state == RESPONSE_SETUP) {
+            if (_slot->state.load(std::memory_order_acquire) != DEFERRED_DONE) {
+                return 0;  // Motion task not done yet
+            }
+            takeReply();
+            AsyncAbstractResponse::_respond(request);
+            return 0;
+        }
+        return AsyncAbstractResponse::_ack(request, len, time);
+    }
+
+    size_t _fillBuffer(uint8_t* buffer, size_t maxLen) override {
+        const char* body = _body ? _body : OUT_OF_MEMORY;
+        size_t length = _contentLength - _offset;
+        if (length > maxLen) {
+            length = maxLen;
+        }
+        memcpy(buffer, body + _offset, length);
+        _offset += length;
+        return length;
+    }
+
+private:
+    DeferredRequest* _slot;     // nullptr once the reply is taken
+    char* _body;
+    size_t _offset;
+
+    void waitForReply() {
+        // finishDeferred() notifies the waiter once the slot is DONE; a
+        // notification left over from an earlier slot only costs a recheck
+        uint32_t start = millis();
+        _slot->waiter.store(xTaskGetCurrentTaskHandle());
+        while (_slot->state.load() != DEFERRED_DONE) {
+            uint32_t waited = millis() - start;
+            if (waited >= WEB_DEFERRED_WAIT_MS) {
+                break;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WEB_DEFERRED_WAIT_MS - waited));
+        }
+        _slot->waiter.store(nullptr);
+    }
+
+    void takeReply() {
+        _body = _slot->reply;
+        _slot->reply = nullptr;
+        setCode(_body ? _slot->code : 500);
+        _contentLength = _body ? _slot->replyLength : strlen(OUT_OF_MEMORY);
+        metrics.countHttpResponse(_code);
+        metrics.recordMicros(Metrics::WEB_DEFERRED, micros() - _slot->startUs);
+
+        _slot->response = nullptr;
+        releaseDeferred(_slot);
+        _slot = nullptr;
+    }
+};
+
+RoboarmWebServer::DeferredRequest* RoboarmWebServer::claimDeferred(AsyncWebServerRequest* request,
+                                                                   DeferredKind kind) {
+    // Only this task claims and releases slots (the motion task just marks
+    // them DONE), so a FREE slot stays free until it is posted
+    DeferredRequest* slot = nullptr;
+    for (int i = 0; i < WEB_DEFERRED_SLOTS; i++) {
+        DeferredRequest& candidate = _deferred[i];
+        uint8_t state = candidate.state.load(std::memory_order_acquire);
+        if (state == DEFERRED_DONE && !candidate.response) {
+            releaseDeferred(&candidate);  // Its client went away
+            state = DEFERRED_FREE;
+        }
+        if (state == DEFERRED_FREE && !slot) {
+            slot = &candidate;
+        }
+    }
+    if (!slot) {
+        sendJsonError(request, 503, "Busy - too many requests in flight, retry");
+        return nullptr;
+    }
+
+    slot->kind = kind;
+    slot->startUs = micros();
+    slot->input = nullptr;
+    slot->count = 0;
+    slot->moves = 0;
+    return slot;
+}
+
+bool RoboarmWebServer::attachInput(AsyncWebServerRequest* request, DeferredRequest* slot,
+                                   void* input) {
+    if (!input) {
+        releaseDeferred(slot);
+        sendJsonError(request, 500, "Out of memory");
+        return false;
+    }
+    slot->input = input;
+    return true;
+}
+
+void RoboarmWebServer::postDeferred(AsyncWebServerRequest* request, DeferredRequest* slot) {
+    slot->state.store(DEFERRED_QUEUED, std::memory_order_release);
+    if (!motionTask.post(MotionTask::CHANNEL_WEB, &executeDeferred, slot)) {
+        // Channel queue full (WebSocket and batch requests share it)
+        releaseDeferred(slot);
+        sendJsonError(request, 503, "Busy - motion task queue full, retry");
+        return;
+    }
+    request->send(new DeferredResponse(slot));
+}
+
+void RoboarmWebServer::executeDeferred(void* context) {
+    // Motion task
+    DeferredRequest* slot = static_cast<DeferredRequest*>(context);
+    JsonDocument response(&deferredArena);
+    int code = 200;
+    switch (slot->kind) {
+        case DEFERRED_COMMAND:
+        case DEFERRED_MOVE:
+        case DEFERRED_ENABLE:
+            code = runCommand(slot, response);
+            break;
+        case DEFERRED_MOVES:          code = runMoves(slot, response); break;
+        case DEFERRED_BATCH:          code = runBatch(slot, response); break;
+        case DEFERRED_CONFIG:         code = runConfig(slot, response); break;
+        case DEFERRED_PROGRAM_DELETE: code = runProgramDelete(slot, response); break;
+        case DEFERRED_WS_COMMANDS:    code = runWebSocketCommands(slot, response); break;
+        case DEFERRED_WS_JOG:         code = runWebSocketJog(slot, response); break;
+    }
+    finishDeferred(slot, code, response);
+}
 
-    JsonDocument response;
-    response["success"] = true;
-    response["enabled"] = motors.isEnabled();
+int RoboarmWebServer::runCommand(DeferredRequest* slot, JsonDocument& response) {
+    CommandResult result = CommandResult::ok();
+    switch (slot->kind) {
+        case DEFERRED_COMMAND:
+            result = commandParser.execute(slot->command);
+            break;
 
-    sendJsonResponse(request, 200, response);
+        case DEFERRED_MOVE:
+            result = CommandParser::queueMove(slot->move);
+            break;
+
+        default:
+            motors.setEnabled(slot->enable);
+            break;
+    }
+
+    response["success"] = result.success;
+    if (slot->kind == DEFERRED_ENABLE) {
+        response["enabled"] = motors.isEnabled();
+    } else {
+        response["message"] = result.message;
+        response["queue_free"] = motors.getQueueFree();
+    }
+    return resultStatusCode(result);
+}
+
+int RoboarmWebServer::runMoves(DeferredRequest* slot, JsonDocument& response) {
+    const MoveRequest* moves = static_cast<const MoveRequest*>(slot->input);
+    const char* busy = CommandParser::moveBusyReason();
+    bool fits = slot->count <= motors.getQueueFree() && !busy;
+    int failed = -1;
+    if (fits) {
+        motors.beginBatch();
+        for (size_t i = 0; i < slot->count; i++) {
+            if (!motors.queueMove(moves[i])) {
+                failed = i;
+                break;
+            }
+        }
+
+        if (failed < 0) {
+            motors.commitBatch();
+        } else {
+            motors.abortBatch();
+        }
+    }
+
+    response["success"] = fits && failed < 0;
+    response["queue_free"] = motors.getQueueFree();
+    if (!fits) {
+        response["error"] = busy ? busy : "Queue full";
+        return 503;
+    }
+    if (failed >= 0) {
+        response["error"] = "Move failed - check limits or enable motors";
+        response["index"] = failed;
+        return 400;
+    }
+    response["queued"] = slot->count;
+    return 200;
+}
+
+int RoboarmWebServer::runBatch(DeferredRequest* slot, JsonDocument& response) {
+    // The whole batch runs as one motion task request, so nothing else can
+    // queue moves between the capacity check and the commit
+    if (slot->moves > motors.getQueueFree()) {
+        response["success"] = false;
+        response["error"] = "Queue full";
+        response["queue_free"] = motors.getQueueFree();
+        return 503;
+    }
+
+    JsonArray results = response["results"].to<JsonArray>();
+    bool success = true;
+    const char* command = static_cast<const char*>(slot->input);
+    motors.beginBatch();
+    for (size_t i = 0; i < slot->count; i++) {
+        CommandResult result = commandParser.execute(command);
+        results.add(result.message);
+        if (!result.success) {
+            success = false;
+            break;  // Stop at the first failure
+        }
+        command += strlen(command) + 1;
+    }
+
+    if (success) {
+        motors.commitBatch();
+    } else {
+        motors.abortBatch();  // Discard moves queued by this batch
+    }
+
+    response["success"] = success;
+    response["queued"] = success ? slot->moves : 0;
+    response["queue_free"] = motors.getQueueFree();
+    return success ? 200 : 400;
+}
+
+int RoboarmWebServer::runProgramDelete(DeferredRequest* slot, JsonDocument& response) {
+    // On the motion task, so M24 cannot open the file meanwhile
+    const char* name = slot->command;
+    bool running = programPlayer.isActive() && strcmp(name, programPlayer.getName()) == 0;
+    bool removed = !running && programStore.remove(name);
+
+    response["success"] = removed;
+    if (running) {
+        response["error"] = "Program running";
+        return 409;
+    }
+    if (!removed) {
+        response["error"] = "Program not found";
+        return 404;
+    }
+    response["message"] = "Program deleted";
+    return 200;
+}
+
+int RoboarmWebServer::runWebSocketCommands(DeferredRequest* slot, JsonDocument& response) {
+    // One or more newline-separated commands, executed in order
+    response["type"] = "result";
+    JsonArray results = response["results"].to<JsonArray>();
+
+    const char* command = static_cast<const char*>(slot->input);
+    for (size_t i = 0; i < slot->count; i++) {
+        CommandResult result = commandParser.execute(command);
+        JsonObject entry = results.add<JsonObject>();
+        entry["success"] = result.success;
+        entry["message"] = result.message;
+        if (result.busy) {
+            entry["busy"] = true;
+        }
+        command += strlen(command) + 1;
+    }
+
+    response["queue_free"] = motors.getQueueFree();
+    return 200;
+}
+
+int RoboarmWebServer::runWebSocketJog(DeferredRequest* slot, JsonDocument& response) {
+    const char* error = nullptr;
+    if (programPlayer.isActive() || trajectoryPlayer.isActive()) {
+        error = "Program running - cannot jog";
+    } else if (!motors.jog(slot->speeds)) {
+        error = motors.isEnabled() ? "Moves in progress - cannot jog"
+                                   : "Motors disabled - enable with M17";
+    }
+
+    response["type"] = "jog";
+    response["success"] = error == nullptr;
+    if (error) {
+        response["error"] = error;
+    }
+    return error ? 400 : 200;
+}
+
+void RoboarmWebServer::buildWebSocketError(DeferredKind kind, size_t count, const char* message,
+                                           bool busy, JsonDocument& doc) {
+    // Shaped like the reply the message would have had
+    if (kind == DEFERRED_WS_JOG) {
+        doc["type"] = "jog";
+        doc["success"] = false;
+        doc["error"] = message;
+        return;
+    }
+
+    doc["type"] = "result";
+    JsonArray results = doc["results"].to<JsonArray>();
+    for (size_t i = 0; i < count; i++) {
+        JsonObject entry = results.add<JsonObject>();
+        entry["success"] = false;
+        entry["message"] = message;
+        if (busy) {
+            entry["busy"] = true;
+        }
+    }
+    doc["queue_free"] = telemetry.get().queueFree;
+}
+
+RoboarmWebServer::DeferredRequest* RoboarmWebServer::claimWebSocket(AsyncWebSocketClient* client,
+                                                                    DeferredKind kind,
+                                                                    size_t count) {
+    uint32_t head = _wsHead.load(std::memory_order_acquire);
+    uint32_t tail = _wsTail.load(std::memory_order_relaxed);
+    if (tail - head == WS_DEFERRED_SLOTS) {
+        // Busy can be answered right away only if it cannot overtake
+        // replies to this client's earlier messages
+        for (uint32_t i = head; i != tail; i++) {
+            if (_wsDeferred[i & (WS_DEFERRED_SLOTS - 1)].client == client->id()) {
+                client->close(1013, "Too many messages in flight");
+                return nullptr;
+            }
+        }
+        JsonDocument doc(&requestArena);
+        buildWebSocketError(kind, count, "error: Busy - too many messages in flight, retry",
+                            true, doc);
+        sendWebSocketJson(client, doc);
+        return nullptr;
+    }
+
+    DeferredRequest* slot = &_wsDeferred[tail & (WS_DEFERRED_SLOTS - 1)];
+    slot->kind = kind;
+    slot->client = client->id();
+    slot->startUs = micros();
+    slot->input = nullptr;
+    slot->count = count;
+    return slot;
+}
+
+void RoboarmWebServer::postWebSocket(DeferredRequest* slot) {
+    slot->state.store(DEFERRED_QUEUED, std::memory_order_release);
+
+    // Failures are replied through the ring too, to keep the order
+    const char* error = nullptr;
+    bool busy = false;
+    if (slot->count && !slot->input) {
+        error = "error: Out of memory";
+    } else if (!motionTask.post(MotionTask::CHANNEL_WEB, &executeDeferred, slot)) {
+        error = "error: Busy - motion task queue full, retry";
+        busy = true;
+    }
+    if (error) {
+        JsonDocument doc(&requestArena);
+        buildWebSocketError(slot->kind, slot->count, error, busy, doc);
+        finishDeferred(slot, 503, doc);
+    }
+
+    _wsTail.store(_wsTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void RoboarmWebServer::sendWebSocketReplies() {
+    static const char OUT_OF_MEMORY_RESULT[] = "{\"type\":\"result\",\"results\":[]}";
+
+    uint32_t head = _wsHead.load(std::memory_order_relaxed);
+    while (head != _wsTail.load(std::memory_order_acquire)) {
+        DeferredRequest& slot = _wsDeferred[head & (WS_DEFERRED_SLOTS - 1)];
+        if (slot.state.load(std::memory_order_acquire) != DEFERRED_DONE) {
+            break;  // Later replies wait for this one
+        }
+
+        // Sent from loop() like the status frames (see DeferredRequest);
+        // a client that has gone is skipped by the library
+        if (slot.reply) {
+            _ws.text(slot.client, slot.reply, slot.replyLength);
+        } else {
+            _ws.text(slot.client, OUT_OF_MEMORY_RESULT, strlen(OUT_OF_MEMORY_RESULT));
+        }
+        metrics.recordMicros(Metrics::WS_DEFERRED, micros() - slot.startUs);
+        releaseDeferred(&slot);
+        _wsHead.store(++head, std::memory_order_release);
+    }
+}
+
+void RoboarmWebServer::finishDeferred(DeferredRequest* slot, int code, const JsonDocument& doc) {
+    size_t length = measureJson(doc);
+    slot->code = code;
+    slot->reply = (char*)malloc(length + 1);
+    slot->replyLength = length;
+    if (slot->reply) {
+        serializeJson(doc, slot->reply, length + 1);
+    }
+    slot->state.store(DEFERRED_DONE);
+
+    // Wake a DeferredResponse waiting for the reply
+    TaskHandle_t waiter = slot->waiter.exchange(nullptr);
+    if (waiter) {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+void RoboarmWebServer::releaseDeferred(DeferredRequest* slot) {
+    free(slot->reply);
+    free(slot->input);
+    slot->reply = nullptr;
+    slot->input = nullptr;
+    slot->state.store(DEFERRED_FREE, std::memory_order_release);
 }
 
 void RoboarmWebServer::handleConfig(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    JsonDocument doc(&requestArena);
     buildConfigJson(doc);
     sendJsonResponse(request, 200, doc);
 }
 
+/**
+ * One {"joint": n, "max_speed", "acceleration", "jerk", "limit_min",
+ * "limit_max"} entry of POST /api/config: the fields given, applied over
+ * the joint's current settings on the motion task
+ */
+struct SettingsPatch {
+    uint8_t joint;          // 0-based
+    uint8_t fields;         // SETTINGS_* bits present
+    JointSettings values;
+};
+
+enum : uint8_t {
+    SETTINGS_MAX_SPEED = 1 << 0,
+    SETTINGS_ACCELERATION = 1 << 1,
+    SETTINGS_JERK = 1 << 2,
+    SETTINGS_LIMIT_MIN = 1 << 3,
+    SETTINGS_LIMIT_MAX = 1 << 4
+};
+
+/**
+ * Check the field types of one entry and fill in its patch
+ * @return nullptr on success, otherwise the error message
+ */
+static const char* parseJointSettings(JsonVariantConst json, SettingsPatch& patch) {
+    int joint = json["joint"] | 0;
+    if (joint < 1 || joint > MOTOR_COUNT) {
+        return "'joint' must be a joint number (1-based)";
+    }
+
+    static const char* const UNSIGNED_KEYS[] = { "max_speed", "acceleration", "jerk" };
+    static const char* const SIGNED_KEYS[] = { "limit_min", "limit_max" };
+    for (const char* key : UNSIGNED_KEYS) {
+        if (!json[key].isNull() && !json[key].is<uint32_t>()) {
+            return "'max_speed', 'acceleration' and 'jerk' must be non-negative integers";
+        }
+    }
+    for (const char* key : SIGNED_KEYS) {
+        if (!json[key].isNull() && !json[key].is<int32_t>()) {
+            return "'limit_min' and 'limit_max' must be integers";
+        }
+    }
+
+    patch.joint = joint - 1;
+    patch.fields = (json["max_speed"].isNull() ? 0 : SETTINGS_MAX_SPEED) |
+                   (json["acceleration"].isNull() ? 0 : SETTINGS_ACCELERATION) |
+                   (json["jerk"].isNull() ? 0 : SETTINGS_JERK) |
+                   (json["limit_min"].isNull() ? 0 : SETTINGS_LIMIT_MIN) |
+                   (json["limit_max"].isNull() ? 0 : SETTINGS_LIMIT_MAX);
+    patch.values.maxSpeedHz = json["max_speed"] | 0u;
+    patch.values.acceleration = json["acceleration"] | 0u;
+    patch.values.jerk = json["jerk"] | 0u;
+    patch.values.limitMin = json["limit_min"] | 0;
+    patch.values.limitMax = json["limit_max"] | 0;
+    return nullptr;
+}
+
+/**
+ * Apply a patch to settings[patch.joint]
+ * @return nullptr on success, otherwise the error message
+ */
+static const char* applyJointSettings(const SettingsPatch& patch,
+                                      JointSettings settings[MOTOR_COUNT]) {
+    JointSettings& s = settings[patch.joint];
+    if (patch.fields & SETTINGS_MAX_SPEED) s.maxSpeedHz = patch.values.maxSpeedHz;
+    if (patch.fields & SETTINGS_ACCELERATION) s.acceleration = patch.values.acceleration;
+    if (patch.fields & SETTINGS_JERK) s.jerk = patch.values.jerk;
+    if (patch.fields & SETTINGS_LIMIT_MIN) s.limitMin = patch.values.limitMin;
+    if (patch.fields & SETTINGS_LIMIT_MAX) s.limitMax = patch.values.limitMax;
+    if (!MotorController::isValidSettings(s)) {
+        return "Out of range: max_speed must be 1 up to the safety limit, "
+               "acceleration > 0 and limit_min < limit_max";
+    }
+    return nullptr;
+}
+
+void RoboarmWebServer::handleConfigUpdate(AsyncWebServerRequest* request, const char* body, size_t len) {
+    Metrics::Timer timer(Metrics::HTTP);
+    JsonDocument doc(&requestArena);
+    if (deserializeJson(doc, body, len)) {
+        sendJsonError(request, 400, "Invalid JSON");
+        return;
+    }
+
+    JsonArrayConst array = doc["motors"].as<JsonArrayConst>();
+    bool save = doc["save"] | false;
+    bool reset = doc["reset"] | false;
+    if (array.isNull() && !save && !reset) {
+        sendJsonError(request, 400, "Missing 'motors' array (or 'save'/'reset')");
+        return;
+    }
+
+    size_t count = array.size();
+    DeferredRequest* slot = claimDeferred(request, DEFERRED_CONFIG);
+    if (!slot || (count && !attachInput(request, slot, malloc(count * sizeof(SettingsPatch))))) {
+        return;
+    }
+
+    SettingsPatch* patches = static_cast<SettingsPatch*>(slot->input);
+    for (size_t i = 0; i < count; i++) {
+        const char* invalid = parseJointSettings(array[i], patches[i]);
+        if (invalid) {
+            releaseDeferred(slot);
+            char message[128];
+            snprintf(message, sizeof(message), "Motor %u: %s", (unsigned)i, invalid);
+            sendJsonError(request, 400, message);
+            return;
+        }
+    }
+    slot->count = count;
+    slot->enable = save;
+    slot->reset = reset;
+    postDeferred(request, slot);
+}
+
+int RoboarmWebServer::runConfig(DeferredRequest* slot, JsonDocument& response) {
+    // Validated against the current values (or the defaults being reset
+    // to), then applied all-or-nothing
+    JointSettings settings[MOTOR_COUNT];
+    bool changed[MOTOR_COUNT] = { false };
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        settings[i] = slot->reset ? MotorController::getDefaultSettings(i) : motors.getSettings(i);
+    }
+    const SettingsPatch* patches = static_cast<const SettingsPatch*>(slot->input);
+    for (size_t i = 0; i < slot->count; i++) {
+        const char* invalid = applyJointSettings(patches[i], settings);
+        if (invalid) {
+            char message[128];
+            snprintf(message, sizeof(message), "Motor %u: %s", (unsigned)i, invalid);
+            response["success"] = false;
+            response["error"] = message;
+            return 400;
+        }
+        changed[patches[i].joint] = true;
+    }
+    if (slot->reset) {
+        motors.resetSettings();
+    }
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (changed[i]) {
+            motors.setSettings(i, settings[i]);
+        }
+    }
+
+    CommandResult result = slot->enable ? commandParser.execute("M500") : CommandResult::ok();
+    webServer.buildConfigJson(response);
+    response["success"] = result.success;
+    response["message"] = result.message;
+    return resultStatusCode(result);
+}
+
+void RoboarmWebServer::handleMetrics(AsyncWebServerRequest* request) {
+    // Streamed into chunks instead of one ~6 KB String
+    AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4",
+                                                                 METRICS_RESPONSE_CHUNK);
+    metrics.writePrometheus(*response);
+    metrics.countHttpResponse(200);
+    request->send(response);
+}
+
+void RoboarmWebServer::handleTrace(AsyncWebServerRequest* request) {
+    if (trace.getState() != TraceState::STOPPED) {
+        sendJsonError(request, 409, "Trace recording - stop it with M860 S0");
+        return;
+    }
+    size_t size = trace.downloadSize();
+    if (!size) {
+        sendJsonError(request, 404, "No trace recorded");
+        return;
+    }
+
+    // Copied out of the ring chunk by chunk as TCP drains, no RAM copy. A
+    // recording started mid-download cuts it short.
+    uint32_t generation = trace.getGeneration();
+    AsyncWebServerResponse* response = request->beginResponse(
+        "application/octet-stream", size,
+        [generation](uint8_t* buffer, size_t maxLength, size_t index) -> size_t {
+            return trace.read(generation, index, buffer, maxLength);
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=\"trace.bin\"");
+    metrics.countHttpResponse(200);
+    request->send(response);
+}
+
+void RoboarmWebServer::handlePrograms(AsyncWebServerRequest* request) {
+    if (!programStore.isMounted()) {
+        sendJsonError(request, 503, "Program storage not available");
+        return;
+    }
+
+    JsonDocument doc(&requestArena);
+    buildProgramsJson(doc);
+    sendJsonResponse(request, 200, doc);
+}
+
+void RoboarmWebServer::handleProgramUpload(AsyncWebServerRequest* request, uint8_t* data,
+                                           size_t len, size_t index, size_t total) {
+    if (index == 0) {
+        if (!request->hasParam("name")) {
+            sendJsonError(request, 400, "Missing 'name' parameter");
+            return;
+        }
+
+        const String& name = request->getParam("name")->value();
+        if (!ProgramStore::isValidName(name.c_str(), name.length())) {
+            sendJsonError(request, 400, "Invalid program name");
+            return;
+        }
+
+        if (programPlayer.isActive() && name == programPlayer.getName()) {
+            sendJsonError(request, 409, "Program running");
+            return;
+        }
+
+        if (!programStore.beginUpload(request, name.c_str(), total)) {
+            sendJsonError(request, programStore.isUploading() ? 409 : 507,
+                          programStore.getUploadError());
+            return;
+        }
+    }
+
+    // Upload was rejected on its first chunk (already answered)
+    if (!programStore.isUploadOwner(request)) {
+        return;
+    }
+
+    if (!programStore.writeUpload(request, data, len)) {
+        sendJsonError(request, 500, programStore.getUploadError());
+        return;
+    }
+
+    if (index + len == total) {
+        JsonDocument response(&requestArena);
+        response["success"] = true;
+        response["name"] = request->getParam("name")->value();
+        response["size"] = total;
+        sendJsonResponse(request, 200, response);
+    }
+}
+
+void RoboarmWebServer::handleProgramDelete(AsyncWebServerRequest* request) {
+    if (!request->hasParam("name")) {
+        sendJsonError(request, 400, "Missing 'name' parameter");
+        return;
+    }
+
+    const String& name = request->getParam("name")->value();
+    if (!ProgramStore::isValidName(name.c_str(), name.length())) {
+        sendJsonError(request, 404, "Program not found");
+        return;
+    }
+
+    DeferredRequest* slot = claimDeferred(request, DEFERRED_PROGRAM_DELETE);
+    if (!slot) {
+        return;
+    }
+    strcpy(slot->command, name.c_str());
+    postDeferred(request, slot);
+}
+
+void RoboarmWebServer::handleTrajectory(AsyncWebServerRequest* request) {
+    if (!trajectoryPlayer.isAvailable()) {
+        sendJsonError(request, 503, "Trajectory partition not found");
+        return;
+    }
+
+    JsonDocument doc(&requestArena);
+    buildTrajectoryJson(doc);
+    sendJsonResponse(request, 200, doc);
+}
+
+void RoboarmWebServer::handleTrajectoryUpload(AsyncWebServerRequest* request, uint8_t* data,
+                                              size_t len, size_t index, size_t total) {
+    // Written straight to flash from here, like program uploads. Playback
+    // is refused while uploading, and TrajectoryPlayer orders the unmap and
+    // remap against playback starting on the motion task.
+    if (index == 0 && !trajectoryPlayer.beginUpload(request, total)) {
+        sendJsonError(request, trajectoryPlayer.isActive() ? 409 : 400,
+                      trajectoryPlayer.getUploadError());
+        return;
+    }
+
+    // Rejected earlier (already answered)
+    if (!trajectoryPlayer.isUploadOwner(request)) {
+        return;
+    }
+
+    if (!trajectoryPlayer.writeUpload(request, data, len)) {
+        sendJsonError(request, index + len == total ? 400 : 500,
+                      trajectoryPlayer.getUploadError());
+        return;
+    }
+
+    if (index + len == total) {
+        JsonDocument response(&requestArena);
+        response["success"] = true;
+        response["records"] = trajectoryPlayer.getRecordCount();
+        sendJsonResponse(request, 200, response);
+    }
+}
+
+int RoboarmWebServer::resultStatusCode(const CommandResult& result) {
+    if (result.success) {
+        return 200;
+    }
+    // 503 tells the client the motion queue is full and to retry
+    return result.busy ? 503 : 400;
+}
+
+void RoboarmWebServer::handleWebSocketEvent(AsyncWebSocketClient* client, AwsEventType type,
+                                            void* arg, uint8_t* data, size_t len) {
+    switch (type) {
+        case WS_EVT_CONNECT: {
+            DEBUG_PRINTF("WebSocket: client %u connected\n", client->id());
+            JsonDocument doc(&requestArena);
+            buildTelemetryJson(doc);
+            sendWebSocketJson(client, doc);
+            _report.requestKeyframe();
+            break;
+        }
+
+        case WS_EVT_DISCONNECT:
+            DEBUG_PRINTF("WebSocket: client %u disconnected\n", client->id());
+            break;
+
+        case WS_EVT_DATA: {
+            // Only whole, unfragmented text messages are supported
+            AwsFrameInfo* info = static_cast<AwsFrameInfo*>(arg);
+            if (!info->final || info->index != 0 || info->len != len) {
+                client->text("{\"type\":\"error\",\"error\":\"Fragmented messages not supported\"}");
+                break;
+            }
+            if (info->opcode != WS_TEXT) {
+                client->text("{\"type\":\"error\",\"error\":\"Text messages only\"}");
+                break;
+            }
+            handleWebSocketText(client, (const char*)data, len);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void RoboarmWebServer::handleWebSocketText(AsyncWebSocketClient* client,
+                                           const char* data, size_t len) {
+    // JSON control message
+    if (len > 0 && data[0] == '{') {
+        JsonDocument doc(&requestArena);
+        if (deserializeJson(doc, data, len)) {
+            client->text("{\"type\":\"error\",\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        // {"jog": {"j1": 500, "j2": -300}} - velocity mode, like M810
+        JsonVariantConst jog = doc["jog"];
+        if (!jog.isNull()) {
+            handleWebSocketJog(client, jog);
+            return;
+        }
+
+        if (doc["telemetry_ms"].is<long>()) {
+            long interval = doc["telemetry_ms"].as<long>();
+            if (interval < 0) interval = 0;
+            if (interval > 0 && interval < WS_MIN_TELEMETRY_INTERVAL_MS) {
+                interval = WS_MIN_TELEMETRY_INTERVAL_MS;
+            }
+            _telemetryIntervalMs = interval;
+        }
+
+        // {"report": "full" | "delta" | "binary"}
+        ReportFormat format = _report.getFormat();
+        const char* mode = doc["report"];
+        if (mode) {
+            if (strcmp(mode, "full") == 0) {
+                _changeDriven = false;
+            } else if (strcmp(mode, "delta") == 0) {
+                _changeDriven = true;
+                format = ReportFormat::JSON;
+            } else if (strcmp(mode, "binary") == 0) {
+                _changeDriven = true;
+                format = ReportFormat::BINARY;
+            } else {
+                client->text("{\"type\":\"error\",\"error\":\"Report must be full, delta or binary\"}");
+                return;
+            }
+        }
+        _report.configure(_changeDriven ? _telemetryIntervalMs : 0, format);
+
+        JsonDocument response(&requestArena);
+        response["type"] = "config";
+        response["telemetry_ms"] = _telemetryIntervalMs;
+        response["report"] = reportModeName();
+        sendWebSocketJson(client, response);
+        return;
+    }
+
+    // One or more newline-separated commands, executed in order on the
+    // motion task; the reply comes from loop()
+    int count = splitCommands(data, len);
+    if (count < 0) {
+        client->text("{\"type\":\"error\",\"error\":\"Too many commands\"}");
+        return;
+    }
+    DeferredRequest* slot = claimWebSocket(client, DEFERRED_WS_COMMANDS, count);
+    if (!slot) {
+        return;
+    }
+    slot->input = packCommands(count);
+    postWebSocket(slot);
+}
+
+void RoboarmWebServer::handleWebSocketJog(AsyncWebSocketClient* client, JsonVariantConst jog) {
+    // Same semantics as M810: the message is the whole velocity vector
+    long speeds[MOTOR_COUNT];
+    bool valid = jog.is<JsonObjectConst>();
+    for (int i = 0; i < MOTOR_COUNT && valid; i++) {
+        JsonVariantConst value = jog[JOINT_KEYS[i]];
+        valid = value.isNull() || value.is<long>();
+        speeds[i] = value | 0L;
+    }
+
+    if (!valid) {
+        JsonDocument response(&requestArena);
+        response["type"] = "jog";
+        response["success"] = false;
+        response["error"] = "Jog speeds must be integers";
+        sendWebSocketJson(client, response);
+        return;
+    }
+
+    DeferredRequest* slot = claimWebSocket(client, DEFERRED_WS_JOG, 0);
+    if (!slot) {
+        return;
+    }
+    memcpy(slot->speeds, speeds, sizeof(speeds));
+    postWebSocket(slot);
+}
+
+void RoboarmWebServer::sendTelemetry() {
+    if (_ws.count() == 0 || !_ws.availableForWriteAll()) {
+        return;  // Nobody listening, or clients still draining
+    }
+
+    JsonDocument doc(&telemetryArena);
+    buildTelemetryJson(doc);
+    sendWebSocketJson(nullptr, doc);
+}
+
+void RoboarmWebServer::sendReport() {
+    if (_ws.count() == 0 || !_ws.availableForWriteAll()) {
+        return;  // Changes wait for a frame that can be sent
+    }
+
+    uint32_t now = millis();
+    ReportFrame frame;
+    if (!_report.poll(now, frame)) {
+        return;
+    }
+
+    if (_report.getFormat() == ReportFormat::BINARY) {
+        uint8_t buffer[BINARY_MAX_STATUS_SIZE];
+        size_t length = AutoReport::encodeBinary(frame, buffer, sizeof(buffer));
+        _ws.binaryAll(buffer, length);
+    } else {
+        JsonDocument doc(&telemetryArena);
+        buildReportJson(frame, doc);
+        sendWebSocketJson(nullptr, doc);
+    }
+    _report.commit(frame, now);
+}
+
+void RoboarmWebServer::buildReportJson(const ReportFrame& frame, JsonDocument& doc) {
+    doc["type"] = "delta";
+    doc["t"] = millis();
+    doc["seq"] = frame.snapshot;
+    doc["n"] = frame.sequence;
+    if (frame.isKeyframe()) {
+        doc["keyframe"] = true;
+    }
+    doc["enabled"] = (frame.flags & REPORT_FLAG_ENABLED) != 0;
+    doc["moving"] = (frame.flags & REPORT_FLAG_MOVING) != 0;
+    doc["jogging"] = (frame.flags & REPORT_FLAG_JOGGING) != 0;
+    doc["homing"] = (frame.flags & REPORT_FLAG_HOMING) != 0;
+    doc["queued"] = frame.queueDepth;
+    doc["homed"] = frame.homedMask;
+
+    // Changed joints only: [position, target, velocity]
+    JsonObject joints = doc["joints"].to<JsonObject>();
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        if (frame.includes(i)) {
+            JsonArray joint = joints[JOINT_KEYS[i]].to<JsonArray>();
+            joint.add(frame.position[i]);
+            joint.add(frame.target[i]);
+            joint.add(frame.speedHz[i]);
+        }
+    }
+}
+
+const char* RoboarmWebServer::reportModeName() const {
+    if (!_changeDriven) {
+        return "full";
+    }
+    return _report.getFormat() == ReportFormat::BINARY ? "binary" : "delta";
+}
+
+void RoboarmWebServer::sendWebSocketJson(AsyncWebSocketClient* client, const JsonDocument& doc) {
+    // Serialize straight into the message buffer the library queues
+    size_t length = measureJson(doc);
+    AsyncWebSocketMessageBuffer* buffer = _ws.makeBuffer(length);
+    if (!buffer) {
+        return;
+    }
+    serializeJson(doc, (char*)buffer->get(), length + 1);
+
+    if (client) {
+        client->text(buffer);
+    } else {
+        _ws.textAll(buffer);
+    }
+}
+
+void RoboarmWebServer::buildTelemetryJson(JsonDocument& doc) {
+    MotionSnapshot snapshot = telemetry.get();
+
+    doc["type"] = "status";
+    doc["t"] = millis();
+    doc["seq"] = snapshot.sequence;
+    doc["t_us"] = snapshot.timestampUs;
+    doc["enabled"] = snapshot.enabled;
+    doc["moving"] = snapshot.isMoving();
+    doc["jogging"] = snapshot.jogging;
+    doc["queued"] = snapshot.queueDepth;
+
+    JsonArray positions = doc["positions"].to<JsonArray>();
+    JsonArray targets = doc["targets"].to<JsonArray>();
+    JsonArray velocities = doc["velocities"].to<JsonArray>();
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        positions.add(snapshot.position[i]);
+        targets.add(snapshot.target[i]);
+        velocities.add(snapshot.speedMilliHz[i] / 1000.0f);
+    }
+}
+
 void RoboarmWebServer::sendJsonResponse(AsyncWebServerRequest* request, int code, const JsonDocument& doc) {
-    String output;
-    serializeJson(doc, output);
-    request->send(code, "application/json", output);
+    metrics.countHttpResponse(code);
+
+    // One buffer of exactly the right size, filled in place
+    AsyncResponseStream* response =
+        request->beginResponseStream("application/json", measureJson(doc));
+    response->setCode(code);
+    serializeJson(doc, *response);
+    request->send(response);
 }
 
-void RoboarmWebServer::sendJsonError(AsyncWebServerRequest* request, int code, const String& message) {
-    JsonDocument doc;
+void RoboarmWebServer::sendJsonError(AsyncWebServerRequest* request, int code, const char* message) {
+    JsonDocument doc(&requestArena);
     doc["success"] = false;
     doc["error"] = message;
     sendJsonResponse(request, code, doc);
 }
 
-void RoboarmWebServer::sendJsonSuccess(AsyncWebServerRequest* request, const String& message) {
-    JsonDocument doc;
+void RoboarmWebServer::sendJsonSuccess(AsyncWebServerRequest* request, const char* message) {
+    JsonDocument doc(&requestArena);
     doc["success"] = true;
     doc["message"] = message;
     sendJsonResponse(request, 200, doc);
 }
 
 void RoboarmWebServer::buildStatusJson(JsonDocument& doc) {
-    doc["enabled"] = motors.isEnabled();
-    doc["moving"] = motors.isAnyMoving();
+    MotionSnapshot snapshot = telemetry.get();
+
+    doc["seq"] = snapshot.sequence;
+    doc["enabled"] = snapshot.enabled;
+    doc["moving"] = snapshot.isMoving();
+    doc["jogging"] = snapshot.jogging;
+    doc["homing"] = snapshot.homing;
+    doc["queued"] = snapshot.queueDepth;
+    doc["queue_free"] = snapshot.queueFree;
 
     JsonObject positions = doc["positions"].to<JsonObject>();
     JsonObject targets = doc["targets"].to<JsonObject>();
     JsonObject distances = doc["distances"].to<JsonObject>();
+    JsonObject homed = doc["homed"].to<JsonObject>();
+
+    JsonObject jointPositions = doc["joint_positions"].to<JsonObject>();
 
     for (int i = 0; i < MOTOR_COUNT; i++) {
-        String key = "j" + String(i + 1);
-        positions[key] = motors.getPosition(i);
-        targets[key] = motors.getTargetPosition(i);
-        distances[key] = motors.getDistanceToGo(i);
+        positions[JOINT_KEYS[i]] = snapshot.position[i];
+        targets[JOINT_KEYS[i]] = snapshot.target[i];
+        distances[JOINT_KEYS[i]] = snapshot.distanceToGo(i);
+        homed[JOINT_KEYS[i]] = (snapshot.homedMask >> i) & 1 ? true : false;
+        // Degrees/mm, exact to the thousandth
+        jointPositions[JOINT_KEYS[i]] = Units::fromSteps(i, snapshot.position[i]) * 0.001;
+    }
+
+    // Closed-loop feedback, only present with encoders fitted
+    uint8_t encoderMask = encoders.getMask();  // Fixed after boot
+    if (encoderMask) {
+        JsonObject encoder = doc["encoder"].to<JsonObject>();
+        JsonObject errors = encoder["following_error"].to<JsonObject>();
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            if ((encoderMask >> i) & 1) {
+                errors[JOINT_KEYS[i]] = snapshot.followingError[i];
+            }
+        }
+        encoder["fault"] = snapshot.encoderFaultMask != 0;
     }
 
-    doc["ip"] = WiFi.localIP().toString();
+    // Tool pose (meaningless until the chain is homed)
+    if ((snapshot.homedMask & Kinematics::chainMask()) == Kinematics::chainMask()) {
+        long steps[MOTOR_COUNT];
+        for (int i = 0; i < MOTOR_COUNT; i++) {
+            steps[i] = snapshot.position[i];
+        }
+        Pose pose;
+        kinematics.poseFromSteps(steps, pose);
+        JsonObject tool = doc["pose"].to<JsonObject>();
+        tool["x"] = roundf(pose.x * 100) / 100;
+        tool["y"] = roundf(pose.y * 100) / 100;
+        tool["z"] = roundf(pose.z * 100) / 100;
+        tool["a"] = roundf(pose.a * 100) / 100;
+        tool["b"] = roundf(pose.b * 100) / 100;
+        tool["c"] = roundf(pose.c * 100) / 100;
+    } else {
+        doc["pose"] = nullptr;
+    }
+    doc["cartesian"] = CartesianPlanner::stateName(cartesianPlanner.getState());
+
+    doc["program"] = ProgramPlayer::stateName(programPlayer.getState());
+
+    IPAddress address = WiFi.localIP();
+    char ip[16];
+    snprintf(ip, sizeof(ip), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+    doc["ip"] = ip;
     doc["uptime"] = millis() / 1000;
 }
 
 void RoboarmWebServer::buildConfigJson(JsonDocument& doc) {
     doc["motor_count"] = MOTOR_COUNT;
     doc["enable_pin"] = MOTORS_ENABLE_PIN;
+    doc["coordinated"] = motors.isCoordinated();
 
     JsonArray motors_arr = doc["motors"].to<JsonArray>();
 
@@ -322,8 +1728,53 @@ void RoboarmWebServer::buildConfigJson(JsonDocument& doc) {
         motor["step_pin"] = cfg.stepPin;
         motor["dir_pin"] = cfg.dirPin;
         motor["steps_per_rev"] = cfg.stepsPerRev;
-        motor["max_speed"] = cfg.maxSpeedHz;
-        motor["acceleration"] = cfg.acceleration;
+        motor["unit"] = Units::name(i);
+        motor["steps_per_unit"] = Units::scale(i);
+        motor["max_speed"] = motors.getMaxSpeed(i);
+        motor["acceleration"] = motors.getAcceleration(i);
+        motor["jerk"] = motors.getJerk(i);
+        motor["limit_min"] = motors.getLimitMin(i);
+        motor["limit_max"] = motors.getLimitMax(i);
         motor["invert_dir"] = cfg.invertDir;
+        motor["endstop_pin"] = cfg.endstopPin;
+        motor["home_dir"] = cfg.homeDir;
+    }
+}
+
+void RoboarmWebServer::buildProgramsJson(JsonDocument& doc) {
+    static ProgramInfo programs[ProgramStore::MAX_PROGRAMS];
+    size_t count = programStore.list(programs, ProgramStore::MAX_PROGRAMS);
+
+    JsonArray list = doc["programs"].to<JsonArray>();
+    for (size_t i = 0; i < count; i++) {
+        JsonObject entry = list.add<JsonObject>();
+        entry["name"] = programs[i].name;
+        entry["size"] = programs[i].size;
+    }
+
+    doc["total_bytes"] = programStore.totalBytes();
+    doc["used_bytes"] = programStore.usedBytes();
+
+    JsonObject playback = doc["playback"].to<JsonObject>();
+    PlaybackState state = programPlayer.getState();
+    playback["state"] = ProgramPlayer::stateName(state);
+    if (state != PlaybackState::IDLE) {
+        playback["name"] = programPlayer.getName();
+        playback["size"] = programPlayer.getFileSize();
+        playback["bytes_executed"] = programPlayer.getBytesExecuted();
+        playback["line"] = programPlayer.getLineNumber();
     }
+    if (state == PlaybackState::FAILED) {
+        playback["error"] = programPlayer.getError();
+    }
+}
+
+void RoboarmWebServer::buildTrajectoryJson(JsonDocument& doc) {
+    doc["valid"] = trajectoryPlayer.isValid();
+    doc["records"] = trajectoryPlayer.getRecordCount();
+    doc["capacity_bytes"] = trajectoryPlayer.getCapacity();
+    doc["state"] = TrajectoryPlayer::stateName(trajectoryPlayer.getState());
+    doc["index"] = trajectoryPlayer.getIndex();
+    doc["pass"] = trajectoryPlayer.getPass();
+    doc["repeat"] = trajectoryPlayer.getRepeat();
 }
@@ -5,9 +5,14 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "config.h"
+#include "auto_report.h"
 #include "motor_controller.h"
 #include "command_parser.h"
+#include "program_store.h"
+#include "program_player.h"
+#include "trajectory.h"
 
 /**
  * Async Web Server for robotic arm control
@@ -15,10 +20,40 @@
  * REST API Endpoints:
  *   GET  /api/status       - Get current positions and status
  *   POST /api/command      - Execute a G-code command
- *   POST /api/move         - Move joints (JSON body)
+ *   POST /api/move         - Queue a move (JSON body, no G-code round trip)
+ *   POST /api/moves        - Queue many moves all-or-nothing (JSON array)
+ *   POST /api/batch        - Execute many commands (JSON array or G-code text)
  *   POST /api/enable       - Enable/disable motors
  *   GET  /api/config       - Get motor configuration
- *   GET  /                 - Simple web UI (if enabled)
+ *   POST /api/config       - Change joint speed/accel/jerk/soft limits
+ *                            ("save": true also stores them, like M500)
+ *   GET  /api/programs     - List stored programs and playback status
+ *   POST /api/programs?name=X    - Upload program (raw G-code body)
+ *   DELETE /api/programs?name=X  - Delete program
+ *   GET  /api/trajectory   - Stored trajectory and playback status
+ *   POST /api/trajectory   - Upload compiled trajectory (binary body)
+ *   GET  /                 - Web UI (gzipped, cached by ETag)
+ *
+ * WebSocket:
+ *   /ws                    - Text messages with one or more newline-separated
+ *                            commands get one {"type":"result"} reply; status
+ *                            frames ({"type":"status"}) are pushed at the
+ *                            telemetry interval. {"telemetry_ms": N} changes
+ *                            the interval (0 = off); {"report": "delta"}
+ *                            pushes only changed joints ({"type":"delta"},
+ *                            see auto_report.h) and "binary" the same as
+ *                            FRAME_STATUS binary messages ("full" = status
+ *                            frames again); {"jog": {"j1": 500}} jogs like
+ *                            M810.
+ *
+ * No handler blocks the AsyncTCP task on the motion task: requests that
+ * change motion state are validated, handed to the motion task with
+ * MotionTask::post() and answered with a DeferredResponse, which AsyncTCP
+ * sends once the motion task has filled in the reply (see DeferredRequest;
+ * it waits at most WEB_DEFERRED_WAIT_MS for that before moving on).
+ * WebSocket commands take the same path through their own ring, replied by
+ * loop() in the order they arrived. The other handlers answer in the
+ * callback.
  */
 
 class RoboarmWebServer {
@@ -26,15 +61,17 @@ public:
     RoboarmWebServer(uint16_t port = WEB_SERVER_PORT);
 
     /**
-     * Initialize WiFi and start the web server
+     * Start connecting to WiFi and start the web server
+     * Returns without waiting for the connection; loop() watches the link
+     * and retries every WIFI_RECONNECT_INTERVAL_MS while it is down.
      * @param ssid WiFi network name
      * @param password WiFi password
-     * @return true if connected successfully
+     * @return true if the server was started (see isConnected for WiFi)
      */
     bool begin(const char* ssid, const char* password);
 
     /**
-     * Check if WiFi is connected
+     * Check if WiFi is connected (the API is reachable)
      */
     bool isConnected() const;
 
@@ -50,28 +87,173 @@ public:
      */
     void loop();
 
+    /**
+     * Fill the GET /api/status document (also timed by bench/command_bench.cpp)
+     */
+    void buildStatusJson(JsonDocument& doc);
+
 private:
     AsyncWebServer _server;
-    bool _connected;
+    AsyncWebSocket _ws;
+    bool _started;
+    bool _linkUp;                   // WiFi state seen by the last loop()
+    unsigned long _lastLinkChange;  // When the link came up/went down, or the last retry
+
+    // WebSocket telemetry push
+    uint32_t _telemetryIntervalMs;
+    unsigned long _lastTelemetry;
+    bool _changeDriven;             // {"report": "delta"/"binary"}
+    AutoReport _report;             // Runs at the telemetry interval when change-driven
+
+    /**
+     * A request waiting for the motion task
+     *
+     * FREE -> QUEUED (AsyncTCP claims the slot and posts it) -> DONE (motion
+     * task serialized the reply) -> FREE (AsyncTCP took the reply into the
+     * DeferredResponse). Only the state is shared with the motion task;
+     * `response` is AsyncTCP's alone. If the client goes away while the
+     * slot is QUEUED, its DeferredResponse is deleted and leaves the slot
+     * behind; claimDeferred frees such slots once they are DONE.
+     *
+     * WebSocket slots form a ring instead: AsyncTCP fills them at _wsTail,
+     * loop() sends and frees them from _wsHead once DONE, so replies keep
+     * the order of the messages.
+     *
+     * All WebSocket frames go out from loop(), replies and pushed status
+     * frames alike. That keeps one sender per socket, so a reply never
+     * interleaves with a broadcast. Replies are addressed by client id, so
+     * a client that AsyncTCP has closed in the meantime is looked up, not
+     * dereferenced, and the library skips it. An HTTP reply, by contrast,
+     * belongs to its AsyncWebServerRequest, which only the AsyncTCP task
+     * may touch; that is why the two paths differ.
+     */
+    enum DeferredKind : uint8_t {
+        DEFERRED_COMMAND,
+        DEFERRED_MOVE,
+        DEFERRED_MOVES,
+        DEFERRED_BATCH,
+        DEFERRED_ENABLE,
+        DEFERRED_CONFIG,
+        DEFERRED_PROGRAM_DELETE,
+        DEFERRED_WS_COMMANDS,
+        DEFERRED_WS_JOG
+    };
+
+    enum DeferredState : uint8_t {
+        DEFERRED_FREE,
+        DEFERRED_QUEUED,
+        DEFERRED_DONE
+    };
+
+    class DeferredResponse;
+
+    struct DeferredRequest {
+        std::atomic<uint8_t> state;         // DeferredState
+        DeferredKind kind;
+        DeferredResponse* response;         // AsyncTCP, nullptr if abandoned
+        std::atomic<TaskHandle_t> waiter;   // AsyncTCP task while it waits for DONE
+        uint32_t client;                    // WebSocket client id
+        uint32_t startUs;
+
+        // Input (AsyncTCP)
+        char command[COMMAND_MAX_LENGTH + 1];   // Command, or program name
+        MoveRequest move;
+        bool enable;                        // Also: save after DEFERRED_CONFIG
+        bool reset;
+        long speeds[MOTOR_COUNT];
+        void* input;                        // Heap: moves, commands or settings
+        size_t count;                       // Entries in input
+        size_t moves;                       // Queued moves among the commands
+
+        // Output (motion task): JSON body on the heap, nullptr if out of memory
+        int code;
+        char* reply;
+        size_t replyLength;
+    };
+
+    DeferredRequest _deferred[WEB_DEFERRED_SLOTS];
+    DeferredRequest _wsDeferred[WS_DEFERRED_SLOTS];
+    std::atomic<uint32_t> _wsHead;  // loop()
+    std::atomic<uint32_t> _wsTail;  // AsyncTCP
 
     // Setup route handlers
     void setupRoutes();
 
     // API handlers
+    void handleIndex(AsyncWebServerRequest* request);
     void handleStatus(AsyncWebServerRequest* request);
     void handleCommand(AsyncWebServerRequest* request, uint8_t* data, size_t len);
-    void handleMove(AsyncWebServerRequest* request, uint8_t* data, size_t len);
+    void handleMove(AsyncWebServerRequest* request, const char* body, size_t len);
+    void handleMoves(AsyncWebServerRequest* request, const char* body, size_t len);
     void handleEnable(AsyncWebServerRequest* request, uint8_t* data, size_t len);
+    void executeBatch(AsyncWebServerRequest* request, const char* body, size_t len);
+
+    // Deferred requests: claim a slot (nullptr = none free, replied 503),
+    // post it to the motion task and answer with its DeferredResponse
+    // (replies 503 and frees the slot if the motion queue is full)
+    DeferredRequest* claimDeferred(AsyncWebServerRequest* request, DeferredKind kind);
+    void postDeferred(AsyncWebServerRequest* request, DeferredRequest* slot);
+
+    // The same for WebSocket messages: nullptr (client closed) if the ring
+    // is full; a full motion queue is answered in order like any reply
+    DeferredRequest* claimWebSocket(AsyncWebSocketClient* client, DeferredKind kind,
+                                    size_t count);
+    void postWebSocket(DeferredRequest* slot);
+    void sendWebSocketReplies();
+    static void executeDeferred(void* context);
+    static void finishDeferred(DeferredRequest* slot, int code, const JsonDocument& doc);
+    static void releaseDeferred(DeferredRequest* slot);
+    bool attachInput(AsyncWebServerRequest* request, DeferredRequest* slot, void* input);
+
+    // Motion task: run a deferred request into its reply, return the status
+    static int runCommand(DeferredRequest* slot, JsonDocument& response);
+    static int runMoves(DeferredRequest* slot, JsonDocument& response);
+    static int runBatch(DeferredRequest* slot, JsonDocument& response);
+    static int runConfig(DeferredRequest* slot, JsonDocument& response);
+    static int runProgramDelete(DeferredRequest* slot, JsonDocument& response);
+    static int runWebSocketCommands(DeferredRequest* slot, JsonDocument& response);
+    static int runWebSocketJog(DeferredRequest* slot, JsonDocument& response);
+    static void buildWebSocketError(DeferredKind kind, size_t count, const char* message,
+                                    bool busy, JsonDocument& doc);
     void handleConfig(AsyncWebServerRequest* request);
+    void handleConfigUpdate(AsyncWebServerRequest* request, const char* body, size_t len);
+    void handleMetrics(AsyncWebServerRequest* request);
+    void handleTrace(AsyncWebServerRequest* request);
+    void handlePrograms(AsyncWebServerRequest* request);
+    void handleProgramUpload(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                             size_t index, size_t total);
+    void handleProgramDelete(AsyncWebServerRequest* request);
+    void handleTrajectory(AsyncWebServerRequest* request);
+    void handleTrajectoryUpload(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                                size_t index, size_t total);
+
+    // WebSocket handlers
+    void handleWebSocketEvent(AsyncWebSocketClient* client, AwsEventType type,
+                              void* arg, uint8_t* data, size_t len);
+    void handleWebSocketText(AsyncWebSocketClient* client, const char* data, size_t len);
+    void handleWebSocketJog(AsyncWebSocketClient* client, JsonVariantConst jog);
+    void sendTelemetry();
+    void buildTelemetryJson(JsonDocument& doc);
+    void sendReport();
+    void buildReportJson(const ReportFrame& frame, JsonDocument& doc);
+    const char* reportModeName() const;
+    void sendWebSocketJson(AsyncWebSocketClient* client, const JsonDocument& doc);
 
-    // Response helpers
+    // Reassemble a chunked body (up to BATCH_MAX_BODY_SIZE); returns it
+    // once the last chunk arrives, nullptr before that or after an error reply
+    const char* collectBody(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                            size_t index, size_t total);
+
+    // Response helpers (serialize straight into the response buffer)
     void sendJsonResponse(AsyncWebServerRequest* request, int code, const JsonDocument& doc);
-    void sendJsonError(AsyncWebServerRequest* request, int code, const String& message);
-    void sendJsonSuccess(AsyncWebServerRequest* request, const String& message);
+    void sendJsonError(AsyncWebServerRequest* request, int code, const char* message);
+    void sendJsonSuccess(AsyncWebServerRequest* request, const char* message);
+    static int resultStatusCode(const CommandResult& result);
 
-    // Build status JSON
-    void buildStatusJson(JsonDocument& doc);
+    // Build JSON documents
     void buildConfigJson(JsonDocument& doc);
+    void buildProgramsJson(JsonDocument& doc);
+    void buildTrajectoryJson(JsonDocument& doc);
 };
 
 // Global web server instance
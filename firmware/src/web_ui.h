@@ -0,0 +1,66 @@
+#ifndef WEB_UI_H
+#define WEB_UI_H
+
+// Generated by tools/embed_web_ui.py from web/index.html - do not edit
+
+#include <Arduino.h>
+
+#define WEB_UI_ETAG "\"5a8a714b412fa58d\""
+
+// 2111 bytes, gzip-compressed to 801
+static const size_t WEB_UI_GZ_LENGTH = 801;
+static const uint8_t WEB_UI_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xcd, 0x56, 0x4b, 0x6f, 0xdb, 0x30,
+    0x0c, 0xbe, 0xf7, 0x57, 0x70, 0xda, 0xa1, 0x09, 0x90, 0xd8, 0x71, 0x81, 0x61, 0x83, 0x63, 0xe7,
+    0xb0, 0x36, 0x18, 0x3a, 0x6c, 0x6b, 0xd1, 0xe6, 0xb2, 0xa3, 0x62, 0x29, 0x8d, 0x56, 0x59, 0x32,
+    0x24, 0x39, 0xad, 0x11, 0xe4, 0xbf, 0x8f, 0xf2, 0x23, 0xcd, 0xab, 0x28, 0x8a, 0x5d, 0xa6, 0x1c,
+    0x62, 0x85, 0xe4, 0x47, 0x7e, 0x7c, 0x39, 0xc9, 0x87, 0xab, 0x9b, 0xcb, 0xd9, 0xef, 0xdb, 0x29,
+    0x2c, 0x5d, 0x2e, 0x27, 0x67, 0x49, 0xf7, 0xc5, 0x29, 0x9b, 0x9c, 0x01, 0x9e, 0xc4, 0x09, 0x27,
+    0xf9, 0xe4, 0x4e, 0xcf, 0x35, 0x35, 0x79, 0x12, 0x36, 0xd7, 0x46, 0x94, 0x73, 0x47, 0x41, 0xd1,
+    0x9c, 0xa7, 0x64, 0x25, 0xf8, 0x53, 0xa1, 0x8d, 0x23, 0x90, 0x69, 0xe5, 0xb8, 0x72, 0x29, 0x79,
+    0x12, 0xcc, 0x2d, 0x53, 0xc6, 0x57, 0x22, 0xe3, 0xc3, 0xfa, 0x32, 0x00, 0xa1, 0x84, 0x13, 0x54,
+    0x0e, 0x6d, 0x46, 0x25, 0x4f, 0x23, 0xd2, 0x02, 0x59, 0x57, 0x75, 0xa0, 0xfe, 0xcc, 0x35, 0xab,
+    0x60, 0x0d, 0x0b, 0x44, 0x1a, 0x2e, 0x68, 0x2e, 0x64, 0x15, 0x43, 0xae, 0x95, 0xb6, 0x05, 0xcd,
+    0xf8, 0x18, 0x0a, 0xca, 0x98, 0x50, 0x0f, 0x31, 0x5c, 0x8c, 0x8a, 0xe7, 0x31, 0xcc, 0x69, 0xf6,
+    0xf8, 0x60, 0x74, 0xa9, 0x58, 0x0c, 0x1f, 0x23, 0xea, 0x3f, 0x63, 0x8c, 0x42, 0x6a, 0x83, 0xf7,
+    0xd1, 0x62, 0x34, 0x86, 0xcd, 0x16, 0x79, 0x19, 0x21, 0xee, 0x8b, 0x6c, 0xb1, 0x2b, 0x2b, 0x0c,
+    0x47, 0xe1, 0x1e, 0xda, 0x68, 0x34, 0xda, 0x71, 0x17, 0x35, 0xee, 0xb4, 0x61, 0x1c, 0xcd, 0xa3,
+    0xe2, 0x19, 0xac, 0x96, 0x82, 0x1d, 0x39, 0x09, 0xe6, 0x4e, 0x1d, 0x21, 0x79, 0x95, 0xad, 0x63,
+    0x0f, 0xdb, 0xe1, 0x28, 0xad, 0xf8, 0x81, 0x93, 0x96, 0x58, 0x4e, 0xcd, 0x83, 0x50, 0x31, 0x7c,
+    0xf2, 0x97, 0xac, 0x34, 0xd6, 0x1b, 0x17, 0x5a, 0x60, 0x7e, 0xcd, 0xa1, 0xbf, 0x78, 0xa9, 0x57,
+    0xdc, 0x1c, 0x7b, 0xdd, 0x63, 0x28, 0x54, 0x51, 0xba, 0x93, 0x1c, 0xf7, 0xd2, 0xf5, 0x1a, 0xc3,
+    0x6d, 0x8c, 0x75, 0x40, 0x0d, 0x6c, 0x12, 0xb6, 0xb5, 0x4b, 0xc2, 0xa6, 0x67, 0x12, 0x5f, 0xbc,
+    0xb6, 0xac, 0xcb, 0xa8, 0xeb, 0x1b, 0xb8, 0xc4, 0x5a, 0x1a, 0x2d, 0x25, 0x37, 0xa8, 0x18, 0xb5,
+    0x72, 0x26, 0x56, 0x2f, 0x45, 0x4f, 0xe6, 0xa5, 0x73, 0x5a, 0x41, 0x26, 0xa9, 0xb5, 0x29, 0x41,
+    0x4e, 0x04, 0xb4, 0xca, 0xa4, 0xc8, 0x1e, 0x53, 0x62, 0xb9, 0x62, 0x97, 0x39, 0xeb, 0x9d, 0xff,
+    0x8c, 0x3e, 0x9f, 0xf7, 0xc9, 0x64, 0xaa, 0xe8, 0x5c, 0xf2, 0x24, 0x6c, 0x6c, 0xde, 0x0f, 0xf2,
+    0xc5, 0x83, 0x5c, 0x09, 0xfb, 0x6f, 0x28, 0xd1, 0x45, 0x1d, 0xcb, 0xf0, 0x7e, 0x76, 0x73, 0xfb,
+    0x4e, 0x94, 0x07, 0xee, 0xee, 0x1d, 0x75, 0xa5, 0xed, 0x21, 0x42, 0xf3, 0xb4, 0x8f, 0x90, 0x84,
+    0xdb, 0xec, 0xf8, 0x3c, 0x41, 0x9d, 0xe6, 0x94, 0x34, 0x3d, 0x31, 0x74, 0xba, 0x68, 0xdb, 0x9f,
+    0xec, 0x38, 0x6c, 0xea, 0xeb, 0xaa, 0x02, 0x15, 0x1d, 0x7f, 0xc6, 0x61, 0x14, 0x2c, 0x25, 0x59,
+    0xce, 0x08, 0x14, 0x12, 0x47, 0x67, 0xa9, 0x25, 0x16, 0x36, 0x25, 0xdf, 0x46, 0xf0, 0x3d, 0x8a,
+    0x23, 0xac, 0x3c, 0xe9, 0x70, 0xeb, 0xf9, 0xf4, 0x90, 0x87, 0x98, 0x6f, 0xa5, 0xe2, 0xda, 0xfb,
+    0xac, 0x49, 0xe0, 0xe5, 0x75, 0x0a, 0x7e, 0xb8, 0x7c, 0x30, 0xba, 0x74, 0xa8, 0x4f, 0x26, 0x77,
+    0xd8, 0x2c, 0x55, 0x10, 0x04, 0x49, 0x88, 0x92, 0x6e, 0x0b, 0x64, 0x46, 0x14, 0xee, 0xc5, 0x37,
+    0xb5, 0x95, 0xca, 0x60, 0x51, 0xaa, 0xcc, 0x09, 0x0c, 0xa1, 0x4b, 0x3c, 0xf2, 0xe9, 0xc3, 0x7a,
+    0xab, 0xe5, 0x0f, 0xee, 0x1c, 0xeb, 0xc0, 0x70, 0x0b, 0x29, 0xd0, 0x27, 0x2a, 0x1c, 0x2c, 0xb8,
+    0xcb, 0x96, 0x3d, 0x12, 0xd2, 0x42, 0x84, 0x99, 0xce, 0x73, 0xaa, 0x18, 0x19, 0x1c, 0x58, 0xf9,
+    0x83, 0x2b, 0x6c, 0xa9, 0x71, 0x0c, 0xc8, 0xed, 0xcd, 0xfd, 0x8c, 0x0c, 0x8e, 0xe4, 0xbe, 0xa9,
+    0xb9, 0xb1, 0x31, 0xac, 0xc9, 0x65, 0xb3, 0xd8, 0x86, 0x33, 0xcc, 0x2f, 0x41, 0x0b, 0x5a, 0x14,
+    0x98, 0x06, 0xea, 0x63, 0x0b, 0xff, 0x58, 0xad, 0xc8, 0xe6, 0xd8, 0xdc, 0x0f, 0x43, 0x0c, 0xdf,
+    0xef, 0x6f, 0x7e, 0x05, 0xd6, 0x19, 0x1c, 0x1e, 0xb1, 0xa8, 0x7a, 0xeb, 0x36, 0xa0, 0x18, 0x90,
+    0xca, 0xa6, 0xbf, 0x67, 0xb4, 0xe9, 0x8f, 0x4f, 0x30, 0x63, 0x14, 0x17, 0x6d, 0x47, 0x0d, 0x69,
+    0x06, 0xde, 0x5f, 0xef, 0x40, 0x95, 0xe9, 0xac, 0xcc, 0x31, 0xc0, 0x00, 0x7b, 0x6b, 0x2a, 0xb9,
+    0x7f, 0xfc, 0x5a, 0x5d, 0xb3, 0x5e, 0x97, 0xf3, 0x7e, 0xe0, 0x7b, 0xa2, 0x65, 0x81, 0x68, 0x07,
+    0x51, 0x79, 0x1f, 0x03, 0x50, 0xa5, 0x94, 0x03, 0xb8, 0xd8, 0x81, 0xde, 0xbc, 0x56, 0x8f, 0x9d,
+    0x16, 0x7e, 0x57, 0x39, 0x6c, 0x6d, 0x44, 0xfe, 0x63, 0xa2, 0x7b, 0x2d, 0xd7, 0x36, 0xf8, 0x49,
+    0x8a, 0x58, 0x3f, 0xc4, 0x7f, 0x35, 0x1e, 0x3f, 0x79, 0xfd, 0x60, 0x45, 0x65, 0xc9, 0xf7, 0x19,
+    0x88, 0x05, 0x34, 0x6d, 0xbc, 0xdb, 0xd3, 0xa7, 0x22, 0x79, 0x03, 0x1a, 0x17, 0xf2, 0x74, 0x85,
+    0xbf, 0xfd, 0x10, 0x16, 0xb9, 0x72, 0xd3, 0x23, 0x8f, 0xbc, 0xc2, 0x81, 0xb2, 0x16, 0x9b, 0xbd,
+    0xc7, 0xfb, 0x90, 0x4e, 0x0e, 0xe2, 0xf6, 0x9e, 0x79, 0x80, 0x5a, 0x90, 0xa6, 0x29, 0x90, 0xa9,
+    0x7f, 0x97, 0x90, 0xfe, 0x2e, 0xd1, 0x9d, 0x30, 0xda, 0x67, 0xdc, 0xf1, 0xed, 0x64, 0xe2, 0x7c,
+    0xd7, 0xdb, 0x1d, 0x77, 0x78, 0xfd, 0x3f, 0xe1, 0x2f, 0x24, 0xf9, 0x61, 0x99, 0x3f, 0x08, 0x00,
+    0x00,
+};
+
+#endif // WEB_UI_H
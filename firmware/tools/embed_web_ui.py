@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Compress web/index.html into src/web_ui.h for the firmware to serve.
+
+Run from anywhere after editing the page:
+
+    python3 firmware/tools/embed_web_ui.py
+
+The page is gzipped (deterministically, so an unchanged page produces an
+identical header) and emitted as a PROGMEM byte array together with an ETag
+derived from its contents.
+"""
+
+from __future__ import annotations
+
+import gzip
+import hashlib
+from pathlib import Path
+
+FIRMWARE_DIR = Path(__file__).resolve().parent.parent
+SOURCE = FIRMWARE_DIR / "web" / "index.html"
+OUTPUT = FIRMWARE_DIR / "src" / "web_ui.h"
+
+BYTES_PER_LINE = 16
+
+
+def render(html: bytes) -> str:
+    compressed = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(html).hexdigest()[:16]
+
+    lines = []
+    for offset in range(0, len(compressed), BYTES_PER_LINE):
+        chunk = compressed[offset : offset + BYTES_PER_LINE]
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in chunk) + ",")
+
+    return "\n".join(
+        [
+            "#ifndef WEB_UI_H",
+            "#define WEB_UI_H",
+            "",
+            "// Generated by tools/embed_web_ui.py from web/index.html - do not edit",
+            "",
+            "#include <Arduino.h>",
+            "",
+            f'#define WEB_UI_ETAG "\\"{etag}\\""',
+            "",
+            f"// {len(html)} bytes, gzip-compressed to {len(compressed)}",
+            f"static const size_t WEB_UI_GZ_LENGTH = {len(compressed)};",
+            "static const uint8_t WEB_UI_GZ[] PROGMEM = {",
+            *lines,
+            "};",
+            "",
+            "#endif // WEB_UI_H",
+            "",
+        ]
+    )
+
+
+def main() -> None:
+    header = render(SOURCE.read_bytes())
+    OUTPUT.write_text(header)
+    print(f"Wrote {OUTPUT.relative_to(FIRMWARE_DIR)}")
+
+
+if __name__ == "__main__":
+    main()
@@ -17,7 +17,9 @@ Usage:
     client.disable()
 """
 
+from .async_client import AsyncRoboarmClient, AsyncRoboarmGroup
 from .client import RoboarmClient
+from .stream import RoboarmStream
 
 __version__ = "0.1.0"
-__all__ = ["RoboarmClient"]
+__all__ = ["AsyncRoboarmClient", "AsyncRoboarmGroup", "RoboarmClient", "RoboarmStream"]
@@ -0,0 +1,513 @@
+"""
+Roboarm async client - pipelined commands, many arms from one event loop.
+
+Usage:
+    import asyncio
+    from roboarm import AsyncRoboarmClient, AsyncRoboarmGroup
+
+    async def main():
+        async with AsyncRoboarmClient("http://roboarm.local") as arm:
+            await arm.enable()
+            moves = [arm.move(j1=p) for p in range(0, 20000, 100)]
+            print(await asyncio.gather(*moves))
+
+        async with AsyncRoboarmGroup(["http://arm1.local", "serial:///dev/ttyUSB0"]) as arms:
+            await arms.send_command("M17")
+            print(await arms.status())
+
+Each arm keeps one persistent connection - the /ws WebSocket over HTTP
+(REST calls share a keep-alive httpx.AsyncClient), the port itself over
+Serial - and up to `window` commands are in flight on it at once. The
+controller runs a connection's commands strictly in order, so replies are
+matched to commands first-in, first-out.
+
+Moves also spend queue credits. Every reply reports the free motion queue
+slots ("ok F:<n>" on Serial, "queue_free" on the WebSocket), and a move is
+only sent while the moves already in flight leave a slot for it; when the
+queue is full the client polls with "?" until the arm drains it. A long
+path therefore streams at the arm's pace without "Queue full" rejections.
+"""
+
+from __future__ import annotations
+
+import asyncio
+import json
+import threading
+import time
+from collections import deque
+from collections.abc import Iterator
+from dataclasses import dataclass, field
+from typing import Any
+from urllib.parse import urlparse
+
+import httpx
+import serial
+from websockets.asyncio.client import ClientConnection, connect
+from websockets.exceptions import ConnectionClosed
+
+from . import protocol
+from .client import RoboarmStatus, merge_report, parse_quick_status, read_serial_message
+
+# How often a client blocked on queue credits asks for fresh ones
+CREDIT_POLL_INTERVAL = 0.02
+
+NO_RESPONSE = {"success": False, "message": "No response from controller"}
+
+
+@dataclass
+class _Command:
+    text: str
+    move: bool
+    future: asyncio.Future[dict[str, Any]] | None  # None for credit polls
+
+
+@dataclass
+class _Sent:
+    """One message on the wire, answered by exactly one reply."""
+
+    commands: list[_Command] = field(default_factory=list)
+
+    @property
+    def moves(self) -> int:
+        return sum(1 for command in self.commands if command.move)
+
+
+class AsyncRoboarmClient:
+    """
+    asyncio client for one Roboarm controller, with pipelined commands.
+
+    Args:
+        url: Connection URL, as for RoboarmClient ("http://..." or
+            "serial:///dev/ttyUSB0")
+        timeout: Reply timeout in seconds
+        baud_rate: Serial baud rate
+        window: Commands in flight at once. Over Serial they wait in the
+            controller's receive buffer (SERIAL_RX_BUFFER_SIZE, 4 KB), so
+            keep window times the longest command well below that.
+        telemetry_ms: WebSocket status push interval (None = firmware
+            default, 0 = off); the latest frame is in latest_status
+    """
+
+    def __init__(
+        self,
+        url: str,
+        timeout: float = 10.0,
+        baud_rate: int = 115200,
+        window: int = 8,
+        telemetry_ms: int | None = None,
+    ) -> None:
+        if window < 1:
+            raise ValueError("window must be at least 1")
+        self._url = url
+        self._timeout = timeout
+        self._baud_rate = baud_rate
+        self._window = window
+        self._telemetry_ms = telemetry_ms
+
+        self._http: httpx.AsyncClient | None = None
+        self._ws: ClientConnection | None = None
+        self._serial: serial.Serial | None = None
+        self._serial_thread: threading.Thread | None = None
+        self._serial_lines: list[str] = []
+        self._tasks: list[asyncio.Task[None]] = []
+        self._loop: asyncio.AbstractEventLoop | None = None
+        self._closing = False
+
+        self._pending: deque[_Command] = deque()     # Not sent yet
+        self._in_flight: deque[_Sent] = deque()      # Sent, awaiting a reply
+        self._wakeup = asyncio.Event()
+        self._queue_free: int | None = None          # As of the newest reply
+        self._polling = False
+
+        self._report: RoboarmStatus | None = None
+        self.latest_status: dict[str, Any] | None = None
+
+        parsed = urlparse(url)
+        if parsed.scheme == "serial":
+            self._mode = "serial"
+            self._serial_port = parsed.path or parsed.netloc
+        elif parsed.scheme in ("http", "https"):
+            self._mode = "http"
+            self._base_url = url.rstrip("/")
+            scheme = "wss" if parsed.scheme == "https" else "ws"
+            self._ws_url = f"{scheme}://{parsed.netloc}/ws"
+        else:
+            raise ValueError(f"Unsupported URL scheme: {parsed.scheme}")
+
+    async def connect(self) -> None:
+        """Open the connection and fetch the initial queue credits."""
+        self._loop = asyncio.get_running_loop()
+        self._closing = False
+        if self._mode == "serial":
+            self._serial = await asyncio.to_thread(
+                serial.Serial, port=self._serial_port, baudrate=self._baud_rate, timeout=0.05
+            )
+            # Wait for ESP-32 to be ready, then drop the startup messages
+            await asyncio.sleep(2)
+            self._serial.reset_input_buffer()
+            self._serial_thread = threading.Thread(
+                target=self._serial_reader, name=f"roboarm {self._serial_port}", daemon=True
+            )
+            self._serial_thread.start()
+        else:
+            self._http = httpx.AsyncClient(base_url=self._base_url, timeout=self._timeout)
+            self._ws = await connect(self._ws_url, open_timeout=self._timeout)
+            if self._telemetry_ms is not None:
+                await self._ws.send(json.dumps({"telemetry_ms": self._telemetry_ms}))
+            self._tasks.append(asyncio.create_task(self._ws_reader()))
+
+        self._tasks.append(asyncio.create_task(self._sender()))
+        await self.send_command("?")
+
+    async def disconnect(self) -> None:
+        """Close the connection; commands still waiting get NO_RESPONSE."""
+        self._closing = True
+        for task in self._tasks:
+            task.cancel()
+        for task in self._tasks:
+            try:
+                await task
+            except asyncio.CancelledError:
+                pass
+        self._tasks.clear()
+        self._fail_all()
+
+        if self._ws:
+            await self._ws.close()
+            self._ws = None
+        if self._http:
+            await self._http.aclose()
+            self._http = None
+        if self._serial_thread:
+            await asyncio.to_thread(self._serial_thread.join)
+            self._serial_thread = None
+        if self._serial:
+            self._serial.close()
+            self._serial = None
+
+    async def __aenter__(self) -> AsyncRoboarmClient:
+        await self.connect()
+        return self
+
+    async def __aexit__(self, *args: Any) -> None:
+        await self.disconnect()
+
+    @property
+    def url(self) -> str:
+        return self._url
+
+    @property
+    def mode(self) -> str:
+        """Connection type: "http" or "serial"."""
+        return self._mode
+
+    @property
+    def queue_free(self) -> int | None:
+        """Free motion queue slots reported by the newest reply."""
+        return self._queue_free
+
+    @property
+    def in_flight(self) -> int:
+        """Commands sent and not yet answered."""
+        return sum(len(sent.commands) for sent in self._in_flight)
+
+    @property
+    def latest_report(self) -> RoboarmStatus | None:
+        """Arm state assembled from Serial auto-reports (M154) seen so far."""
+        return self._report
+
+    # -------------------------------------------------------------------------
+    # Pipelining
+    # -------------------------------------------------------------------------
+
+    async def send_command(self, command: str) -> dict[str, Any]:
+        """
+        Queue a G-code command and wait for its reply.
+
+        Returns:
+            Response dict with 'success' and 'message' (plus 'queue_free' when
+            the controller reported it, and 'busy' for retryable rejections).
+            A reply that does not arrive within the timeout gives
+            NO_RESPONSE; a late reply is still matched to its command, so
+            the ones after it stay in step.
+        """
+        return await self._wait(self._submit(command))
+
+    async def send_commands(self, commands: list[str]) -> list[dict[str, Any]]:
+        """Queue several commands at once (in order) and wait for every reply."""
+        futures = [self._submit(command) for command in commands]
+        return list(await asyncio.gather(*(self._wait(future) for future in futures)))
+
+    def _submit(self, command: str) -> asyncio.Future[dict[str, Any]]:
+        if self._loop is None or self._closing:
+            raise RuntimeError("Not connected. Call connect() first.")
+        future: asyncio.Future[dict[str, Any]] = self._loop.create_future()
+        self._pending.append(_Command(command, protocol.is_queued_move(command), future))
+        self._wakeup.set()
+        return future
+
+    async def _wait(self, future: asyncio.Future[dict[str, Any]]) -> dict[str, Any]:
+        try:
+            return await asyncio.wait_for(asyncio.shield(future), self._timeout)
+        except asyncio.TimeoutError:
+            return dict(NO_RESPONSE)
+
+    def _credits(self) -> int:
+        """Queue slots left for moves not yet sent."""
+        if self._queue_free is None:
+            return 0
+        return self._queue_free - sum(sent.moves for sent in self._in_flight)
+
+    async def _sender(self) -> None:
+        while True:
+            await self._wakeup.wait()
+            self._wakeup.clear()
+
+            # Everything that fits the window and the credits; moves keep
+            # their place in line, so a blocked move holds up what follows
+            batch: list[_Command] = []
+            credits = self._credits()
+            while self._pending and self.in_flight + len(batch) < self._window:
+                command = self._pending[0]
+                if command.move:
+                    if credits <= 0:
+                        break
+                    credits -= 1
+                batch.append(self._pending.popleft())
+
+            if batch:
+                await self._transmit(batch)
+            elif self._pending and not self._in_flight and not self._polling:
+                # Blocked on credits with nothing in flight to bring new ones
+                assert self._loop is not None
+                self._polling = True
+                self._loop.call_later(CREDIT_POLL_INTERVAL, self._poll_credits)
+
+    def _poll_credits(self) -> None:
+        self._polling = False
+        if self._closing or self._in_flight:
+            return
+        self._pending.appendleft(_Command("?", False, None))
+        self._wakeup.set()
+
+    async def _transmit(self, batch: list[_Command]) -> None:
+        if self._mode == "http":
+            # One message; its reply has one result per command
+            assert self._ws is not None
+            self._in_flight.append(_Sent(batch))
+            await self._ws.send("\n".join(command.text for command in batch))
+        else:
+            # One line per command, each answered on its own
+            assert self._serial is not None
+            for command in batch:
+                self._in_flight.append(_Sent([command]))
+            data = "".join(f"{command.text}\n" for command in batch).encode()
+            await asyncio.to_thread(self._serial.write, data)
+
+    def _complete(self, results: list[dict[str, Any]], queue_free: int | None) -> None:
+        """Resolve the oldest message in flight with its reply."""
+        if not self._in_flight:
+            return  # Unsolicited, e.g. after a timeout gave up on everything
+        sent = self._in_flight.popleft()
+        if queue_free is not None:
+            self._queue_free = queue_free
+
+        for command, result in zip(sent.commands, results):
+            if queue_free is not None:
+                result.setdefault("queue_free", queue_free)
+            elif command.move and result.get("busy"):
+                self._queue_free = 0  # Serial errors carry no credits
+            if command.future and not command.future.done():
+                command.future.set_result(result)
+        for command in sent.commands[len(results):]:
+            if command.future and not command.future.done():
+                command.future.set_result({"success": False, "message": "error: No result"})
+        self._wakeup.set()
+
+    def _fail_all(self) -> None:
+        for sent in self._in_flight:
+            for command in sent.commands:
+                if command.future and not command.future.done():
+                    command.future.set_result(dict(NO_RESPONSE))
+        for command in self._pending:
+            if command.future and not command.future.done():
+                command.future.set_result(dict(NO_RESPONSE))
+        self._in_flight.clear()
+        self._pending.clear()
+
+    # -------------------------------------------------------------------------
+    # Transports
+    # -------------------------------------------------------------------------
+
+    async def _ws_reader(self) -> None:
+        assert self._ws is not None
+        try:
+            async for raw in self._ws:
+                if isinstance(raw, bytes):
+                    continue  # Binary auto-reports; use RoboarmStream for those
+                message = json.loads(raw)
+                kind = message.get("type")
+                if kind == "result":
+                    self._complete(message.get("results", []), message.get("queue_free"))
+                elif kind == "status":
+                    self.latest_status = message
+        except ConnectionClosed:
+            pass
+        self._fail_all()
+
+    def _serial_reader(self) -> None:
+        """Reader thread: hands each message to the event loop."""
+        assert self._serial is not None and self._loop is not None
+        while not self._closing:
+            try:
+                message = read_serial_message(self._serial, time.time() + 0.1)
+            except (serial.SerialException, OSError):
+                break  # Port closed
+            if message is not None:
+                self._loop.call_soon_threadsafe(self._on_serial_message, message)
+
+    def _on_serial_message(self, message: str | bytes) -> None:
+        if isinstance(message, bytes) or protocol.is_report_line(message):
+            self._report = merge_report(self._report, message)
+            return
+        if not message:
+            return
+        self._serial_lines.append(message)
+        if not protocol.is_reply_end(message):
+            return
+
+        lines = self._serial_lines
+        self._serial_lines = []
+        if message.startswith("error:"):
+            reply: dict[str, Any] = {"success": False, "message": "\n".join(lines)}
+            if message == "error: Queue full":
+                reply["busy"] = True
+            self._complete([reply], None)
+            return
+
+        credits = protocol.parse_credits(message)
+        reply = {"success": True, "message": "\n".join(lines[:-1]) or "ok"}
+        self._complete([reply], credits)
+
+    # -------------------------------------------------------------------------
+    # Commands
+    # -------------------------------------------------------------------------
+
+    async def status(self) -> RoboarmStatus:
+        """Current status: GET /api/status over HTTP, "?" over Serial."""
+        if self._mode == "serial":
+            result = await self.send_command("?")
+            return parse_quick_status(result["message"])
+        if not self._http:
+            raise RuntimeError("Not connected. Call connect() first.")
+        response = await self._http.get("/api/status")
+        return RoboarmStatus.from_dict(response.json())
+
+    async def enable(self) -> dict[str, Any]:
+        """Enable all stepper motors."""
+        return await self.send_command("M17")
+
+    async def disable(self) -> dict[str, Any]:
+        """Disable all stepper motors."""
+        return await self.send_command("M18")
+
+    async def emergency_stop(self) -> dict[str, Any]:
+        """
+        Emergency stop (M112). It goes ahead of commands not sent yet,
+        which are dropped; it cannot overtake the ones already in flight.
+        """
+        for command in self._pending:
+            if command.future and not command.future.done():
+                command.future.set_result({"success": False, "message": "error: Cancelled by E-stop"})
+        self._pending.clear()
+        return await self.send_command("M112")
+
+    async def home(self) -> dict[str, Any]:
+        """Home all joints (G28); returns once homing has started."""
+        return await self.send_command("G28")
+
+    async def move(
+        self,
+        j1: float | None = None,
+        j2: float | None = None,
+        j3: float | None = None,
+        j4: float | None = None,
+        j5: float | None = None,
+        j6: float | None = None,
+        relative: bool = False,
+    ) -> dict[str, Any]:
+        """Queue a joint move in steps (G0, or G1 for relative)."""
+        cmd = "G1" if relative else "G0"
+        for i, pos in enumerate([j1, j2, j3, j4, j5, j6], 1):
+            if pos is not None:
+                cmd += f" J{i}:{int(pos)}"
+        return await self.send_command(cmd)
+
+    async def wait_for_idle(self, timeout: float = 60.0, poll_interval: float = 0.1) -> bool:
+        """
+        Wait until every command is answered and the arm has stopped.
+
+        Returns:
+            True if motors stopped, False if timeout
+        """
+        end_time = time.monotonic() + timeout
+        while time.monotonic() < end_time:
+            if not self._pending and not self._in_flight:
+                status = await self.status()
+                if not status.moving and not status.homing and status.queued == 0:
+                    return True
+            await asyncio.sleep(poll_interval)
+        return False
+
+
+class AsyncRoboarmGroup:
+    """
+    Several arms driven together from one event loop.
+
+    Every call runs on all arms concurrently and returns one result per arm,
+    in the order of `urls`.
+
+    Args:
+        urls: Connection URLs
+        **kwargs: AsyncRoboarmClient options, shared by every arm
+    """
+
+    def __init__(self, urls: list[str], **kwargs: Any) -> None:
+        self.arms = [AsyncRoboarmClient(url, **kwargs) for url in urls]
+
+    async def connect(self) -> None:
+        await asyncio.gather(*(arm.connect() for arm in self.arms))
+
+    async def disconnect(self) -> None:
+        await asyncio.gather(*(arm.disconnect() for arm in self.arms))
+
+    async def __aenter__(self) -> AsyncRoboarmGroup:
+        await self.connect()
+        return self
+
+    async def __aexit__(self, *args: Any) -> None:
+        await self.disconnect()
+
+    def __len__(self) -> int:
+        return len(self.arms)
+
+    def __iter__(self) -> Iterator[AsyncRoboarmClient]:
+        return iter(self.arms)
+
+    def __getitem__(self, index: int) -> AsyncRoboarmClient:
+        return self.arms[index]
+
+    async def send_command(self, command: str) -> list[dict[str, Any]]:
+        """Send the same command to every arm."""
+        return list(await asyncio.gather(*(arm.send_command(command) for arm in self.arms)))
+
+    async def status(self) -> list[RoboarmStatus]:
+        return list(await asyncio.gather(*(arm.status() for arm in self.arms)))
+
+    async def emergency_stop(self) -> list[dict[str, Any]]:
+        return list(await asyncio.gather(*(arm.emergency_stop() for arm in self.arms)))
+
+    async def wait_for_idle(self, timeout: float = 60.0) -> bool:
+        """True once every arm is idle, False if any timed out."""
+        done = await asyncio.gather(*(arm.wait_for_idle(timeout) for arm in self.arms))
+        return all(done)
@@ -0,0 +1,162 @@
+"""
+Roboarm throughput benchmark - command round trips and segment rate.
+
+Usage:
+    from roboarm import RoboarmClient, bench
+
+    with RoboarmClient("http://roboarm.local") as client:
+        client.enable()
+        for transport in bench.transports(client):
+            print(bench.run(client, transport))
+
+Each run times quick-status ("?") round trips, then streams small moves on
+one joint - back and forth, so the arm ends where it started - re-sending
+any the controller rejects with a full queue, and times until the queue has
+drained. That rate is end to end: transport, parser, planner and the
+steppers themselves.
+"""
+
+from __future__ import annotations
+
+import time
+from collections.abc import Callable
+from dataclasses import dataclass
+from typing import Any
+
+from .client import RoboarmClient
+
+Sender = Callable[[str], dict[str, Any]]
+
+# Cheapest command there is, so its round trip is mostly transport
+PING_COMMAND = "?"
+
+
+@dataclass
+class BenchResult:
+    """Results of one transport's run (latencies in milliseconds)."""
+
+    transport: str
+    round_trips: int
+    min_ms: float
+    mean_ms: float
+    p50_ms: float
+    p99_ms: float
+    max_ms: float
+    segments: int
+    retries: int        # Moves re-sent because the motion queue was full
+    seconds: float      # First segment sent to queue drained
+
+    @property
+    def segments_per_second(self) -> float:
+        return self.segments / self.seconds if self.seconds > 0 else 0.0
+
+
+def transports(client: RoboarmClient) -> list[str]:
+    """Transports the client's connection can be benchmarked over."""
+    return ["serial"] if client.mode == "serial" else ["http", "ws"]
+
+
+def _percentile(ordered: list[float], percent: float) -> float:
+    return ordered[min(len(ordered) - 1, int(len(ordered) * percent / 100))]
+
+
+def _is_busy(reply: dict[str, Any]) -> bool:
+    return bool(reply.get("busy")) or "Queue full" in str(reply.get("message", ""))
+
+
+def time_round_trips(send: Sender, count: int) -> list[float]:
+    """Send PING_COMMAND count times; returns each round trip in ms."""
+    samples = []
+    for _ in range(count):
+        start = time.perf_counter()
+        reply = send(PING_COMMAND)
+        samples.append((time.perf_counter() - start) * 1000)
+        if not reply.get("success"):
+            raise RuntimeError(f"{PING_COMMAND}: {reply.get('message')}")
+    return samples
+
+
+def stream_segments(send: Sender, count: int, joint: int, steps: int) -> int:
+    """
+    Queue count relative moves of +steps/-steps on one joint (count should
+    be even to end where it started), re-sending busy ones.
+
+    Returns:
+        Number of re-sends
+    """
+    retries = 0
+    for i in range(count):
+        command = f"G1 J{joint}:{steps if i % 2 == 0 else -steps}"
+        while True:
+            reply = send(command)
+            if reply.get("success"):
+                break
+            if not _is_busy(reply):
+                raise RuntimeError(f"{command}: {reply.get('message')}")
+            retries += 1
+    return retries
+
+
+def run(
+    client: RoboarmClient,
+    transport: str,
+    round_trips: int = 200,
+    segments: int = 200,
+    joint: int = 1,
+    steps: int = 10,
+) -> BenchResult:
+    """
+    Benchmark one transport. The motors must be enabled; the queue is
+    drained before and after.
+
+    Args:
+        client: Connected client
+        transport: "http", "ws" or "serial" (see transports())
+        round_trips: Quick-status round trips to time
+        segments: Moves to stream (rounded up to an even number)
+        joint: Joint to move back and forth
+        steps: Size of each move, steps
+    """
+    if transport not in transports(client):
+        raise ValueError(f"Transport {transport!r} not available over {client.mode}")
+    segments += segments % 2
+
+    if transport == "ws":
+        with client.stream(telemetry_ms=0) as stream:
+            return _run(client, stream.send_command, transport, round_trips,
+                        segments, joint, steps)
+    return _run(client, client.send_command, transport, round_trips, segments, joint, steps)
+
+
+def _run(
+    client: RoboarmClient,
+    send: Sender,
+    transport: str,
+    round_trips: int,
+    segments: int,
+    joint: int,
+    steps: int,
+) -> BenchResult:
+    if not client.wait_for_idle(timeout=30.0):
+        raise RuntimeError("Arm did not become idle")
+
+    samples = sorted(time_round_trips(send, round_trips))
+
+    start = time.perf_counter()
+    retries = stream_segments(send, segments, joint, steps)
+    if not client.wait_for_idle(timeout=60.0, poll_interval=0.01):
+        raise RuntimeError("Timed out waiting for the motion queue to drain")
+    seconds = time.perf_counter() - start
+
+    return BenchResult(
+        transport=transport,
+        round_trips=len(samples),
+        min_ms=samples[0],
+        mean_ms=sum(samples) / len(samples),
+        p50_ms=_percentile(samples, 50),
+        p99_ms=_percentile(samples, 99),
+        max_ms=samples[-1],
+        segments=segments,
+        retries=retries,
+        seconds=seconds,
+    )
@@ -9,6 +9,7 @@ Usage:
 
 from __future__ import annotations
 
+from pathlib import Path
 from typing import Annotated
 
 import typer
@@ -16,6 +17,8 @@ from rich import print as rprint
 from rich.console import Console
 from rich.table import Table
 
+from . import bench as benchmark
+from . import trajectory
 from .client import RoboarmClient
 
 app = typer.Typer(
@@ -47,6 +50,7 @@ def status(
 
         table.add_row("Enabled", "Yes" if status.enabled else "No")
         table.add_row("Moving", "Yes" if status.moving else "No")
+        table.add_row("Queued", str(status.queued))
 
         if status.ip:
             table.add_row("IP Address", status.ip)
@@ -121,6 +125,8 @@ def move(
     j5: Annotated[int | None, typer.Option("--j5", help="Joint 5 position")] = None,
     j6: Annotated[int | None, typer.Option("--j6", help="Joint 6 position")] = None,
     relative: Annotated[bool, typer.Option("--relative", "-r", help="Relative move")] = False,
+    speed: Annotated[int | None, typer.Option("--speed", help="Speed cap, steps/s")] = None,
+    accel: Annotated[int | None, typer.Option("--accel", help="Accel cap, steps/s^2")] = None,
     wait: Annotated[bool, typer.Option("--wait", "-w", help="Wait for completion")] = False,
 ) -> None:
     """Move joints to specified positions."""
@@ -129,7 +135,10 @@ def move(
         raise typer.Exit(1)
 
     with get_client(url) as client:
-        result = client.move(j1=j1, j2=j2, j3=j3, j4=j4, j5=j5, j6=j6, relative=relative)
+        result = client.move(
+            j1=j1, j2=j2, j3=j3, j4=j4, j5=j5, j6=j6,
+            relative=relative, speed=speed, accel=accel,
+        )
 
         if result["success"]:
             mode = "relative" if relative else "absolute"
@@ -142,18 +151,56 @@ def move(
                 else:
                     rprint("[yellow]Timeout waiting for move[/yellow]")
         else:
-            rprint(f"[red]Error: {result['message']}[/red]")
+            rprint(f"[red]Error: {result.get('message', result.get('error'))}[/red]")
+
+
+@app.command()
+def movel(
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+    x: Annotated[float | None, typer.Option("--x", help="Tool X, mm")] = None,
+    y: Annotated[float | None, typer.Option("--y", help="Tool Y, mm")] = None,
+    z: Annotated[float | None, typer.Option("--z", help="Tool Z, mm")] = None,
+    a: Annotated[float | None, typer.Option("--a", help="Rotation about X, degrees")] = None,
+    b: Annotated[float | None, typer.Option("--b", help="Rotation about Y, degrees")] = None,
+    c: Annotated[float | None, typer.Option("--c", help="Rotation about Z, degrees")] = None,
+    relative: Annotated[bool, typer.Option("--relative", "-r", help="Offsets from current pose")] = False,
+    speed: Annotated[float | None, typer.Option("--speed", help="Tool speed, mm/s")] = None,
+    wait: Annotated[bool, typer.Option("--wait", "-w", help="Wait for completion")] = False,
+) -> None:
+    """Move the tool in a straight line to a Cartesian pose."""
+    if all(v is None for v in [x, y, z, a, b, c]):
+        rprint("[red]Error: Specify at least one of --x, --y, --z, --a, --b, --c[/red]")
+        raise typer.Exit(1)
+
+    with get_client(url) as client:
+        result = client.move_linear(x=x, y=y, z=z, a=a, b=b, c=c, relative=relative, speed=speed)
+
+        if result["success"]:
+            rprint("[green]Linear move started[/green]")
+
+            if wait:
+                rprint("Waiting for move to complete...")
+                if client.wait_for_idle():
+                    rprint("[green]Move complete[/green]")
+                else:
+                    rprint("[yellow]Timeout waiting for move[/yellow]")
+        else:
+            rprint(f"[red]Error: {result.get('message', result.get('error'))}[/red]")
 
 
 @app.command()
 def home(
     url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
 ) -> None:
-    """Home all axes (sets current position as zero)."""
+    """Home all joints against their endstops."""
     with get_client(url) as client:
         result = client.home()
         if result["success"]:
-            rprint("[green]All joints homed (zeroed)[/green]")
+            rprint(f"[green]{result['message']}[/green]")
+            if client.wait_for_idle():
+                rprint("[green]Homing finished[/green]")
+            else:
+                rprint("[yellow]Timeout waiting for homing[/yellow]")
         else:
             rprint(f"[red]Error: {result['message']}[/red]")
 
@@ -172,5 +219,191 @@ def send(
             rprint(f"[red]{result['message']}[/red]")
 
 
+@app.command()
+def batch(
+    file: Annotated[typer.FileText, typer.Argument(help="G-code file, one command per line")],
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+) -> None:
+    """Upload a G-code file as a single batch (moves are queued all-or-nothing)."""
+    commands = [
+        line.split(";", 1)[0].strip() for line in file if line.split(";", 1)[0].strip()
+    ]
+    if not commands:
+        rprint("[red]Error: No commands in file[/red]")
+        raise typer.Exit(1)
+
+    with get_client(url) as client:
+        result = client.execute_batch(commands)
+        if result["success"]:
+            rprint(f"[green]{len(result['results'])} commands executed[/green]")
+        else:
+            message = result["results"][-1] if result["results"] else result.get("error")
+            rprint(f"[red]Batch failed: {message}[/red]")
+            raise typer.Exit(1)
+
+
+@app.command()
+def upload(
+    file: Annotated[typer.FileBinaryRead, typer.Argument(help="G-code program file")],
+    name: Annotated[str | None, typer.Option("--name", "-n", help="Name on the controller")] = None,
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+) -> None:
+    """Store a G-code program on the controller's flash."""
+    program_name = name or Path(file.name).name
+    with get_client(url) as client:
+        result = client.upload_program(program_name, file.read())
+        if result.get("success"):
+            rprint(f"[green]Stored {result['name']} ({result['size']} bytes)[/green]")
+        else:
+            rprint(f"[red]Upload failed: {result.get('error')}[/red]")
+            raise typer.Exit(1)
+
+
+@app.command()
+def programs(
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+) -> None:
+    """List programs stored on the controller."""
+    with get_client(url) as client:
+        result = client.list_programs()
+
+        table = Table(title="Stored Programs")
+        table.add_column("Name", style="cyan")
+        table.add_column("Size", justify="right")
+        for program in result.get("programs", []):
+            table.add_row(program["name"], str(program["size"]))
+        console.print(table)
+
+        playback = result.get("playback", {})
+        if "name" in playback:
+            rprint(f"Playback: {playback['name']} {playback['state']} "
+                   f"(line {playback['line']})")
+        if "error" in playback:
+            rprint(f"[red]{playback['error']}[/red]")
+
+
+@app.command()
+def play(
+    name: Annotated[str, typer.Argument(help="Stored program name")],
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+) -> None:
+    """Play a stored program from the controller's flash."""
+    with get_client(url) as client:
+        result = client.play_program(name)
+        if result["success"]:
+            rprint(f"[green]{result['message']}[/green]")
+        else:
+            rprint(f"[red]{result['message']}[/red]")
+            raise typer.Exit(1)
+
+
+@app.command("compile")
+def compile_trajectory(
+    file: Annotated[typer.FileText, typer.Argument(help="G-code path (G0/G1, G28, M204, M800)")],
+    output: Annotated[Path | None, typer.Option("--output", "-o", help="Output .traj file")] = None,
+) -> None:
+    """Compile a G-code path into a binary trajectory for flash playback."""
+    try:
+        records = trajectory.compile_gcode(file)
+        data = trajectory.pack(records)
+    except ValueError as e:
+        rprint(f"[red]Error: {e}[/red]")
+        raise typer.Exit(1) from e
+
+    target = output or Path(file.name).with_suffix(".traj")
+    target.write_bytes(data)
+    rprint(f"[green]{len(records)} moves -> {target} ({len(data)} bytes)[/green]")
+
+
+@app.command()
+def upload_trajectory(
+    file: Annotated[typer.FileBinaryRead, typer.Argument(help="Compiled .traj file")],
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+) -> None:
+    """Store a compiled trajectory on the controller's flash."""
+    data = file.read()
+    try:
+        trajectory.unpack(data)
+    except ValueError as e:
+        rprint(f"[red]Error: {e}[/red]")
+        raise typer.Exit(1) from e
+
+    with get_client(url) as client:
+        result = client.upload_trajectory(data)
+        if result.get("success"):
+            rprint(f"[green]Stored trajectory ({result['records']} moves)[/green]")
+        else:
+            rprint(f"[red]Upload failed: {result.get('error')}[/red]")
+            raise typer.Exit(1)
+
+
+@app.command()
+def play_trajectory(
+    repeat: Annotated[int, typer.Option("--repeat", "-n", help="Passes (0 = until stopped)")] = 1,
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+) -> None:
+    """Play the stored trajectory from the controller's flash."""
+    with get_client(url) as client:
+        result = client.play_trajectory(repeat)
+        if result["success"]:
+            rprint(f"[green]{result['message']}[/green]")
+        else:
+            rprint(f"[red]{result['message']}[/red]")
+            raise typer.Exit(1)
+
+
 if __name__ == "__main__":
     app()
+
+
+@app.command()
+def bench(
+    url: Annotated[str, typer.Option("--url", "-u", help="Controller URL")] = "http://roboarm.local",
+    transport: Annotated[
+        list[str] | None,
+        typer.Option("--transport", "-t", help="http, ws or serial (default: all available)"),
+    ] = None,
+    round_trips: Annotated[
+        int, typer.Option("--round-trips", min=1, help="Quick-status round trips to time")
+    ] = 200,
+    segments: Annotated[int, typer.Option("--segments", min=2, help="Moves to stream")] = 200,
+    joint: Annotated[int, typer.Option("--joint", min=1, max=6, help="Joint to move")] = 1,
+    steps: Annotated[int, typer.Option("--steps", min=1, help="Size of each move, steps")] = 10,
+) -> None:
+    """
+    Measure round-trip latency and end-to-end segments per second.
+
+    Enables the motors and moves one joint back and forth by --steps.
+    """
+    with get_client(url) as client:
+        transports = transport or benchmark.transports(client)
+        result = client.enable()
+        if not result["success"]:
+            rprint(f"[red]Error: {result['message']}[/red]")
+            raise typer.Exit(1)
+
+        table = Table(title="Roboarm Benchmark")
+        table.add_column("Transport", style="cyan")
+        for column in ("RTT min", "mean", "p50", "p99", "max"):
+            table.add_column(column + " (ms)", justify="right", style="green")
+        table.add_column("Segments/s", justify="right", style="yellow")
+        table.add_column("Retries", justify="right", style="magenta")
+
+        for name in transports:
+            try:
+                run = benchmark.run(client, name, round_trips, segments, joint, steps)
+            except (ValueError, RuntimeError) as e:
+                rprint(f"[red]{name}: {e}[/red]")
+                raise typer.Exit(1) from e
+            table.add_row(
+                name,
+                f"{run.min_ms:.2f}",
+                f"{run.mean_ms:.2f}",
+                f"{run.p50_ms:.2f}",
+                f"{run.p99_ms:.2f}",
+                f"{run.max_ms:.2f}",
+                f"{run.segments_per_second:.1f}",
+                str(run.retries),
+            )
+
+        console.print(table)
@@ -8,12 +8,16 @@ from __future__ import annotations
 
 import time
 from dataclasses import dataclass
+from pathlib import Path
 from typing import Any
 from urllib.parse import urlparse
 
 import httpx
 import serial
 
+from . import protocol, trace
+from .stream import RoboarmStream
+
 
 @dataclass
 class RoboarmStatus:
@@ -24,6 +28,13 @@ class RoboarmStatus:
     positions: dict[str, int]
     targets: dict[str, int]
     distances: dict[str, int]
+    queued: int = 0
+    queue_free: int | None = None
+    homing: bool = False
+    homed: dict[str, bool] | None = None
+    pose: dict[str, float] | None = None
+    joint_positions: dict[str, float] | None = None
+    encoder: dict[str, Any] | None = None
     ip: str | None = None
     uptime: int | None = None
 
@@ -35,6 +46,13 @@ class RoboarmStatus:
             positions=data.get("positions", {}),
             targets=data.get("targets", {}),
             distances=data.get("distances", {}),
+            queued=data.get("queued", 0),
+            queue_free=data.get("queue_free"),
+            homing=data.get("homing", False),
+            homed=data.get("homed"),
+            pose=data.get("pose"),
+            joint_positions=data.get("joint_positions"),
+            encoder=data.get("encoder"),
             ip=data.get("ip"),
             uptime=data.get("uptime"),
         )
@@ -52,6 +70,8 @@ class RoboarmClient:
             - Serial: "serial:///dev/ttyUSB0" or "serial://COM3"
         timeout: Connection timeout in seconds
         baud_rate: Serial baud rate (default: 115200)
+        binary: Send moves as compact binary frames over Serial
+            (see roboarm.protocol); other commands stay ASCII
     """
 
     def __init__(
@@ -59,12 +79,16 @@ class RoboarmClient:
         url: str,
         timeout: float = 10.0,
         baud_rate: int = 115200,
+        binary: bool = False,
     ) -> None:
         self._url = url
         self._timeout = timeout
         self._baud_rate = baud_rate
+        self._binary = binary
+        self._seq = 0
         self._serial: serial.Serial | None = None
         self._http_client: httpx.Client | None = None
+        self._report: RoboarmStatus | None = None
 
         # Determine connection type
         parsed = urlparse(url)
@@ -108,6 +132,11 @@ class RoboarmClient:
     def __exit__(self, *args: Any) -> None:
         self.disconnect()
 
+    @property
+    def mode(self) -> str:
+        """Connection type: "http" or "serial"."""
+        return self._mode
+
     def send_command(self, command: str) -> dict[str, Any]:
         """
         Send a G-code command to the controller.
@@ -116,13 +145,144 @@ class RoboarmClient:
             command: G-code command (e.g., "G0 J1:1000")
 
         Returns:
-            Response dict with 'success' and 'message' keys
+            Response dict with 'success' and 'message' keys. Moves rejected
+            because the controller's motion queue is full report
+            "error: Queue full" and should be retried.
         """
         if self._mode == "serial":
             return self._send_serial(command)
         else:
             return self._send_http(command)
 
+    def execute_batch(self, commands: list[str]) -> dict[str, Any]:
+        """
+        Execute many commands in one request.
+
+        Over HTTP the whole list goes to /api/batch: moves are queued
+        all-or-nothing (HTTP 503 if they don't all fit), and execution stops
+        at the first failing command. Over Serial the commands are sent one
+        by one, stopping at the first error.
+
+        Returns:
+            Dict with 'success', 'results' (one message per executed command)
+            and 'queue_free'
+        """
+        if self._mode == "http":
+            if not self._http_client:
+                raise RuntimeError("Not connected. Call connect() first.")
+            response = self._http_client.post(
+                f"{self._base_url}/api/batch",
+                json={"commands": commands},
+            )
+            result: dict[str, Any] = response.json()
+            result.setdefault("results", [])
+            return result
+
+        results: list[str] = []
+        for command in commands:
+            reply = self._send_serial(command)
+            results.append(reply["message"])
+            if not reply["success"]:
+                return {"success": False, "results": results}
+        return {"success": True, "results": results}
+
+    def _require_http(self, operation: str) -> httpx.Client:
+        if self._mode != "http":
+            raise RuntimeError(f"{operation} requires an HTTP connection")
+        if not self._http_client:
+            raise RuntimeError("Not connected. Call connect() first.")
+        return self._http_client
+
+    def upload_program(self, name: str, program: str | bytes) -> dict[str, Any]:
+        """
+        Store a G-code program on the controller's flash (HTTP only).
+
+        An existing program with the same name is replaced once the upload
+        has completed.
+
+        Returns:
+            Dict with 'success', 'name' and 'size' (or 'error')
+        """
+        client = self._require_http("Program upload")
+        body = program.encode() if isinstance(program, str) else program
+        response = client.post(
+            f"{self._base_url}/api/programs",
+            params={"name": name},
+            content=body,
+            headers={"Content-Type": "text/plain"},
+        )
+        result: dict[str, Any] = response.json()
+        return result
+
+    def list_programs(self) -> dict[str, Any]:
+        """
+        List stored programs and playback status (HTTP only).
+
+        Returns:
+            Dict with 'programs' ([{'name', 'size'}]), 'total_bytes',
+            'used_bytes' and 'playback'
+        """
+        client = self._require_http("Program listing")
+        result: dict[str, Any] = client.get(f"{self._base_url}/api/programs").json()
+        return result
+
+    def delete_program(self, name: str) -> dict[str, Any]:
+        """Delete a stored program (HTTP only)."""
+        client = self._require_http("Program deletion")
+        response = client.delete(f"{self._base_url}/api/programs", params={"name": name})
+        result: dict[str, Any] = response.json()
+        return result
+
+    def play_program(self, name: str) -> dict[str, Any]:
+        """Select a stored program and start playing it from flash."""
+        result = self.send_command(f"M23 {name}")
+        if not result["success"]:
+            return result
+        return self.send_command("M24")
+
+    def pause_program(self) -> dict[str, Any]:
+        """Pause the running program (moves already queued still run)."""
+        return self.send_command("M25")
+
+    def resume_program(self) -> dict[str, Any]:
+        """Resume a paused program."""
+        return self.send_command("M24")
+
+    def abort_program(self) -> dict[str, Any]:
+        """Abort the running program and stop motion."""
+        return self.send_command("M524")
+
+    def upload_trajectory(self, data: bytes) -> dict[str, Any]:
+        """
+        Store a compiled trajectory (see roboarm.trajectory) on the
+        controller's flash, replacing the previous one (HTTP only).
+
+        Returns:
+            Dict with 'success' and 'records' (or 'error')
+        """
+        client = self._require_http("Trajectory upload")
+        response = client.post(
+            f"{self._base_url}/api/trajectory",
+            content=data,
+            headers={"Content-Type": "application/octet-stream"},
+        )
+        result: dict[str, Any] = response.json()
+        return result
+
+    def trajectory_info(self) -> dict[str, Any]:
+        """Get the stored trajectory and its playback state (HTTP only)."""
+        client = self._require_http("Trajectory info")
+        result: dict[str, Any] = client.get(f"{self._base_url}/api/trajectory").json()
+        return result
+
+    def play_trajectory(self, repeat: int = 1) -> dict[str, Any]:
+        """Play the stored trajectory `repeat` times (0 = until stopped)."""
+        return self.send_command(f"M720 L{repeat}")
+
+    def stop_trajectory(self) -> dict[str, Any]:
+        """Stop trajectory playback and motion."""
+        return self.send_command("M721")
+
     def _send_serial(self, command: str) -> dict[str, Any]:
         if not self._serial:
             raise RuntimeError("Not connected. Call connect() first.")
@@ -131,30 +291,31 @@ class RoboarmClient:
         self._serial.write(f"{command}\n".encode())
         self._serial.flush()
 
-        # Read response (until we get a line)
+        # Read response (until we get a line); auto-reports are set aside
         response_lines = []
         timeout_end = time.time() + self._timeout
 
-        while time.time() < timeout_end:
-            if self._serial.in_waiting:
-                line = self._serial.readline().decode().strip()
-                if line:
-                    response_lines.append(line)
-                    # Check if we've received a complete response
-                    if line.startswith("ok") or line.startswith("error:"):
-                        break
-            else:
-                time.sleep(0.01)
+        while True:
+            message = self._read_serial_message(timeout_end)
+            if message is None:
+                break
+            if isinstance(message, bytes) or protocol.is_report_line(message):
+                self._apply_report(message)
+                continue
+            if message:
+                response_lines.append(message)
+                if protocol.is_reply_end(message):
+                    break
 
-        if not response_lines:
-            return {"success": False, "message": "No response from controller"}
+        return _serial_reply(response_lines)
 
-        # Parse response
-        full_response = "\n".join(response_lines)
-        if response_lines[-1].startswith("error:"):
-            return {"success": False, "message": full_response}
+    def _read_serial_message(self, deadline: float) -> str | bytes | None:
+        assert self._serial is not None
+        return read_serial_message(self._serial, deadline)
 
-        return {"success": True, "message": full_response}
+    def _apply_report(self, message: str | bytes) -> None:
+        """Merge an auto-report (text line or FRAME_STATUS frame) into latest_report."""
+        self._report = merge_report(self._report, message)
 
     def _send_http(self, command: str) -> dict[str, Any]:
         if not self._http_client:
@@ -167,29 +328,116 @@ class RoboarmClient:
         result: dict[str, Any] = response.json()
         return result
 
+    def _send_binary(self, targets: dict[int, int], relative: bool) -> dict[str, Any]:
+        if not self._serial:
+            raise RuntimeError("Not connected. Call connect() first.")
+
+        self._seq = (self._seq + 1) & 0xFF
+        self._serial.write(protocol.encode_move(targets, relative=relative, seq=self._seq))
+
+        # Skip text (e.g. debug output) and set auto-reports aside
+        timeout_end = time.time() + self._timeout
+        while True:
+            message = self._read_serial_message(timeout_end)
+            if message is None:
+                break
+            if isinstance(message, str):
+                if protocol.is_report_line(message):
+                    self._apply_report(message)
+                continue
+            if message[1] == protocol.FRAME_STATUS:
+                self._apply_report(message)
+                continue
+            try:
+                ack = protocol.decode_ack(message)
+            except ValueError:
+                continue
+            if ack.seq != self._seq:
+                continue
+            return {
+                "success": ack.success,
+                "busy": ack.status == protocol.STATUS_QUEUE_FULL,
+                "message": ack.message,
+                "queue_free": ack.queue_free,
+            }
+
+        return {"success": False, "message": "No response from controller"}
+
+    def set_baud_rate(self, baud_rate: int) -> dict[str, Any]:
+        """
+        Change the controller's serial baud rate (M575) and follow it.
+
+        The controller replies at the old rate, then switches. Up to
+        3,000,000 baud is supported by the ESP32 UART.
+        """
+        result = self.send_command(f"M575 B{baud_rate}")
+        if result["success"] and self._serial:
+            self._serial.baudrate = baud_rate
+            self._serial.reset_input_buffer()
+            self._baud_rate = baud_rate
+        return result
+
+    def auto_report(self, interval_ms: int, binary: bool = False) -> dict[str, Any]:
+        """
+        Have the controller push changed joints over Serial (M154) at most
+        every interval_ms (0 = off), as text lines or FRAME_STATUS frames.
+
+        Reports arriving with command replies are merged into
+        latest_report; read_report() waits for the next one.
+        """
+        self._report = None
+        return self.send_command(f"M154 S{interval_ms} B{1 if binary else 0}")
+
+    @property
+    def latest_report(self) -> RoboarmStatus | None:
+        """Arm state assembled from the auto-reports received so far."""
+        return self._report
+
+    def read_report(self, timeout: float | None = None) -> RoboarmStatus | None:
+        """
+        Wait for the next auto-report and return the merged state.
+
+        Returns:
+            None if no report arrived within timeout (default: client timeout)
+        """
+        if not self._serial:
+            raise RuntimeError("Auto-reports require a serial connection")
+        deadline = time.time() + (self._timeout if timeout is None else timeout)
+        while True:
+            message = self._read_serial_message(deadline)
+            if message is None:
+                return None
+            if isinstance(message, bytes) and message[1] == protocol.FRAME_STATUS:
+                self._apply_report(message)
+                return self._report
+            if isinstance(message, str) and protocol.is_report_line(message):
+                self._apply_report(message)
+                return self._report
+
+    def stream(
+        self, telemetry_ms: int | None = None, report: str | None = None
+    ) -> RoboarmStream:
+        """
+        Open a WebSocket stream for batched commands and pushed status.
+
+        Args:
+            telemetry_ms: Status push interval (None = firmware default, 0 = off)
+            report: "full", "delta" or "binary" (see RoboarmStream)
+
+        Returns:
+            Unconnected RoboarmStream; use it as a context manager
+        """
+        if self._mode != "http":
+            raise RuntimeError("Streaming requires an HTTP connection")
+        return RoboarmStream(
+            self._base_url, timeout=self._timeout, telemetry_ms=telemetry_ms, report=report
+        )
+
     def status(self) -> RoboarmStatus:
         """Get current status of the robotic arm."""
         if self._mode == "serial":
             result = self.send_command("?")
-            # Parse quick status format: "EM P:0,0,0,0,0,0"
-            # This is a simplified implementation
-            parts = result["message"].split()
-            enabled = "E" in parts[0]
-            moving = "M" in parts[0]
-
-            positions = {}
-            if len(parts) > 1 and parts[1].startswith("P:"):
-                pos_values = parts[1][2:].split(",")
-                for i, val in enumerate(pos_values):
-                    positions[f"j{i + 1}"] = int(val)
-
-            return RoboarmStatus(
-                enabled=enabled,
-                moving=moving,
-                positions=positions,
-                targets={},
-                distances={},
-            )
+            return parse_quick_status(result["message"])
         else:
             if not self._http_client:
                 raise RuntimeError("Not connected. Call connect() first.")
@@ -211,35 +459,316 @@ class RoboarmClient:
 
     def move(
         self,
-        j1: int | None = None,
-        j2: int | None = None,
-        j3: int | None = None,
-        j4: int | None = None,
-        j5: int | None = None,
-        j6: int | None = None,
+        j1: float | None = None,
+        j2: float | None = None,
+        j3: float | None = None,
+        j4: float | None = None,
+        j5: float | None = None,
+        j6: float | None = None,
         relative: bool = False,
+        coordinated: bool | None = None,
+        speed: int | None = None,
+        accel: int | None = None,
+        units: str = "steps",
     ) -> dict[str, Any]:
         """
         Move joints to specified positions.
 
+        Over HTTP the move goes to /api/move as JSON and is queued without a
+        G-code round trip; Serial sends G0/G1 (or a binary frame).
+
         Args:
-            j1-j6: Target positions in steps (None to skip)
+            j1-j6: Target positions (None to skip)
             relative: If True, positions are relative to current position
+            coordinated: All joints arrive together (None = controller mode;
+                HTTP only)
+            speed: Speed cap for this move in steps/s (HTTP only)
+            accel: Acceleration cap for this move in steps/s^2 (HTTP only)
+            units: "steps", or "joint" for degrees/mm as configured on the
+                controller (HTTP only; over Serial use set_joint_units())
 
         Returns:
             Response dict
         """
-        cmd = "G1" if relative else "G0"
         joints = [j1, j2, j3, j4, j5, j6]
+        overrides = coordinated is not None or speed is not None or accel is not None
+
+        if self._mode == "http":
+            move = _move_body(joints, relative, coordinated, speed, accel)
+            if units != "steps":
+                move["units"] = units
+            response = self._require_http("move").post(f"{self._base_url}/api/move", json=move)
+            result: dict[str, Any] = response.json()
+            return result
+
+        if overrides or units != "steps":
+            raise RuntimeError(
+                "Per-move coordinated/speed/accel/units requires an HTTP connection"
+            )
+
+        if self._binary:
+            targets = {i: int(pos) for i, pos in enumerate(joints, 1) if pos is not None}
+            return self._send_binary(targets, relative)
+
+        cmd = "G1" if relative else "G0"
 
         for i, pos in enumerate(joints, 1):
             if pos is not None:
-                cmd += f" J{i}:{pos}"
+                cmd += f" J{i}:{int(pos)}"
+
+        return self.send_command(cmd)
+
+    def move_linear(
+        self,
+        x: float | None = None,
+        y: float | None = None,
+        z: float | None = None,
+        a: float | None = None,
+        b: float | None = None,
+        c: float | None = None,
+        relative: bool = False,
+        speed: float | None = None,
+    ) -> dict[str, Any]:
+        """
+        Move the tool in a straight line to a Cartesian pose (G0/G1 X..C).
+
+        The controller interpolates the line and solves the joint angles
+        itself, so one call replaces a densely sampled joint path. The arm
+        must be homed first.
+
+        Args:
+            x, y, z: Tool position in mm (None keeps the current value)
+            a, b, c: Tool orientation in degrees, rotations about X, Y, Z
+            relative: Values are offsets from the current pose
+            speed: Tool speed along the line in mm/s (None = controller default)
+
+        Returns:
+            Response dict (busy while the previous linear move is still being
+            fed to the motion queue - retry)
+        """
+        axes = {"X": x, "Y": y, "Z": z, "A": a, "B": b, "C": c}
+        words = [f"{axis}{value:g}" for axis, value in axes.items() if value is not None]
+        if not words:
+            raise ValueError("Specify at least one of x, y, z, a, b, c")
+        if speed is not None:
+            words.append(f"F{speed:g}")
+        return self.send_command(("G1 " if relative else "G0 ") + " ".join(words))
+
+    def move_many(self, moves: list[dict[str, Any]]) -> dict[str, Any]:
+        """
+        Queue several moves in one request (/api/moves), all-or-nothing.
+
+        Args:
+            moves: Move objects as accepted by /api/move, e.g.
+                {"j1": 1000, "j2": 500, "speed": 2000, "relative": True}
+
+        Returns:
+            Dict with 'success', 'queue_free' and 'queued' (or 'error', plus
+            'index' of the failing move)
+        """
+        client = self._require_http("move_many")
+        response = client.post(f"{self._base_url}/api/moves", json={"moves": moves})
+        result: dict[str, Any] = response.json()
+        return result
+
+    def jog(self, speeds: dict[int, int]) -> dict[str, Any]:
+        """
+        Jog joints at signed speeds in steps/s (M810, velocity mode).
+
+        Joints not listed stop; an empty dict stops all. Repeat within the
+        controller's watchdog (250 ms) to keep moving. For high-rate
+        teleoperation prefer RoboarmStream.jog().
+        """
+        cmd = "M810" + "".join(f" J{joint}:{speed}" for joint, speed in sorted(speeds.items()))
+        return self.send_command(cmd)
+
+    def set_coordinated(self, enabled: bool = True) -> dict[str, Any]:
+        """Make all joints of each move arrive together (or move independently)."""
+        return self.send_command(f"M800 S{1 if enabled else 0}")
 
+    def set_jerk(self, jerks: dict[int, int]) -> dict[str, Any]:
+        """
+        Set per-joint jerk limits in steps/s^3 (M205) for S-curve ramps;
+        0 returns a joint to trapezoidal ramps. Joints not listed keep theirs.
+        """
+        cmd = "M205" + "".join(f" J{joint}:{jerk}" for joint, jerk in sorted(jerks.items()))
+        return self.send_command(cmd)
+
+    def set_max_speed(self, speeds: dict[int, int]) -> dict[str, Any]:
+        """Set per-joint maximum speeds in steps/s (M203). Joints not listed keep theirs."""
+        cmd = "M203" + "".join(f" J{joint}:{speed}" for joint, speed in sorted(speeds.items()))
+        return self.send_command(cmd)
+
+    def set_acceleration(self, accels: dict[int, int]) -> dict[str, Any]:
+        """Set per-joint accelerations in steps/s^2 (M201). Joints not listed keep theirs."""
+        cmd = "M201" + "".join(f" J{joint}:{accel}" for joint, accel in sorted(accels.items()))
         return self.send_command(cmd)
 
+    def set_soft_limits(
+        self, minimum: dict[int, int] | None = None, maximum: dict[int, int] | None = None
+    ) -> dict[str, Any]:
+        """Set per-joint soft position limits in steps (M208 S1 / M208)."""
+        result: dict[str, Any] = {"success": True, "message": "ok"}
+        for words, prefix in ((minimum, "M208 S1"), (maximum, "M208")):
+            if words:
+                cmd = prefix + "".join(f" J{joint}:{value}" for joint, value in sorted(words.items()))
+                result = self.send_command(cmd)
+                if not result.get("success"):
+                    break
+        return result
+
+    def save_settings(self) -> dict[str, Any]:
+        """
+        Store the current speed, acceleration, jerk and soft limits on the
+        controller (M500); they are loaded at every boot. Refused while moving.
+        """
+        return self.send_command("M500")
+
+    def load_settings(self) -> dict[str, Any]:
+        """Go back to the last saved settings (M501)."""
+        return self.send_command("M501")
+
+    def reset_settings(self) -> dict[str, Any]:
+        """Go back to the firmware defaults (M502); save_settings() keeps them."""
+        return self.send_command("M502")
+
+    def set_joint_units(self, enabled: bool = True) -> dict[str, Any]:
+        """
+        Take and report G-code joint positions in degrees/mm instead of steps
+        (M801). The mode is controller-wide and also applies to programs.
+        """
+        return self.send_command(f"M801 S{1 if enabled else 0}")
+
+    def metrics(self) -> str:
+        """
+        Latency histograms, counters, queue high-water marks and heap stats.
+
+        Over HTTP this is GET /api/metrics (Prometheus text format); over
+        serial it is the M850 summary.
+        """
+        if self._mode != "http":
+            return str(self.send_command("M850").get("message", ""))
+        client = self._require_http("Metrics")
+        response = client.get(f"{self._base_url}/api/metrics")
+        response.raise_for_status()
+        return response.text
+
+    def reset_metrics(self) -> dict[str, Any]:
+        """Clear the latency histograms and high-water marks (M850 R1)."""
+        return self.send_command("M850 R1")
+
+    def start_trace(self, rate_hz: int = 1000) -> dict[str, Any]:
+        """Record a motion trace at rate_hz until stop_trace() (M860 S1)."""
+        return self.send_command(f"M860 S1 R{rate_hz}")
+
+    def arm_trace(self, rate_hz: int = 1000, post_trigger_ms: int = 200) -> dict[str, Any]:
+        """
+        Record continuously and stop post_trigger_ms after the next E-stop,
+        homing or path fault, or trigger_trace() (M860 S2).
+        """
+        return self.send_command(f"M860 S2 R{rate_hz} P{post_trigger_ms}")
+
+    def trigger_trace(self) -> dict[str, Any]:
+        """Trigger an armed trace by hand (M860 E1)."""
+        return self.send_command("M860 E1")
+
+    def stop_trace(self) -> dict[str, Any]:
+        """Stop recording; the trace stays on the controller for download."""
+        return self.send_command("M860 S0")
+
+    def download_trace(self, path: str | Path | None = None) -> trace.TraceData:
+        """
+        Download the stopped trace (HTTP only) and decode it into numpy
+        arrays (see roboarm.trace).
+
+        Args:
+            path: Also save the raw download here
+
+        Raises:
+            RuntimeError: Still recording, or nothing recorded
+        """
+        client = self._require_http("Trace download")
+        response = client.get(f"{self._base_url}/api/trace")
+        if response.status_code != 200:
+            raise RuntimeError(response.json().get("error", f"HTTP {response.status_code}"))
+        if path is not None:
+            Path(path).write_bytes(response.content)
+        return trace.decode(response.content)
+
+    def sync_master(self, group: int = 1) -> dict[str, Any]:
+        """Broadcast this controller's clock to a sync group (M870 S1)."""
+        return self.send_command(f"M870 S1 G{group}")
+
+    def sync_follow(self, group: int = 1) -> dict[str, Any]:
+        """Track the clock of a sync group's master (M870 S2)."""
+        return self.send_command(f"M870 S2 G{group}")
+
+    def sync_off(self) -> dict[str, Any]:
+        """Leave the sync group (M870 S0)."""
+        return self.send_command("M870 S0")
+
+    def sync_pulse(self, enabled: bool = True) -> dict[str, Any]:
+        """Start on the wired sync pulse instead of the shared clock (M870 P)."""
+        return self.send_command(f"M870 P{1 if enabled else 0}")
+
+    def hold_start(self) -> dict[str, Any]:
+        """
+        Hold queued moves until a synchronized start (M871 H1).
+
+        Queue the moves after this, then start_group() on the master.
+        """
+        return self.send_command("M871 H1")
+
+    def release_start(self) -> dict[str, Any]:
+        """Drop the hold and any armed start; queued moves run now (M871 H0)."""
+        return self.send_command("M871 H0")
+
+    def start_at(self, time_ms: int) -> dict[str, Any]:
+        """Start the held moves at a shared clock time in ms (M871 T)."""
+        return self.send_command(f"M871 T{time_ms}")
+
+    def start_group(self, delay_ms: int = 100) -> dict[str, Any]:
+        """
+        Master only: start every arm of the group delay_ms from now (M871 D).
+
+        The delay must cover the broadcast reaching the followers.
+        """
+        return self.send_command(f"M871 D{delay_ms}")
+
+    def set_encoder_mode(
+        self,
+        mode: int,
+        fault_steps: int | None = None,
+        deadband_steps: int | None = None,
+    ) -> dict[str, Any]:
+        """
+        Configure encoder feedback (M880): 0 off, 1 monitor, 2 correct.
+
+        fault_steps is the following error that stops and disables the arm;
+        deadband_steps the settled error that correct mode moves out.
+        """
+        command = f"M880 S{mode}"
+        if fault_steps is not None:
+            command += f" E{fault_steps}"
+        if deadband_steps is not None:
+            command += f" D{deadband_steps}"
+        return self.send_command(command)
+
+    def encoder_status(self) -> dict[str, Any]:
+        """Report measured positions, following errors and faults (M880)."""
+        return self.send_command("M880")
+
+    def clear_encoder_fault(self) -> dict[str, Any]:
+        """Clear the encoder fault latch and maximum errors (M880 R1)."""
+        return self.send_command("M880 R1")
+
     def home(self) -> dict[str, Any]:
-        """Home all axes (sets current position as zero)."""
+        """
+        Home all joints against their endstops (G28), in parallel.
+
+        Returns as soon as homing has started; use wait_for_idle() to wait
+        for it and the 'homed' field of status() to check the result.
+        """
         return self.send_command("G28")
 
     def get_positions(self) -> dict[str, int]:
@@ -248,7 +777,7 @@ class RoboarmClient:
 
     def wait_for_idle(self, timeout: float = 60.0, poll_interval: float = 0.1) -> bool:
         """
-        Wait for all motors to stop moving.
+        Wait for all motors to stop moving and the motion queue to drain.
 
         Args:
             timeout: Maximum time to wait in seconds
@@ -261,8 +790,143 @@ class RoboarmClient:
 
         while time.time() < end_time:
             status = self.status()
-            if not status.moving:
+            if not status.moving and not status.homing and status.queued == 0:
                 return True
             time.sleep(poll_interval)
 
         return False
+
+
+def _move_body(
+    joints: list[float | None],
+    relative: bool,
+    coordinated: bool | None,
+    speed: int | None,
+    accel: int | None,
+) -> dict[str, Any]:
+    """Build an /api/move JSON body."""
+    body: dict[str, Any] = {f"j{i}": pos for i, pos in enumerate(joints, 1) if pos is not None}
+    if relative:
+        body["relative"] = True
+    if coordinated is not None:
+        body["coordinated"] = coordinated
+    if speed is not None:
+        body["speed"] = speed
+    if accel is not None:
+        body["accel"] = accel
+    return body
+
+
+def read_serial_message(port: serial.Serial, deadline: float) -> str | bytes | None:
+    """
+    Next message from the controller: a stripped text line, or a binary
+    frame (ack or auto-report) starting with the sync byte. Both are only
+    sent whole, so a message always starts at the next byte.
+
+    Returns:
+        None once the deadline has passed
+    """
+    while time.time() < deadline:
+        if not port.in_waiting:
+            time.sleep(0.01)
+            continue
+        first = port.read(1)
+        if not first:
+            continue
+        if first[0] != protocol.SYNC:
+            return (first + port.readline()).decode(errors="replace").strip()
+
+        header = first + port.read(3)
+        if len(header) < 4:
+            continue
+        if header[1] == protocol.FRAME_STATUS:
+            length = protocol.status_frame_length(header)
+        else:
+            length = protocol.ACK_SIZE
+        return header + port.read(length - len(header))
+    return None
+
+
+def merge_report(status: RoboarmStatus | None, message: str | bytes) -> RoboarmStatus | None:
+    """
+    Merge an auto-report (text line or FRAME_STATUS frame) into the state
+    assembled from the previous ones; a keyframe starts over.
+
+    Returns:
+        The merged state (status unchanged if the report is malformed)
+    """
+    try:
+        if isinstance(message, bytes):
+            report = protocol.decode_status(message)
+        else:
+            report = protocol.parse_report_line(message)
+    except ValueError:
+        return status
+
+    if status is None or report.keyframe:
+        status = RoboarmStatus(
+            enabled=False, moving=False, positions={}, targets={}, distances={},
+            homed={},
+        )
+    status.enabled = report.enabled
+    status.moving = report.moving
+    status.homing = report.homing
+    status.queued = report.queued
+    for joint, (position, target, _speed) in report.joints.items():
+        key = f"j{joint}"
+        status.positions[key] = position
+        status.targets[key] = target
+        status.distances[key] = target - position
+    status.homed = {
+        f"j{joint}": bool(report.homed_mask & (1 << (joint - 1)))
+        for joint in range(1, protocol.JOINT_COUNT + 1)
+    }
+    return status
+
+
+def parse_quick_status(message: str) -> RoboarmStatus:
+    """Parse the "?" reply, e.g. "EM P:0,0,0,0,0,0 Q:0" (M moving, I idle, H homing)."""
+    parts = message.split()
+    enabled = "E" in parts[0]
+    moving = "M" in parts[0]
+    homing = "H" in parts[0]
+
+    positions = {}
+    queued = 0
+    for part in parts[1:]:
+        if part.startswith("P:"):
+            pos_values = part[2:].split(",")
+            for i, val in enumerate(pos_values):
+                positions[f"j{i + 1}"] = int(val)
+        elif part.startswith("Q:"):
+            queued = int(part[2:])
+
+    return RoboarmStatus(
+        enabled=enabled,
+        moving=moving,
+        positions=positions,
+        targets={},
+        distances={},
+        queued=queued,
+        homing=homing,
+    )
+
+
+def _serial_reply(lines: list[str]) -> dict[str, Any]:
+    """
+    Reply dict from the lines of one serial reply. The "ok F:<n>" line that
+    ends a successful reply becomes queue_free; the message keeps the rest
+    ("ok" if nothing else).
+    """
+    if not lines:
+        return {"success": False, "message": "No response from controller"}
+    if lines[-1].startswith("error:"):
+        return {"success": False, "message": "\n".join(lines)}
+
+    reply: dict[str, Any] = {"success": True}
+    credits = protocol.parse_credits(lines[-1])
+    if credits is not None:
+        reply["queue_free"] = credits
+        lines = lines[:-1] or ["ok"]
+    reply["message"] = "\n".join(lines)
+    return reply
@@ -0,0 +1,236 @@
+"""
+Roboarm binary protocol - compact move frames for high-rate serial streaming.
+
+Mirrors firmware/src/binary_protocol.h. Frames start with the sync byte
+0xA5 (never used in ASCII commands), so binary frames and text commands can
+share one serial link.
+
+Also decodes auto-reports (M154, firmware/src/auto_report.h): FRAME_STATUS
+binary frames and "R ..." text lines, each carrying only the joints that
+changed since the previous report.
+
+Text replies end with one "ok F:<free queue slots>" or "error: ..." line
+(see is_reply_end), which is what lets a host pipeline commands.
+"""
+
+from __future__ import annotations
+
+import binascii
+import struct
+from dataclasses import dataclass, field
+
+SYNC = 0xA5
+HEADER_SIZE = 4
+CRC_SIZE = 2
+ACK_SIZE = 7
+JOINT_COUNT = 6
+
+FRAME_MOVE_ABSOLUTE = 0x01
+FRAME_MOVE_RELATIVE = 0x02
+FRAME_STATUS = 0x10
+FRAME_ACK_FLAG = 0x80
+
+STATUS_HEADER_SIZE = 8
+STATUS_JOINT_SIZE = 12
+
+# Auto-report flags (REPORT_FLAG_*)
+REPORT_ENABLED = 1 << 0
+REPORT_MOVING = 1 << 1
+REPORT_JOGGING = 1 << 2
+REPORT_HOMING = 1 << 3
+REPORT_COORDINATED = 1 << 4
+REPORT_KEYFRAME = 1 << 7
+
+STATUS_OK = 0
+STATUS_QUEUE_FULL = 1
+STATUS_REJECTED = 2
+STATUS_BAD_FRAME = 3
+
+STATUS_MESSAGES = {
+    STATUS_OK: "ok",
+    STATUS_QUEUE_FULL: "error: Queue full",
+    STATUS_REJECTED: "error: Move failed - check limits or enable motors",
+    STATUS_BAD_FRAME: "error: Bad frame",
+}
+
+
+def crc16(data: bytes) -> int:
+    """CRC16-CCITT (poly 0x1021, init 0xFFFF), as used by the firmware."""
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+def encode_move(targets: dict[int, int], relative: bool = False, seq: int = 0) -> bytes:
+    """
+    Encode a move frame.
+
+    Args:
+        targets: Joint number (1-6) -> target (or offset) in steps
+        relative: Offsets relative to the end of the queued path
+        seq: Sequence number (0-255), echoed in the ack
+
+    Returns:
+        Complete frame including sync byte and CRC
+    """
+    if not targets:
+        raise ValueError("At least one joint target is required")
+
+    mask = 0
+    payload = b""
+    for joint in sorted(targets):
+        if not 1 <= joint <= JOINT_COUNT:
+            raise ValueError(f"Invalid joint number: {joint}")
+        mask |= 1 << (joint - 1)
+        payload += struct.pack("<i", targets[joint])
+
+    frame_type = FRAME_MOVE_RELATIVE if relative else FRAME_MOVE_ABSOLUTE
+    body = bytes([frame_type, seq & 0xFF, mask]) + payload
+    return bytes([SYNC]) + body + struct.pack("<H", crc16(body))
+
+
+@dataclass
+class Ack:
+    """Acknowledgement frame sent by the controller for each binary frame."""
+
+    frame_type: int
+    seq: int
+    status: int
+    queue_free: int
+
+    @property
+    def success(self) -> bool:
+        return self.status == STATUS_OK
+
+    @property
+    def message(self) -> str:
+        return STATUS_MESSAGES.get(self.status, f"error: Status {self.status}")
+
+
+def decode_ack(frame: bytes) -> Ack:
+    """Decode a 7-byte ack frame, raising ValueError if it is malformed."""
+    if len(frame) != ACK_SIZE or frame[0] != SYNC:
+        raise ValueError("Not an ack frame")
+    if crc16(frame[1:5]) != struct.unpack("<H", frame[5:7])[0]:
+        raise ValueError("Ack CRC mismatch")
+    if not frame[1] & FRAME_ACK_FLAG:
+        raise ValueError("Not an ack frame")
+    return Ack(
+        frame_type=frame[1] & ~FRAME_ACK_FLAG,
+        seq=frame[2],
+        status=frame[3],
+        queue_free=frame[4],
+    )
+
+
+@dataclass
+class StatusReport:
+    """
+    One auto-report: arm-wide state plus the joints that changed.
+
+    Attributes:
+        joints: Joint number (1-6) -> (position, target, speed in steps/s),
+            only for joints included in this report
+        keyframe: Every joint is included
+        seq: Report count (binary frames only; a gap means a lost frame)
+    """
+
+    enabled: bool
+    moving: bool
+    jogging: bool
+    homing: bool
+    queued: int
+    homed_mask: int
+    joints: dict[int, tuple[int, int, int]] = field(default_factory=dict)
+    keyframe: bool = False
+    seq: int | None = None
+
+
+def status_frame_length(header: bytes) -> int:
+    """Length of a FRAME_STATUS frame from its first 4 bytes (sync, type, seq, mask)."""
+    return STATUS_HEADER_SIZE + STATUS_JOINT_SIZE * bin(header[3]).count("1") + CRC_SIZE
+
+
+def decode_status(frame: bytes) -> StatusReport:
+    """Decode a FRAME_STATUS frame, raising ValueError if it is malformed."""
+    if len(frame) < STATUS_HEADER_SIZE + CRC_SIZE or frame[0] != SYNC or frame[1] != FRAME_STATUS:
+        raise ValueError("Not a status frame")
+    if len(frame) != status_frame_length(frame):
+        raise ValueError("Status frame length mismatch")
+    if crc16(frame[1:-CRC_SIZE]) != struct.unpack("<H", frame[-CRC_SIZE:])[0]:
+        raise ValueError("Status frame CRC mismatch")
+
+    mask, flags, _moving, homed, queued = frame[3:STATUS_HEADER_SIZE]
+    joints = {}
+    offset = STATUS_HEADER_SIZE
+    for joint in range(JOINT_COUNT):
+        if mask & (1 << joint):
+            joints[joint + 1] = struct.unpack_from("<iii", frame, offset)
+            offset += STATUS_JOINT_SIZE
+    return StatusReport(
+        enabled=bool(flags & REPORT_ENABLED),
+        moving=bool(flags & REPORT_MOVING),
+        jogging=bool(flags & REPORT_JOGGING),
+        homing=bool(flags & REPORT_HOMING),
+        queued=queued,
+        homed_mask=homed,
+        joints=joints,
+        keyframe=bool(flags & REPORT_KEYFRAME),
+        seq=frame[2],
+    )
+
+
+def is_report_line(line: str) -> bool:
+    """True for a text auto-report ("R ..." or keyframe "RK ...")."""
+    return line.startswith("R ") or line.startswith("RK ")
+
+
+def parse_report_line(line: str) -> StatusReport:
+    """
+    Parse a text auto-report, e.g. "R EM Q:2 H:3F J1:1200,1250,300".
+
+    The state letters are E/D (enabled/disabled) then H homing, J jogging,
+    M moving or I idle.
+    """
+    parts = line.split()
+    if len(parts) < 2 or parts[0] not in ("R", "RK") or len(parts[1]) != 2:
+        raise ValueError(f"Not an auto-report: {line!r}")
+    state = parts[1]
+    report = StatusReport(
+        enabled=state[0] == "E",
+        moving=state[1] in "MJ",
+        jogging=state[1] == "J",
+        homing=state[1] == "H",
+        queued=0,
+        homed_mask=0,
+        keyframe=parts[0] == "RK",
+    )
+    for part in parts[2:]:
+        key, _, value = part.partition(":")
+        if key == "Q":
+            report.queued = int(value)
+        elif key == "H":
+            report.homed_mask = int(value, 16)
+        elif key.startswith("J"):
+            position, target, speed = (int(v) for v in value.split(","))
+            report.joints[int(key[1:])] = (position, target, speed)
+    return report
+
+
+def is_reply_end(line: str) -> bool:
+    """True for the line that ends a text command reply ("ok ..." or "error: ...")."""
+    return line.startswith("ok") or line.startswith("error:")
+
+
+def parse_credits(line: str) -> int | None:
+    """Free motion queue slots from an "ok F:<n>" reply end, None if it has none."""
+    if not line.startswith("ok F:"):
+        return None
+    try:
+        return int(line[5:])
+    except ValueError:
+        return None
+
+
+def is_queued_move(command: str) -> bool:
+    """True for G0/G1, the commands that take motion queue slots (not G10, G28, ...)."""
+    command = command.lstrip().upper()
+    return command[:2] in ("G0", "G1") and not command[2:3].isdigit()
@@ -0,0 +1,205 @@
+"""
+Roboarm WebSocket streaming - batched commands and pushed telemetry.
+
+Usage:
+    from roboarm import RoboarmClient
+
+    with RoboarmClient("http://roboarm.local") as client:
+        with client.stream(telemetry_ms=50) as stream:
+            stream.send_commands(["G0 J1:1000", "G0 J1:2000"])
+            print(stream.latest_status)
+
+With report="delta" (or "binary") the controller pushes only the joints
+that changed; they are merged into latest_status, which keeps the shape of
+a full status frame.
+"""
+
+from __future__ import annotations
+
+import json
+import time
+from collections.abc import Iterator
+from typing import Any
+from urllib.parse import urlparse
+
+from websockets.sync.client import ClientConnection, connect
+
+from . import protocol
+
+
+class RoboarmStream:
+    """
+    Persistent WebSocket connection to the controller's /ws endpoint.
+
+    Commands sent together share one message and one reply. Status frames
+    pushed by the controller are kept in `latest_status` and can be
+    consumed with `telemetry()`.
+
+    Args:
+        base_url: Controller HTTP URL (e.g. "http://roboarm.local")
+        timeout: Reply timeout in seconds
+        telemetry_ms: Status push interval to request (None = firmware default,
+            0 = off)
+        report: "full" status frames, or only changed joints as "delta" JSON
+            or "binary" FRAME_STATUS messages (None = leave as is)
+    """
+
+    def __init__(
+        self,
+        base_url: str,
+        timeout: float = 10.0,
+        telemetry_ms: int | None = None,
+        report: str | None = None,
+    ) -> None:
+        parsed = urlparse(base_url)
+        scheme = "wss" if parsed.scheme == "https" else "ws"
+        self._ws_url = f"{scheme}://{parsed.netloc}/ws"
+        self._timeout = timeout
+        self._telemetry_ms = telemetry_ms
+        self._report = report
+        self._ws: ClientConnection | None = None
+        self.latest_status: dict[str, Any] | None = None
+
+    def connect(self) -> None:
+        """Open the WebSocket and apply the telemetry interval."""
+        self._ws = connect(self._ws_url, open_timeout=self._timeout)
+        if self._telemetry_ms is not None or self._report is not None:
+            self._configure(self._telemetry_ms, self._report)
+
+    def close(self) -> None:
+        """Close the WebSocket."""
+        if self._ws:
+            self._ws.close()
+            self._ws = None
+
+    def __enter__(self) -> RoboarmStream:
+        self.connect()
+        return self
+
+    def __exit__(self, *args: Any) -> None:
+        self.close()
+
+    def _recv(self, timeout: float) -> dict[str, Any]:
+        if not self._ws:
+            raise RuntimeError("Not connected. Call connect() first.")
+        data = self._ws.recv(timeout=timeout)
+        if isinstance(data, bytes):
+            message = _delta_from_frame(protocol.decode_status(data))
+        else:
+            message = json.loads(data)
+        if message.get("type") == "status":
+            self.latest_status = message
+        elif message.get("type") == "delta":
+            self._merge_delta(message)
+        return message
+
+    def _merge_delta(self, delta: dict[str, Any]) -> None:
+        """Apply a change-driven report to latest_status."""
+        status = self.latest_status
+        if status is None:
+            return  # The full frame sent on connect is always first
+        for key in ("t", "seq", "enabled", "moving", "jogging", "queued"):
+            if key in delta:
+                status[key] = delta[key]
+        for name, (position, target, velocity) in delta.get("joints", {}).items():
+            index = int(name[1:]) - 1
+            status["positions"][index] = position
+            status["targets"][index] = target
+            status["velocities"][index] = velocity
+
+    def _wait_for(self, message_type: str) -> dict[str, Any]:
+        """Read messages until one of the given type arrives (status frames are kept)."""
+        deadline = time.monotonic() + self._timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                raise TimeoutError(f"No '{message_type}' reply from controller")
+            message = self._recv(remaining)
+            if message.get("type") == message_type:
+                return message
+            if message.get("type") == "error":
+                raise RuntimeError(message.get("error", "WebSocket error"))
+
+    def send_commands(self, commands: list[str]) -> list[dict[str, Any]]:
+        """
+        Send several G-code commands in one message.
+
+        Returns:
+            One dict per command with 'success' and 'message' keys
+            ('busy' is set when the motion queue was full)
+        """
+        if not self._ws:
+            raise RuntimeError("Not connected. Call connect() first.")
+        self._ws.send("\n".join(commands))
+        results: list[dict[str, Any]] = self._wait_for("result")["results"]
+        return results
+
+    def send_command(self, command: str) -> dict[str, Any]:
+        """Send a single G-code command."""
+        return self.send_commands([command])[0]
+
+    def jog(self, speeds: dict[int, int]) -> dict[str, Any]:
+        """
+        Jog joints at signed speeds (steps/s), like M810.
+
+        Each call replaces the whole velocity vector: joints not listed
+        stop. Repeat at least every 250 ms (firmware JOG_WATCHDOG_MS) or the
+        controller ramps every joint down; send {} to stop.
+
+        Returns:
+            Dict with 'success' (and 'error' if the jog was refused)
+        """
+        if not self._ws:
+            raise RuntimeError("Not connected. Call connect() first.")
+        jog = {f"j{joint}": speed for joint, speed in speeds.items()}
+        self._ws.send(json.dumps({"jog": jog}))
+        return self._wait_for("jog")
+
+    def _configure(self, interval_ms: int | None, report: str | None) -> dict[str, Any]:
+        if not self._ws:
+            raise RuntimeError("Not connected. Call connect() first.")
+        config: dict[str, Any] = {}
+        if interval_ms is not None:
+            config["telemetry_ms"] = interval_ms
+        if report is not None:
+            config["report"] = report
+        self._ws.send(json.dumps(config))
+        return self._wait_for("config")
+
+    def set_telemetry_interval(self, interval_ms: int) -> int:
+        """Change the status push interval (0 = off). Returns the applied value."""
+        applied: int = self._configure(interval_ms, None)["telemetry_ms"]
+        return applied
+
+    def set_report_mode(self, report: str) -> str:
+        """Push "full" status frames, or only changed joints ("delta"/"binary")."""
+        applied: str = self._configure(None, report)["report"]
+        return applied
+
+    def telemetry(self) -> Iterator[dict[str, Any]]:
+        """
+        Yield pushed frames: "status" frames, or in delta/binary mode the
+        changes (latest_status holds the merged state).
+        """
+        while True:
+            message = self._recv(self._timeout)
+            if message.get("type") in ("status", "delta"):
+                yield message
+
+
+def _delta_from_frame(report: protocol.StatusReport) -> dict[str, Any]:
+    """Express a binary FRAME_STATUS message like a JSON delta."""
+    delta: dict[str, Any] = {
+        "type": "delta",
+        "n": report.seq,
+        "enabled": report.enabled,
+        "moving": report.moving,
+        "jogging": report.jogging,
+        "homing": report.homing,
+        "queued": report.queued,
+        "homed": report.homed_mask,
+        "joints": {f"j{joint}": list(values) for joint, values in report.joints.items()},
+    }
+    if report.keyframe:
+        delta["keyframe"] = True
+    return delta
@@ -0,0 +1,196 @@
+"""
+Roboarm motion traces - decoding the recorder's download.
+
+Mirrors firmware/src/trace.h. GET /api/trace returns a 32-byte header and
+then fixed-size blocks, oldest first, all little-endian. Each block opens
+with a keyframe (one sample in full) followed by delta-encoded samples:
+zigzag varints for the time (minus the sample period) and each joint's
+position and speed, then raw queue-depth and flag bytes.
+
+Usage:
+    from roboarm import RoboarmClient
+
+    with RoboarmClient("http://roboarm.local") as client:
+        client.arm_trace(rate_hz=2000, post_trigger_ms=200)
+        ...                                   # E-stop or fault happens
+        data = client.download_trace()
+        print(data.position[data.trigger_index])
+
+Decoding needs numpy (pip install roboarm[trace]).
+"""
+
+from __future__ import annotations
+
+import struct
+from dataclasses import dataclass
+from typing import TYPE_CHECKING, Any
+
+if TYPE_CHECKING:
+    import numpy as np
+
+MAGIC = b"RBTR"
+VERSION = 1
+
+FILE_HEADER_FORMAT = "<4sBBHIIIiB3xI"
+FILE_HEADER_SIZE = struct.calcsize(FILE_HEADER_FORMAT)
+
+# Sample flags (TRACE_FLAG_*)
+FLAG_ENABLED = 1 << 0
+FLAG_MOVING = 1 << 1
+FLAG_JOGGING = 1 << 2
+FLAG_HOMING = 1 << 3
+
+TRIGGER_REASONS = ["none", "manual", "estop", "homing", "path", "encoder"]
+
+
+def _block_header_format(joints: int) -> str:
+    # firstSample, timeUs, position[], speedHz[], queueDepth, flags, count, length
+    return f"<II{joints}i{joints}iBBHH2x"
+
+
+@dataclass
+class TraceData:
+    """
+    A decoded recording, one row per sample.
+
+    Attributes:
+        rate_hz: Sample rate
+        time_us: Sample times, microseconds since the first one (int64)
+        position: Joint positions, steps (int32, samples x joints)
+        speed_hz: Signed joint speeds, steps/s (int32, samples x joints)
+        queue_depth: Motion queue entries (uint8)
+        flags: FLAG_* bits (uint8)
+        trigger_index: Row of the trigger sample, or None
+        trigger_reason: "estop", "homing", "path", "manual" or "none"
+        missed_samples: Timer ticks the recorder could not take
+    """
+
+    rate_hz: int
+    time_us: np.ndarray
+    position: np.ndarray
+    speed_hz: np.ndarray
+    queue_depth: np.ndarray
+    flags: np.ndarray
+    trigger_index: int | None
+    trigger_reason: str
+    missed_samples: int
+
+
+def _unzigzag(value: int) -> int:
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_columns(blob: bytes) -> dict[str, Any]:
+    """
+    Decode a download into plain Python columns (no numpy needed).
+
+    Returns:
+        Dict with the TraceData fields; the per-sample ones are lists
+
+    Raises:
+        ValueError: Not a trace, unknown version or truncated
+    """
+    if len(blob) < FILE_HEADER_SIZE:
+        raise ValueError("Trace too short")
+    (magic, version, joints, block_size, rate_hz, block_count, sample_count,
+     trigger_sample, trigger_reason, missed) = struct.unpack_from(FILE_HEADER_FORMAT, blob)
+    if magic != MAGIC:
+        raise ValueError("Not a roboarm trace")
+    if version != VERSION:
+        raise ValueError(f"Unsupported trace version {version}")
+    if len(blob) < FILE_HEADER_SIZE + block_count * block_size:
+        raise ValueError("Trace truncated")
+
+    block_format = _block_header_format(joints)
+    block_header_size = struct.calcsize(block_format)
+    period_us = 1_000_000 // rate_hz
+
+    time_us: list[int] = []
+    position: list[list[int]] = []
+    speed: list[list[int]] = []
+    queue_depth: list[int] = []
+    flags: list[int] = []
+
+    elapsed = 0         # Unwrapped from the 32-bit micros() stamps
+    last_raw: int | None = None
+
+    for b in range(block_count):
+        offset = FILE_HEADER_SIZE + b * block_size
+        fields = struct.unpack_from(block_format, blob, offset)
+        raw_time = fields[1]
+        pos = list(fields[2:2 + joints])
+        spd = list(fields[2 + joints:2 + 2 * joints])
+        depth, flag, count, length = fields[2 + 2 * joints:]
+
+        if last_raw is not None:
+            elapsed += (raw_time - last_raw) & 0xFFFFFFFF
+        last_raw = raw_time
+        time_us.append(elapsed)
+        position.append(pos[:])
+        speed.append(spd[:])
+        queue_depth.append(depth)
+        flags.append(flag)
+
+        data = blob[offset + block_header_size:offset + block_header_size + length]
+        i = 0
+        for _ in range(count - 1):
+            values = []
+            for _ in range(1 + 2 * joints):
+                value = shift = 0
+                while True:
+                    byte = data[i]
+                    i += 1
+                    value |= (byte & 0x7F) << shift
+                    if byte < 0x80:
+                        break
+                    shift += 7
+                values.append(_unzigzag(value))
+
+            dt = values[0] + period_us
+            elapsed += dt
+            last_raw = (last_raw + dt) & 0xFFFFFFFF
+            for j in range(joints):
+                pos[j] += values[1 + 2 * j]
+                spd[j] += values[2 + 2 * j]
+            time_us.append(elapsed)
+            position.append(pos[:])
+            speed.append(spd[:])
+            queue_depth.append(data[i])
+            flags.append(data[i + 1])
+            i += 2
+
+    if len(time_us) != sample_count:
+        raise ValueError(f"Trace has {len(time_us)} samples, header says {sample_count}")
+
+    return {
+        "rate_hz": rate_hz,
+        "joints": joints,
+        "time_us": time_us,
+        "position": position,
+        "speed_hz": speed,
+        "queue_depth": queue_depth,
+        "flags": flags,
+        "trigger_index": trigger_sample if trigger_sample >= 0 else None,
+        "trigger_reason": (TRIGGER_REASONS[trigger_reason]
+                           if trigger_reason < len(TRIGGER_REASONS) else "unknown"),
+        "missed_samples": missed,
+    }
+
+
+def decode(blob: bytes) -> TraceData:
+    """Decode a GET /api/trace download into numpy arrays."""
+    import numpy as np
+
+    columns = decode_columns(blob)
+    joints = columns["joints"]
+    return TraceData(
+        rate_hz=columns["rate_hz"],
+        time_us=np.asarray(columns["time_us"], dtype=np.int64),
+        position=np.asarray(columns["position"], dtype=np.int32).reshape(-1, joints),
+        speed_hz=np.asarray(columns["speed_hz"], dtype=np.int32).reshape(-1, joints),
+        queue_depth=np.asarray(columns["queue_depth"], dtype=np.uint8),
+        flags=np.asarray(columns["flags"], dtype=np.uint8),
+        trigger_index=columns["trigger_index"],
+        trigger_reason=columns["trigger_reason"],
+        missed_samples=columns["missed_samples"],
+    )
@@ -0,0 +1,157 @@
+"""
+Roboarm binary trajectories - paths compiled offline for flash playback.
+
+Mirrors firmware/src/trajectory.h. A trajectory is a 16-byte header
+followed by fixed-size 36-byte records, all little-endian. The firmware
+memory-maps the file from its "traj" partition and queues records as-is,
+so everything that needs parsing happens here, once.
+"""
+
+from __future__ import annotations
+
+import re
+import struct
+from collections.abc import Iterable
+from dataclasses import dataclass, field
+
+from .protocol import JOINT_COUNT, crc16
+
+MAGIC = b"RATJ"
+VERSION = 1
+
+FLAG_COORDINATED = 0x01
+
+HEADER_FORMAT = "<4sBBHIHH"
+RECORD_FORMAT = "<BBH" + "i" * JOINT_COUNT + "II"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+_JOINT_WORD = re.compile(r"^J(\d+):([+-]?\d+)$", re.IGNORECASE)
+_LETTER_WORD = re.compile(r"^([A-Z])([+-]?\d+)$", re.IGNORECASE)
+
+
+@dataclass
+class TrajectoryRecord:
+    """One queued move: absolute targets for the joints that move."""
+
+    targets: dict[int, int] = field(default_factory=dict)  # Joint (1-6) -> steps
+    speed_hz: int = 0  # Speed cap (0 = joint limits)
+    accel: int = 0  # Acceleration cap (0 = joint limits)
+    coordinated: bool = True
+
+    def pack(self) -> bytes:
+        mask = 0
+        values = [0] * JOINT_COUNT
+        for joint, target in self.targets.items():
+            if not 1 <= joint <= JOINT_COUNT:
+                raise ValueError(f"Invalid joint number: {joint}")
+            mask |= 1 << (joint - 1)
+            values[joint - 1] = target
+        flags = FLAG_COORDINATED if self.coordinated else 0
+        return struct.pack(RECORD_FORMAT, mask, flags, 0, *values, self.speed_hz, self.accel)
+
+    @classmethod
+    def unpack(cls, data: bytes) -> TrajectoryRecord:
+        mask, flags, _, *rest = struct.unpack(RECORD_FORMAT, data)
+        values, speed_hz, accel = rest[:JOINT_COUNT], rest[JOINT_COUNT], rest[JOINT_COUNT + 1]
+        targets = {j + 1: values[j] for j in range(JOINT_COUNT) if mask & (1 << j)}
+        return cls(targets, speed_hz, accel, bool(flags & FLAG_COORDINATED))
+
+
+def pack(records: list[TrajectoryRecord]) -> bytes:
+    """Pack records into a trajectory file."""
+    if not records:
+        raise ValueError("Trajectory has no moves")
+    body = b"".join(record.pack() for record in records)
+    header = struct.pack(
+        HEADER_FORMAT, MAGIC, VERSION, JOINT_COUNT, RECORD_SIZE, len(records), crc16(body), 0
+    )
+    return header + body
+
+
+def unpack(data: bytes) -> list[TrajectoryRecord]:
+    """Unpack and validate a trajectory file."""
+    if len(data) < HEADER_SIZE:
+        raise ValueError("Trajectory too short")
+    magic, version, joints, record_size, count, crc, _ = struct.unpack(
+        HEADER_FORMAT, data[:HEADER_SIZE]
+    )
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("Not a version 1 trajectory")
+    if joints != JOINT_COUNT or record_size != RECORD_SIZE:
+        raise ValueError("Trajectory layout mismatch")
+    body = data[HEADER_SIZE : HEADER_SIZE + count * RECORD_SIZE]
+    if len(body) != count * RECORD_SIZE or crc16(body) != crc:
+        raise ValueError("Trajectory truncated or corrupt")
+    return [
+        TrajectoryRecord.unpack(body[i : i + RECORD_SIZE]) for i in range(0, len(body), RECORD_SIZE)
+    ]
+
+
+def compile_gcode(lines: Iterable[str]) -> list[TrajectoryRecord]:
+    """
+    Compile G-code into trajectory records.
+
+    Understands the motion subset of the firmware's dialect:
+      G0/G1 J<n>:<steps> [F<speed>]   absolute / relative move
+      G28                             joints are at zero
+      M204 S<accel>                   acceleration cap for following moves
+      M800 S0|S1                      coordinated moves off/on
+    ';' starts a comment. F and M204 are modal; 0 means the joint limits.
+    Lines that don't affect motion are rejected, since nothing but moves
+    can be stored in a trajectory.
+
+    Relative moves need a known starting point, so each joint must be
+    given an absolute target (or G28) before its first G1.
+    """
+    records: list[TrajectoryRecord] = []
+    position: dict[int, int] = {}
+    speed_hz = 0
+    accel = 0
+    coordinated = True
+
+    for number, raw in enumerate(lines, 1):
+        line = raw.split(";", 1)[0].strip()
+        if not line:
+            continue
+
+        code, *words = line.split()
+        code = code.upper()
+        joints: dict[int, int] = {}
+        letters: dict[str, int] = {}
+        for word in words:
+            if match := _JOINT_WORD.match(word):
+                joints[int(match.group(1))] = int(match.group(2))
+            elif match := _LETTER_WORD.match(word):
+                letters[match.group(1).upper()] = int(match.group(2))
+            else:
+                raise ValueError(f"Line {number}: invalid argument {word!r}")
+
+        if code in ("G0", "G00", "G1", "G01"):
+            if not joints:
+                raise ValueError(f"Line {number}: no joints specified")
+            relative = code in ("G1", "G01")
+            targets: dict[int, int] = {}
+            for joint, value in joints.items():
+                if not 1 <= joint <= JOINT_COUNT:
+                    raise ValueError(f"Line {number}: invalid joint J{joint}")
+                if relative:
+                    if joint not in position:
+                        raise ValueError(
+                            f"Line {number}: G1 on J{joint} before its position is known"
+                        )
+                    value += position[joint]
+                targets[joint] = value
+            position.update(targets)
+            speed_hz = letters.get("F", speed_hz)
+            records.append(TrajectoryRecord(targets, speed_hz, accel, coordinated))
+        elif code == "G28":
+            position = dict.fromkeys(range(1, JOINT_COUNT + 1), 0)
+        elif code == "M204":
+            accel = letters.get("S", 0)
+        elif code == "M800":
+            coordinated = letters.get("S", 1) != 0
+        else:
+            raise ValueError(f"Line {number}: {code} cannot be compiled into a trajectory")
+
+    return records
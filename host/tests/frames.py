@@ -0,0 +1,29 @@
+"""Controller-side frames, built the way the firmware sends them."""
+
+from __future__ import annotations
+
+import struct
+
+from roboarm import protocol
+
+
+def ack_frame(frame_type: int, seq: int, status: int, queue_free: int) -> bytes:
+    body = bytes([frame_type | protocol.FRAME_ACK_FLAG, seq, status, queue_free])
+    return bytes([protocol.SYNC]) + body + struct.pack("<H", protocol.crc16(body))
+
+
+def status_frame(
+    joints: dict[int, tuple[int, int, int]],
+    flags: int = 0,
+    seq: int = 0,
+    homed: int = 0,
+    queued: int = 0,
+) -> bytes:
+    """FRAME_STATUS with (position, target, speed) for the given joints."""
+    mask = 0
+    payload = b""
+    for joint in sorted(joints):
+        mask |= 1 << (joint - 1)
+        payload += struct.pack("<iii", *joints[joint])
+    body = bytes([protocol.FRAME_STATUS, seq, mask, flags, 0, homed, queued]) + payload
+    return bytes([protocol.SYNC]) + body + struct.pack("<H", protocol.crc16(body))
@@ -0,0 +1,154 @@
+"""Pipelining and queue-credit accounting in AsyncRoboarmClient."""
+
+from __future__ import annotations
+
+import asyncio
+import contextlib
+from collections.abc import AsyncIterator
+from typing import Any
+
+import pytest
+
+from roboarm import async_client
+from roboarm.async_client import AsyncRoboarmClient, _Command, _Sent
+
+OK = {"success": True, "message": "ok"}
+
+
+class Arm:
+    """A client whose transport records what it sends instead of writing it."""
+
+    def __init__(self, window: int = 8) -> None:
+        self.client = AsyncRoboarmClient("http://arm.test", timeout=1.0, window=window)
+        self.sent: list[list[str]] = []
+
+    async def _transmit(self, batch: list[_Command]) -> None:
+        self.client._in_flight.append(_Sent(batch))
+        self.sent.append([command.text for command in batch])
+
+    def reply(self, queue_free: int | None, results: list[dict[str, Any]] | None = None) -> None:
+        """Answer the oldest message in flight (every command ok by default)."""
+        sent = self.client._in_flight[0]
+        if results is None:
+            results = [dict(OK) for _ in sent.commands]
+        self.client._complete(results, queue_free)
+
+
+async def settle() -> None:
+    for _ in range(10):
+        await asyncio.sleep(0)
+
+
+@pytest.fixture
+async def arm() -> AsyncIterator[Arm]:
+    arm = Arm(window=4)
+    arm.client._transmit = arm._transmit  # type: ignore[method-assign]
+    arm.client._loop = asyncio.get_running_loop()
+    sender = asyncio.create_task(arm.client._sender())
+    yield arm
+    sender.cancel()
+    with contextlib.suppress(asyncio.CancelledError):
+        await sender
+
+
+async def connected(arm: Arm, queue_free: int) -> None:
+    """The "?" sent on connect, answered with the queue's free slots."""
+    status = arm.client._submit("?")
+    await settle()
+    arm.reply(queue_free)
+    await status
+
+
+async def test_no_moves_before_first_credits(arm: Arm):
+    arm.client._submit("G0 J1:100")
+    await settle()
+    assert arm.sent == []
+    assert arm.client._credits() == 0
+
+
+async def test_moves_wait_for_credits(arm: Arm):
+    await connected(arm, 2)
+    moves = [arm.client._submit(f"G0 J1:{i}") for i in range(4)]
+    await settle()
+
+    # Two slots free: two moves go, the others wait for credits
+    assert arm.sent[-1] == ["G0 J1:0", "G0 J1:1"]
+    assert arm.client.in_flight == 2
+    assert arm.client._credits() == 0
+
+    # The reply frees one slot again (the arm ran a segment meanwhile)
+    arm.reply(1)
+    await settle()
+    assert moves[0].result() == {**OK, "queue_free": 1}
+    assert arm.sent[-1] == ["G0 J1:2"]
+    assert arm.client._credits() == 0
+
+    arm.reply(3)
+    await settle()
+    assert arm.sent[-1] == ["G0 J1:3"]
+    assert arm.client._credits() == 2
+
+
+async def test_blocked_move_holds_up_later_commands(arm: Arm):
+    await connected(arm, 1)
+    arm.client._submit("G0 J1:1")
+    arm.client._submit("G0 J1:2")
+    arm.client._submit("M114")
+    await settle()
+
+    # M114 needs no credit, but must not overtake the move ahead of it
+    assert arm.sent[-1] == ["G0 J1:1"]
+    arm.reply(1)
+    await settle()
+    assert arm.sent[-1] == ["G0 J1:2", "M114"]
+
+
+async def test_window_limits_commands_in_flight(arm: Arm):
+    await connected(arm, 32)
+    for i in range(6):
+        arm.client._submit(f"M114 {i}")
+    await settle()
+    assert arm.client.in_flight == 4
+
+    arm.reply(32)
+    await settle()
+    assert arm.sent[-1] == ["M114 4", "M114 5"]
+
+
+async def test_busy_reply_without_credits_empties_the_queue(arm: Arm):
+    await connected(arm, 4)
+    move = arm.client._submit("G0 J1:1")
+    await settle()
+
+    # Serial "error: Queue full" carries no F:<n>
+    arm.reply(None, [{"success": False, "message": "error: Queue full", "busy": True}])
+    assert (await move)["busy"]
+    assert arm.client.queue_free == 0
+
+
+async def test_missing_results_fail_their_commands(arm: Arm):
+    await connected(arm, 4)
+    first = arm.client._submit("G0 J1:1")
+    second = arm.client._submit("G0 J1:2")
+    await settle()
+
+    arm.reply(3, [dict(OK)])
+    assert (await first)["success"]
+    assert await second == {"success": False, "message": "error: No result"}
+
+
+async def test_polls_for_credits_when_nothing_is_in_flight(arm: Arm, monkeypatch):
+    monkeypatch.setattr(async_client, "CREDIT_POLL_INTERVAL", 0)
+    await connected(arm, 0)
+    move = arm.client._submit("G0 J1:1")
+    await settle()
+    await asyncio.sleep(0.01)
+    await settle()
+
+    # A "?" goes ahead of the blocked move to fetch fresh credits
+    assert arm.sent[-1] == ["?"]
+    arm.reply(5)
+    await settle()
+    assert arm.sent[-1] == ["G0 J1:1"]
+    arm.reply(4)
+    assert (await move)["queue_free"] == 4
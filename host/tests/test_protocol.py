@@ -0,0 +1,135 @@
+"""Binary framing and text reply helpers (roboarm.protocol, read_serial_message)."""
+
+from __future__ import annotations
+
+import struct
+import time
+
+import pytest
+from frames import ack_frame, status_frame
+
+from roboarm import protocol
+from roboarm.client import read_serial_message
+
+
+class FakePort:
+    """Just enough of serial.Serial for read_serial_message."""
+
+    def __init__(self, data: bytes) -> None:
+        self._data = data
+
+    @property
+    def in_waiting(self) -> int:
+        return len(self._data)
+
+    def read(self, size: int = 1) -> bytes:
+        chunk, self._data = self._data[:size], self._data[size:]
+        return chunk
+
+    def readline(self) -> bytes:
+        end = self._data.find(b"\n")
+        end = len(self._data) if end < 0 else end + 1
+        return self.read(end)
+
+
+def test_crc16_is_ccitt_false():
+    assert protocol.crc16(b"123456789") == 0x29B1
+
+
+def test_encode_move_layout():
+    frame = protocol.encode_move({3: -1, 1: 1000}, seq=7)
+    assert frame[:4] == bytes([protocol.SYNC, protocol.FRAME_MOVE_ABSOLUTE, 7, 0b101])
+    # Targets lowest joint first, then the CRC over everything after the sync byte
+    assert struct.unpack_from("<ii", frame, 4) == (1000, -1)
+    assert struct.unpack("<H", frame[-2:])[0] == protocol.crc16(frame[1:-2])
+    assert len(frame) == protocol.HEADER_SIZE + 2 * 4 + protocol.CRC_SIZE
+
+
+def test_encode_move_relative_and_seq_wrap():
+    frame = protocol.encode_move({6: 5}, relative=True, seq=0x1FF)
+    assert frame[1] == protocol.FRAME_MOVE_RELATIVE
+    assert frame[2] == 0xFF
+    assert frame[3] == 1 << 5
+
+
+@pytest.mark.parametrize("targets", [{}, {0: 1}, {7: 1}])
+def test_encode_move_rejects_bad_joints(targets):
+    with pytest.raises(ValueError):
+        protocol.encode_move(targets)
+
+
+def test_decode_ack():
+    ack = protocol.decode_ack(ack_frame(protocol.FRAME_MOVE_ABSOLUTE, 42, protocol.STATUS_OK, 31))
+    assert ack.frame_type == protocol.FRAME_MOVE_ABSOLUTE
+    assert (ack.seq, ack.queue_free) == (42, 31)
+    assert ack.success
+    assert ack.message == "ok"
+
+    full = protocol.decode_ack(ack_frame(protocol.FRAME_MOVE_RELATIVE, 1,
+                                         protocol.STATUS_QUEUE_FULL, 0))
+    assert not full.success
+    assert full.message == "error: Queue full"
+
+
+def test_decode_ack_rejects_damage():
+    frame = bytearray(ack_frame(protocol.FRAME_MOVE_ABSOLUTE, 1, protocol.STATUS_OK, 4))
+    frame[4] ^= 1
+    with pytest.raises(ValueError, match="CRC"):
+        protocol.decode_ack(bytes(frame))
+    with pytest.raises(ValueError):
+        protocol.decode_ack(frame[:-1])
+
+    # A valid CRC but no ack flag: a move frame echoed back, not an ack
+    body = bytes([protocol.FRAME_MOVE_ABSOLUTE, 1, 0, 4])
+    echoed = bytes([protocol.SYNC]) + body + struct.pack("<H", protocol.crc16(body))
+    with pytest.raises(ValueError):
+        protocol.decode_ack(echoed)
+
+
+def test_status_frame_length_from_header():
+    frame = status_frame({1: (1, 2, 3), 4: (4, 5, 6)})
+    assert protocol.status_frame_length(frame[:4]) == len(frame)
+    assert len(frame) == protocol.STATUS_HEADER_SIZE + 2 * protocol.STATUS_JOINT_SIZE + 2
+
+
+def test_decode_status_rejects_damage():
+    frame = status_frame({2: (10, 20, -30)})
+    with pytest.raises(ValueError, match="length"):
+        protocol.decode_status(frame + b"\x00")
+    damaged = bytearray(frame)
+    damaged[9] ^= 0x40
+    with pytest.raises(ValueError, match="CRC"):
+        protocol.decode_status(bytes(damaged))
+
+
+def test_reply_end_and_credits():
+    assert protocol.is_reply_end("ok F:12")
+    assert protocol.is_reply_end("ok")
+    assert protocol.is_reply_end("error: Queue full")
+    assert not protocol.is_reply_end("Baud rate: 921600")
+
+    assert protocol.parse_credits("ok F:12") == 12
+    assert protocol.parse_credits("ok") is None
+    assert protocol.parse_credits("ok F:x") is None
+    assert protocol.parse_credits("error: Queue full") is None
+
+
+@pytest.mark.parametrize(
+    ("command", "queued"),
+    [("G0 J1:100", True), (" g1 J2:-5", True), ("G0", True), ("G10", False),
+     ("G28", False), ("M17", False), ("", False)],
+)
+def test_is_queued_move(command, queued):
+    assert protocol.is_queued_move(command) == queued
+
+
+def test_read_serial_message_splits_text_and_frames():
+    ack = ack_frame(protocol.FRAME_MOVE_ABSOLUTE, 3, protocol.STATUS_OK, 9)
+    report = status_frame({1: (100, 200, 50)}, seq=5)
+    port = FakePort(b"EI P:0,0,0,0,0,0 Q:0\r\nok F:32\n" + ack + report + b"ok F:31\n")
+
+    messages = []
+    while port.in_waiting:
+        messages.append(read_serial_message(port, time.time() + 1))
+
+    assert messages == ["EI P:0,0,0,0,0,0 Q:0", "ok F:32", ack, report, "ok F:31"]
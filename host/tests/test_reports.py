@@ -0,0 +1,103 @@
+"""Change-driven auto-reports: decoding and merging (M154, WebSocket deltas)."""
+
+from __future__ import annotations
+
+import pytest
+from frames import status_frame
+
+from roboarm import protocol
+from roboarm.client import merge_report
+from roboarm.stream import RoboarmStream, _delta_from_frame
+
+
+def test_decode_status_frame():
+    flags = protocol.REPORT_ENABLED | protocol.REPORT_MOVING | protocol.REPORT_KEYFRAME
+    report = protocol.decode_status(
+        status_frame({1: (100, 250, 300), 3: (-5, -5, 0)}, flags, seq=9, homed=0x05, queued=2)
+    )
+    assert report.joints == {1: (100, 250, 300), 3: (-5, -5, 0)}
+    assert report.enabled and report.moving and report.keyframe
+    assert not report.jogging and not report.homing
+    assert (report.seq, report.homed_mask, report.queued) == (9, 0x05, 2)
+
+
+def test_parse_report_line():
+    report = protocol.parse_report_line("R EM Q:2 H:3F J1:1200,1250,300 J4:-7,0,-40")
+    assert report.enabled and report.moving and not report.keyframe
+    assert report.queued == 2
+    assert report.homed_mask == 0x3F
+    assert report.joints == {1: (1200, 1250, 300), 4: (-7, 0, -40)}
+
+    keyframe = protocol.parse_report_line("RK DH Q:0 H:0")
+    assert keyframe.keyframe and keyframe.homing and not keyframe.enabled
+    assert keyframe.joints == {}
+
+    assert protocol.parse_report_line("R EJ Q:0 H:0").jogging
+
+
+@pytest.mark.parametrize("line", ["R", "RX EM", "R EMX Q:1", "ok F:3"])
+def test_parse_report_line_rejects_other_lines(line):
+    with pytest.raises(ValueError):
+        protocol.parse_report_line(line)
+
+
+def test_merge_report_keeps_unchanged_joints():
+    status = merge_report(None, "RK EI Q:0 H:1 J1:0,0,0 J2:10,10,0")
+    assert status is not None
+    assert status.positions == {"j1": 0, "j2": 10}
+
+    status = merge_report(status, "R EM Q:1 H:1 J1:50,400,900")
+    assert status is not None
+    assert status.moving and status.queued == 1
+    assert status.positions == {"j1": 50, "j2": 10}
+    assert status.targets == {"j1": 400, "j2": 10}
+    assert status.distances == {"j1": 350, "j2": 0}
+    assert status.homed is not None and status.homed["j1"] and not status.homed["j2"]
+
+
+def test_merge_report_keyframe_starts_over():
+    status = merge_report(None, "R EI Q:0 H:0 J1:5,5,0 J2:6,6,0")
+    status = merge_report(status, status_frame({3: (7, 8, 1)}, protocol.REPORT_KEYFRAME))
+    assert status is not None
+    assert status.positions == {"j3": 7}
+    assert not status.enabled
+
+
+def test_merge_report_ignores_malformed():
+    status = merge_report(None, "R EI Q:0 H:0 J1:5,5,0")
+    damaged = bytearray(status_frame({1: (9, 9, 0)}))
+    damaged[-1] ^= 1
+    assert merge_report(status, bytes(damaged)) is status
+    assert merge_report(status, "R garbage") is status
+    assert status is not None and status.positions == {"j1": 5}
+
+
+def test_stream_merges_binary_delta():
+    stream = RoboarmStream("http://arm.test")
+    stream.latest_status = {
+        "type": "status",
+        "enabled": False,
+        "moving": False,
+        "queued": 0,
+        "positions": [0, 0, 0, 0, 0, 0],
+        "targets": [0, 0, 0, 0, 0, 0],
+        "velocities": [0, 0, 0, 0, 0, 0],
+    }
+
+    frame = status_frame({2: (100, 500, 250)}, protocol.REPORT_ENABLED | protocol.REPORT_MOVING,
+                         seq=3, queued=4)
+    delta = _delta_from_frame(protocol.decode_status(frame))
+    assert delta["type"] == "delta" and delta["n"] == 3 and "keyframe" not in delta
+    stream._merge_delta(delta)
+
+    status = stream.latest_status
+    assert status["enabled"] and status["moving"] and status["queued"] == 4
+    assert status["positions"] == [0, 100, 0, 0, 0, 0]
+    assert status["targets"] == [0, 500, 0, 0, 0, 0]
+    assert status["velocities"] == [0, 250, 0, 0, 0, 0]
+
+
+def test_stream_ignores_delta_before_first_status():
+    stream = RoboarmStream("http://arm.test")
+    stream._merge_delta({"type": "delta", "joints": {"j1": [1, 2, 3]}})
+    assert stream.latest_status is None
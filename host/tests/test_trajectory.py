@@ -0,0 +1,104 @@
+"""Trajectory file encoding and the G-code compiler (roboarm.trajectory)."""
+
+from __future__ import annotations
+
+import struct
+
+import pytest
+
+from roboarm import trajectory
+from roboarm.protocol import crc16
+from roboarm.trajectory import TrajectoryRecord
+
+
+def test_layout_matches_firmware():
+    # static_asserts in firmware/src/trajectory.h
+    assert trajectory.HEADER_SIZE == 16
+    assert trajectory.RECORD_SIZE == 36
+
+
+def test_record_pack_layout():
+    record = TrajectoryRecord({1: 100, 6: -7}, speed_hz=2000, accel=5000, coordinated=True)
+    data = record.pack()
+    mask, flags, reserved = struct.unpack_from("<BBH", data)
+    assert (mask, flags, reserved) == (0b100001, trajectory.FLAG_COORDINATED, 0)
+    assert struct.unpack_from("<6i", data, 4) == (100, 0, 0, 0, 0, -7)
+    assert struct.unpack_from("<II", data, 28) == (2000, 5000)
+
+
+def test_record_rejects_bad_joint():
+    with pytest.raises(ValueError):
+        TrajectoryRecord({7: 1}).pack()
+
+
+def test_pack_unpack_round_trip():
+    records = [
+        TrajectoryRecord({1: 1000, 2: -500}),
+        TrajectoryRecord({3: 42}, speed_hz=800, accel=100, coordinated=False),
+    ]
+    data = trajectory.pack(records)
+    assert len(data) == trajectory.HEADER_SIZE + 2 * trajectory.RECORD_SIZE
+
+    magic, version, joints, record_size, count, crc, _ = struct.unpack_from(
+        trajectory.HEADER_FORMAT, data
+    )
+    assert (magic, version, joints, record_size, count) == (b"RATJ", 1, 6, 36, 2)
+    assert crc == crc16(data[trajectory.HEADER_SIZE:])
+    assert trajectory.unpack(data) == records
+
+
+def test_pack_rejects_empty():
+    with pytest.raises(ValueError):
+        trajectory.pack([])
+
+
+def test_unpack_rejects_damage():
+    data = bytearray(trajectory.pack([TrajectoryRecord({1: 1}), TrajectoryRecord({1: 2})]))
+
+    with pytest.raises(ValueError, match="truncated"):
+        trajectory.unpack(bytes(data[:-1]))
+    with pytest.raises(ValueError, match="short"):
+        trajectory.unpack(bytes(data[:8]))
+
+    corrupt = bytearray(data)
+    corrupt[-1] ^= 0xFF
+    with pytest.raises(ValueError, match="corrupt"):
+        trajectory.unpack(bytes(corrupt))
+
+    foreign = bytearray(data)
+    foreign[:4] = b"XXXX"
+    with pytest.raises(ValueError, match="version 1"):
+        trajectory.unpack(bytes(foreign))
+
+
+def test_compile_gcode():
+    records = trajectory.compile_gcode([
+        "; warm-up",
+        "G28",
+        "G1 J1:100 F2000      ; relative to home",
+        "M204 S5000",
+        "G0 J2:-300",
+        "M800 S0",
+        "g1 J1:-50 J2:10",
+        "",
+    ])
+    assert records == [
+        TrajectoryRecord({1: 100}, 2000, 0, True),
+        TrajectoryRecord({2: -300}, 2000, 5000, True),
+        TrajectoryRecord({1: 50, 2: -290}, 2000, 5000, False),
+    ]
+
+
+@pytest.mark.parametrize(
+    ("lines", "message"),
+    [
+        (["G1 J1:10"], "before its position is known"),
+        (["G0"], "no joints"),
+        (["G0 J7:1"], "invalid joint"),
+        (["G0 J1:abc"], "invalid argument"),
+        (["M17"], "cannot be compiled"),
+    ],
+)
+def test_compile_gcode_errors(lines, message):
+    with pytest.raises(ValueError, match=message):
+        trajectory.compile_gcode(lines)